@@ -0,0 +1,83 @@
+#!/usr/bin/env python
+
+"""
+Compare Steiner point placement strategies (the U switch) for quality
+meshing: number of points, number of triangles and run time.
+
+usage: python bench/offcenter.py [repeat]
+"""
+
+import math
+import random
+import sys
+import time
+
+import triangulate
+
+
+def square_with_holes(n=40, holes=3):
+    """Unit square with a row of polygonal holes."""
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.)]
+    segs = [(0, 1), (1, 2), (2, 3), (3, 0)]
+    hls = []
+    for h in range(holes):
+        xc, yc, r = (h + 1.)/(holes + 1.), 0.5, 0.1
+        i0 = len(pts)
+        for i in range(n):
+            t = 2*math.pi*i/n
+            pts.append((xc + r*math.cos(t), yc + r*math.sin(t)))
+            segs.append((i0 + i, i0 + (i + 1) % n))
+        hls.append((xc, yc))
+    return pts, segs, hls
+
+
+def spiral(n=200):
+    """A thin spiral channel, many small angles between segments."""
+    pts, segs = [], []
+    for i in range(n):
+        t = 6*math.pi*i/n
+        r = 0.1 + 0.8*i/n
+        pts.append((r*math.cos(t), r*math.sin(t)))
+    for i in range(n - 1):
+        segs.append((i, i + 1))
+    return pts, segs, []
+
+
+def cloud(n=2000, seed=1):
+    """Random points, meshed within their convex hull."""
+    rnd = random.Random(seed)
+    pts = [(rnd.random(), rnd.random()) for i in range(n)]
+    return pts, [], []
+
+
+def run(case, mode, repeat):
+    pts, segs, hls = case
+    best = float('inf')
+    for r in range(repeat):
+        h_in = triangulate.new()
+        h_out = triangulate.new()
+        h_vor = triangulate.new()
+        triangulate.set_points(h_in, pts, [0 for p in pts])
+        triangulate.set_segments(h_in, segs, [1 for s in segs])
+        triangulate.set_holes(h_in, hls)
+        tic = time.perf_counter()
+        triangulate.triangulate(mode, h_in, h_out, h_vor)
+        best = min(best, time.perf_counter() - tic)
+    return (triangulate.get_num_points(h_out),
+            triangulate.get_num_triangles(h_out), best)
+
+
+if __name__ == '__main__':
+    repeat = int(sys.argv[1]) if len(sys.argv) > 1 else 3
+    cases = [('holes', square_with_holes(), 'pz'),
+             ('spiral', spiral(), 'pcz'),
+             ('cloud', cloud(), 'z')]
+    print('%-8s %-4s %-4s %9s %9s %10s' % ('case', 'q', 'U', 'points',
+                                            'triangles', 'ms'))
+    for name, case, base in cases:
+        for q in (30, 31, 32, 33):
+            for u in (0, 1, 2):
+                mode = '%sq%dU%dQ' % (base, q, u)
+                npts, ntri, dt = run(case, mode, repeat)
+                print('%-8s %-4d %-4d %9d %9d %10.2f' % (name, q, u, npts,
+                                                         ntri, 1000*dt))
@@ -0,0 +1,38 @@
+#!/usr/bin/env python
+
+"""
+Time the output stage of triangulate: writing the vertices, triangles,
+edges and neighbors of the mesh to arrays (see triangulate.get_stats).
+
+usage: python bench/output.py [number of points] [repeat]
+"""
+
+import random
+import sys
+
+import triangulate
+
+
+def run(pts, mode, repeat):
+    best = float('inf')
+    for r in range(repeat):
+        h_in = triangulate.new()
+        h_out = triangulate.new()
+        h_vor = triangulate.new()
+        triangulate.set_points(h_in, pts, [0 for p in pts])
+        triangulate.triangulate(mode, h_in, h_out, h_vor)
+        best = min(best, triangulate.get_stats(h_out)['output_ms'])
+        del h_in, h_out, h_vor
+    return best
+
+
+if __name__ == '__main__':
+    npts = int(sys.argv[1]) if len(sys.argv) > 1 else 1000000
+    repeat = int(sys.argv[2]) if len(sys.argv) > 2 else 3
+    rnd = random.Random(1)
+    pts = [(rnd.random(), rnd.random()) for i in range(npts)]
+    print('%d points' % npts)
+    print('%-6s %10s' % ('mode', 'output ms'))
+    for switches in ('', 'e', 'n', 'en', 'enK'):
+        print('%-6s %10.1f' % ('-' + switches, run(pts, 'z%sQ' % switches,
+                                                    repeat)))
@@ -0,0 +1,411 @@
+#!/usr/bin/env python
+
+"""
+Benchmark suite of the triangulation pipeline, with baselines to catch
+performance regressions. Every case runs in its own process, on synthetic
+inputs, and records the wall time, the time of each phase, the peak
+resident memory and the number of geometric predicates evaluated, in
+total and past the fast floating-point filter (see triangulate.get_stats).
+
+usage: python bench/suite.py [--scale S] [--repeat R] [--cases c1,c2,..]
+                             [--save baseline.json]
+                             [--compare baseline.json [--threshold T]]
+
+--scale multiplies the size of every case (e.g. 0.1 for a quick run),
+--compare exits with status 1 if a case is slower, bigger or evaluates
+more predicates than the baseline by more than T (default 0.2, i.e. 20%).
+"""
+
+import argparse
+import array
+import json
+import math
+import random
+import resource
+import subprocess
+import sys
+import time
+
+import triangulate
+import triangle
+
+
+def uniform(n, seed=1):
+    """Uniform random points in the unit square."""
+    rnd = random.Random(seed)
+    return [(rnd.random(), rnd.random()) for i in range(n)]
+
+
+def clustered(n, clusters=20, seed=1):
+    """Points in tight Gaussian clusters, a hard case for the divide and
+    conquer cuts."""
+    rnd = random.Random(seed)
+    centers = [(rnd.random(), rnd.random()) for i in range(clusters)]
+    pts = []
+    for i in range(n):
+        xc, yc = centers[i % clusters]
+        pts.append((rnd.gauss(xc, 0.01), rnd.gauss(yc, 0.01)))
+    return pts
+
+
+def kuzmin(n, seed=1):
+    """Kuzmin disk distribution: density falling off as r^-3, very dense
+    in the center."""
+    rnd = random.Random(seed)
+    pts = []
+    for i in range(n):
+        u = rnd.random()
+        r = math.sqrt(1./(1. - u)**2 - 1.)
+        t = 2*math.pi*rnd.random()
+        pts.append((r*math.cos(t), r*math.sin(t)))
+    return pts
+
+
+def holes(rows, n=8):
+    """Unit square with rows x rows polygonal holes of n sides."""
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.)]
+    segs = [(0, 1), (1, 2), (2, 3), (3, 0)]
+    hls = []
+    h = 1./rows
+    for i in range(rows):
+        for j in range(rows):
+            xc, yc, r = (i + 0.5)*h, (j + 0.5)*h, 0.3*h
+            i0 = len(pts)
+            for k in range(n):
+                t = 2*math.pi*k/n
+                pts.append((xc + r*math.cos(t), yc + r*math.sin(t)))
+                segs.append((i0 + k, i0 + (k + 1) % n))
+            hls.append((xc, yc))
+    return pts, segs, hls
+
+
+def polygons(n, seed=1):
+    """n small star shaped polygons of 10 to 60 sides, in the compressed
+    sparse row form of triangle.triangulate_many."""
+    rnd = random.Random(seed)
+    pts, offsets, segs, seg_offsets = array.array('d'), [0], array.array('i'), [0]
+    for i in range(n):
+        m = rnd.randint(10, 60)
+        xc, yc = rnd.random(), rnd.random()
+        for k in range(m):
+            r, t = 1.e-3*(1. + rnd.random()), 2*math.pi*k/m
+            pts.extend((xc + r*math.cos(t), yc + r*math.sin(t)))
+            segs.extend((k, (k + 1) % m))
+        offsets.append(offsets[-1] + m)
+        seg_offsets.append(seg_offsets[-1] + m)
+    return pts, offsets, segs, seg_offsets
+
+
+def _result(stats, wall, npoints, ntriangles):
+    """The result of a case: the statistics of triangulate.get_stats (if
+    any), the wall clock time in ms and the size of the mesh."""
+    res = dict(stats or {})
+    res['wall_ms'] = 1000*wall
+    res['points'] = npoints
+    res['triangles'] = ntriangles
+    return res
+
+
+def run_handles(mode, pts, segs=[], hls=[], reuse=False):
+    """Triangulate with the low level interface, return the timings. With
+    reuse, the output takes the input points over if none is added."""
+    h_in = triangulate.new()
+    h_out = triangulate.new()
+    h_vor = triangulate.new()
+    triangulate.set_points(h_in, pts, [0 for p in pts])
+    if segs:
+        triangulate.set_segments(h_in, segs, [1 for s in segs])
+    if hls:
+        triangulate.set_holes(h_in, hls)
+    tic = time.perf_counter()
+    triangulate.triangulate(mode, h_in, h_out, h_vor, reuse)
+    wall = time.perf_counter() - tic
+    return _result(triangulate.get_stats(h_out), wall,
+                   triangulate.get_num_points(h_out), triangulate.get_num_triangles(h_out))
+
+
+def case_delaunay(gen, n, reuse=False):
+    return lambda scale: run_handles('zQ', gen(max(3, int(n*scale))), reuse=reuse)
+
+
+def case_stream(n, chunk=65536):
+    """Delaunay triangulation of uniform points appended in chunks with
+    triangulate.stream_points, never held in a list."""
+    def run(scale):
+        m = max(3, int(n*scale))
+        rnd = random.Random(1)
+        h_in = triangulate.new()
+        h_out = triangulate.new()
+        h_vor = triangulate.new()
+        tic = time.perf_counter()
+        for i in range(0, m, chunk):
+            xy = array.array('d', [rnd.random() for k in range(2*min(chunk, m - i))])
+            triangulate.stream_points(h_in, xy, None, None, m)
+        triangulate.triangulate('zQ', h_in, h_out, h_vor)
+        wall = time.perf_counter() - tic
+        return _result(triangulate.get_stats(h_out), wall,
+                       triangulate.get_num_points(h_out), triangulate.get_num_triangles(h_out))
+    return run
+
+
+def case_stream_delaunay(n, cols=64):
+    """Delaunay triangulation of uniform points generated column by column
+    with triangle.stream_delaunay, only the open columns held at once."""
+    class Sink:
+        def write(self, data):
+            pass
+
+    def run(scale):
+        m = max(3*cols, int(n*scale))
+        rnd = random.Random(1)
+
+        def chunks():
+            for i in range(cols):
+                xy = array.array('d')
+                for k in range(m//cols):
+                    xy.append((i + rnd.random())/cols)
+                    xy.append(rnd.random())
+                yield xy, [(i - 1, 0)] if i > 0 else []
+
+        tic = time.perf_counter()
+        npts, ntri, active = triangle.stream_delaunay(
+            chunks(), (0., 0., 1./cols, 1., cols, 1), Sink())
+        wall = time.perf_counter() - tic
+        return _result(None, wall, npts, ntri)
+    return run
+
+
+def case_steps(n, steps, recycle=True):
+    """Delaunay triangulations of moving points, one per time step, into the
+    same output handle, whose arrays are recycled unless recycle is False."""
+    def run(scale):
+        pts = uniform(max(3, int(n*scale)))
+        h_in = triangulate.new()
+        h_out = triangulate.new()
+        h_vor = triangulate.new()
+        wall = 0.
+        for step in range(steps):
+            moved = [(x + 1.e-3*math.sin(step + 7*y),
+                      y + 1.e-3*math.cos(step + 7*x)) for x, y in pts]
+            triangulate.set_points(h_in, moved, [0 for p in moved])
+            tic = time.perf_counter()
+            triangulate.triangulate('zenQ', h_in, h_out, h_vor, False, recycle)
+            wall += time.perf_counter() - tic
+        return _result(triangulate.get_stats(h_out), wall,
+                       triangulate.get_num_points(h_out), triangulate.get_num_triangles(h_out))
+    return run
+
+
+def case_pslg(rows, mode, area=None):
+    def run(scale):
+        pts, segs, hls = holes(max(1, int(rows*math.sqrt(scale))))
+        if area:
+            return run_handles(mode + 'a%g' % (area/scale), pts, segs, hls)
+        return run_handles(mode, pts, segs, hls)
+    return run
+
+
+def case_tiles(rows, area, tiles):
+    """The quality mesh of case_pslg meshed tile by tile and stitched with
+    triangle.triangulate_tiles (concurrently in the OpenMP build)."""
+    def run(scale):
+        pts, segs, hls = holes(max(1, int(rows*math.sqrt(scale))))
+        tic = time.perf_counter()
+        xy, tris, tile_of = triangle.triangulate_tiles(
+            [c for p in pts for c in p], [k for s in segs for k in s],
+            [c for h in hls for c in h], tiles=tiles, area=area/scale,
+            mode='pzq30Q')
+        wall = time.perf_counter() - tic
+        return _result(None, wall, len(xy)//2, len(tile_of))
+    return run
+
+
+def case_utm(rows, mode, area):
+    """The PSLG of case_pslg, 1 km across in UTM like coordinates."""
+    def run(scale):
+        pts, segs, hls = holes(max(1, int(rows*math.sqrt(scale))))
+        x0, y0, size = 512345.678, 5123456.789, 1000.
+        pts = [(x0 + size*x, y0 + size*y) for x, y in pts]
+        hls = [(x0 + size*x, y0 + size*y) for x, y in hls]
+        return run_handles(mode + 'a%g' % (area/scale), pts, segs, hls)
+    return run
+
+
+def case_refine(rows, steps):
+    """A chain of refinements through Triangle.refine()."""
+    def run(scale):
+        pts, segs, hls = holes(max(1, int(rows*math.sqrt(scale))))
+        t = triangle.Triangle()
+        t.set_points(pts, [1 for p in pts])
+        t.set_segments(segs)
+        t.set_holes(hls)
+        tic = time.perf_counter()
+        t.triangulate(area=0.5/len(pts), mode='pzq30eQ')
+        for i in range(steps):
+            t.refine(area_ratio=2.0)
+        wall = time.perf_counter() - tic
+        return _result(t.get_stats(), wall,
+                       t.get_num_points(), t.get_num_triangles())
+    return run
+
+
+def case_binding(n):
+    """Overhead of converting the output to Python objects."""
+    def run(scale):
+        t = triangle.Triangle()
+        pts = uniform(max(3, int(n*scale)))
+        t.set_points(pts, [0 for p in pts])
+        t.triangulate(mode='zQ')
+        tic = time.perf_counter()
+        tris = t.get_triangles()
+        wall = time.perf_counter() - tic
+        return _result(t.get_stats(), wall,
+                       t.get_num_points(), len(tris))
+    return run
+
+
+def case_voronoi(n):
+    """Voronoi cells of a Delaunay triangulation, clipped to the box."""
+    def run(scale):
+        t = triangle.Triangle()
+        pts = uniform(max(3, int(n*scale)))
+        t.set_points(pts, [0 for p in pts])
+        t.triangulate(mode='zQ')
+        tic = time.perf_counter()
+        t.get_voronoi_cells(clip=True)
+        wall = time.perf_counter() - tic
+        return _result(t.get_stats(), wall,
+                       t.get_num_points(), t.get_num_triangles())
+    return run
+
+
+def case_many(n):
+    """A batch of small polygons triangulated in one call."""
+    def run(scale):
+        pts, offsets, segs, seg_offsets = polygons(max(1, int(n*scale)))
+        tic = time.perf_counter()
+        xy, point_offsets, tris, tri_offsets = \
+            triangle.triangulate_many(pts, offsets, segs, seg_offsets, mode='pQ')
+        wall = time.perf_counter() - tic
+        return _result(None, wall, point_offsets[-1], tri_offsets[-1])
+    return run
+
+
+CASES = [('uniform', case_delaunay(uniform, 400000)),
+         ('clustered', case_delaunay(clustered, 400000)),
+         ('kuzmin', case_delaunay(kuzmin, 400000)),
+         ('reuse', case_delaunay(uniform, 400000, reuse=True)),
+         ('stream', case_stream(400000)),
+         ('stream_delaunay', case_stream_delaunay(400000)),
+         ('steps', case_steps(100000, 8)),
+         ('steps_alloc', case_steps(100000, 8, recycle=False)),
+         ('holes', case_pslg(60, 'pzQ')),
+         ('q20', case_pslg(30, 'pzq20Q', 2.e-5)),
+         ('q30', case_pslg(30, 'pzq30Q', 2.e-5)),
+         ('q33', case_pslg(30, 'pzq33Q', 2.e-5)),
+         ('tiles', case_tiles(30, 2.e-5, 8)),
+         ('utm', case_utm(30, 'pzq30Q', 20.)),
+         ('utm_T', case_utm(30, 'pzq30QT', 20.)),
+         ('refine', case_refine(10, 4)),
+         ('get_triangles', case_binding(200000)),
+         ('voronoi', case_voronoi(400000)),
+         ('many', case_many(20000))]
+
+# name, relative noise tolerated on top of the threshold
+TIMED = [('wall_ms', 1.), ('total_ms', 1.), ('max_rss_kb', 0.)]
+COUNTED = ['incircle_tests', 'orient2d_tests', 'incircle_adapt',
+           'orient2d_adapt', 'triangles']
+
+
+def run_case(name, scale, repeat):
+    """Run a case in this process, keep the fastest of the repeats."""
+    func = dict(CASES)[name]
+    best = None
+    for r in range(repeat):
+        res = func(scale)
+        if best is None or res['wall_ms'] < best['wall_ms']:
+            best = res
+    best['max_rss_kb'] = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return best
+
+
+def spawn(name, scale, repeat):
+    """Run a case in a fresh process, so that its peak memory is its own."""
+    out = subprocess.run([sys.executable, __file__, '--run', name,
+                          '--scale', str(scale), '--repeat', str(repeat)],
+                         check=True, stdout=subprocess.PIPE)
+    return json.loads(out.stdout.decode())
+
+
+def compare(results, baseline, threshold):
+    """Return the list of regressions of results with respect to baseline."""
+    bad = []
+    for name, res in results.items():
+        if name not in baseline:
+            continue
+        ref = baseline[name]
+        for key, noise in TIMED:
+            if key in res and key in ref and ref[key] > 0 and \
+               res[key] > ref[key]*(1. + threshold*(1. + noise)):
+                bad.append((name, key, ref[key], res[key]))
+        for key in COUNTED:
+            if key in res and key in ref and ref[key] > 0 and \
+               res[key] > ref[key]*(1. + threshold):
+                bad.append((name, key, ref[key], res[key]))
+    return bad
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    parser.add_argument('--scale', type=float, default=1.)
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('--cases', default=','.join([c[0] for c in CASES]))
+    parser.add_argument('--save')
+    parser.add_argument('--compare')
+    parser.add_argument('--threshold', type=float, default=0.2)
+    parser.add_argument('--run', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.run:
+        json.dump(run_case(args.run, args.scale, args.repeat), sys.stdout)
+        return 0
+
+    results = {}
+    print('%-14s %9s %9s %9s %9s %9s %9s %12s' % ('case', 'points',
+                                                   'triangles', 'wall ms',
+                                                   'delaunay', 'quality',
+                                                   'adapt', 'rss kB'))
+    for name in args.cases.split(','):
+        res = spawn(name, args.scale, args.repeat)
+        res['scale'] = args.scale
+        results[name] = res
+        print('%-14s %9d %9d %9.1f %9.1f %9.1f %9d %12d' % (name,
+              res['points'], res['triangles'], res['wall_ms'],
+              res.get('delaunay_ms', 0.), res.get('quality_ms', 0.),
+              res.get('incircle_adapt', 0) + res.get('orient2d_adapt', 0),
+              res['max_rss_kb']))
+
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(results, f, indent=1, sort_keys=True)
+
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)
+        for name in results:
+            if name in baseline and baseline[name].get('scale') != args.scale:
+                print('%s: baseline scale %s differs, not compared' \
+                      % (name, baseline[name].get('scale')))
+                del baseline[name]
+        bad = compare(results, baseline, args.threshold)
+        for name, key, ref, val in bad:
+            print('REGRESSION %s %s: %g -> %g (%+.0f%%)' \
+                  % (name, key, ref, val, 100.*(val - ref)/ref))
+        if bad:
+            return 1
+        print('no regression beyond %.0f%%' % (100*args.threshold))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -12,6 +12,7 @@ python setup.py register
 python setup.py sdist upload -r pypi
 """
 
+import os
 import sys
 import re
 
@@ -34,6 +35,20 @@ with open(f"{PACKAGE}/__init__.py.in") as fi:
 
 from setuptools import setup, Extension
 
+# set TRIANGLE_OPENMP=1 to write the output arrays of large meshes with
+# several threads (OpenMP)
+extra_compile_args = []
+extra_link_args = []
+if os.environ.get("TRIANGLE_OPENMP", "0") not in ("", "0"):
+    extra_compile_args.append("-fopenmp")
+    extra_link_args.append("-fopenmp")
+
+# set TRIANGLE_SINGLE=1 to store coordinates and attributes as float, which
+# halves the memory of the points (the predicates remain exact)
+define_macros = [("TRILIBRARY",1), ("NO_TIMER",1)]
+if os.environ.get("TRIANGLE_SINGLE", "0") not in ("", "0"):
+    define_macros.append(("SINGLE",1))
+
 setup (name = "pytriangle",
        version = "2.4",
        description='A 2D triangulation program originally written by Jonathan Richard Shewchuck',
@@ -44,9 +59,10 @@ setup (name = "pytriangle",
        ext_modules = [Extension("triangulate", # name of the shared library
                                           ["src/triangle.c", 
                                            "src/trianglemodule.c"],
-                                define_macros=[("TRILIBRARY",1),
-                                               ("NO_TIMER",1)],
+                                define_macros=define_macros,
                                 include_dirs=["code",],
+                                extra_compile_args=extra_compile_args,
+                                extra_link_args=extra_link_args,
                                 ),
                       
                       ]
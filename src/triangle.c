@@ -294,7 +294,7 @@
 #define TRIPERBLOCK 4092           /* Number of triangles allocated at once. */
 #define SUBSEGPERBLOCK 508       /* Number of subsegments allocated at once. */
 #define VERTEXPERBLOCK 4092         /* Number of vertices allocated at once. */
-#define VIRUSPERBLOCK 1020   /* Number of virus triangles allocated at once. */
+#define VIRUSPERBLOCK 1020    /* Initial length of the queue of viri. */
 /* Number of encroached subsegments allocated at once. */
 #define BADSUBSEGPERBLOCK 252
 /* Number of skinny triangles allocated at once. */
@@ -353,6 +353,9 @@
 #ifndef NO_TIMER
 #include <sys/time.h>
 #endif /* not NO_TIMER */
+#ifdef TRILIBRARY
+#include <time.h>
+#endif /* TRILIBRARY */
 #ifdef CPU86
 #include <float.h>
 #endif /* CPU86 */
@@ -606,6 +609,34 @@ struct splaynode {
   struct splaynode *lchild, *rchild;              /* Children in splay tree. */
 };
 
+/* A hole or region point awaiting point location.  Holes and regions are   */
+/*   located together, after sorting them along a space-filling curve so    */
+/*   that each search can start where the previous one ended.  `region' is  */
+/*   the index of the region in the region list, or -1 for a hole.  The     */
+/*   triangle that contains the point is returned in `location' (or         */
+/*   `dummytri' if the point lies outside the mesh).                        */
+
+struct seedpoint {
+  REAL *point;                         /* Coordinates of the seed point. */
+  unsigned long key;            /* Position along the space-filling curve. */
+  int region;                        /* Region index, or -1 for a hole. */
+  struct otri location;          /* Triangle in which the point falls. */
+};
+
+/* A block of the triangle pool, as seen by the output routines.  `items' is */
+/*   the number of items traverse() visits in the block, live or dead, and   */
+/*   `offset' and `edgeoffset' are the numbers of live triangles and of      */
+/*   edges in the blocks before it.  The blocks can thus be written          */
+/*   independently (and concurrently, when compiled with OpenMP) at the      */
+/*   place a serial traversal would put them.                                */
+
+struct triblock {
+  triangle *firsttri;                /* First item of the block. */
+  int items;                  /* Items traversed in the block. */
+  long offset;    /* Live triangles in the preceding blocks. */
+  long edgeoffset;          /* Edges in the preceding blocks. */
+};
+
 /* A type used to allocate memory.  firstblock is the first block of items.  */
 /*   nowblock is the block from which items are currently being allocated.   */
 /*   nextitem points to the next slab of free memory for an item.            */
@@ -657,6 +688,10 @@ REAL o3derrboundA, o3derrboundB, o3derrboundC;
 /* Random number seed is not constant, but I've made it global anyway.       */
 
 unsigned long randomseed;                     /* Current random number seed. */
+#ifdef _OPENMP
+/* The threads of triangulatemany() draw their own random numbers.           */
+#pragma omp threadprivate(randomseed)
+#endif /* _OPENMP */
 
 
 /* Mesh data structure.  Triangle operates on only one mesh, but the mesh    */
@@ -665,13 +700,12 @@ unsigned long randomseed;                     /* Current random number seed. */
 struct mesh {
 
 /* Variables used to allocate memory for triangles, subsegments, vertices,   */
-/*   viri (triangles being eaten), encroached segments, bad (skinny or too   */
-/*   large) triangles, and splay tree nodes.                                 */
+/*   encroached segments, bad (skinny or too large) triangles, and splay     */
+/*   tree nodes.                                                             */
 
   struct memorypool triangles;
   struct memorypool subsegs;
   struct memorypool vertices;
-  struct memorypool viri;
   struct memorypool badsubsegs;
   struct memorypool badtriangles;
   struct memorypool flipstackers;
@@ -689,6 +723,16 @@ struct mesh {
 
   struct flipstacker *lastflip;
 
+/* Variables that maintain the queue of viri (triangles being eaten, or      */
+/*   being painted with regional attributes).  The queue is an array that    */
+/*   grows as needed; triangles are appended as they are infected and are    */
+/*   visited in the same order, so the virus spreads breadth-first.          */
+
+  triangle **viri;
+  long virusitems;                     /* Number of triangles in the queue. */
+  long virusspace;              /* Number of triangles the array can hold. */
+  long maxviri;                   /* Largest number of viri queued at once. */
+
 /* Other variables. */
 
   REAL xmin, xmax, ymin, ymax;                            /* x and y bounds. */
@@ -715,12 +759,20 @@ struct mesh {
   int readnodefile;                           /* Has a .node file been read? */
   long samples;              /* Number of random samples for point location. */
 
+  REAL xorigin, yorigin;  /* The input is translated by (-xorigin, -yorigin) */
+  REAL scale, invscale;   /*   and then scaled by `scale' (-T switch).       */
+
   long incirclecount;                 /* Number of incircle tests performed. */
   long counterclockcount;     /* Number of counterclockwise tests performed. */
   long orient3dcount;           /* Number of 3D orientation tests performed. */
+  long incircleadaptcount;      /* Incircle tests past the fast error bound. */
+  long counterclockadaptcount;     /* Orientation tests past the fast bound. */
+  long orient3dadaptcount;      /* 3D orientation tests past the fast bound. */
   long hyperbolacount;      /* Number of right-of-hyperbola tests performed. */
   long circumcentercount;  /* Number of circumcenter calculations performed. */
   long circletopcount;       /* Number of circle top calculations performed. */
+  long segmentsteiners;        /* Number of Steiner points put on segments. */
+  long trianglesteiners;    /* Number of Steiner points put inside the mesh. */
 
 /* Triangular bounding box vertices.                                         */
 
@@ -757,11 +809,17 @@ struct behavior {
 /*     minangle: minimum angle bound, specified after -q switch.             */
 /*     goodangle: cosine squared of minangle.                                */
 /*     offconstant: constant used to place off-center Steiner points.        */
+/*     offcenters: Steiner point placement, specified after -U switch.       */
+/*       0 = circumcenters, 1 = damped off-centers (default), 2 = Ungor's    */
+/*       off-centers.                                                        */
 /*   vararea: -a switch without number.                                      */
 /*   fixedarea: -a switch with number.                                       */
 /*     maxarea: maximum area bound, specified after -a switch.               */
 /*   usertest: -u switch.                                                    */
-/*   regionattrib: -A switch.  convex: -c switch.                            */
+/*   levels: number of additional refinement levels, specified after -L     */
+/*     switch.                                                               */
+/*   regionattrib: -A switch.  segmentregions: -R switch.                    */
+/*   convex: -c switch.                                                      */
 /*   weighted: 1 for -w switch, 2 for -W switch.  jettison: -j switch        */
 /*   firstnumber: inverse of -z switch.  All items are numbered starting     */
 /*     from `firstnumber'.                                                   */
@@ -770,7 +828,8 @@ struct behavior {
 /*   nobound: -B switch.  nopolywritten: -P switch.                          */
 /*   nonodewritten: -N switch.  noelewritten: -E switch.                     */
 /*   noiterationnum: -I switch.  noholes: -O switch.                         */
-/*   noexact: -X switch.                                                     */
+/*   noexact: -X switch.  translate: -T switch.                              */
+/*   keepmesh: -K switch (library only).                                     */
 /*   order: element order, specified after -o switch.                        */
 /*   nobisect: count of how often -Y switch is selected.                     */
 /*   steiner: maximum number of Steiner points, specified after -S switch.   */
@@ -785,11 +844,14 @@ struct behavior {
 /* Read the instructions to find out the meaning of these switches.          */
 
   int poly, refine, quality, vararea, fixedarea, usertest;
-  int regionattrib, convex, weighted, jettison;
+  int levels;
+  int regionattrib, segmentregions, convex, weighted, jettison;
   int firstnumber;
   int edgesout, voronoi, neighbors, geomview;
   int nobound, nopolywritten, nonodewritten, noelewritten, noiterationnum;
   int noholes, noexact, conformdel;
+  int translate;
+  int keepmesh;
   int incremental, sweepline, dwyer;
   int splitseg;
   int docheck;
@@ -798,6 +860,7 @@ struct behavior {
   int order;
   int nobisect;
   int steiner;
+  int offcenters;
   REAL minangle, goodangle, offconstant;
   REAL maxarea;
 
@@ -820,6 +883,21 @@ struct behavior {
 
 };                                              /* End of `struct behavior'. */
 
+/* A finished mesh kept past triangulate() by the -K switch, so that the     */
+/*   edges and the neighbors are only written when they are asked for (see   */
+/*   trimeshoutput()).  `deferedges' and `deferneighbors' are set while the  */
+/*   -e and -n outputs are still to be written.                              */
+
+#ifdef TRILIBRARY
+
+struct trimesh {
+  struct mesh m;
+  struct behavior b;
+  int deferedges, deferneighbors;
+};
+
+#endif /* TRILIBRARY */
+
 
 /*****************************************************************************/
 /*                                                                           */
@@ -1442,6 +1520,31 @@ int size;
   return(memptr);
 }
 
+/* trimallocarray() allocates `count' items of `size' bytes, for arrays   */
+/*   that may grow past what the int argument of trimalloc() can express. */
+
+#ifdef ANSI_DECLARATORS
+VOID *trimallocarray(size_t count, size_t size)
+#else /* not ANSI_DECLARATORS */
+VOID *trimallocarray(count, size)
+size_t count;
+size_t size;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  VOID *memptr;
+
+  memptr = (VOID *) NULL;
+  if ((size == 0) || (count <= ((size_t) -1) / size)) {
+    memptr = (VOID *) malloc(count * size);
+  }
+  if (memptr == (VOID *) NULL) {
+    printf("Error:  Out of memory.\n");
+    triexit(1);
+  }
+  return(memptr);
+}
+
 #ifdef ANSI_DECLARATORS
 void trifree(VOID *memptr)
 #else /* not ANSI_DECLARATORS */
@@ -1473,15 +1576,16 @@ void syntax()
 {
 #ifdef CDT_ONLY
 #ifdef REDUCED
-  printf("triangle [-pAcjevngBPNEIOXzo_lQVh] input_file\n");
+  printf("triangle [-pARcjevngBPNEIOXTzo_lQVh] input_file\n");
 #else /* not REDUCED */
-  printf("triangle [-pAcjevngBPNEIOXzo_iFlCQVh] input_file\n");
+  printf("triangle [-pARcjevngBPNEIOXTzo_iFlCQVh] input_file\n");
 #endif /* not REDUCED */
 #else /* not CDT_ONLY */
 #ifdef REDUCED
-  printf("triangle [-prq__a__uAcDjevngBPNEIOXzo_YS__lQVh] input_file\n");
+  printf("triangle [-prq__a__uL_ARcDjevngBPNEIOXTzo_YS__U_lQVh] input_file\n");
 #else /* not REDUCED */
-  printf("triangle [-prq__a__uAcDjevngBPNEIOXzo_YS__iFlsCQVh] input_file\n");
+  printf(
+    "triangle [-prq__a__uL_ARcDjevngBPNEIOXTzo_YS__U_iFlsCQVh] input_file\n");
 #endif /* not REDUCED */
 #endif /* not CDT_ONLY */
 
@@ -1492,9 +1596,11 @@ void syntax()
     "    -q  Quality mesh generation.  A minimum angle may be specified.\n");
   printf("    -a  Applies a maximum triangle area constraint.\n");
   printf("    -u  Applies a user-defined triangle constraint.\n");
+  printf("    -L  Refines further levels, halving the area constraints.\n");
 #endif /* not CDT_ONLY */
   printf(
     "    -A  Applies attributes to identify triangles in certain regions.\n");
+  printf("    -R  Numbers the segment-bounded regions of the mesh.\n");
   printf("    -c  Encloses the convex hull with segments.\n");
 #ifndef CDT_ONLY
   printf("    -D  Conforming Delaunay:  all triangles are truly Delaunay.\n");
@@ -1515,11 +1621,13 @@ void syntax()
   printf("    -I  Suppresses mesh iteration numbers.\n");
   printf("    -O  Ignores holes in .poly file.\n");
   printf("    -X  Suppresses use of exact arithmetic.\n");
+  printf("    -T  Translates and scales the input near the origin.\n");
   printf("    -z  Numbers all items starting from zero (rather than one).\n");
   printf("    -o2 Generates second-order subparametric elements.\n");
 #ifndef CDT_ONLY
   printf("    -Y  Suppresses boundary segment splitting.\n");
   printf("    -S  Specifies maximum number of added Steiner points.\n");
+  printf("    -U  Selects where Steiner points are placed (-U0, -U1, -U2).\n");
 #endif /* not CDT_ONLY */
 #ifndef REDUCED
   printf("    -i  Uses incremental method, rather than divide-and-conquer.\n");
@@ -1584,7 +1692,8 @@ void info()
   printf(
 "Delaunay triangulation is returned in .node and .ele output files.  The\n");
   printf("command syntax is:\n\n");
-  printf("triangle [-prq__a__uAcDjevngBPNEIOXzo_YS__iFlsCQVh] input_file\n\n");
+  printf(
+  "triangle [-prq__a__uL_ARcDjevngBPNEIOXTzo_YS__U_iFlsCQVh] input_file\n\n");
   printf(
 "Underscores indicate that numbers may optionally follow certain switches.\n");
   printf(
@@ -1707,6 +1816,26 @@ void info()
 "        triunsuitable().  In either case, the -u switch causes the user-\n");
   printf("        defined test to be applied to every triangle.\n");
   printf(
+"    -L  Refines the mesh through a sequence of levels.  A number after\n");
+  printf(
+"        the L gives the number of levels to add (default 1).  After the\n");
+  printf(
+"        mesh meets its constraints, every area constraint (-a) is halved\n"
+);
+  printf(
+"        and the same mesh is refined again, once per level.  Vertices are\n"
+);
+  printf(
+"        only added, so the vertices of each coarser level are a prefix of\n"
+);
+  printf(
+"        the output vertices.  The library records the number of vertices\n"
+);
+  printf(
+"        and the triangles of each coarser level; the program writes only\n"
+);
+  printf("        the finest level.\n");
+  printf(
 "    -A  Assigns an additional floating-point attribute to each triangle\n");
   printf(
 "        that identifies what segment-bounded region each triangle belongs\n");
@@ -1720,6 +1849,27 @@ void info()
 "        an effect only when the -p switch is used and the -r switch is not.\n"
 );
   printf(
+"    -R  Assigns an additional floating-point attribute to each triangle\n");
+  printf(
+"        that numbers the segment-bounded region it belongs to.  Regions\n");
+  printf(
+"        are found without the help of region points:  every connected set\n"
+);
+  printf(
+"        of triangles not separated by segments is numbered 1, 2, 3, ... in\n"
+);
+  printf(
+"        turn.  If the -a switch is used without a number, each region also\n"
+);
+  printf(
+"        receives the smallest area constraint listed (in the library's\n");
+  printf(
+"        `markerarealist') for the markers of the segments that bound it.\n"
+);
+  printf(
+"        The -R switch has an effect only when the -p switch is used and\n");
+  printf("        the -r switch is not.\n");
+  printf(
 "    -c  Creates segments on the convex hull of the triangulation.  If you\n");
   printf(
 "        are triangulating a vertex set, this switch causes a .poly file to\n"
@@ -1850,6 +2000,24 @@ void info()
 );
   printf("        fail to produce a valid mesh.  Not recommended.\n");
   printf(
+"    -T  Translates the input vertices so their bounding box is centered\n");
+  printf(
+"        near the origin, and scales them by a power of two so it is about\n"
+);
+  printf(
+"        one unit across, before meshing.  The output vertices are mapped\n");
+  printf(
+"        back, the input vertices exactly.  Far from the origin (as in UTM\n");
+  printf(
+"        coordinates), Steiner points are rounded to the few bits that the\n"
+);
+  printf(
+"        coordinates do not share; near it they keep full precision.  The\n");
+  printf(
+"        switch is ignored if a vertex cannot be translated exactly.  The\n");
+  printf(
+"        statistics printed by -V are in translated units.\n");
+  printf(
 "    -z  Numbers all items starting from zero (rather than one).  Note that\n"
 );
   printf(
@@ -1879,6 +2047,20 @@ void info()
 "        (`-YY') to prevent all segment splitting, including internal\n");
   printf("        boundaries.\n");
   printf(
+"    -U  Selects how Steiner points are placed in skinny triangles.  -U0\n");
+  printf(
+"        inserts circumcenters only.  -U1 (the default) inserts off-centers\n"
+);
+  printf(
+"        slightly closer to the shortest edge than Ungor's, leaving a margin\n"
+);
+  printf(
+"        against roundoff.  -U2 (or -U alone) inserts Ungor's off-centers,\n");
+  printf(
+"        which form an angle just above the -q bound with the shortest\n");
+  printf(
+"        edge and often meet it with fewer Steiner points.\n");
+  printf(
 "    -S  Specifies the maximum number of Steiner points (vertices that are\n");
   printf(
 "        not in the input, but are added to meet the constraints on minimum\n"
@@ -3307,12 +3489,16 @@ struct behavior *b;
 
   b->poly = b->refine = b->quality = 0;
   b->vararea = b->fixedarea = b->usertest = 0;
-  b->regionattrib = b->convex = b->weighted = b->jettison = 0;
+  b->levels = 0;
+  b->regionattrib = b->segmentregions = 0;
+  b->convex = b->weighted = b->jettison = 0;
   b->firstnumber = 1;
   b->edgesout = b->voronoi = b->neighbors = b->geomview = 0;
   b->nobound = b->nopolywritten = b->nonodewritten = b->noelewritten = 0;
   b->noiterationnum = 0;
   b->noholes = b->noexact = 0;
+  b->translate = 0;
+  b->keepmesh = 0;
   b->incremental = b->sweepline = 0;
   b->dwyer = 1;
   b->splitseg = 0;
@@ -3320,6 +3506,7 @@ struct behavior *b;
   b->nobisect = 0;
   b->conformdel = 0;
   b->steiner = -1;
+  b->offcenters = 1;
   b->order = 1;
   b->minangle = 0.0;
   b->maxarea = -1.0;
@@ -3383,10 +3570,24 @@ struct behavior *b;
           b->quality = 1;
           b->usertest = 1;
         }
+        if (argv[i][j] == 'L') {
+          b->quality = 1;
+          b->levels = 1;
+          if ((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) {
+            b->levels = 0;
+            while ((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '9')) {
+              j++;
+              b->levels = b->levels * 10 + (int) (argv[i][j] - '0');
+            }
+          }
+        }
 #endif /* not CDT_ONLY */
         if (argv[i][j] == 'A') {
           b->regionattrib = 1;
         }
+        if (argv[i][j] == 'R') {
+          b->segmentregions = 1;
+        }
         if (argv[i][j] == 'c') {
           b->convex = 1;
         }
@@ -3437,6 +3638,14 @@ struct behavior *b;
         if (argv[i][j] == 'X') {
           b->noexact = 1;
 	}
+        if (argv[i][j] == 'T') {
+          b->translate = 1;
+	}
+#ifdef TRILIBRARY
+        if (argv[i][j] == 'K') {
+          b->keepmesh = 1;
+        }
+#endif /* TRILIBRARY */
         if (argv[i][j] == 'o') {
           if (argv[i][j + 1] == '2') {
             j++;
@@ -3454,6 +3663,13 @@ struct behavior *b;
             b->steiner = b->steiner * 10 + (int) (argv[i][j] - '0');
           }
         }
+        if (argv[i][j] == 'U') {
+          b->offcenters = 2;
+          if ((argv[i][j + 1] >= '0') && (argv[i][j + 1] <= '2')) {
+            j++;
+            b->offcenters = (int) (argv[i][j] - '0');
+          }
+        }
 #endif /* not CDT_ONLY */
 #ifndef REDUCED
         if (argv[i][j] == 'i') {
@@ -3526,9 +3742,18 @@ struct behavior *b;
 #endif /* not TRILIBRARY */
   b->usesegments = b->poly || b->refine || b->quality || b->convex;
   b->goodangle = cos(b->minangle * PI / 180.0);
-  if (b->goodangle == 1.0) {
+  if ((b->goodangle == 1.0) || (b->offcenters == 0)) {
     b->offconstant = 0.0;
+  } else if (b->offcenters == 2) {
+    /* Ungor's off-centers:  the new vertex forms an angle opposite the    */
+    /*   shortest edge that just exceeds `minangle'.  (Aiming for exactly  */
+    /*   `minangle' is a bad idea:  roundoff makes about half of the new   */
+    /*   triangles fail the quality test, and they are split again.)       */
+    b->offconstant = 0.5 / tan(b->minangle * 1.005 * PI / 360.0);
   } else {
+    /* Damped off-centers, at 0.95 of Ungor's distance from the midpoint   */
+    /*   of the shortest edge:  0.475 / tan(minangle / 2) edge lengths     */
+    /*   instead of 0.5 / tan(minangle / 2), a margin against roundoff.    */
     b->offconstant = 0.475 * sqrt((1.0 + b->goodangle) / (1.0 - b->goodangle));
   }
   b->goodangle *= b->goodangle;
@@ -3546,6 +3771,7 @@ struct behavior *b;
   /*   input supports it (PSLG in, but not refining a preexisting mesh). */
   if (b->refine || !b->poly) {
     b->regionattrib = 0;
+    b->segmentregions = 0;
   }
   /* Regular/weighted triangulations are incompatible with PSLGs */
   /*   and meshing.                                              */
@@ -3916,6 +4142,27 @@ struct memorypool *pool;
   pool->deaditemstack = (VOID *) NULL;
 }
 
+/*****************************************************************************/
+/*                                                                           */
+/*  pooldeinit()   Free to the operating system all memory taken by a pool.  */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void pooldeinit(struct memorypool *pool)
+#else /* not ANSI_DECLARATORS */
+void pooldeinit(pool)
+struct memorypool *pool;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  while (pool->firstblock != (VOID **) NULL) {
+    pool->nowblock = (VOID **) *(pool->firstblock);
+    trifree((VOID *) pool->firstblock);
+    pool->firstblock = pool->nowblock;
+  }
+}
+
 /*****************************************************************************/
 /*                                                                           */
 /*  poolinit()   Initialize a pool of memory for allocation of items.        */
@@ -3931,6 +4178,11 @@ struct memorypool *pool;
 /*  `alignment' is normally used to create a few unused bits at the bottom   */
 /*  of each item's pointer, in which information may be stored.              */
 /*                                                                           */
+/*  If the pool still holds the blocks of a previous mesh (as in             */
+/*  triangulatemany(), which reuses its meshes) and they are blocks of the   */
+/*  same items, at least as large, they are reused instead of being freed    */
+/*  and allocated again.                                                     */
+/*                                                                           */
 /*  Don't change this routine unless you understand it.                      */
 /*                                                                           */
 /*****************************************************************************/
@@ -3948,23 +4200,35 @@ int alignment;
 #endif /* not ANSI_DECLARATORS */
 
 {
+  int alignbytes;
+  int itembytes;
+
   /* Find the proper alignment, which must be at least as large as:   */
   /*   - The parameter `alignment'.                                   */
   /*   - sizeof(VOID *), so the stack of dead items can be maintained */
   /*       without unaligned accesses.                                */
   if (alignment > (int) sizeof(VOID *)) {
-    pool->alignbytes = alignment;
+    alignbytes = alignment;
   } else {
-    pool->alignbytes = sizeof(VOID *);
+    alignbytes = sizeof(VOID *);
   }
-  pool->itembytes = ((bytecount - 1) / pool->alignbytes + 1) *
-                    pool->alignbytes;
-  pool->itemsperblock = itemcount;
+  itembytes = ((bytecount - 1) / alignbytes + 1) * alignbytes;
   if (firstitemcount == 0) {
-    pool->itemsfirstblock = itemcount;
-  } else {
-    pool->itemsfirstblock = firstitemcount;
+    firstitemcount = itemcount;
+  }
+  if (pool->firstblock != (VOID **) NULL) {
+    if ((pool->alignbytes == alignbytes) && (pool->itembytes == itembytes) &&
+        (pool->itemsperblock == itemcount) &&
+        (pool->itemsfirstblock >= firstitemcount)) {
+      poolrestart(pool);
+      return;
+    }
+    pooldeinit(pool);
   }
+  pool->alignbytes = alignbytes;
+  pool->itembytes = itembytes;
+  pool->itemsperblock = itemcount;
+  pool->itemsfirstblock = firstitemcount;
 
   /* Allocate a block of items.  Space for `itemsfirstblock' items and one  */
   /*   pointer (to point to the next block) are allocated, as well as space */
@@ -3977,27 +4241,6 @@ int alignment;
   poolrestart(pool);
 }
 
-/*****************************************************************************/
-/*                                                                           */
-/*  pooldeinit()   Free to the operating system all memory taken by a pool.  */
-/*                                                                           */
-/*****************************************************************************/
-
-#ifdef ANSI_DECLARATORS
-void pooldeinit(struct memorypool *pool)
-#else /* not ANSI_DECLARATORS */
-void pooldeinit(pool)
-struct memorypool *pool;
-#endif /* not ANSI_DECLARATORS */
-
-{
-  while (pool->firstblock != (VOID **) NULL) {
-    pool->nowblock = (VOID **) *(pool->firstblock);
-    trifree((VOID *) pool->firstblock);
-    pool->firstblock = pool->nowblock;
-  }
-}
-
 /*****************************************************************************/
 /*                                                                           */
 /*  poolalloc()   Allocate space for an item.                                */
@@ -4338,13 +4581,15 @@ struct behavior *b;
   m->elemattribindex = (trisize + sizeof(REAL) - 1) / sizeof(REAL);
   /* The index within each triangle at which the maximum area constraint  */
   /*   is found, where the index is measured in REALs.  Note that if the  */
-  /*   `regionattrib' flag is set, an additional attribute will be added. */
-  m->areaboundindex = m->elemattribindex + m->eextras + b->regionattrib;
+  /*   `regionattrib' or `segmentregions' flag is set, an additional      */
+  /*   attribute will be added for each.                                  */
+  m->areaboundindex = m->elemattribindex + m->eextras + b->regionattrib +
+                      b->segmentregions;
   /* If triangle attributes or an area bound are needed, increase the number */
   /*   of bytes occupied by a triangle.                                      */
   if (b->vararea) {
     trisize = (m->areaboundindex + 1) * sizeof(REAL);
-  } else if (m->eextras + b->regionattrib > 0) {
+  } else if (m->eextras + b->regionattrib + b->segmentregions > 0) {
     trisize = m->areaboundindex * sizeof(REAL);
   }
   /* If a Voronoi diagram or triangle neighbor graph is requested, make    */
@@ -5287,6 +5532,7 @@ vertex pc;
     return det;
   }
 
+  m->counterclockadaptcount++;
   return counterclockwiseadapt(pa, pb, pc, detsum);
 }
 
@@ -5945,6 +6191,7 @@ vertex pd;
     return det;
   }
 
+  m->incircleadaptcount++;
   return incircleadapt(pa, pb, pc, pd, permanent);
 }
 
@@ -6456,6 +6703,7 @@ REAL dheight;
     return det;
   }
 
+  m->orient3dadaptcount++;
   return orient3dadapt(pa, pb, pc, pd, aheight, bheight, cheight, dheight,
                        permanent);
 }
@@ -6627,6 +6875,41 @@ int offcenter;
 /**                                                                         **/
 /********* Geometric primitives end here                             *********/
 
+/*****************************************************************************/
+/*                                                                           */
+/*  meshrestart()   Initialize the variables of a mesh, but not its pools.   */
+/*                                                                           */
+/*  Used by triangleinit(), and by triangulatemany() to triangulate one      */
+/*  polygon after another in the same memory.                                */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void meshrestart(struct mesh *m)
+#else /* not ANSI_DECLARATORS */
+void meshrestart(m)
+struct mesh *m;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  m->viri = (triangle **) NULL;
+  m->virusitems = m->virusspace = m->maxviri = 0;
+
+  m->recenttri.tri = (triangle *) NULL; /* No triangle has been visited yet. */
+  m->undeads = 0;                       /* No eliminated input vertices yet. */
+  m->samples = 1;         /* Point location should take at least one sample. */
+  m->checksegments = 0;   /* There are no segments in the triangulation yet. */
+  m->checkquality = 0;     /* The quality triangulation stage has not begun. */
+  m->xorigin = m->yorigin = 0.0;
+  m->scale = m->invscale = 1.0;
+  m->incirclecount = m->counterclockcount = m->orient3dcount = 0;
+  m->incircleadaptcount = m->counterclockadaptcount = 0;
+  m->orient3dadaptcount = 0;
+  m->hyperbolacount = m->circletopcount = m->circumcentercount = 0;
+  m->segmentsteiners = m->trianglesteiners = 0;
+  randomseed = 1;
+}
+
 /*****************************************************************************/
 /*                                                                           */
 /*  triangleinit()   Initialize some variables.                              */
@@ -6644,20 +6927,11 @@ struct mesh *m;
   poolzero(&m->vertices);
   poolzero(&m->triangles);
   poolzero(&m->subsegs);
-  poolzero(&m->viri);
   poolzero(&m->badsubsegs);
   poolzero(&m->badtriangles);
   poolzero(&m->flipstackers);
   poolzero(&m->splaynodes);
-
-  m->recenttri.tri = (triangle *) NULL; /* No triangle has been visited yet. */
-  m->undeads = 0;                       /* No eliminated input vertices yet. */
-  m->samples = 1;         /* Point location should take at least one sample. */
-  m->checksegments = 0;   /* There are no segments in the triangulation yet. */
-  m->checkquality = 0;     /* The quality triangulation stage has not begun. */
-  m->incirclecount = m->counterclockcount = m->orient3dcount = 0;
-  m->hyperbolacount = m->circletopcount = m->circumcentercount = 0;
-  randomseed = 1;
+  meshrestart(m);
 
   exactinit();                     /* Initialize exact arithmetic constants. */
 }
@@ -11375,7 +11649,8 @@ FILE *polyfile;
         area = (REAL) strtod(stringptr, &stringptr);
       }
 #endif /* not TRILIBRARY */
-      setareabound(triangleloop, area);
+      /* Area constraints scale with the square (-T switch). */
+      setareabound(triangleloop, area * m->scale * m->scale);
     }
 
     /* Set the triangle's vertices. */
@@ -11759,6 +12034,7 @@ vertex endpoint2;
   }
   /* Record a triangle whose origin is the new vertex. */
   setvertex2tri(newvertex, encode(*splittri));
+  m->segmentsteiners++;
   if (m->steinerleft > 0) {
     m->steinerleft--;
   }
@@ -11965,6 +12241,7 @@ int newmark;
       }
     }
     /* The vertex has been inserted successfully. */
+    m->segmentsteiners++;
     if (m->steinerleft > 0) {
       m->steinerleft--;
     }
@@ -12570,6 +12847,209 @@ char *polyfilename;
 /**                                                                         **/
 /**                                                                         **/
 
+/*****************************************************************************/
+/*                                                                           */
+/*  virusinfect()   Infect a triangle and append it to the virus queue.      */
+/*                                                                           */
+/*  The queue doubles in length whenever it fills up.                        */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void virusinfect(struct mesh *m, struct otri *infecttri)
+#else /* not ANSI_DECLARATORS */
+void virusinfect(m, infecttri)
+struct mesh *m;
+struct otri *infecttri;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  triangle **newviri;
+  long newspace;
+
+  if (m->virusitems == m->virusspace) {
+    newspace = (m->virusspace == 0) ? VIRUSPERBLOCK : 2 * m->virusspace;
+    newviri = (triangle **) trimallocarray((size_t) newspace,
+                                           sizeof(triangle *));
+    if (m->virusitems > 0) {
+      memcpy(newviri, m->viri, (size_t) m->virusitems * sizeof(triangle *));
+    }
+    if (m->viri != (triangle **) NULL) {
+      trifree((VOID *) m->viri);
+    }
+    m->viri = newviri;
+    m->virusspace = newspace;
+  }
+  infect(*infecttri);
+  m->viri[m->virusitems++] = infecttri->tri;
+  if (m->virusitems > m->maxviri) {
+    m->maxviri = m->virusitems;
+  }
+}
+
+/*****************************************************************************/
+/*                                                                           */
+/*  seedsort()   Sort an array of hole and region points by their position   */
+/*               along a space-filling curve.                                */
+/*                                                                           */
+/*  Uses quicksort with a middle pivot, so that the random number sequence   */
+/*  (used later for point location) is left undisturbed.                     */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void seedsort(struct seedpoint *sortarray, int arraysize)
+#else /* not ANSI_DECLARATORS */
+void seedsort(sortarray, arraysize)
+struct seedpoint *sortarray;
+int arraysize;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct seedpoint temp;
+  unsigned long pivotkey;
+  int left, right;
+
+  while (arraysize > 1) {
+    pivotkey = sortarray[arraysize / 2].key;
+    left = 0;
+    right = arraysize - 1;
+    while (left <= right) {
+      while (sortarray[left].key < pivotkey) {
+        left++;
+      }
+      while (sortarray[right].key > pivotkey) {
+        right--;
+      }
+      if (left <= right) {
+        temp = sortarray[left];
+        sortarray[left] = sortarray[right];
+        sortarray[right] = temp;
+        left++;
+        right--;
+      }
+    }
+    /* Recurse on the smaller subset, and loop on the larger one. */
+    if (right + 1 < arraysize - left) {
+      seedsort(sortarray, right + 1);
+      sortarray = &sortarray[left];
+      arraysize -= left;
+    } else {
+      seedsort(&sortarray[left], arraysize - left);
+      arraysize = right + 1;
+    }
+  }
+}
+
+/*****************************************************************************/
+/*                                                                           */
+/*  locateseeds()   Find the triangles in which hole and region points lie.  */
+/*                                                                           */
+/*  The points are sorted along a Z-order (Morton) curve, and each point is  */
+/*  found by walking from the triangle in which the previous one was found.  */
+/*  Nearby points are usually only a few triangles apart, so this is much    */
+/*  faster than searching for every point from the convex hull.              */
+/*                                                                           */
+/*  Points outside the bounding box of the mesh are ignored, as are points   */
+/*  outside the convex hull.  For these, `location' is set to `dummytri'.    */
+/*                                                                           */
+/*  WARNING:  Like locate(), this routine requires a convex triangulation,   */
+/*  so it must be called before the holes and concavities are carved.       */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void locateseeds(struct mesh *m, struct behavior *b,
+                 struct seedpoint *seeds, int seedcount)
+#else /* not ANSI_DECLARATORS */
+void locateseeds(m, b, seeds, seedcount)
+struct mesh *m;
+struct behavior *b;
+struct seedpoint *seeds;
+int seedcount;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct otri searchtri;
+  struct otri backtri;
+  vertex torg, tdest;
+  REAL xscale, yscale;
+  REAL ahead;
+  unsigned long ix, iy;
+  unsigned long bit;
+  enum locateresult intersect;
+  int i, j;
+  triangle ptr;                         /* Temporary variable used by sym(). */
+
+  /* Compute each point's position along a Z-order curve, interleaving the */
+  /*   bits of 16-bit quantized x and y coordinates.                       */
+  xscale = (m->xmax > m->xmin) ? 65535.0 / (m->xmax - m->xmin) : 0.0;
+  yscale = (m->ymax > m->ymin) ? 65535.0 / (m->ymax - m->ymin) : 0.0;
+  for (i = 0; i < seedcount; i++) {
+    seeds[i].location.tri = m->dummytri;
+    seeds[i].location.orient = 0;
+    if ((seeds[i].point[0] >= m->xmin) && (seeds[i].point[0] <= m->xmax) &&
+        (seeds[i].point[1] >= m->ymin) && (seeds[i].point[1] <= m->ymax)) {
+      ix = (unsigned long) ((seeds[i].point[0] - m->xmin) * xscale);
+      iy = (unsigned long) ((seeds[i].point[1] - m->ymin) * yscale);
+    } else {
+      ix = iy = 0;
+    }
+    seeds[i].key = 0;
+    for (j = 15; j >= 0; j--) {
+      bit = 1ul << j;
+      seeds[i].key = (seeds[i].key << 2) | ((ix & bit) ? 2ul : 0ul) |
+                     ((iy & bit) ? 1ul : 0ul);
+    }
+  }
+  seedsort(seeds, seedcount);
+
+  /* Start searching from some triangle on the outer boundary. */
+  searchtri.tri = m->dummytri;
+  searchtri.orient = 0;
+  symself(searchtri);
+  for (i = 0; i < seedcount; i++) {
+    /* Ignore points that aren't within the bounds of the mesh. */
+    if ((seeds[i].point[0] < m->xmin) || (seeds[i].point[0] > m->xmax) ||
+        (seeds[i].point[1] < m->ymin) || (seeds[i].point[1] > m->ymax)) {
+      continue;
+    }
+    /* Orient `searchtri' so that the point is to the left of its edge, */
+    /*   as preciselocate() requires.                                   */
+    org(searchtri, torg);
+    dest(searchtri, tdest);
+    if ((torg[0] == seeds[i].point[0]) && (torg[1] == seeds[i].point[1])) {
+      intersect = ONVERTEX;
+    } else if ((tdest[0] == seeds[i].point[0]) &&
+               (tdest[1] == seeds[i].point[1])) {
+      lnextself(searchtri);
+      intersect = ONVERTEX;
+    } else {
+      ahead = counterclockwise(m, b, torg, tdest, seeds[i].point);
+      if (ahead < 0.0) {
+        sym(searchtri, backtri);
+        if (backtri.tri == m->dummytri) {
+          /* The point is on the far side of a convex hull edge. */
+          continue;
+        }
+        otricopy(backtri, searchtri);
+        intersect = preciselocate(m, b, seeds[i].point, &searchtri, 0);
+      } else if ((ahead == 0.0) &&
+                 (((torg[0] < seeds[i].point[0]) ==
+                   (seeds[i].point[0] < tdest[0])) &&
+                  ((torg[1] < seeds[i].point[1]) ==
+                   (seeds[i].point[1] < tdest[1])))) {
+        intersect = ONEDGE;
+      } else {
+        intersect = preciselocate(m, b, seeds[i].point, &searchtri, 0);
+      }
+    }
+    if (intersect != OUTSIDE) {
+      otricopy(searchtri, seeds[i].location);
+    }
+  }
+}
+
 /*****************************************************************************/
 /*                                                                           */
 /*  infecthull()   Virally infect all of the triangles of the convex hull    */
@@ -12591,7 +13071,6 @@ struct behavior *b;
   struct otri nexttri;
   struct otri starttri;
   struct osub hullsubseg;
-  triangle **deadtriangle;
   vertex horg, hdest;
   triangle ptr;                         /* Temporary variable used by sym(). */
   subseg sptr;                      /* Temporary variable used by tspivot(). */
@@ -12614,9 +13093,7 @@ struct behavior *b;
       if (hullsubseg.ss == m->dummysub) {
         /* The triangle is not protected; infect it. */
         if (!infected(hulltri)) {
-          infect(hulltri);
-          deadtriangle = (triangle **) poolalloc(&m->viri);
-          *deadtriangle = hulltri.tri;
+          virusinfect(m, &hulltri);
         }
       } else {
         /* The triangle is protected; set boundary markers if appropriate. */
@@ -12652,7 +13129,7 @@ struct behavior *b;
 /*                                                                           */
 /*  This procedure operates in two phases.  The first phase identifies all   */
 /*  the triangles that will die, and marks them as infected.  They are       */
-/*  marked to ensure that each triangle is added to the virus pool only      */
+/*  marked to ensure that each triangle is added to the virus queue only     */
 /*  once, so the procedure will terminate.                                   */
 /*                                                                           */
 /*  The second phase actually eliminates the infected triangles.  It also    */
@@ -12671,12 +13148,11 @@ struct behavior *b;
 {
   struct otri testtri;
   struct otri neighbor;
-  triangle **virusloop;
-  triangle **deadtriangle;
   struct osub neighborsubseg;
   vertex testvertex;
   vertex norg, ndest;
   vertex deadorg, deaddest, deadapex;
+  long virusindex;
   int killorg;
   triangle ptr;             /* Temporary variable used by sym() and onext(). */
   subseg sptr;                      /* Temporary variable used by tspivot(). */
@@ -12685,11 +13161,10 @@ struct behavior *b;
     printf("  Marking neighbors of marked triangles.\n");
   }
   /* Loop through all the infected triangles, spreading the virus to */
-  /*   their neighbors, then to their neighbors' neighbors.          */
-  traversalinit(&m->viri);
-  virusloop = (triangle **) traverse(&m->viri);
-  while (virusloop != (triangle **) NULL) {
-    testtri.tri = *virusloop;
+  /*   their neighbors, then to their neighbors' neighbors.  The     */
+  /*   queue may grow (and move) while it is being traversed.        */
+  for (virusindex = 0; virusindex < m->virusitems; virusindex++) {
+    testtri.tri = m->viri[virusindex];
     /* A triangle is marked as infected by messing with one of its pointers */
     /*   to subsegments, setting it to an illegal value.  Hence, we have to */
     /*   temporarily uninfect this triangle so that we can examine its      */
@@ -12740,10 +13215,8 @@ struct behavior *b;
                    deadorg[0], deadorg[1], deaddest[0], deaddest[1],
                    deadapex[0], deadapex[1]);
           }
-          infect(neighbor);
           /* Ensure that the neighbor's neighbors will be infected. */
-          deadtriangle = (triangle **) poolalloc(&m->viri);
-          *deadtriangle = neighbor.tri;
+          virusinfect(m, &neighbor);
         } else {               /* The neighbor is protected by a subsegment. */
           /* Remove this triangle from the subsegment. */
           stdissolve(neighborsubseg);
@@ -12763,19 +13236,16 @@ struct behavior *b;
       }
     }
     /* Remark the triangle as infected, so it doesn't get added to the */
-    /*   virus pool again.                                             */
+    /*   virus queue again.                                            */
     infect(testtri);
-    virusloop = (triangle **) traverse(&m->viri);
   }
 
   if (b->verbose) {
     printf("  Deleting marked triangles.\n");
   }
 
-  traversalinit(&m->viri);
-  virusloop = (triangle **) traverse(&m->viri);
-  while (virusloop != (triangle **) NULL) {
-    testtri.tri = *virusloop;
+  for (virusindex = 0; virusindex < m->virusitems; virusindex++) {
+    testtri.tri = m->viri[virusindex];
 
     /* Check each of the three corners of the triangle for elimination. */
     /*   This is done by walking around each vertex, checking if it is  */
@@ -12849,10 +13319,9 @@ struct behavior *b;
     }
     /* Return the dead triangle to the pool of triangles. */
     triangledealloc(m, testtri.tri);
-    virusloop = (triangle **) traverse(&m->viri);
   }
-  /* Empty the virus pool. */
-  poolrestart(&m->viri);
+  /* Empty the virus queue. */
+  m->virusitems = 0;
 }
 
 /*****************************************************************************/
@@ -12863,7 +13332,7 @@ struct behavior *b;
 /*  This procedure operates in two phases.  The first phase spreads an       */
 /*  attribute and/or an area constraint through a (segment-bounded) region.  */
 /*  The triangles are marked to ensure that each triangle is added to the    */
-/*  virus pool only once, so the procedure will terminate.                   */
+/*  virus queue only once, so the procedure will terminate.                  */
 /*                                                                           */
 /*  The second phase uninfects all infected triangles, returning them to     */
 /*  normal.                                                                  */
@@ -12884,10 +13353,9 @@ REAL area;
 {
   struct otri testtri;
   struct otri neighbor;
-  triangle **virusloop;
-  triangle **regiontri;
   struct osub neighborsubseg;
   vertex regionorg, regiondest, regionapex;
+  long virusindex;
   triangle ptr;             /* Temporary variable used by sym() and onext(). */
   subseg sptr;                      /* Temporary variable used by tspivot(). */
 
@@ -12897,10 +13365,8 @@ REAL area;
   /* Loop through all the infected triangles, spreading the attribute      */
   /*   and/or area constraint to their neighbors, then to their neighbors' */
   /*   neighbors.                                                          */
-  traversalinit(&m->viri);
-  virusloop = (triangle **) traverse(&m->viri);
-  while (virusloop != (triangle **) NULL) {
-    testtri.tri = *virusloop;
+  for (virusindex = 0; virusindex < m->virusitems; virusindex++) {
+    testtri.tri = m->viri[virusindex];
     /* A triangle is marked as infected by messing with one of its pointers */
     /*   to subsegments, setting it to an illegal value.  Hence, we have to */
     /*   temporarily uninfect this triangle so that we can examine its      */
@@ -12943,32 +13409,26 @@ REAL area;
                  regionorg[0], regionorg[1], regiondest[0], regiondest[1],
                  regionapex[0], regionapex[1]);
         }
-        /* Infect the neighbor. */
-        infect(neighbor);
-        /* Ensure that the neighbor's neighbors will be infected. */
-        regiontri = (triangle **) poolalloc(&m->viri);
-        *regiontri = neighbor.tri;
+        /* Infect the neighbor, and ensure that the neighbor's neighbors */
+        /*   will be infected.                                           */
+        virusinfect(m, &neighbor);
       }
     }
     /* Remark the triangle as infected, so it doesn't get added to the */
-    /*   virus pool again.                                             */
+    /*   virus queue again.                                            */
     infect(testtri);
-    virusloop = (triangle **) traverse(&m->viri);
   }
 
   /* Uninfect all triangles. */
   if (b->verbose > 1) {
     printf("  Unmarking marked triangles.\n");
   }
-  traversalinit(&m->viri);
-  virusloop = (triangle **) traverse(&m->viri);
-  while (virusloop != (triangle **) NULL) {
-    testtri.tri = *virusloop;
+  for (virusindex = 0; virusindex < m->virusitems; virusindex++) {
+    testtri.tri = m->viri[virusindex];
     uninfect(testtri);
-    virusloop = (triangle **) traverse(&m->viri);
   }
-  /* Empty the virus pool. */
-  poolrestart(&m->viri);
+  /* Empty the virus queue. */
+  m->virusitems = 0;
 }
 
 /*****************************************************************************/
@@ -12997,15 +13457,12 @@ int regions;
 #endif /* not ANSI_DECLARATORS */
 
 {
-  struct otri searchtri;
   struct otri triangleloop;
   struct otri *regiontris;
-  triangle **holetri;
-  triangle **regiontri;
-  vertex searchorg, searchdest;
-  enum locateresult intersect;
+  struct seedpoint *seeds;
+  REAL *seedcoords;
+  int seedcount;
   int i;
-  triangle ptr;                         /* Temporary variable used by sym(). */
 
   if (!(b->quiet || (b->noholes && b->convex))) {
     printf("Removing unwanted triangles.\n");
@@ -13022,91 +13479,77 @@ int regions;
     regiontris = (struct otri *) NULL;
   }
 
-  if (((holes > 0) && !b->noholes) || !b->convex || (regions > 0)) {
-    /* Initialize a pool of viri to be used for holes, concavities, */
-    /*   regional attributes, and/or regional area constraints.     */
-    poolinit(&m->viri, sizeof(triangle *), VIRUSPERBLOCK, VIRUSPERBLOCK, 0);
-  }
-
   if (!b->convex) {
     /* Mark as infected any unprotected triangles on the boundary. */
     /*   This is one way by which concavities are created.         */
     infecthull(m, b);
   }
 
-  if ((holes > 0) && !b->noholes) {
-    /* Infect each triangle in which a hole lies. */
-    for (i = 0; i < 2 * holes; i += 2) {
-      /* Ignore holes that aren't within the bounds of the mesh. */
-      if ((holelist[i] >= m->xmin) && (holelist[i] <= m->xmax)
-          && (holelist[i + 1] >= m->ymin) && (holelist[i + 1] <= m->ymax)) {
-        /* Start searching from some triangle on the outer boundary. */
-        searchtri.tri = m->dummytri;
-        searchtri.orient = 0;
-        symself(searchtri);
-        /* Ensure that the hole is to the left of this boundary edge; */
-        /*   otherwise, locate() will falsely report that the hole    */
-        /*   falls within the starting triangle.                      */
-        org(searchtri, searchorg);
-        dest(searchtri, searchdest);
-        if (counterclockwise(m, b, searchorg, searchdest, &holelist[i]) >
-            0.0) {
-          /* Find a triangle that contains the hole. */
-          intersect = locate(m, b, &holelist[i], &searchtri);
-          if ((intersect != OUTSIDE) && (!infected(searchtri))) {
-            /* Infect the triangle.  This is done by marking the triangle  */
-            /*   as infected and including the triangle in the virus pool. */
-            infect(searchtri);
-            holetri = (triangle **) poolalloc(&m->viri);
-            *holetri = searchtri.tri;
-          }
-        }
+  /* Now, we have to find all the holes and regions BEFORE we carve the     */
+  /*   holes, because locateseeds() won't work when the triangulation is no  */
+  /*   longer convex.  (Incidentally, this is the reason why regional        */
+  /*   attributes and area constraints can't be used when refining a         */
+  /*   preexisting mesh, which might not be convex; they can only be used    */
+  /*   with a freshly triangulated PSLG.)                                    */
+  seedcount = (b->noholes ? 0 : holes) + regions;
+  if (seedcount > 0) {
+    seeds = (struct seedpoint *) trimalloc(seedcount *
+                                           (int) sizeof(struct seedpoint));
+    seedcoords = (REAL *) NULL;
+    seedcount = 0;
+    if (!b->noholes) {
+      for (i = 0; i < holes; i++) {
+        seeds[seedcount].point = &holelist[2 * i];
+        seeds[seedcount].region = -1;
+        seedcount++;
       }
     }
-  }
+    for (i = 0; i < regions; i++) {
+      seeds[seedcount].point = &regionlist[4 * i];
+      seeds[seedcount].region = i;
+      seedcount++;
+    }
+    if (b->translate) {
+      /* Move the hole and region points like the vertices. */
+      seedcoords = (REAL *) trimalloc(seedcount * 2 * (int) sizeof(REAL));
+      for (i = 0; i < seedcount; i++) {
+        seedcoords[2 * i] = (seeds[i].point[0] - m->xorigin) * m->scale;
+        seedcoords[2 * i + 1] = (seeds[i].point[1] - m->yorigin) * m->scale;
+        seeds[i].point = &seedcoords[2 * i];
+      }
+    }
+    /* Find the triangles in which the hole and region points lie. */
+    locateseeds(m, b, seeds, seedcount);
 
-  /* Now, we have to find all the regions BEFORE we carve the holes, because */
-  /*   locate() won't work when the triangulation is no longer convex.       */
-  /*   (Incidentally, this is the reason why regional attributes and area    */
-  /*   constraints can't be used when refining a preexisting mesh, which     */
-  /*   might not be convex; they can only be used with a freshly             */
-  /*   triangulated PSLG.)                                                   */
-  if (regions > 0) {
-    /* Find the starting triangle for each region. */
+    /* Infect each triangle in which a hole lies. */
+    for (i = 0; i < seedcount; i++) {
+      if ((seeds[i].region < 0) && (seeds[i].location.tri != m->dummytri) &&
+          !infected(seeds[i].location)) {
+        virusinfect(m, &seeds[i].location);
+      }
+    }
+    /* Record the triangle in which each region point lies, for processing */
+    /*   after the holes have been carved.                                 */
     for (i = 0; i < regions; i++) {
       regiontris[i].tri = m->dummytri;
-      /* Ignore region points that aren't within the bounds of the mesh. */
-      if ((regionlist[4 * i] >= m->xmin) && (regionlist[4 * i] <= m->xmax) &&
-          (regionlist[4 * i + 1] >= m->ymin) &&
-          (regionlist[4 * i + 1] <= m->ymax)) {
-        /* Start searching from some triangle on the outer boundary. */
-        searchtri.tri = m->dummytri;
-        searchtri.orient = 0;
-        symself(searchtri);
-        /* Ensure that the region point is to the left of this boundary */
-        /*   edge; otherwise, locate() will falsely report that the     */
-        /*   region point falls within the starting triangle.           */
-        org(searchtri, searchorg);
-        dest(searchtri, searchdest);
-        if (counterclockwise(m, b, searchorg, searchdest, &regionlist[4 * i]) >
-            0.0) {
-          /* Find a triangle that contains the region point. */
-          intersect = locate(m, b, &regionlist[4 * i], &searchtri);
-          if ((intersect != OUTSIDE) && (!infected(searchtri))) {
-            /* Record the triangle for processing after the */
-            /*   holes have been carved.                    */
-            otricopy(searchtri, regiontris[i]);
-          }
-        }
+    }
+    for (i = 0; i < seedcount; i++) {
+      if ((seeds[i].region >= 0) && (seeds[i].location.tri != m->dummytri) &&
+          !infected(seeds[i].location)) {
+        otricopy(seeds[i].location, regiontris[seeds[i].region]);
       }
     }
+    trifree((VOID *) seeds);
+    if (seedcoords != (REAL *) NULL) {
+      trifree((VOID *) seedcoords);
+    }
   }
 
-  if (m->viri.items > 0) {
+  if (m->virusitems > 0) {
     /* Carve the holes and concavities. */
     plague(m, b);
   }
-  /* The virus pool should be empty now. */
+  /* The virus queue should be empty now. */
 
   if (regions > 0) {
     if (!b->quiet) {
@@ -13135,13 +13578,12 @@ int regions;
         /* Make sure the triangle under consideration still exists. */
         /*   It may have been eaten by the virus.                   */
         if (!deadtri(regiontris[i].tri)) {
-          /* Put one triangle in the virus pool. */
-          infect(regiontris[i]);
-          regiontri = (triangle **) poolalloc(&m->viri);
-          *regiontri = regiontris[i].tri;
+          /* Put one triangle in the virus queue. */
+          virusinfect(m, &regiontris[i]);
           /* Apply one region's attribute and/or area constraint. */
-          regionplague(m, b, regionlist[4 * i + 2], regionlist[4 * i + 3]);
-          /* The virus pool should be empty now. */
+          regionplague(m, b, regionlist[4 * i + 2],
+                       regionlist[4 * i + 3] * m->scale * m->scale);
+          /* The virus queue should be empty now. */
         }
       }
     }
@@ -13152,14 +13594,219 @@ int regions;
   }
 
   /* Free up memory. */
-  if (((holes > 0) && !b->noholes) || !b->convex || (regions > 0)) {
-    pooldeinit(&m->viri);
+  if (m->viri != (triangle **) NULL) {
+    trifree((VOID *) m->viri);
+    m->viri = (triangle **) NULL;
+    m->virusspace = 0;
   }
   if (regions > 0) {
     trifree((VOID *) regiontris);
   }
 }
 
+/*****************************************************************************/
+/*                                                                           */
+/*  markerareasort()   Sort a list of (marker, area) pairs by marker.        */
+/*                                                                           */
+/*  Uses quicksort with a middle pivot.                                      */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void markerareasort(REAL *sortarray, int arraysize)
+#else /* not ANSI_DECLARATORS */
+void markerareasort(sortarray, arraysize)
+REAL *sortarray;
+int arraysize;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  REAL pivotmarker;
+  REAL temp;
+  int left, right;
+
+  while (arraysize > 1) {
+    pivotmarker = sortarray[2 * (arraysize / 2)];
+    left = 0;
+    right = arraysize - 1;
+    while (left <= right) {
+      while (sortarray[2 * left] < pivotmarker) {
+        left++;
+      }
+      while (sortarray[2 * right] > pivotmarker) {
+        right--;
+      }
+      if (left <= right) {
+        temp = sortarray[2 * left];
+        sortarray[2 * left] = sortarray[2 * right];
+        sortarray[2 * right] = temp;
+        temp = sortarray[2 * left + 1];
+        sortarray[2 * left + 1] = sortarray[2 * right + 1];
+        sortarray[2 * right + 1] = temp;
+        left++;
+        right--;
+      }
+    }
+    /* Recurse on the smaller subset, and loop on the larger one. */
+    if (right + 1 < arraysize - left) {
+      markerareasort(sortarray, right + 1);
+      sortarray = &sortarray[2 * left];
+      arraysize -= left;
+    } else {
+      markerareasort(&sortarray[2 * left], arraysize - left);
+      arraysize = right + 1;
+    }
+  }
+}
+
+/*****************************************************************************/
+/*                                                                           */
+/*  segmentregions()   Number the regions bounded by segments.               */
+/*                                                                           */
+/*  Every triangle is assigned an additional attribute that identifies the   */
+/*  connected set of triangles (not separated by subsegments) it belongs     */
+/*  to.  The regions are numbered 1, 2, 3, ... in the order in which they    */
+/*  are first met while traversing the triangles, so no region points are    */
+/*  needed.  Each region is flooded breadth-first through the virus queue,   */
+/*  so every triangle is visited once.                                       */
+/*                                                                           */
+/*  If the -a switch is used without a number, `markerarealist' may list     */
+/*  pairs of a segment marker and a maximum area.  Each region takes the     */
+/*  smallest positive area associated with the markers of the subsegments    */
+/*  that bound it, unless its triangles already have a smaller constraint.   */
+/*                                                                           */
+/*  This routine must be called after the holes have been carved.            */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void segmentregions(struct mesh *m, struct behavior *b,
+                    REAL *markerarealist, int markerareas)
+#else /* not ANSI_DECLARATORS */
+void segmentregions(m, b, markerarealist, markerareas)
+struct mesh *m;
+struct behavior *b;
+REAL *markerarealist;
+int markerareas;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct otri triangleloop;
+  struct otri testtri;
+  struct otri neighbor;
+  struct osub neighborsubseg;
+  REAL *areatable;
+  REAL regionnumber;
+  REAL area;
+  REAL marker;
+  long virusindex;
+  long regioncount;
+  int low, high, middle;
+  int i;
+  triangle ptr;                         /* Temporary variable used by sym(). */
+  subseg sptr;                      /* Temporary variable used by tspivot(). */
+
+  if (!b->quiet) {
+    printf("Numbering segment-bounded regions.\n");
+  }
+
+  /* Sort a copy of the area table so markers can be found quickly. */
+  areatable = (REAL *) NULL;
+  if (b->vararea && (markerareas > 0)) {
+    areatable = (REAL *) trimalloc(2 * markerareas * (int) sizeof(REAL));
+    for (i = 0; i < 2 * markerareas; i++) {
+      areatable[i] = markerarealist[i] * m->scale * m->scale;
+    }
+    markerareasort(areatable, markerareas);
+  }
+
+  regioncount = 0;
+  traversalinit(&m->triangles);
+  triangleloop.orient = 0;
+  triangleloop.tri = triangletraverse(m);
+  while (triangleloop.tri != (triangle *) NULL) {
+    /* An uninfected triangle belongs to a region not yet numbered. */
+    if (!infected(triangleloop)) {
+      regioncount++;
+      regionnumber = (REAL) regioncount;
+      area = -1.0;
+      virusinfect(m, &triangleloop);
+      /* Spread the infection to every triangle of the region.  The queue */
+      /*   may grow (and move) while it is being scanned.                 */
+      for (virusindex = 0; virusindex < m->virusitems; virusindex++) {
+        testtri.tri = m->viri[virusindex];
+        setelemattribute(testtri, m->eextras, regionnumber);
+        for (testtri.orient = 0; testtri.orient < 3; testtri.orient++) {
+          sym(testtri, neighbor);
+          tspivot(testtri, neighborsubseg);
+          if (neighborsubseg.ss == m->dummysub) {
+            /* No subsegment protects this edge, so the region continues. */
+            if ((neighbor.tri != m->dummytri) && !infected(neighbor)) {
+              virusinfect(m, &neighbor);
+            }
+          } else if (areatable != (REAL *) NULL) {
+            /* Look up the area constraint of the bounding subsegment. */
+            marker = (REAL) mark(neighborsubseg);
+            low = 0;
+            high = markerareas - 1;
+            while (low <= high) {
+              middle = (low + high) / 2;
+              if (areatable[2 * middle] < marker) {
+                low = middle + 1;
+              } else if (areatable[2 * middle] > marker) {
+                high = middle - 1;
+              } else {
+                if ((areatable[2 * middle + 1] > 0.0) &&
+                    ((area <= 0.0) || (areatable[2 * middle + 1] < area))) {
+                  area = areatable[2 * middle + 1];
+                }
+                break;
+              }
+            }
+          }
+        }
+      }
+      if (area > 0.0) {
+        /* Apply the region's area constraint where it is more restrictive. */
+        for (virusindex = 0; virusindex < m->virusitems; virusindex++) {
+          testtri.tri = m->viri[virusindex];
+          if ((areabound(testtri) <= 0.0) || (area < areabound(testtri))) {
+            setareabound(testtri, area);
+          }
+        }
+      }
+      /* Empty the virus queue; the triangles stay infected so that */
+      /*   the traversal won't number them again.                   */
+      m->virusitems = 0;
+    }
+    triangleloop.tri = triangletraverse(m);
+  }
+
+  /* Uninfect all triangles. */
+  traversalinit(&m->triangles);
+  triangleloop.tri = triangletraverse(m);
+  while (triangleloop.tri != (triangle *) NULL) {
+    uninfect(triangleloop);
+    triangleloop.tri = triangletraverse(m);
+  }
+  /* Note the fact that each triangle has an additional attribute. */
+  m->eextras++;
+
+  if (b->verbose) {
+    printf("  Found %ld segment-bounded regions.\n", regioncount);
+  }
+
+  /* Free up memory. */
+  if (areatable != (REAL *) NULL) {
+    trifree((VOID *) areatable);
+  }
+  if (m->viri != (triangle **) NULL) {
+    trifree((VOID *) m->viri);
+    m->viri = (triangle **) NULL;
+    m->virusspace = 0;
+  }
+}
+
 /**                                                                         **/
 /**                                                                         **/
 /********* Carving out holes and concavities ends here               *********/
@@ -13425,6 +14072,7 @@ int triflaws;
           printf("  Failure to split a segment.\n");
           internalerror();
         }
+        m->segmentsteiners++;
         if (m->steinerleft > 0) {
           m->steinerleft--;
         }
@@ -13563,6 +14211,7 @@ struct badtriang *badtri;
       success = insertvertex(m, b, newvertex, &badotri, (struct osub *) NULL,
                              1, 1);
       if (success == SUCCESSFULVERTEX) {
+        m->trianglesteiners++;
         if (m->steinerleft > 0) {
           m->steinerleft--;
         }
@@ -13702,6 +14351,262 @@ struct behavior *b;
   }
 }
 
+/*****************************************************************************/
+/*                                                                           */
+/*  recordlevel()   Append the triangles of the current mesh to the list of  */
+/*                  refinement levels.                                       */
+/*                                                                           */
+/*  Each level records how many vertices it has, and the corners and         */
+/*  attributes of its triangles.  The vertices are numbered as they will be  */
+/*  in the output.  This numbering is only valid because no vertex that      */
+/*  exists now will move in the vertex pool (see refinelevels()).  The       */
+/*  vertex numbers are written over the boundary markers while the           */
+/*  triangles are written, so the markers are set aside and restored.        */
+/*                                                                           */
+/*  The lists of all the levels grow geometrically:  `*levelspace' is the    */
+/*  number of triangles they can hold, and the per-level counts are          */
+/*  reallocated when the number of levels reaches a power of two.  Only the  */
+/*  new level is written.                                                    */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void recordlevel(struct mesh *m, struct behavior *b, struct triangulateio *out,
+                 long *levelspace)
+#else /* not ANSI_DECLARATORS */
+void recordlevel(m, b, out, levelspace)
+struct mesh *m;
+struct behavior *b;
+struct triangulateio *out;
+long *levelspace;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct otri triangleloop;
+  vertex vertexloop;
+  vertex p1, p2, p3;
+  int *vertexmarkers;
+  int *newcounts;
+  int *newtrianglelist;
+  REAL *newattriblist;
+  long oldtriangles;
+  long newspace;
+  long cornerindex;
+  long attribindex;
+  int vertexnumber;
+  int vertexindex;
+  int level;
+  int i;
+
+  level = out->numberoflevels;
+  if (b->verbose) {
+    printf("  Recording level %d.\n", level);
+  }
+
+  /* Number the vertices, setting their boundary markers aside. */
+  vertexmarkers = (int *) trimallocarray((size_t) m->vertices.items,
+                                         sizeof(int));
+  traversalinit(&m->vertices);
+  vertexindex = 0;
+  vertexnumber = b->firstnumber;
+  vertexloop = vertextraverse(m);
+  while (vertexloop != (vertex) NULL) {
+    vertexmarkers[vertexindex++] = vertexmark(vertexloop);
+    setvertexmark(vertexloop, vertexnumber);
+    if (!b->jettison || (vertextype(vertexloop) != UNDEADVERTEX)) {
+      vertexnumber++;
+    }
+    vertexloop = vertextraverse(m);
+  }
+
+  /* Grow the per-level counts when the number of levels is 0, 1, 2, 4,... */
+  if ((level & (level - 1)) == 0) {
+    newspace = (level == 0) ? 1 : 2 * level;
+    newcounts = (int *) trimallocarray((size_t) newspace, sizeof(int));
+    if (level > 0) {
+      memcpy(newcounts, out->levelpointcountlist,
+             (size_t) level * sizeof(int));
+      trifree((VOID *) out->levelpointcountlist);
+    }
+    out->levelpointcountlist = newcounts;
+    newcounts = (int *) trimallocarray((size_t) newspace, sizeof(int));
+    if (level > 0) {
+      memcpy(newcounts, out->leveltrianglecountlist,
+             (size_t) level * sizeof(int));
+      trifree((VOID *) out->leveltrianglecountlist);
+    }
+    out->leveltrianglecountlist = newcounts;
+  }
+  out->levelpointcountlist[level] = vertexnumber - b->firstnumber;
+  out->leveltrianglecountlist[level] = (int) m->triangles.items;
+  oldtriangles = 0;
+  for (i = 0; i < level; i++) {
+    oldtriangles += out->leveltrianglecountlist[i];
+  }
+
+  /* Grow the triangle and attribute lists, which hold all the levels */
+  /*   one after another, to twice their size or more.                */
+  if (oldtriangles + m->triangles.items > *levelspace) {
+    newspace = 2 * *levelspace;
+    if (newspace < oldtriangles + m->triangles.items) {
+      newspace = oldtriangles + m->triangles.items;
+    }
+    newtrianglelist = (int *) trimallocarray((size_t) newspace * 3,
+                                             sizeof(int));
+    if (oldtriangles > 0) {
+      memcpy(newtrianglelist, out->leveltrianglelist,
+             (size_t) oldtriangles * 3 * sizeof(int));
+    }
+    if (out->leveltrianglelist != (int *) NULL) {
+      trifree((VOID *) out->leveltrianglelist);
+    }
+    out->leveltrianglelist = newtrianglelist;
+    if (m->eextras > 0) {
+      newattriblist = (REAL *) trimallocarray((size_t) newspace *
+                                              (size_t) m->eextras,
+                                              sizeof(REAL));
+      if (oldtriangles > 0) {
+        memcpy(newattriblist, out->leveltriangleattributelist,
+               (size_t) oldtriangles * (size_t) m->eextras * sizeof(REAL));
+      }
+      if (out->leveltriangleattributelist != (REAL *) NULL) {
+        trifree((VOID *) out->leveltriangleattributelist);
+      }
+      out->leveltriangleattributelist = newattriblist;
+    }
+    *levelspace = newspace;
+  }
+
+  cornerindex = 3 * oldtriangles;
+  attribindex = m->eextras * oldtriangles;
+  traversalinit(&m->triangles);
+  triangleloop.tri = triangletraverse(m);
+  triangleloop.orient = 0;
+  while (triangleloop.tri != (triangle *) NULL) {
+    org(triangleloop, p1);
+    dest(triangleloop, p2);
+    apex(triangleloop, p3);
+    out->leveltrianglelist[cornerindex++] = vertexmark(p1);
+    out->leveltrianglelist[cornerindex++] = vertexmark(p2);
+    out->leveltrianglelist[cornerindex++] = vertexmark(p3);
+    for (i = 0; i < m->eextras; i++) {
+      out->leveltriangleattributelist[attribindex++] =
+        elemattribute(triangleloop, i);
+    }
+    triangleloop.tri = triangletraverse(m);
+  }
+  out->numberoflevels = level + 1;
+
+  /* Restore the boundary markers. */
+  traversalinit(&m->vertices);
+  vertexindex = 0;
+  vertexloop = vertextraverse(m);
+  while (vertexloop != (vertex) NULL) {
+    setvertexmark(vertexloop, vertexmarkers[vertexindex++]);
+    vertexloop = vertextraverse(m);
+  }
+  trifree((VOID *) vertexmarkers);
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  refinelevels()   Refine the mesh through successive levels, halving the  */
+/*                   area constraints at each level.                         */
+/*                                                                           */
+/*  The mesh is refined in place; nothing is rebuilt between levels.  Before */
+/*  each level, the free vertices are made input vertices, as they would be  */
+/*  if the mesh were read back in with the -r switch, so that they can't be  */
+/*  deleted from the diametral circles of encroached subsegments.  The       */
+/*  pool's stack of dead vertices is discarded, so that new vertices are     */
+/*  always allocated after the existing ones.  Hence the vertices of each    */
+/*  level are numbered before those added by later levels, and a level is   */
+/*  fully described by its vertex count and its triangles.                   */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void refinelevels(struct mesh *m, struct behavior *b,
+                  struct triangulateio *out)
+#else /* not ANSI_DECLARATORS */
+void refinelevels(m, b, out)
+struct mesh *m;
+struct behavior *b;
+struct triangulateio *out;
+#endif /* not ANSI_DECLARATORS */
+
+#else /* not TRILIBRARY */
+
+#ifdef ANSI_DECLARATORS
+void refinelevels(struct mesh *m, struct behavior *b)
+#else /* not ANSI_DECLARATORS */
+void refinelevels(m, b)
+struct mesh *m;
+struct behavior *b;
+#endif /* not ANSI_DECLARATORS */
+
+#endif /* not TRILIBRARY */
+
+{
+  struct otri triangleloop;
+  vertex vertexloop;
+#ifdef TRILIBRARY
+  long levelspace;
+#endif /* TRILIBRARY */
+  int level;
+
+#ifdef TRILIBRARY
+  levelspace = 0;
+#endif /* TRILIBRARY */
+  for (level = 0; level < b->levels; level++) {
+#ifdef TRILIBRARY
+    recordlevel(m, b, out, &levelspace);
+#endif /* TRILIBRARY */
+    if (!b->quiet) {
+      printf("Refining level %d.\n", level + 1);
+    }
+    /* The vertices of coarser levels must stay where they are. */
+    traversalinit(&m->vertices);
+    vertexloop = vertextraverse(m);
+    while (vertexloop != (vertex) NULL) {
+      if (vertextype(vertexloop) == FREEVERTEX) {
+        setvertextype(vertexloop, INPUTVERTEX);
+      }
+      vertexloop = vertextraverse(m);
+    }
+    /* New vertices must follow all the vertices of coarser levels. */
+    m->vertices.deaditemstack = (VOID *) NULL;
+    /* Halve the area constraints. */
+    if (b->fixedarea) {
+      b->maxarea *= 0.5;
+    }
+    if (b->vararea) {
+      traversalinit(&m->triangles);
+      triangleloop.orient = 0;
+      triangleloop.tri = triangletraverse(m);
+      while (triangleloop.tri != (triangle *) NULL) {
+        if (areabound(triangleloop) > 0.0) {
+          setareabound(triangleloop, 0.5 * areabound(triangleloop));
+        }
+        triangleloop.tri = triangletraverse(m);
+      }
+    }
+    /* Discard the queues of the previous level, then refine again. */
+    pooldeinit(&m->badsubsegs);
+    if ((b->minangle > 0.0) || b->vararea || b->fixedarea || b->usertest) {
+      pooldeinit(&m->badtriangles);
+      pooldeinit(&m->flipstackers);
+    }
+    m->checkquality = 0;
+    enforcequality(m, b);
+  }
+}
+
 #endif /* not CDT_ONLY */
 
 /**                                                                         **/
@@ -13883,49 +14788,140 @@ char *string;
 
 /*****************************************************************************/
 /*                                                                           */
-/*  readnodes()   Read the vertices from a file, which may be a .node or     */
-/*                .poly file.                                                */
+/*  translatenodes()   Move the input vertices near the origin (-T switch).  */
+/*                                                                           */
+/*  The bounding box is centered on the origin, to within 1/16 of its size,  */
+/*  and scaled by a power of two to be between one and two units across.     */
+/*  Far from the origin, the coordinates of the vertices share most of their */
+/*  leading bits, and the Steiner points inserted between them are rounded   */
+/*  to what little is left; near the origin they keep full precision.  The   */
+/*  origin is a multiple of a power of two, so that subtracting it from a    */
+/*  coordinate is normally exact; if it is not for some vertex, the vertices */
+/*  are left as they are and the switch is turned off.  writenodes() maps    */
+/*  the vertices back, recovering the input vertices exactly.                */
 /*                                                                           */
 /*****************************************************************************/
 
-#ifndef TRILIBRARY
-
 #ifdef ANSI_DECLARATORS
-void readnodes(struct mesh *m, struct behavior *b, char *nodefilename,
-               char *polyfilename, FILE **polyfile)
+void translatenodes(struct mesh *m, struct behavior *b)
 #else /* not ANSI_DECLARATORS */
-void readnodes(m, b, nodefilename, polyfilename, polyfile)
+void translatenodes(m, b)
 struct mesh *m;
 struct behavior *b;
-char *nodefilename;
-char *polyfilename;
-FILE **polyfile;
 #endif /* not ANSI_DECLARATORS */
 
 {
-  FILE *infile;
   vertex vertexloop;
-  char inputline[INPUTLINESIZE];
-  char *stringptr;
-  char *infilename;
+  REAL width;
   REAL x, y;
-  int firstnode;
-  int nodemarkers;
-  int currentmarker;
-  int i, j;
+  REAL xerr, yerr;
+  INEXACT REAL bvirt;
+  REAL avirt, bround, around;
+  int exponent;
 
-  if (b->poly) {
-    /* Read the vertices from a .poly file. */
-    if (!b->quiet) {
-      printf("Opening %s.\n", polyfilename);
-    }
-    *polyfile = fopen(polyfilename, "r");
-    if (*polyfile == (FILE *) NULL) {
-      printf("  Error:  Cannot access file %s.\n", polyfilename);
-      triexit(1);
-    }
-    /* Read number of vertices, number of dimensions, number of vertex */
-    /*   attributes, and number of boundary markers.                   */
+  width = m->xmax - m->xmin;
+  if (m->ymax - m->ymin > width) {
+    width = m->ymax - m->ymin;
+  }
+  if ((width <= 0.0) || b->weighted) {
+    /* Nothing to scale, or the weights would have to be scaled too. */
+    b->translate = 0;
+    return;
+  }
+  frexp(width, &exponent);
+  m->xorigin = (REAL) ldexp(floor(ldexp(0.5 * (m->xmin + m->xmax),
+                                        4 - exponent) + 0.5), exponent - 4);
+  m->yorigin = (REAL) ldexp(floor(ldexp(0.5 * (m->ymin + m->ymax),
+                                        4 - exponent) + 0.5), exponent - 4);
+  m->scale = (REAL) ldexp(1.0, 1 - exponent);
+  m->invscale = (REAL) ldexp(1.0, exponent - 1);
+
+  /* Check that every coordinate can be translated exactly. */
+  traversalinit(&m->vertices);
+  vertexloop = vertextraverse(m);
+  while (vertexloop != (vertex) NULL) {
+    Two_Diff(vertexloop[0], m->xorigin, x, xerr);
+    Two_Diff(vertexloop[1], m->yorigin, y, yerr);
+    if ((xerr != 0.0) || (yerr != 0.0)) {
+      if (b->verbose) {
+        printf("  Cannot translate vertex (%.12g, %.12g) exactly;\n",
+               vertexloop[0], vertexloop[1]);
+        printf("    ignoring the -T switch.\n");
+      }
+      m->xorigin = m->yorigin = 0.0;
+      m->scale = m->invscale = 1.0;
+      b->translate = 0;
+      return;
+    }
+    vertexloop = vertextraverse(m);
+  }
+
+  if (b->verbose) {
+    printf("  Translating the vertices by (%.12g, %.12g), scaling by %.12g.\n",
+           -m->xorigin, -m->yorigin, m->scale);
+  }
+  traversalinit(&m->vertices);
+  vertexloop = vertextraverse(m);
+  while (vertexloop != (vertex) NULL) {
+    vertexloop[0] = (vertexloop[0] - m->xorigin) * m->scale;
+    vertexloop[1] = (vertexloop[1] - m->yorigin) * m->scale;
+    vertexloop = vertextraverse(m);
+  }
+  m->xmin = (m->xmin - m->xorigin) * m->scale;
+  m->xmax = (m->xmax - m->xorigin) * m->scale;
+  m->ymin = (m->ymin - m->yorigin) * m->scale;
+  m->ymax = (m->ymax - m->yorigin) * m->scale;
+  if (b->fixedarea) {
+    /* Area constraints scale with the square. */
+    b->maxarea *= m->scale * m->scale;
+  }
+}
+
+/*****************************************************************************/
+/*                                                                           */
+/*  readnodes()   Read the vertices from a file, which may be a .node or     */
+/*                .poly file.                                                */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifndef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void readnodes(struct mesh *m, struct behavior *b, char *nodefilename,
+               char *polyfilename, FILE **polyfile)
+#else /* not ANSI_DECLARATORS */
+void readnodes(m, b, nodefilename, polyfilename, polyfile)
+struct mesh *m;
+struct behavior *b;
+char *nodefilename;
+char *polyfilename;
+FILE **polyfile;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  FILE *infile;
+  vertex vertexloop;
+  char inputline[INPUTLINESIZE];
+  char *stringptr;
+  char *infilename;
+  REAL x, y;
+  int firstnode;
+  int nodemarkers;
+  int currentmarker;
+  int i, j;
+
+  if (b->poly) {
+    /* Read the vertices from a .poly file. */
+    if (!b->quiet) {
+      printf("Opening %s.\n", polyfilename);
+    }
+    *polyfile = fopen(polyfilename, "r");
+    if (*polyfile == (FILE *) NULL) {
+      printf("  Error:  Cannot access file %s.\n", polyfilename);
+      triexit(1);
+    }
+    /* Read number of vertices, number of dimensions, number of vertex */
+    /*   attributes, and number of boundary markers.                   */
     stringptr = readline(inputline, *polyfile, polyfilename);
     m->invertices = (int) strtol(stringptr, &stringptr, 0);
     stringptr = findfield(stringptr);
@@ -14072,6 +15068,10 @@ FILE **polyfile;
     fclose(infile);
   }
 
+  if (b->translate) {
+    translatenodes(m, b);
+  }
+
   /* Nonexistent x value used as a flag to mark circle events in sweepline */
   /*   Delaunay algorithm.                                                 */
   m->xminextreme = 10 * m->xmin - 9 * m->xmax;
@@ -14156,6 +15156,149 @@ int numberofpointattribs;
     }
   }
 
+  if (b->translate) {
+    translatenodes(m, b);
+  }
+
+  /* Nonexistent x value used as a flag to mark circle events in sweepline */
+  /*   Delaunay algorithm.                                                 */
+  m->xminextreme = 10 * m->xmin - 9 * m->xmax;
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  streampoints()   Append vertices to the pool held by `in->pointstream',  */
+/*                   which triangulate() then uses without copying them.     */
+/*                                                                           */
+/*  The pool is created by the first call, with room for `sizehint'          */
+/*  vertices in its first block and `in->numberofpointattributes'            */
+/*  attributes per vertex.  Its vertices always have room for the triangle   */
+/*  pointer that the -p switch needs, so that the switches need not be known */
+/*  yet.  `pointmarkerlist' may be NULL.  Returns the number of vertices     */
+/*  appended so far; `numberofpoints' may be zero.                           */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+int streampoints(struct triangulateio *in, REAL *pointlist,
+                 REAL *pointattriblist, int *pointmarkerlist,
+                 int numberofpoints, int sizehint)
+#else /* not ANSI_DECLARATORS */
+int streampoints(in, pointlist, pointattriblist, pointmarkerlist,
+                 numberofpoints, sizehint)
+struct triangulateio *in;
+REAL *pointlist;
+REAL *pointattriblist;
+int *pointmarkerlist;
+int numberofpoints;
+int sizehint;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct mesh *m;
+  struct behavior b;
+  vertex vertexloop;
+  REAL x, y;
+  int maxvertices;
+  int i, j;
+
+  m = (struct mesh *) in->pointstream;
+  if (m == (struct mesh *) NULL) {
+    m = (struct mesh *) trimalloc((int) sizeof(struct mesh));
+    triangleinit(m);
+    m->mesh_dim = 2;
+    m->nextras = in->numberofpointattributes;
+    /* Keep the first block below 1 GB, so that its size fits in an int. */
+    maxvertices = (1 << 30) / ((m->nextras + 2) * (int) sizeof(REAL) +
+                               4 * (int) sizeof(VOID *));
+    m->invertices = (sizehint < maxvertices) ? sizehint : maxvertices;
+    b.poly = 1;
+    initializevertexpool(m, &b);
+    in->pointstream = (VOID *) m;
+  }
+
+  for (i = 0; i < numberofpoints; i++) {
+    vertexloop = (vertex) poolalloc(&m->vertices);
+    x = vertexloop[0] = pointlist[2 * i];
+    y = vertexloop[1] = pointlist[2 * i + 1];
+    for (j = 0; j < m->nextras; j++) {
+      vertexloop[2 + j] = pointattriblist[m->nextras * i + j];
+    }
+    if (pointmarkerlist != (int *) NULL) {
+      setvertexmark(vertexloop, pointmarkerlist[i]);
+    } else {
+      setvertexmark(vertexloop, 0);
+    }
+    setvertextype(vertexloop, INPUTVERTEX);
+    if (m->vertices.items == 1) {
+      m->xmin = m->xmax = x;
+      m->ymin = m->ymax = y;
+    } else {
+      m->xmin = (x < m->xmin) ? x : m->xmin;
+      m->xmax = (x > m->xmax) ? x : m->xmax;
+      m->ymin = (y < m->ymin) ? y : m->ymin;
+      m->ymax = (y > m->ymax) ? y : m->ymax;
+    }
+  }
+  return (int) m->vertices.items;
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  transferstream()   Take over the vertices appended by streampoints().    */
+/*                                                                           */
+/*  The pool of `in->pointstream' becomes the vertex pool of the mesh, and   */
+/*  `in->pointstream' is set to NULL.                                        */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void transferstream(struct mesh *m, struct behavior *b,
+                    struct triangulateio *in)
+#else /* not ANSI_DECLARATORS */
+void transferstream(m, b, in)
+struct mesh *m;
+struct behavior *b;
+struct triangulateio *in;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct mesh *s;
+
+  s = (struct mesh *) in->pointstream;
+  m->vertices = s->vertices;
+  m->vertexmarkindex = s->vertexmarkindex;
+  m->vertex2triindex = s->vertex2triindex;
+  m->invertices = (int) s->vertices.items;
+  m->mesh_dim = 2;
+  m->nextras = s->nextras;
+  m->readnodefile = 0;
+  m->xmin = s->xmin;
+  m->xmax = s->xmax;
+  m->ymin = s->ymin;
+  m->ymax = s->ymax;
+  trifree((VOID *) s);
+  in->pointstream = (VOID *) NULL;
+  if (m->invertices < 3) {
+    printf("Error:  Input must have at least three input vertices.\n");
+    triexit(1);
+  }
+  if (m->nextras == 0) {
+    b->weighted = 0;
+  }
+
+  if (b->translate) {
+    translatenodes(m, b);
+  }
+
   /* Nonexistent x value used as a flag to mark circle events in sweepline */
   /*   Delaunay algorithm.                                                 */
   m->xminextreme = 10 * m->xmin - 9 * m->xmax;
@@ -14163,6 +15306,35 @@ int numberofpointattribs;
 
 #endif /* TRILIBRARY */
 
+/*****************************************************************************/
+/*                                                                           */
+/*  pointstreamfree()   Free the vertices appended by streampoints() that    */
+/*                      were not triangulated.                               */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void pointstreamfree(struct triangulateio *in)
+#else /* not ANSI_DECLARATORS */
+void pointstreamfree(in)
+struct triangulateio *in;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct mesh *s;
+
+  s = (struct mesh *) in->pointstream;
+  if (s != (struct mesh *) NULL) {
+    pooldeinit(&s->vertices);
+    trifree((VOID *) s);
+    in->pointstream = (VOID *) NULL;
+  }
+}
+
+#endif /* TRILIBRARY */
+
 /*****************************************************************************/
 /*                                                                           */
 /*  readholes()   Read the holes, and possibly regional attributes and area  */
@@ -14321,6 +15493,10 @@ char **argv;
 /*  To save memory, the vertex numbers are written over the boundary markers */
 /*  after the vertices are written to a file.                                */
 /*                                                                           */
+/*  In the library, `pointlist' or `pointattriblist' may be NULL, so that    */
+/*  the coordinates or the attributes are not written (they are known to be  */
+/*  those of the input already).                                             */
+/*                                                                           */
 /*****************************************************************************/
 
 #ifdef TRILIBRARY
@@ -14364,6 +15540,7 @@ char **argv;
   FILE *outfile;
 #endif /* not TRILIBRARY */
   vertex vertexloop;
+  REAL x, y;
   long outvertices;
   int vertexnumber;
   int i;
@@ -14378,21 +15555,27 @@ char **argv;
   if (!b->quiet) {
     printf("Writing vertices.\n");
   }
+  plist = (REAL *) NULL;
+  palist = (REAL *) NULL;
   /* Allocate memory for output vertices if necessary. */
-  if (*pointlist == (REAL *) NULL) {
-    *pointlist = (REAL *) trimalloc((int) (outvertices * 2 * sizeof(REAL)));
+  if (pointlist != (REAL **) NULL) {
+    if (*pointlist == (REAL *) NULL) {
+      *pointlist = (REAL *) trimalloc((int) (outvertices * 2 * sizeof(REAL)));
+    }
+    plist = *pointlist;
   }
   /* Allocate memory for output vertex attributes if necessary. */
-  if ((m->nextras > 0) && (*pointattriblist == (REAL *) NULL)) {
-    *pointattriblist = (REAL *) trimalloc((int) (outvertices * m->nextras *
-                                                 sizeof(REAL)));
+  if ((m->nextras > 0) && (pointattriblist != (REAL **) NULL)) {
+    if (*pointattriblist == (REAL *) NULL) {
+      *pointattriblist = (REAL *) trimalloc((int) (outvertices * m->nextras *
+                                                   sizeof(REAL)));
+    }
+    palist = *pointattriblist;
   }
   /* Allocate memory for output vertex markers if necessary. */
   if (!b->nobound && (*pointmarkerlist == (int *) NULL)) {
     *pointmarkerlist = (int *) trimalloc((int) (outvertices * sizeof(int)));
   }
-  plist = *pointlist;
-  palist = *pointattriblist;
   pmlist = *pointmarkerlist;
   coordindex = 0;
   attribindex = 0;
@@ -14416,13 +15599,24 @@ char **argv;
   vertexloop = vertextraverse(m);
   while (vertexloop != (vertex) NULL) {
     if (!b->jettison || (vertextype(vertexloop) != UNDEADVERTEX)) {
+      x = vertexloop[0];
+      y = vertexloop[1];
+      if (b->translate) {
+        /* Undo translatenodes(); exact for the input vertices. */
+        x = x * m->invscale + m->xorigin;
+        y = y * m->invscale + m->yorigin;
+      }
 #ifdef TRILIBRARY
-      /* X and y coordinates. */
-      plist[coordindex++] = vertexloop[0];
-      plist[coordindex++] = vertexloop[1];
-      /* Vertex attributes. */
-      for (i = 0; i < m->nextras; i++) {
-        palist[attribindex++] = vertexloop[2 + i];
+      if (plist != (REAL *) NULL) {
+        /* X and y coordinates. */
+        plist[coordindex++] = x;
+        plist[coordindex++] = y;
+      }
+      if (palist != (REAL *) NULL) {
+        /* Vertex attributes. */
+        for (i = 0; i < m->nextras; i++) {
+          palist[attribindex++] = vertexloop[2 + i];
+        }
       }
       if (!b->nobound) {
         /* Copy the boundary marker. */
@@ -14430,8 +15624,7 @@ char **argv;
       }
 #else /* not TRILIBRARY */
       /* Vertex number, x and y coordinates. */
-      fprintf(outfile, "%4d    %.17g  %.17g", vertexnumber, vertexloop[0],
-              vertexloop[1]);
+      fprintf(outfile, "%4d    %.17g  %.17g", vertexnumber, x, y);
       for (i = 0; i < m->nextras; i++) {
         /* Write an attribute. */
         fprintf(outfile, "  %.17g", vertexloop[i + 2]);
@@ -14491,145 +15684,815 @@ struct behavior *b;
 
 /*****************************************************************************/
 /*                                                                           */
-/*  writeelements()   Write the triangles to an .ele file.                   */
+/*  counttriblock()   Count the live triangles of one block of the triangle  */
+/*                    pool, and optionally the edges that belong to it.      */
+/*                                                                           */
+/*  An edge belongs to the adjoining triangle with the smaller pointer (or   */
+/*  to its only triangle on the boundary), so each edge is counted once.     */
+/*  The counts are left in `offset' and `edgeoffset'.                        */
 /*                                                                           */
 /*****************************************************************************/
 
 #ifdef TRILIBRARY
 
 #ifdef ANSI_DECLARATORS
-void writeelements(struct mesh *m, struct behavior *b,
-                   int **trianglelist, REAL **triangleattriblist)
+void counttriblock(struct mesh *m, struct triblock *block, int countedges)
 #else /* not ANSI_DECLARATORS */
-void writeelements(m, b, trianglelist, triangleattriblist)
+void counttriblock(m, block, countedges)
 struct mesh *m;
-struct behavior *b;
-int **trianglelist;
-REAL **triangleattriblist;
+struct triblock *block;
+int countedges;
 #endif /* not ANSI_DECLARATORS */
 
-#else /* not TRILIBRARY */
+{
+  struct otri triangleloop, trisym;
+  long live, edges;
+  int i;
+  triangle ptr;                         /* Temporary variable used by sym(). */
+
+  live = 0;
+  edges = 0;
+  for (i = 0; i < block->items; i++) {
+    triangleloop.tri = (triangle *) ((char *) block->firsttri +
+                                     i * m->triangles.itembytes);
+    if (deadtri(triangleloop.tri)) {
+      continue;
+    }
+    live++;
+    if (countedges) {
+      for (triangleloop.orient = 0; triangleloop.orient < 3;
+           triangleloop.orient++) {
+        sym(triangleloop, trisym);
+        if ((triangleloop.tri < trisym.tri) || (trisym.tri == m->dummytri)) {
+          edges++;
+        }
+      }
+    }
+  }
+  block->offset = live;
+  block->edgeoffset = edges;
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  triangleblocks()   List the blocks of the triangle pool, and the number  */
+/*                     of live triangles (and optionally of edges) that      */
+/*                     precede each one.                                     */
+/*                                                                           */
+/*  The blocks are listed in the order traverse() visits them, so the        */
+/*  output routines can write the triangles of block i starting at entry     */
+/*  `offset' and get exactly the numbering of a serial traversal.  Returns   */
+/*  the number of blocks; the caller frees the array.                        */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
 
 #ifdef ANSI_DECLARATORS
-void writeelements(struct mesh *m, struct behavior *b, char *elefilename,
-                   int argc, char **argv)
+int triangleblocks(struct mesh *m, struct triblock **blocks, int countedges)
 #else /* not ANSI_DECLARATORS */
-void writeelements(m, b, elefilename, argc, argv)
+int triangleblocks(m, blocks, countedges)
 struct mesh *m;
-struct behavior *b;
-char *elefilename;
-int argc;
-char **argv;
+struct triblock **blocks;
+int countedges;
 #endif /* not ANSI_DECLARATORS */
 
-#endif /* not TRILIBRARY */
-
 {
-#ifdef TRILIBRARY
-  int *tlist;
-  REAL *talist;
-  int vertexindex;
-  int attribindex;
-#else /* not TRILIBRARY */
-  FILE *outfile;
-#endif /* not TRILIBRARY */
-  struct otri triangleloop;
-  vertex p1, p2, p3;
-  vertex mid1, mid2, mid3;
-  long elementnumber;
+  struct triblock *blocklist;
+  VOID **block;
+  _PTR_UINT alignptr;
+  long offset, edgeoffset, count;
+  int nblocks;
   int i;
 
-#ifdef TRILIBRARY
-  if (!b->quiet) {
-    printf("Writing triangles.\n");
-  }
-  /* Allocate memory for output triangles if necessary. */
-  if (*trianglelist == (int *) NULL) {
-    *trianglelist = (int *) trimalloc((int) (m->triangles.items *
-                                             ((b->order + 1) * (b->order + 2) /
-                                              2) * sizeof(int)));
-  }
-  /* Allocate memory for output triangle attributes if necessary. */
-  if ((m->eextras > 0) && (*triangleattriblist == (REAL *) NULL)) {
-    *triangleattriblist = (REAL *) trimalloc((int) (m->triangles.items *
-                                                    m->eextras *
-                                                    sizeof(REAL)));
-  }
-  tlist = *trianglelist;
-  talist = *triangleattriblist;
-  vertexindex = 0;
-  attribindex = 0;
-#else /* not TRILIBRARY */
-  if (!b->quiet) {
-    printf("Writing %s.\n", elefilename);
+  /* The pool's items end in `nowblock', at `nextitem'. */
+  nblocks = 1;
+  for (block = m->triangles.firstblock; block != m->triangles.nowblock;
+       block = (VOID **) *block) {
+    nblocks++;
+  }
+  blocklist = (struct triblock *) trimalloc(nblocks *
+                                            (int) sizeof(struct triblock));
+  block = m->triangles.firstblock;
+  for (i = 0; i < nblocks; i++) {
+    /* Find the first item in the block, as traversalinit() does. */
+    alignptr = (_PTR_UINT) (block + 1);
+    blocklist[i].firsttri = (triangle *)
+      (alignptr + (_PTR_UINT) m->triangles.alignbytes -
+       (alignptr % (_PTR_UINT) m->triangles.alignbytes));
+    if (block == m->triangles.nowblock) {
+      blocklist[i].items = (int) (((char *) m->triangles.nextitem -
+                                   (char *) blocklist[i].firsttri) /
+                                  m->triangles.itembytes);
+    } else if (i == 0) {
+      blocklist[i].items = m->triangles.itemsfirstblock;
+    } else {
+      blocklist[i].items = m->triangles.itemsperblock;
+    }
+    block = (VOID **) *block;
   }
-  outfile = fopen(elefilename, "w");
-  if (outfile == (FILE *) NULL) {
-    printf("  Error:  Cannot create file %s.\n", elefilename);
-    triexit(1);
+
+  /* Count the triangles and edges of each block... */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (nblocks > 1)
+#endif /* _OPENMP */
+  for (i = 0; i < nblocks; i++) {
+    counttriblock(m, &blocklist[i], countedges);
+  }
+  /*   ...and turn the counts into offsets. */
+  offset = 0;
+  edgeoffset = 0;
+  for (i = 0; i < nblocks; i++) {
+    count = blocklist[i].offset;
+    blocklist[i].offset = offset;
+    offset += count;
+    count = blocklist[i].edgeoffset;
+    blocklist[i].edgeoffset = edgeoffset;
+    edgeoffset += count;
   }
-  /* Number of triangles, vertices per triangle, attributes per triangle. */
-  fprintf(outfile, "%ld  %d  %d\n", m->triangles.items,
-          (b->order + 1) * (b->order + 2) / 2, m->eextras);
-#endif /* not TRILIBRARY */
 
-  traversalinit(&m->triangles);
-  triangleloop.tri = triangletraverse(m);
-  triangleloop.orient = 0;
-  elementnumber = b->firstnumber;
-  while (triangleloop.tri != (triangle *) NULL) {
-    org(triangleloop, p1);
-    dest(triangleloop, p2);
-    apex(triangleloop, p3);
-    if (b->order == 1) {
+  *blocks = blocklist;
+  return nblocks;
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  writemeshblock()   Write the triangles and the edges of one block of the */
+/*                     triangle pool (see triangleblocks()).                 */
+/*                                                                           */
+/*  Any of `tlist' and `elist' may be NULL.  If `numbered' is set, each      */
+/*  triangle's number is written over its first subsegment once the          */
+/*  triangle is done with, for writeneighborblock() to look up.              */
+/*                                                                           */
+/*****************************************************************************/
+
 #ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void writemeshblock(struct mesh *m, struct behavior *b, struct triblock *block,
+                    int *tlist, REAL *talist, int *elist, int *emlist,
+                    int numbered)
+#else /* not ANSI_DECLARATORS */
+void writemeshblock(m, b, block, tlist, talist, elist, emlist, numbered)
+struct mesh *m;
+struct behavior *b;
+struct triblock *block;
+int *tlist;
+REAL *talist;
+int *elist;
+int *emlist;
+int numbered;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct otri triangleloop, trisym;
+  struct osub checkmark;
+  vertex p1, p2, p3;
+  vertex mid1, mid2, mid3;
+  long elementnumber;
+  int vertexindex;
+  int attribindex;
+  int edgeindex;
+  int i, j;
+  triangle ptr;                         /* Temporary variable used by sym(). */
+  subseg sptr;                      /* Temporary variable used by tspivot(). */
+
+  elementnumber = b->firstnumber + block->offset;
+  vertexindex = 0;
+  attribindex = 0;
+  edgeindex = 0;
+  for (i = 0; i < block->items; i++) {
+    triangleloop.tri = (triangle *) ((char *) block->firsttri +
+                                     i * m->triangles.itembytes);
+    if (deadtri(triangleloop.tri)) {
+      continue;
+    }
+
+    if (tlist != (int *) NULL) {
+      triangleloop.orient = 0;
+      org(triangleloop, p1);
+      dest(triangleloop, p2);
+      apex(triangleloop, p3);
       tlist[vertexindex++] = vertexmark(p1);
       tlist[vertexindex++] = vertexmark(p2);
       tlist[vertexindex++] = vertexmark(p3);
-#else /* not TRILIBRARY */
+      if (b->order > 1) {
+        mid1 = (vertex) triangleloop.tri[m->highorderindex + 1];
+        mid2 = (vertex) triangleloop.tri[m->highorderindex + 2];
+        mid3 = (vertex) triangleloop.tri[m->highorderindex];
+        tlist[vertexindex++] = vertexmark(mid1);
+        tlist[vertexindex++] = vertexmark(mid2);
+        tlist[vertexindex++] = vertexmark(mid3);
+      }
+      for (j = 0; j < m->eextras; j++) {
+        talist[attribindex++] = elemattribute(triangleloop, j);
+      }
+    }
+
+    if (elist != (int *) NULL) {
+      /* Each edge is written by the adjoining triangle with the smaller */
+      /*   pointer, as in counttriblock().                               */
+      for (triangleloop.orient = 0; triangleloop.orient < 3;
+           triangleloop.orient++) {
+        sym(triangleloop, trisym);
+        if ((triangleloop.tri < trisym.tri) || (trisym.tri == m->dummytri)) {
+          org(triangleloop, p1);
+          dest(triangleloop, p2);
+          elist[2 * edgeindex] = vertexmark(p1);
+          elist[2 * edgeindex + 1] = vertexmark(p2);
+          if (emlist == (int *) NULL) {
+            /* The -B switch:  no boundary markers. */
+          } else if (b->usesegments) {
+            /* If there's no subsegment, the boundary marker is zero. */
+            tspivot(triangleloop, checkmark);
+            if (checkmark.ss == m->dummysub) {
+              emlist[edgeindex] = 0;
+            } else {
+              emlist[edgeindex] = mark(checkmark);
+            }
+          } else {
+            emlist[edgeindex] = trisym.tri == m->dummytri;
+          }
+          edgeindex++;
+        }
+      }
+    }
+
+    if (numbered) {
+      * (int *) (triangleloop.tri + 6) = (int) elementnumber;
+    }
+    elementnumber++;
+  }
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  writeneighborblock()   Write the neighbors of the triangles of one       */
+/*                         block, once every block is numbered.              */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void writeneighborblock(struct mesh *m, struct triblock *block, int *nlist)
+#else /* not ANSI_DECLARATORS */
+void writeneighborblock(m, block, nlist)
+struct mesh *m;
+struct triblock *block;
+int *nlist;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct otri triangleloop, trisym;
+  int index;
+  int i;
+  triangle ptr;                         /* Temporary variable used by sym(). */
+
+  index = 0;
+  for (i = 0; i < block->items; i++) {
+    triangleloop.tri = (triangle *) ((char *) block->firsttri +
+                                     i * m->triangles.itembytes);
+    if (deadtri(triangleloop.tri)) {
+      continue;
+    }
+    triangleloop.orient = 1;
+    sym(triangleloop, trisym);
+    nlist[index++] = * (int *) (trisym.tri + 6);
+    triangleloop.orient = 2;
+    sym(triangleloop, trisym);
+    nlist[index++] = * (int *) (trisym.tri + 6);
+    triangleloop.orient = 0;
+    sym(triangleloop, trisym);
+    nlist[index++] = * (int *) (trisym.tri + 6);
+  }
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  writemesh()   Write the triangles, the edges, and the neighbors to       */
+/*                arrays, in one traversal of the triangle pool.             */
+/*                                                                           */
+/*  Any of the requested arrays may be NULL.  The triangles and the edges    */
+/*  are numbered as in a serial traversal (see triangleblocks()).  The       */
+/*  neighbors need a second traversal, once every triangle has its number.   */
+/*                                                                           */
+/*  WARNING:  When neighbors are written, this procedure messes up the       */
+/*  subsegments of every element, like writevoronoi().                       */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void writemesh(struct mesh *m, struct behavior *b,
+               int **trianglelist, REAL **triangleattriblist,
+               int **edgelist, int **edgemarkerlist, int **neighborlist)
+#else /* not ANSI_DECLARATORS */
+void writemesh(m, b, trianglelist, triangleattriblist, edgelist,
+               edgemarkerlist, neighborlist)
+struct mesh *m;
+struct behavior *b;
+int **trianglelist;
+REAL **triangleattriblist;
+int **edgelist;
+int **edgemarkerlist;
+int **neighborlist;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct triblock *blocks;
+  int *tlist;
+  REAL *talist;
+  int *elist;
+  int *emlist;
+  int *nlist;
+  int corners;
+  int nblocks;
+  int i;
+
+  corners = (b->order + 1) * (b->order + 2) / 2;
+  tlist = (int *) NULL;
+  talist = (REAL *) NULL;
+  elist = (int *) NULL;
+  emlist = (int *) NULL;
+  nlist = (int *) NULL;
+  if (trianglelist != (int **) NULL) {
+    if (!b->quiet) {
+      printf("Writing triangles.\n");
+    }
+    /* Allocate memory for output triangles if necessary. */
+    if (*trianglelist == (int *) NULL) {
+      *trianglelist = (int *) trimalloc((int) (m->triangles.items * corners *
+                                               sizeof(int)));
+    }
+    /* Allocate memory for output triangle attributes if necessary. */
+    if ((m->eextras > 0) && (*triangleattriblist == (REAL *) NULL)) {
+      *triangleattriblist = (REAL *) trimalloc((int) (m->triangles.items *
+                                                      m->eextras *
+                                                      sizeof(REAL)));
+    }
+    tlist = *trianglelist;
+    talist = *triangleattriblist;
+  }
+  if (edgelist != (int **) NULL) {
+    if (!b->quiet) {
+      printf("Writing edges.\n");
+    }
+    /* Allocate memory for edges if necessary. */
+    if (*edgelist == (int *) NULL) {
+      *edgelist = (int *) trimalloc((int) (m->edges * 2 * sizeof(int)));
+    }
+    /* Allocate memory for edge markers if necessary. */
+    if (!b->nobound && (*edgemarkerlist == (int *) NULL)) {
+      *edgemarkerlist = (int *) trimalloc((int) (m->edges * sizeof(int)));
+    }
+    elist = *edgelist;
+    emlist = *edgemarkerlist;
+  }
+  if (neighborlist != (int **) NULL) {
+    if (!b->quiet) {
+      printf("Writing neighbors.\n");
+    }
+    /* Allocate memory for neighbors if necessary. */
+    if (*neighborlist == (int *) NULL) {
+      *neighborlist = (int *) trimalloc((int) (m->triangles.items * 3 *
+                                               sizeof(int)));
+    }
+    nlist = *neighborlist;
+  }
+  if ((tlist == (int *) NULL) && (elist == (int *) NULL) &&
+      (nlist == (int *) NULL)) {
+    return;
+  }
+
+  /* Write the blocks of the triangle pool independently. */
+  nblocks = triangleblocks(m, &blocks, elist != (int *) NULL);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (nblocks > 1)
+#endif /* _OPENMP */
+  for (i = 0; i < nblocks; i++) {
+    writemeshblock(m, b, &blocks[i],
+                   tlist == (int *) NULL ? (int *) NULL :
+                   &tlist[blocks[i].offset * corners],
+                   m->eextras == 0 || tlist == (int *) NULL ? (REAL *) NULL :
+                   &talist[blocks[i].offset * m->eextras],
+                   elist == (int *) NULL ? (int *) NULL :
+                   &elist[2 * blocks[i].edgeoffset],
+                   emlist == (int *) NULL ? (int *) NULL :
+                   &emlist[blocks[i].edgeoffset],
+                   nlist != (int *) NULL);
+  }
+  if (nlist != (int *) NULL) {
+    /* Every triangle now has its number. */
+    * (int *) (m->dummytri + 6) = -1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (nblocks > 1)
+#endif /* _OPENMP */
+    for (i = 0; i < nblocks; i++) {
+      writeneighborblock(m, &blocks[i], &nlist[3 * blocks[i].offset]);
+    }
+  }
+  trifree((VOID *) blocks);
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  reservelist()   Make room for `count' items of `size' bytes in an       */
+/*                  output array whose size is recorded in `*capacity' (see  */
+/*                  triangle.h), or free it if it is not `written'.          */
+/*                                                                           */
+/*  An array that is too small, or of unknown size, is freed and allocated   */
+/*  again a quarter larger than needed, or just as large if the quarter      */
+/*  would overflow.  A size that does not fit in a long is recorded as       */
+/*  unknown.  An array that is not written by this call is freed, so that,   */
+/*  as without `capacities', only the arrays that hold the output are not    */
+/*  NULL.                                                                    */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void reservelist(VOID **list, long *capacity, int written, size_t count,
+                 size_t size)
+#else /* not ANSI_DECLARATORS */
+void reservelist(list, capacity, written, count, size)
+VOID **list;
+long *capacity;
+int written;
+size_t count;
+size_t size;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  size_t longmax;
+  size_t room;
+
+  longmax = (size_t) (((unsigned long) -1) >> 1);
+  if (written && (*list != (VOID *) NULL) && (*capacity > 0) &&
+      ((size == 0) || ((size_t) *capacity / size >= count))) {
+    return;
+  }
+  if (*list != (VOID *) NULL) {
+    trifree(*list);
+    *list = (VOID *) NULL;
+  }
+  *capacity = 0;
+  if (written) {
+    room = count + count / 4;
+    if ((room < count) || ((size > 0) && (room > ((size_t) -1) / size))) {
+      room = count;
+    }
+    /* trimallocarray() fails cleanly if `count' items overflow. */
+    *list = trimallocarray(room > 0 ? room : 1, size);
+    if ((size == 0) || (room <= longmax / size)) {
+      *capacity = (long) (room * size);
+    }
+  }
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  reserveoutput()   Make room in the arrays of `out' that triangulate()    */
+/*                    is about to write, whose sizes are recorded in         */
+/*                    `out->capacities', and free the others.                */
+/*                                                                           */
+/*  The point arrays that `out' shares with `in' are left alone:             */
+/*  triangulate() either keeps them, or lets writenodes() allocate new ones. */
+/*  So are the edges and the neighbors deferred by the -K switch, which      */
+/*  trimeshoutput() makes room for.                                          */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void reserveoutput(struct mesh *m, struct behavior *b,
+                   struct triangulateio *in, struct triangulateio *out)
+#else /* not ANSI_DECLARATORS */
+void reserveoutput(m, b, in, out)
+struct mesh *m;
+struct behavior *b;
+struct triangulateio *in;
+struct triangulateio *out;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct triangulatecapacities *capacities;
+  long outvertices;
+  long corners;
+  int nodes, elements, segments, deferred;
+
+  capacities = out->capacities;
+  if (b->jettison) {
+    outvertices = m->vertices.items - m->undeads;
+  } else {
+    outvertices = m->vertices.items;
+  }
+  nodes = !b->nonodewritten && !(b->noiterationnum && m->readnodefile);
+  if ((out->pointlist == (REAL *) NULL) || (out->pointlist != in->pointlist)) {
+    reservelist((VOID **) &out->pointlist, &capacities->pointlist, nodes,
+                (size_t) outvertices, 2 * sizeof(REAL));
+  }
+  if ((out->pointattributelist == (REAL *) NULL) ||
+      (out->pointattributelist != in->pointattributelist)) {
+    reservelist((VOID **) &out->pointattributelist,
+                &capacities->pointattributelist, nodes && (m->nextras > 0),
+                (size_t) outvertices, (size_t) m->nextras * sizeof(REAL));
+  }
+  if ((out->pointmarkerlist == (int *) NULL) ||
+      (out->pointmarkerlist != in->pointmarkerlist)) {
+    reservelist((VOID **) &out->pointmarkerlist,
+                &capacities->pointmarkerlist, nodes && !b->nobound,
+                (size_t) outvertices, sizeof(int));
+  }
+
+  elements = !b->noelewritten;
+  corners = (b->order + 1) * (b->order + 2) / 2;
+  reservelist((VOID **) &out->trianglelist, &capacities->trianglelist,
+              elements, (size_t) m->triangles.items,
+              (size_t) corners * sizeof(int));
+  reservelist((VOID **) &out->triangleattributelist,
+              &capacities->triangleattributelist,
+              elements && (m->eextras > 0),
+              (size_t) m->triangles.items, (size_t) m->eextras * sizeof(REAL));
+
+  /* triangulate() gives up the -K switch for the Voronoi diagram, and */
+  /*   when neither the edges nor the neighbors are to be deferred.     */
+  deferred = b->keepmesh && !b->voronoi;
+  if (!deferred || !b->edgesout) {
+    reservelist((VOID **) &out->edgelist, &capacities->edgelist,
+                b->edgesout, (size_t) m->edges, 2 * sizeof(int));
+    reservelist((VOID **) &out->edgemarkerlist, &capacities->edgemarkerlist,
+                b->edgesout && !b->nobound, (size_t) m->edges, sizeof(int));
+  }
+  if (!deferred || !b->neighbors) {
+    reservelist((VOID **) &out->neighborlist, &capacities->neighborlist,
+                b->neighbors, (size_t) m->triangles.items, 3 * sizeof(int));
+  }
+
+  segments = (b->poly || b->convex) && !b->nopolywritten &&
+             !b->noiterationnum;
+  reservelist((VOID **) &out->segmentlist, &capacities->segmentlist,
+              segments, (size_t) m->subsegs.items, 2 * sizeof(int));
+  reservelist((VOID **) &out->segmentmarkerlist,
+              &capacities->segmentmarkerlist, segments && !b->nobound,
+              (size_t) m->subsegs.items, sizeof(int));
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  reservevoronoi()   Make room in the arrays of `vorout' that              */
+/*                     writevoronoi() is about to write, whose sizes are     */
+/*                     recorded in `vorout->capacities', and free the        */
+/*                     others.                                               */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void reservevoronoi(struct mesh *m, struct triangulateio *vorout)
+#else /* not ANSI_DECLARATORS */
+void reservevoronoi(m, vorout)
+struct mesh *m;
+struct triangulateio *vorout;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct triangulatecapacities *capacities;
+
+  capacities = vorout->capacities;
+  reservelist((VOID **) &vorout->pointlist, &capacities->pointlist, 1,
+              (size_t) m->triangles.items, 2 * sizeof(REAL));
+  reservelist((VOID **) &vorout->pointattributelist,
+              &capacities->pointattributelist, m->nextras > 0,
+              (size_t) m->triangles.items, (size_t) m->nextras * sizeof(REAL));
+  reservelist((VOID **) &vorout->pointmarkerlist,
+              &capacities->pointmarkerlist, 0, 0, sizeof(int));
+  reservelist((VOID **) &vorout->edgelist, &capacities->edgelist, 1,
+              (size_t) m->edges, 2 * sizeof(int));
+  reservelist((VOID **) &vorout->edgemarkerlist,
+              &capacities->edgemarkerlist, 0, 0, sizeof(int));
+  reservelist((VOID **) &vorout->normlist, &capacities->normlist, 1,
+              (size_t) m->edges, 2 * sizeof(REAL));
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  trimeshoutput()   Write the edges and/or the neighbors deferred by the   */
+/*                    -K switch, for a mesh kept in `out->mesh'.             */
+/*                                                                           */
+/*  `switches' selects the outputs with `e' and `n'.  Outputs that were not  */
+/*  selected when the mesh was built, or that were already written, are      */
+/*  skipped.  The triangle numbers that writemesh() stamps in each triangle  */
+/*  to write the neighbors are undone, so that the subsegments of the kept   */
+/*  mesh stay intact.                                                        */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void trimeshoutput(struct triangulateio *out, char *switches)
+#else /* not ANSI_DECLARATORS */
+void trimeshoutput(out, switches)
+struct triangulateio *out;
+char *switches;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct trimesh *kept;
+  struct otri triangleloop;
+  int *savedstamps;
+  int saveddummystamp;
+  int edges, neighbors;
+  long i;
+
+  kept = (struct trimesh *) out->mesh;
+  if (kept == (struct trimesh *) NULL) {
+    return;
+  }
+  edges = kept->deferedges && (strchr(switches, 'e') != (char *) NULL);
+  neighbors = kept->deferneighbors && (strchr(switches, 'n') != (char *) NULL);
+  if (!edges && !neighbors) {
+    return;
+  }
+
+  savedstamps = (int *) NULL;
+  saveddummystamp = 0;
+  if (neighbors) {
+    /* Save what writemesh() overwrites with the triangle numbers. */
+    savedstamps = (int *) trimalloc((int) (kept->m.triangles.items *
+                                           sizeof(int)));
+    traversalinit(&kept->m.triangles);
+    triangleloop.tri = triangletraverse(&kept->m);
+    for (i = 0; triangleloop.tri != (triangle *) NULL; i++) {
+      savedstamps[i] = * (int *) (triangleloop.tri + 6);
+      triangleloop.tri = triangletraverse(&kept->m);
+    }
+    saveddummystamp = * (int *) (kept->m.dummytri + 6);
+  }
+
+  if (out->capacities != (struct triangulatecapacities *) NULL) {
+    if (edges) {
+      reservelist((VOID **) &out->edgelist, &out->capacities->edgelist, 1,
+                  (size_t) kept->m.edges, 2 * sizeof(int));
+      reservelist((VOID **) &out->edgemarkerlist,
+                  &out->capacities->edgemarkerlist, !kept->b.nobound,
+                  (size_t) kept->m.edges, sizeof(int));
+    }
+    if (neighbors) {
+      reservelist((VOID **) &out->neighborlist,
+                  &out->capacities->neighborlist, 1,
+                  (size_t) kept->m.triangles.items, 3 * sizeof(int));
+    }
+  }
+
+  writemesh(&kept->m, &kept->b, (int **) NULL, (REAL **) NULL,
+            edges ? &out->edgelist : (int **) NULL,
+            edges ? &out->edgemarkerlist : (int **) NULL,
+            neighbors ? &out->neighborlist : (int **) NULL);
+
+  if (neighbors) {
+    traversalinit(&kept->m.triangles);
+    triangleloop.tri = triangletraverse(&kept->m);
+    for (i = 0; triangleloop.tri != (triangle *) NULL; i++) {
+      * (int *) (triangleloop.tri + 6) = savedstamps[i];
+      triangleloop.tri = triangletraverse(&kept->m);
+    }
+    * (int *) (kept->m.dummytri + 6) = saveddummystamp;
+    trifree((VOID *) savedstamps);
+    kept->deferneighbors = 0;
+  }
+  if (edges) {
+    kept->deferedges = 0;
+  }
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  trimeshfree()   Free the mesh kept by the -K switch.                     */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void trimeshfree(struct triangulateio *out)
+#else /* not ANSI_DECLARATORS */
+void trimeshfree(out)
+struct triangulateio *out;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct trimesh *kept;
+
+  kept = (struct trimesh *) out->mesh;
+  if (kept != (struct trimesh *) NULL) {
+    triangledeinit(&kept->m, &kept->b);
+    trifree((VOID *) kept);
+    out->mesh = (VOID *) NULL;
+  }
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  writeelements()   Write the triangles to an .ele file.                   */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifndef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void writeelements(struct mesh *m, struct behavior *b, char *elefilename,
+                   int argc, char **argv)
+#else /* not ANSI_DECLARATORS */
+void writeelements(m, b, elefilename, argc, argv)
+struct mesh *m;
+struct behavior *b;
+char *elefilename;
+int argc;
+char **argv;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  FILE *outfile;
+  struct otri triangleloop;
+  vertex p1, p2, p3;
+  vertex mid1, mid2, mid3;
+  long elementnumber;
+  int i;
+
+  if (!b->quiet) {
+    printf("Writing %s.\n", elefilename);
+  }
+  outfile = fopen(elefilename, "w");
+  if (outfile == (FILE *) NULL) {
+    printf("  Error:  Cannot create file %s.\n", elefilename);
+    triexit(1);
+  }
+  /* Number of triangles, vertices per triangle, attributes per triangle. */
+  fprintf(outfile, "%ld  %d  %d\n", m->triangles.items,
+          (b->order + 1) * (b->order + 2) / 2, m->eextras);
+
+  traversalinit(&m->triangles);
+  triangleloop.tri = triangletraverse(m);
+  triangleloop.orient = 0;
+  elementnumber = b->firstnumber;
+  while (triangleloop.tri != (triangle *) NULL) {
+    org(triangleloop, p1);
+    dest(triangleloop, p2);
+    apex(triangleloop, p3);
+    if (b->order == 1) {
       /* Triangle number, indices for three vertices. */
       fprintf(outfile, "%4ld    %4d  %4d  %4d", elementnumber,
               vertexmark(p1), vertexmark(p2), vertexmark(p3));
-#endif /* not TRILIBRARY */
     } else {
       mid1 = (vertex) triangleloop.tri[m->highorderindex + 1];
       mid2 = (vertex) triangleloop.tri[m->highorderindex + 2];
       mid3 = (vertex) triangleloop.tri[m->highorderindex];
-#ifdef TRILIBRARY
-      tlist[vertexindex++] = vertexmark(p1);
-      tlist[vertexindex++] = vertexmark(p2);
-      tlist[vertexindex++] = vertexmark(p3);
-      tlist[vertexindex++] = vertexmark(mid1);
-      tlist[vertexindex++] = vertexmark(mid2);
-      tlist[vertexindex++] = vertexmark(mid3);
-#else /* not TRILIBRARY */
       /* Triangle number, indices for six vertices. */
       fprintf(outfile, "%4ld    %4d  %4d  %4d  %4d  %4d  %4d", elementnumber,
               vertexmark(p1), vertexmark(p2), vertexmark(p3), vertexmark(mid1),
               vertexmark(mid2), vertexmark(mid3));
-#endif /* not TRILIBRARY */
     }
 
-#ifdef TRILIBRARY
-    for (i = 0; i < m->eextras; i++) {
-      talist[attribindex++] = elemattribute(triangleloop, i);
-    }
-#else /* not TRILIBRARY */
     for (i = 0; i < m->eextras; i++) {
       fprintf(outfile, "  %.17g", elemattribute(triangleloop, i));
     }
     fprintf(outfile, "\n");
-#endif /* not TRILIBRARY */
 
     triangleloop.tri = triangletraverse(m);
     elementnumber++;
   }
 
-#ifndef TRILIBRARY
   finishfile(outfile, argc, argv);
-#endif /* not TRILIBRARY */
 }
 
+#endif /* not TRILIBRARY */
+
 /*****************************************************************************/
 /*                                                                           */
 /*  writepoly()   Write the segments and holes to a .poly file.              */
@@ -14782,20 +16645,7 @@ char **argv;
 /*                                                                           */
 /*****************************************************************************/
 
-#ifdef TRILIBRARY
-
-#ifdef ANSI_DECLARATORS
-void writeedges(struct mesh *m, struct behavior *b,
-                int **edgelist, int **edgemarkerlist)
-#else /* not ANSI_DECLARATORS */
-void writeedges(m, b, edgelist, edgemarkerlist)
-struct mesh *m;
-struct behavior *b;
-int **edgelist;
-int **edgemarkerlist;
-#endif /* not ANSI_DECLARATORS */
-
-#else /* not TRILIBRARY */
+#ifndef TRILIBRARY
 
 #ifdef ANSI_DECLARATORS
 void writeedges(struct mesh *m, struct behavior *b, char *edgefilename,
@@ -14808,17 +16658,9 @@ char *edgefilename;
 int argc;
 char **argv;
 #endif /* not ANSI_DECLARATORS */
-
-#endif /* not TRILIBRARY */
-
-{
-#ifdef TRILIBRARY
-  int *elist;
-  int *emlist;
-  int index;
-#else /* not TRILIBRARY */
+
+{
   FILE *outfile;
-#endif /* not TRILIBRARY */
   struct otri triangleloop, trisym;
   struct osub checkmark;
   vertex p1, p2;
@@ -14826,22 +16668,6 @@ char **argv;
   triangle ptr;                         /* Temporary variable used by sym(). */
   subseg sptr;                      /* Temporary variable used by tspivot(). */
 
-#ifdef TRILIBRARY
-  if (!b->quiet) {
-    printf("Writing edges.\n");
-  }
-  /* Allocate memory for edges if necessary. */
-  if (*edgelist == (int *) NULL) {
-    *edgelist = (int *) trimalloc((int) (m->edges * 2 * sizeof(int)));
-  }
-  /* Allocate memory for edge markers if necessary. */
-  if (!b->nobound && (*edgemarkerlist == (int *) NULL)) {
-    *edgemarkerlist = (int *) trimalloc((int) (m->edges * sizeof(int)));
-  }
-  elist = *edgelist;
-  emlist = *edgemarkerlist;
-  index = 0;
-#else /* not TRILIBRARY */
   if (!b->quiet) {
     printf("Writing %s.\n", edgefilename);
   }
@@ -14852,7 +16678,6 @@ char **argv;
   }
   /* Number of edges, number of boundary markers (zero or one). */
   fprintf(outfile, "%ld  %d\n", m->edges, 1 - b->nobound);
-#endif /* not TRILIBRARY */
 
   traversalinit(&m->triangles);
   triangleloop.tri = triangletraverse(m);
@@ -14870,43 +16695,25 @@ char **argv;
       if ((triangleloop.tri < trisym.tri) || (trisym.tri == m->dummytri)) {
         org(triangleloop, p1);
         dest(triangleloop, p2);
-#ifdef TRILIBRARY
-        elist[index++] = vertexmark(p1);
-        elist[index++] = vertexmark(p2);
-#endif /* TRILIBRARY */
         if (b->nobound) {
-#ifndef TRILIBRARY
           /* Edge number, indices of two endpoints. */
           fprintf(outfile, "%4ld   %d  %d\n", edgenumber,
                   vertexmark(p1), vertexmark(p2));
-#endif /* not TRILIBRARY */
         } else {
           /* Edge number, indices of two endpoints, and a boundary marker. */
           /*   If there's no subsegment, the boundary marker is zero.      */
           if (b->usesegments) {
             tspivot(triangleloop, checkmark);
             if (checkmark.ss == m->dummysub) {
-#ifdef TRILIBRARY
-              emlist[edgenumber - b->firstnumber] = 0;
-#else /* not TRILIBRARY */
               fprintf(outfile, "%4ld   %d  %d  %d\n", edgenumber,
                       vertexmark(p1), vertexmark(p2), 0);
-#endif /* not TRILIBRARY */
             } else {
-#ifdef TRILIBRARY
-              emlist[edgenumber - b->firstnumber] = mark(checkmark);
-#else /* not TRILIBRARY */
               fprintf(outfile, "%4ld   %d  %d  %d\n", edgenumber,
                       vertexmark(p1), vertexmark(p2), mark(checkmark));
-#endif /* not TRILIBRARY */
             }
           } else {
-#ifdef TRILIBRARY
-            emlist[edgenumber - b->firstnumber] = trisym.tri == m->dummytri;
-#else /* not TRILIBRARY */
             fprintf(outfile, "%4ld   %d  %d  %d\n", edgenumber,
                     vertexmark(p1), vertexmark(p2), trisym.tri == m->dummytri);
-#endif /* not TRILIBRARY */
           }
         }
         edgenumber++;
@@ -14915,11 +16722,11 @@ char **argv;
     triangleloop.tri = triangletraverse(m);
   }
 
-#ifndef TRILIBRARY
   finishfile(outfile, argc, argv);
-#endif /* not TRILIBRARY */
 }
 
+#endif /* not TRILIBRARY */
+
 /*****************************************************************************/
 /*                                                                           */
 /*  writevoronoi()   Write the Voronoi diagram to a .v.node and .v.edge      */
@@ -15034,6 +16841,11 @@ char **argv;
     dest(triangleloop, tdest);
     apex(triangleloop, tapex);
     findcircumcenter(m, b, torg, tdest, tapex, circumcenter, &xi, &eta, 0);
+    if (b->translate) {
+      /* Undo translatenodes(). */
+      circumcenter[0] = circumcenter[0] * m->invscale + m->xorigin;
+      circumcenter[1] = circumcenter[1] * m->invscale + m->yorigin;
+    }
 #ifdef TRILIBRARY
     /* X and y coordinates. */
     plist[coordindex++] = circumcenter[0];
@@ -15115,15 +16927,16 @@ char **argv;
 #ifdef TRILIBRARY
           /* Copy an infinite ray.  Index of one endpoint, and -1. */
           elist[coordindex] = p1;
-          normlist[coordindex++] = tdest[1] - torg[1];
+          normlist[coordindex++] = (tdest[1] - torg[1]) * m->invscale;
           elist[coordindex] = -1;
-          normlist[coordindex++] = torg[0] - tdest[0];
+          normlist[coordindex++] = (torg[0] - tdest[0]) * m->invscale;
 #else /* not TRILIBRARY */
           /* Write an infinite ray.  Edge number, index of one endpoint, -1, */
           /*   and x and y coordinates of a vector representing the          */
           /*   direction of the ray.                                         */
           fprintf(outfile, "%4ld   %d  %d   %.17g  %.17g\n", vedgenumber,
-                  p1, -1, tdest[1] - torg[1], torg[0] - tdest[0]);
+                  p1, -1, (tdest[1] - torg[1]) * m->invscale,
+                  (torg[0] - tdest[0]) * m->invscale);
 #endif /* not TRILIBRARY */
         } else {
           /* Find the number of the adjacent triangle (and Voronoi vertex). */
@@ -15149,18 +16962,7 @@ char **argv;
 #endif /* not TRILIBRARY */
 }
 
-#ifdef TRILIBRARY
-
-#ifdef ANSI_DECLARATORS
-void writeneighbors(struct mesh *m, struct behavior *b, int **neighborlist)
-#else /* not ANSI_DECLARATORS */
-void writeneighbors(m, b, neighborlist)
-struct mesh *m;
-struct behavior *b;
-int **neighborlist;
-#endif /* not ANSI_DECLARATORS */
-
-#else /* not TRILIBRARY */
+#ifndef TRILIBRARY
 
 #ifdef ANSI_DECLARATORS
 void writeneighbors(struct mesh *m, struct behavior *b, char *neighborfilename,
@@ -15174,32 +16976,13 @@ int argc;
 char **argv;
 #endif /* not ANSI_DECLARATORS */
 
-#endif /* not TRILIBRARY */
-
 {
-#ifdef TRILIBRARY
-  int *nlist;
-  int index;
-#else /* not TRILIBRARY */
   FILE *outfile;
-#endif /* not TRILIBRARY */
   struct otri triangleloop, trisym;
   long elementnumber;
   int neighbor1, neighbor2, neighbor3;
   triangle ptr;                         /* Temporary variable used by sym(). */
 
-#ifdef TRILIBRARY
-  if (!b->quiet) {
-    printf("Writing neighbors.\n");
-  }
-  /* Allocate memory for neighbors if necessary. */
-  if (*neighborlist == (int *) NULL) {
-    *neighborlist = (int *) trimalloc((int) (m->triangles.items * 3 *
-                                             sizeof(int)));
-  }
-  nlist = *neighborlist;
-  index = 0;
-#else /* not TRILIBRARY */
   if (!b->quiet) {
     printf("Writing %s.\n", neighborfilename);
   }
@@ -15210,7 +16993,6 @@ char **argv;
   }
   /* Number of triangles, three neighbors per triangle. */
   fprintf(outfile, "%ld  %d\n", m->triangles.items, 3);
-#endif /* not TRILIBRARY */
 
   traversalinit(&m->triangles);
   triangleloop.tri = triangletraverse(m);
@@ -15236,25 +17018,19 @@ char **argv;
     triangleloop.orient = 0;
     sym(triangleloop, trisym);
     neighbor3 = * (int *) (trisym.tri + 6);
-#ifdef TRILIBRARY
-    nlist[index++] = neighbor1;
-    nlist[index++] = neighbor2;
-    nlist[index++] = neighbor3;
-#else /* not TRILIBRARY */
     /* Triangle number, neighboring triangle numbers. */
     fprintf(outfile, "%4ld    %d  %d  %d\n", elementnumber,
             neighbor1, neighbor2, neighbor3);
-#endif /* not TRILIBRARY */
 
     triangleloop.tri = triangletraverse(m);
     elementnumber++;
   }
 
-#ifndef TRILIBRARY
   finishfile(outfile, argc, argv);
-#endif /* not TRILIBRARY */
 }
 
+#endif /* not TRILIBRARY */
+
 /*****************************************************************************/
 /*                                                                           */
 /*  writeoff()   Write the triangulation to an .off file.                    */
@@ -15439,112 +17215,826 @@ struct behavior *b;
       }
     }
 
-    triarea = counterclockwise(m, b, p[0], p[1], p[2]);
-    if (triarea < smallestarea) {
-      smallestarea = triarea;
-    }
-    if (triarea > biggestarea) {
-      biggestarea = triarea;
-    }
-    triminaltitude2 = triarea * triarea / trilongest2;
-    if (triminaltitude2 < minaltitude) {
-      minaltitude = triminaltitude2;
-    }
-    triaspect2 = trilongest2 / triminaltitude2;
-    if (triaspect2 > worstaspect) {
-      worstaspect = triaspect2;
+    triarea = counterclockwise(m, b, p[0], p[1], p[2]);
+    if (triarea < smallestarea) {
+      smallestarea = triarea;
+    }
+    if (triarea > biggestarea) {
+      biggestarea = triarea;
+    }
+    triminaltitude2 = triarea * triarea / trilongest2;
+    if (triminaltitude2 < minaltitude) {
+      minaltitude = triminaltitude2;
+    }
+    triaspect2 = trilongest2 / triminaltitude2;
+    if (triaspect2 > worstaspect) {
+      worstaspect = triaspect2;
+    }
+    aspectindex = 0;
+    while ((triaspect2 > ratiotable[aspectindex] * ratiotable[aspectindex])
+           && (aspectindex < 15)) {
+      aspectindex++;
+    }
+    aspecttable[aspectindex]++;
+
+    for (i = 0; i < 3; i++) {
+      j = plus1mod3[i];
+      k = minus1mod3[i];
+      dotproduct = dx[j] * dx[k] + dy[j] * dy[k];
+      cossquare = dotproduct * dotproduct / (edgelength[j] * edgelength[k]);
+      tendegree = 8;
+      for (ii = 7; ii >= 0; ii--) {
+        if (cossquare > cossquaretable[ii]) {
+          tendegree = ii;
+        }
+      }
+      if (dotproduct <= 0.0) {
+        angletable[tendegree]++;
+        if (cossquare > smallestangle) {
+          smallestangle = cossquare;
+        }
+        if (acutebiggest && (cossquare < biggestangle)) {
+          biggestangle = cossquare;
+        }
+      } else {
+        angletable[17 - tendegree]++;
+        if (acutebiggest || (cossquare > biggestangle)) {
+          biggestangle = cossquare;
+          acutebiggest = 0;
+        }
+      }
+    }
+    triangleloop.tri = triangletraverse(m);
+  }
+
+  shortest = sqrt(shortest);
+  longest = sqrt(longest);
+  minaltitude = sqrt(minaltitude);
+  worstaspect = sqrt(worstaspect);
+  smallestarea *= 0.5;
+  biggestarea *= 0.5;
+  if (smallestangle >= 1.0) {
+    smallestangle = 0.0;
+  } else {
+    smallestangle = degconst * acos(sqrt(smallestangle));
+  }
+  if (biggestangle >= 1.0) {
+    biggestangle = 180.0;
+  } else {
+    if (acutebiggest) {
+      biggestangle = degconst * acos(sqrt(biggestangle));
+    } else {
+      biggestangle = 180.0 - degconst * acos(sqrt(biggestangle));
+    }
+  }
+
+  printf("  Smallest area: %16.5g   |  Largest area: %16.5g\n",
+         smallestarea, biggestarea);
+  printf("  Shortest edge: %16.5g   |  Longest edge: %16.5g\n",
+         shortest, longest);
+  printf("  Shortest altitude: %12.5g   |  Largest aspect ratio: %8.5g\n\n",
+         minaltitude, worstaspect);
+
+  printf("  Triangle aspect ratio histogram:\n");
+  printf("  1.1547 - %-6.6g    :  %8d    | %6.6g - %-6.6g     :  %8d\n",
+         ratiotable[0], aspecttable[0], ratiotable[7], ratiotable[8],
+         aspecttable[8]);
+  for (i = 1; i < 7; i++) {
+    printf("  %6.6g - %-6.6g    :  %8d    | %6.6g - %-6.6g     :  %8d\n",
+           ratiotable[i - 1], ratiotable[i], aspecttable[i],
+           ratiotable[i + 7], ratiotable[i + 8], aspecttable[i + 8]);
+  }
+  printf("  %6.6g - %-6.6g    :  %8d    | %6.6g -            :  %8d\n",
+         ratiotable[6], ratiotable[7], aspecttable[7], ratiotable[14],
+         aspecttable[15]);
+  printf("  (Aspect ratio is longest edge divided by shortest altitude)\n\n");
+
+  printf("  Smallest angle: %15.5g   |  Largest angle: %15.5g\n\n",
+         smallestangle, biggestangle);
+
+  printf("  Angle histogram:\n");
+  for (i = 0; i < 9; i++) {
+    printf("    %3d - %3d degrees:  %8d    |    %3d - %3d degrees:  %8d\n",
+           i * 10, i * 10 + 10, angletable[i],
+           i * 10 + 90, i * 10 + 100, angletable[i + 9]);
+  }
+  printf("\n");
+}
+
+/*****************************************************************************/
+/*                                                                           */
+/*  measurequality()   Compute the quality of each triangle of an output     */
+/*                     mesh, and the statistics quality_statistics() prints. */
+/*                                                                           */
+/*  The mesh is given by its `pointlist' and `trianglelist' (whose first     */
+/*  three corners are used), so this works on the output of triangulate()    */
+/*  long after the mesh itself is gone.  `firstnumber' is 1 unless the `z'   */
+/*  switch was used.  Any of `minanglelist' (smallest angle of each          */
+/*  triangle, in degrees), `aspectlist' (longest edge divided by shortest    */
+/*  altitude), and `arealist' may be NULL.  The triangles are measured       */
+/*  concurrently when compiled with OpenMP.                                  */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void measurequality(REAL *pointlist, int *trianglelist, int numberoftriangles,
+                    int numberofcorners, int firstnumber, REAL *minanglelist,
+                    REAL *aspectlist, REAL *arealist,
+                    struct qualitystats *quality)
+#else /* not ANSI_DECLARATORS */
+void measurequality(pointlist, trianglelist, numberoftriangles,
+                    numberofcorners, firstnumber, minanglelist, aspectlist,
+                    arealist, quality)
+REAL *pointlist;
+int *trianglelist;
+int numberoftriangles;
+int numberofcorners;
+int firstnumber;
+REAL *minanglelist;
+REAL *aspectlist;
+REAL *arealist;
+struct qualitystats *quality;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  static REAL qualityratiotable[15] = {1.5, 2.0, 2.5, 3.0, 4.0, 6.0, 10.0,
+                                       15.0, 25.0, 50.0, 100.0, 300.0,
+                                       1000.0, 10000.0, 100000.0};
+  REAL shortest2, longest2, minaltitude2;
+  int t;
+
+  quality->smallestangle = 180.0;
+  quality->biggestangle = 0.0;
+  quality->smallestarea = numberoftriangles > 0 ? HUGE_VAL : 0.0;
+  quality->biggestarea = 0.0;
+  quality->worstaspect = 0.0;
+  shortest2 = numberoftriangles > 0 ? HUGE_VAL : 0.0;
+  longest2 = 0.0;
+  minaltitude2 = numberoftriangles > 0 ? HUGE_VAL : 0.0;
+  for (t = 0; t < 18; t++) {
+    quality->angletable[t] = 0;
+  }
+  for (t = 0; t < 16; t++) {
+    quality->aspecttable[t] = 0;
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif /* _OPENMP */
+  {
+    /* Each thread gathers its own statistics, merged at the end. */
+    struct qualitystats part;
+    REAL partshortest2, partlongest2, partminaltitude2;
+    REAL *p[3];
+    REAL edgelength[3];
+    REAL ux, uy, vx, vy;
+    REAL cross, area, aspect, angle, minangle;
+    REAL trilongest2, altitude2;
+    int i, j, k, n;
+
+    part = *quality;
+    for (k = 0; k < 18; k++) {
+      part.angletable[k] = 0;
+    }
+    for (k = 0; k < 16; k++) {
+      part.aspecttable[k] = 0;
+    }
+    partshortest2 = shortest2;
+    partlongest2 = longest2;
+    partminaltitude2 = minaltitude2;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif /* _OPENMP */
+    for (n = 0; n < numberoftriangles; n++) {
+      for (k = 0; k < 3; k++) {
+        p[k] = &pointlist[2 * (trianglelist[n * numberofcorners + k] -
+                               firstnumber)];
+      }
+
+      trilongest2 = 0.0;
+      minangle = 180.0;
+      for (k = 0; k < 3; k++) {
+        /* The angle at corner k, and the length of the edge opposite. */
+        i = plus1mod3[k];
+        j = minus1mod3[k];
+        ux = p[i][0] - p[k][0];
+        uy = p[i][1] - p[k][1];
+        vx = p[j][0] - p[k][0];
+        vy = p[j][1] - p[k][1];
+        angle = (180.0 / PI) *
+                atan2(fabs(ux * vy - uy * vx), ux * vx + uy * vy);
+        edgelength[k] = (vx - ux) * (vx - ux) + (vy - uy) * (vy - uy);
+        if (edgelength[k] > trilongest2) {
+          trilongest2 = edgelength[k];
+        }
+        if (edgelength[k] > partlongest2) {
+          partlongest2 = edgelength[k];
+        }
+        if (edgelength[k] < partshortest2) {
+          partshortest2 = edgelength[k];
+        }
+        if (angle < minangle) {
+          minangle = angle;
+        }
+        if (angle < part.smallestangle) {
+          part.smallestangle = angle;
+        }
+        if (angle > part.biggestangle) {
+          part.biggestangle = angle;
+        }
+        part.angletable[angle < 170.0 ? (int) (angle / 10.0) : 17]++;
+      }
+
+      cross = (p[1][0] - p[0][0]) * (p[2][1] - p[0][1]) -
+              (p[1][1] - p[0][1]) * (p[2][0] - p[0][0]);
+      area = 0.5 * cross;
+      if (area < part.smallestarea) {
+        part.smallestarea = area;
+      }
+      if (area > part.biggestarea) {
+        part.biggestarea = area;
+      }
+      altitude2 = cross * cross / trilongest2;
+      if (altitude2 < partminaltitude2) {
+        partminaltitude2 = altitude2;
+      }
+      aspect = trilongest2 / fabs(cross);
+      if (aspect > part.worstaspect) {
+        part.worstaspect = aspect;
+      }
+      for (k = 0; (k < 15) && (aspect > qualityratiotable[k]); k++);
+      part.aspecttable[k]++;
+
+      if (minanglelist != (REAL *) NULL) {
+        minanglelist[n] = minangle;
+      }
+      if (aspectlist != (REAL *) NULL) {
+        aspectlist[n] = aspect;
+      }
+      if (arealist != (REAL *) NULL) {
+        arealist[n] = area;
+      }
+    }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif /* _OPENMP */
+    {
+      if (part.smallestangle < quality->smallestangle) {
+        quality->smallestangle = part.smallestangle;
+      }
+      if (part.biggestangle > quality->biggestangle) {
+        quality->biggestangle = part.biggestangle;
+      }
+      if (part.smallestarea < quality->smallestarea) {
+        quality->smallestarea = part.smallestarea;
+      }
+      if (part.biggestarea > quality->biggestarea) {
+        quality->biggestarea = part.biggestarea;
+      }
+      if (part.worstaspect > quality->worstaspect) {
+        quality->worstaspect = part.worstaspect;
+      }
+      if (partshortest2 < shortest2) {
+        shortest2 = partshortest2;
+      }
+      if (partlongest2 > longest2) {
+        longest2 = partlongest2;
+      }
+      if (partminaltitude2 < minaltitude2) {
+        minaltitude2 = partminaltitude2;
+      }
+      for (k = 0; k < 18; k++) {
+        quality->angletable[k] += part.angletable[k];
+      }
+      for (k = 0; k < 16; k++) {
+        quality->aspecttable[k] += part.aspecttable[k];
+      }
+    }
+  }
+
+  quality->shortestedge = sqrt(shortest2);
+  quality->longestedge = sqrt(longest2);
+  quality->shortestaltitude = sqrt(minaltitude2);
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  clipcell()   Clip a polygon to one side of an axis-parallel line.        */
+/*                                                                           */
+/*  Sutherland-Hodgman clipping of the `count' vertices of `polygon' (with   */
+/*  their `ids') against the line where coordinate `axis' equals `bound';    */
+/*  the side kept is above the line if `above' is set, below otherwise.      */
+/*  The result goes to `clipped' and `clippedids', and its number of         */
+/*  vertices is returned.  Vertices created on the line get the id -2.       */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+int clipcell(REAL *polygon, int *ids, int count, int axis, REAL bound,
+             int above, REAL *clipped, int *clippedids)
+#else /* not ANSI_DECLARATORS */
+int clipcell(polygon, ids, count, axis, bound, above, clipped, clippedids)
+REAL *polygon;
+int *ids;
+int count;
+int axis;
+REAL bound;
+int above;
+REAL *clipped;
+int *clippedids;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  REAL *p, *q;
+  REAL t;
+  int pinside, qinside;
+  int clippedcount;
+  int i;
+
+  clippedcount = 0;
+  for (i = 0; i < count; i++) {
+    p = &polygon[2 * ((i + count - 1) % count)];
+    q = &polygon[2 * i];
+    pinside = above ? (p[axis] >= bound) : (p[axis] <= bound);
+    qinside = above ? (q[axis] >= bound) : (q[axis] <= bound);
+    if (pinside != qinside) {
+      /* The edge pq crosses the line. */
+      t = (bound - p[axis]) / (q[axis] - p[axis]);
+      clipped[2 * clippedcount] = p[0] + t * (q[0] - p[0]);
+      clipped[2 * clippedcount + 1] = p[1] + t * (q[1] - p[1]);
+      clipped[2 * clippedcount + axis] = bound;
+      clippedids[clippedcount++] = -2;
+    }
+    if (qinside) {
+      clipped[2 * clippedcount] = q[0];
+      clipped[2 * clippedcount + 1] = q[1];
+      clippedids[clippedcount++] = ids[i];
+    }
+  }
+  return clippedcount;
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  voronoicell()   Gather the Voronoi cell of one vertex, from the          */
+/*                  triangles around it.                                     */
+/*                                                                           */
+/*  `incident' lists the `degree' triangles that have `vertex' as a corner,  */
+/*  each as its number, its two other corners, counterclockwise, and the     */
+/*  place in `incident' of the triangle that shares its second edge at the   */
+/*  vertex (-1 if none).  They are chained counterclockwise around the       */
+/*  vertex by these places, in time linear in `degree'.  The cell is the     */
+/*  polygon of their circumcenters.  If the chain is open (the vertex lies   */
+/*  on the boundary of the mesh), the cell is open too:  without a           */
+/*  `clipbox', the -1 id comes first to say so; with one, the cell is closed */
+/*  by the rays perpendicular to the two boundary edges (or by their         */
+/*  intersection if they converge), then clipped to the box.  Should the     */
+/*  triangles around the vertex form several fans, only the first one is     */
+/*  used.                                                                    */
+/*                                                                           */
+/*  `scratch' must hold 64 * (degree + 3) REALs, `scratchids' half as many   */
+/*  ints, and `chain' `degree' ints.  The length of the cell is returned,    */
+/*  and the number of vertices it adds (those not at a circumcenter) in      */
+/*  `newcount'.  If `cell' is not NULL, the ids of the vertices are written  */
+/*  to it:  the number of the triangle for a circumcenter, or `firstnew'     */
+/*  onwards for an added vertex, whose coordinates go to `newvertices'.      */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+int voronoicell(REAL *pointlist, int firstnumber, REAL *circumcenters,
+                int *incident, int degree, int vertex, REAL *clipbox,
+                REAL *scratch, int *scratchids, int *chain, int *cell,
+                REAL *newvertices, int firstnew, int *newcount)
+#else /* not ANSI_DECLARATORS */
+int voronoicell(pointlist, firstnumber, circumcenters, incident, degree,
+                vertex, clipbox, scratch, scratchids, chain, cell,
+                newvertices, firstnew, newcount)
+REAL *pointlist;
+int firstnumber;
+REAL *circumcenters;
+int *incident;
+int degree;
+int vertex;
+REAL *clipbox;
+REAL *scratch;
+int *scratchids;
+int *chain;
+int *cell;
+REAL *newvertices;
+int firstnew;
+int *newcount;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  REAL *polygon, *clipped, *swap;
+  REAL *v, *first, *last, *firstcenter, *lastcenter;
+  REAL firstnormal[2], lastnormal[2], middle[2];
+  REAL norm, farness, dist, det, s;
+  int *ids, *clippedids, *swapids;
+  int length, count, open;
+  int i, j, k;
+
+  *newcount = 0;
+  if (degree == 0) {
+    return 0;
+  }
+
+  /* Find the first triangle:  the one that follows no other, if any. */
+  for (i = 0; i < degree; i++) {
+    chain[i] = 0;
+  }
+  for (i = 0; i < degree; i++) {
+    if (incident[4 * i + 3] >= 0) {
+      chain[incident[4 * i + 3]] = 1;
     }
-    aspectindex = 0;
-    while ((triaspect2 > ratiotable[aspectindex] * ratiotable[aspectindex])
-           && (aspectindex < 15)) {
-      aspectindex++;
+  }
+  open = 0;
+  for (i = 0; (i < degree) && !open; i++) {
+    open = !chain[i];
+  }
+  chain[0] = open ? i - 1 : 0;
+
+  /* Walk counterclockwise from the first triangle. */
+  for (length = 1; length < degree; length++) {
+    j = incident[4 * chain[length - 1] + 3];
+    if ((j < 0) || (j == chain[0])) {
+      break;
     }
-    aspecttable[aspectindex]++;
+    chain[length] = j;
+  }
 
-    for (i = 0; i < 3; i++) {
-      j = plus1mod3[i];
-      k = minus1mod3[i];
-      dotproduct = dx[j] * dx[k] + dy[j] * dy[k];
-      cossquare = dotproduct * dotproduct / (edgelength[j] * edgelength[k]);
-      tendegree = 8;
-      for (ii = 7; ii >= 0; ii--) {
-        if (cossquare > cossquaretable[ii]) {
-          tendegree = ii;
-        }
+  if (clipbox == (REAL *) NULL) {
+    /* No coordinates needed. */
+    if (cell != (int *) NULL) {
+      if (open) {
+        *(cell++) = -1;
       }
-      if (dotproduct <= 0.0) {
-        angletable[tendegree]++;
-        if (cossquare > smallestangle) {
-          smallestangle = cossquare;
-        }
-        if (acutebiggest && (cossquare < biggestangle)) {
-          biggestangle = cossquare;
-        }
-      } else {
-        angletable[17 - tendegree]++;
-        if (acutebiggest || (cossquare > biggestangle)) {
-          biggestangle = cossquare;
-          acutebiggest = 0;
+      for (i = 0; i < length; i++) {
+        cell[i] = incident[4 * chain[i]];
+      }
+    }
+    return open ? length + 1 : length;
+  }
+
+  polygon = scratch;
+  ids = scratchids;
+  for (i = 0; i < length; i++) {
+    polygon[2 * i] = circumcenters[2 * incident[4 * chain[i]]];
+    polygon[2 * i + 1] = circumcenters[2 * incident[4 * chain[i]] + 1];
+    ids[i] = incident[4 * chain[i]];
+  }
+  count = length;
+
+  if (open) {
+    /* Close the cell beyond the boundary edges of the first and the last */
+    /*   triangles, whose outer normals are the directions of the rays.   */
+    v = &pointlist[2 * vertex];
+    first = &pointlist[2 * (incident[4 * chain[0] + 1] - firstnumber)];
+    last = &pointlist[2 * (incident[4 * chain[count - 1] + 2] - firstnumber)];
+    firstnormal[0] = first[1] - v[1];
+    firstnormal[1] = v[0] - first[0];
+    lastnormal[0] = v[1] - last[1];
+    lastnormal[1] = last[0] - v[0];
+    norm = sqrt(firstnormal[0] * firstnormal[0] +
+                firstnormal[1] * firstnormal[1]);
+    firstnormal[0] /= norm;
+    firstnormal[1] /= norm;
+    norm = sqrt(lastnormal[0] * lastnormal[0] +
+                lastnormal[1] * lastnormal[1]);
+    lastnormal[0] /= norm;
+    lastnormal[1] /= norm;
+    firstcenter = &polygon[0];
+    lastcenter = &polygon[2 * (count - 1)];
+
+    det = lastnormal[0] * firstnormal[1] - lastnormal[1] * firstnormal[0];
+    if ((det > 0.0) || ((det == 0.0) &&
+                        (lastnormal[0] * firstnormal[0] +
+                         lastnormal[1] * firstnormal[1] > 0.0))) {
+      /* The rays diverge:  add a point far along each of them, and one  */
+      /*   in between, far enough for the box to be inside the polygon.  */
+      farness = (clipbox[2] - clipbox[0]) + (clipbox[3] - clipbox[1]);
+      for (i = 0; i < count; i++) {
+        dist = fabs(polygon[2 * i] - v[0]) + fabs(polygon[2 * i + 1] - v[1]);
+        if (dist > farness) {
+          farness = dist;
         }
       }
+      farness *= 4.0;
+      middle[0] = firstnormal[0] + lastnormal[0];
+      middle[1] = firstnormal[1] + lastnormal[1];
+      norm = sqrt(middle[0] * middle[0] + middle[1] * middle[1]);
+      if (norm < 0.5) {
+        /* The rays are nearly opposite:  bisect their normals instead. */
+        middle[0] = firstnormal[1] - lastnormal[1];
+        middle[1] = lastnormal[0] - firstnormal[0];
+        norm = sqrt(middle[0] * middle[0] + middle[1] * middle[1]);
+      }
+      polygon[2 * count] = lastcenter[0] + farness * lastnormal[0];
+      polygon[2 * count + 1] = lastcenter[1] + farness * lastnormal[1];
+      polygon[2 * count + 2] = v[0] + farness * middle[0] / norm;
+      polygon[2 * count + 3] = v[1] + farness * middle[1] / norm;
+      polygon[2 * count + 4] = firstcenter[0] + farness * firstnormal[0];
+      polygon[2 * count + 5] = firstcenter[1] + farness * firstnormal[1];
+      ids[count] = ids[count + 1] = ids[count + 2] = -2;
+      count += 3;
+    } else if (det < 0.0) {
+      /* The rays converge (at a reflex corner of a hole, say). */
+      s = ((firstcenter[0] - lastcenter[0]) * firstnormal[1] -
+           (firstcenter[1] - lastcenter[1]) * firstnormal[0]) / det;
+      if (s > 0.0) {
+        polygon[2 * count] = lastcenter[0] + s * lastnormal[0];
+        polygon[2 * count + 1] = lastcenter[1] + s * lastnormal[1];
+        ids[count++] = -2;
+      }
     }
-    triangleloop.tri = triangletraverse(m);
   }
 
-  shortest = sqrt(shortest);
-  longest = sqrt(longest);
-  minaltitude = sqrt(minaltitude);
-  worstaspect = sqrt(worstaspect);
-  smallestarea *= 0.5;
-  biggestarea *= 0.5;
-  if (smallestangle >= 1.0) {
-    smallestangle = 0.0;
-  } else {
-    smallestangle = degconst * acos(sqrt(smallestangle));
+  clipped = scratch + 32 * (degree + 3);
+  clippedids = scratchids + 16 * (degree + 3);
+  for (k = 0; k < 4; k++) {
+    /* xmin, ymin, xmax, ymax in turn. */
+    count = clipcell(polygon, ids, count, k % 2, clipbox[k], k < 2,
+                     clipped, clippedids);
+    swap = polygon;
+    polygon = clipped;
+    clipped = swap;
+    swapids = ids;
+    ids = clippedids;
+    clippedids = swapids;
   }
-  if (biggestangle >= 1.0) {
-    biggestangle = 180.0;
-  } else {
-    if (acutebiggest) {
-      biggestangle = degconst * acos(sqrt(biggestangle));
-    } else {
-      biggestangle = 180.0 - degconst * acos(sqrt(biggestangle));
+
+  for (i = 0; i < count; i++) {
+    if (ids[i] < 0) {
+      if (cell != (int *) NULL) {
+        newvertices[2 * *newcount] = polygon[2 * i];
+        newvertices[2 * *newcount + 1] = polygon[2 * i + 1];
+        ids[i] = firstnew + *newcount;
+      }
+      (*newcount)++;
+    }
+    if (cell != (int *) NULL) {
+      cell[i] = ids[i];
     }
   }
+  return count;
+}
 
-  printf("  Smallest area: %16.5g   |  Largest area: %16.5g\n",
-         smallestarea, biggestarea);
-  printf("  Shortest edge: %16.5g   |  Longest edge: %16.5g\n",
-         shortest, longest);
-  printf("  Shortest altitude: %12.5g   |  Largest aspect ratio: %8.5g\n\n",
-         minaltitude, worstaspect);
+#endif /* TRILIBRARY */
 
-  printf("  Triangle aspect ratio histogram:\n");
-  printf("  1.1547 - %-6.6g    :  %8d    | %6.6g - %-6.6g     :  %8d\n",
-         ratiotable[0], aspecttable[0], ratiotable[7], ratiotable[8],
-         aspecttable[8]);
-  for (i = 1; i < 7; i++) {
-    printf("  %6.6g - %-6.6g    :  %8d    | %6.6g - %-6.6g     :  %8d\n",
-           ratiotable[i - 1], ratiotable[i], aspecttable[i],
-           ratiotable[i + 7], ratiotable[i + 8], aspecttable[i + 8]);
-  }
-  printf("  %6.6g - %-6.6g    :  %8d    | %6.6g -            :  %8d\n",
-         ratiotable[6], ratiotable[7], aspecttable[7], ratiotable[14],
-         aspecttable[15]);
-  printf("  (Aspect ratio is longest edge divided by shortest altitude)\n\n");
+/*****************************************************************************/
+/*                                                                           */
+/*  voronoicells()   Compute the Voronoi cell of every vertex of an output   */
+/*                   mesh, in compressed sparse row form.                    */
+/*                                                                           */
+/*  The mesh is given by its `pointlist' and `trianglelist' as in            */
+/*  measurequality().  The vertices of the cells are the circumcenters of    */
+/*  the triangles, in the order of the triangles, followed by the vertices   */
+/*  added to close and clip the cells if `clipbox' (xmin, ymin, xmax, ymax)  */
+/*  is not NULL; `numberofvertices' of them in all, in `vertexlist'.  The    */
+/*  cell of vertex i lists the (zero-based) numbers of its vertices,         */
+/*  counterclockwise, from `cellvertexlist[celloffsetlist[i]]' up to         */
+/*  `cellvertexlist[celloffsetlist[i + 1]]' excluded.  See voronoicell() for */
+/*  the open cells of the boundary vertices.  Vertices that are not a corner */
+/*  of any triangle get an empty cell.  The three lists are allocated with   */
+/*  trimalloc().  The cells are gathered concurrently when compiled with     */
+/*  OpenMP.                                                                  */
+/*                                                                           */
+/*****************************************************************************/
 
-  printf("  Smallest angle: %15.5g   |  Largest angle: %15.5g\n\n",
-         smallestangle, biggestangle);
+#ifdef TRILIBRARY
 
-  printf("  Angle histogram:\n");
-  for (i = 0; i < 9; i++) {
-    printf("    %3d - %3d degrees:  %8d    |    %3d - %3d degrees:  %8d\n",
-           i * 10, i * 10 + 10, angletable[i],
-           i * 10 + 90, i * 10 + 100, angletable[i + 9]);
+#ifdef ANSI_DECLARATORS
+void voronoicells(REAL *pointlist, int numberofpoints, int *trianglelist,
+                  int numberoftriangles, int numberofcorners,
+                  int firstnumber, REAL *clipbox, REAL **vertexlist,
+                  int *numberofvertices, int **celloffsetlist,
+                  int **cellvertexlist)
+#else /* not ANSI_DECLARATORS */
+void voronoicells(pointlist, numberofpoints, trianglelist, numberoftriangles,
+                  numberofcorners, firstnumber, clipbox, vertexlist,
+                  numberofvertices, celloffsetlist, cellvertexlist)
+REAL *pointlist;
+int numberofpoints;
+int *trianglelist;
+int numberoftriangles;
+int numberofcorners;
+int firstnumber;
+REAL *clipbox;
+REAL **vertexlist;
+int *numberofvertices;
+int **celloffsetlist;
+int **cellvertexlist;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  REAL *circumcenters;
+  int *incidentoffset, *incident, *place;
+  int *celloffset, *newoffset;
+  int maxdegree;
+  int i, j, k, n;
+
+  /* The triangles around each vertex, in compressed sparse row form. */
+  incidentoffset = (int *) trimallocarray((size_t) numberofpoints + 1,
+                                          sizeof(int));
+  incident = (int *) trimallocarray(12 * (size_t) numberoftriangles + 1,
+                                    sizeof(int));
+  for (i = 0; i <= numberofpoints; i++) {
+    incidentoffset[i] = 0;
+  }
+  for (n = 0; n < numberoftriangles; n++) {
+    for (k = 0; k < 3; k++) {
+      incidentoffset[trianglelist[n * numberofcorners + k] - firstnumber +
+                     1]++;
+    }
+  }
+  maxdegree = 0;
+  for (i = 0; i < numberofpoints; i++) {
+    if (incidentoffset[i + 1] > maxdegree) {
+      maxdegree = incidentoffset[i + 1];
+    }
+    incidentoffset[i + 1] += incidentoffset[i];
+  }
+  for (n = 0; n < numberoftriangles; n++) {
+    for (k = 0; k < 3; k++) {
+      i = trianglelist[n * numberofcorners + k] - firstnumber;
+      incident[4 * (size_t) incidentoffset[i]] = n;
+      incident[4 * (size_t) incidentoffset[i] + 1] =
+        trianglelist[n * numberofcorners + plus1mod3[k]];
+      incident[4 * (size_t) incidentoffset[i] + 2] =
+        trianglelist[n * numberofcorners + minus1mod3[k]];
+      incidentoffset[i]++;
+    }
+  }
+  for (i = numberofpoints; i > 0; i--) {
+    incidentoffset[i] = incidentoffset[i - 1];
+  }
+  incidentoffset[0] = 0;
+
+  /* Chain the triangles around each vertex:  the one that follows a      */
+  /*   triangle is the (first) one whose second corner is its third.    */
+  /*   `place' maps the second corners to their triangle, and is cleared  */
+  /*   after each vertex.                                                 */
+  place = (int *) trimallocarray((size_t) numberofpoints + 1, sizeof(int));
+  for (i = 0; i < numberofpoints; i++) {
+    place[i] = -1;
+  }
+  for (i = 0; i < numberofpoints; i++) {
+    for (j = incidentoffset[i + 1] - 1; j >= incidentoffset[i]; j--) {
+      place[incident[4 * (size_t) j + 1] - firstnumber] =
+        j - incidentoffset[i];
+    }
+    for (j = incidentoffset[i]; j < incidentoffset[i + 1]; j++) {
+      incident[4 * (size_t) j + 3] =
+        place[incident[4 * (size_t) j + 2] - firstnumber];
+    }
+    for (j = incidentoffset[i]; j < incidentoffset[i + 1]; j++) {
+      place[incident[4 * (size_t) j + 1] - firstnumber] = -1;
+    }
+  }
+  trifree((VOID *) place);
+
+  circumcenters = (REAL *) trimallocarray(2 * (size_t) numberoftriangles + 1,
+                                          sizeof(REAL));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif /* _OPENMP */
+  for (n = 0; n < numberoftriangles; n++) {
+    REAL *p[3];
+    REAL xdo, ydo, xao, yao, dodist, aodist, denominator;
+    int j;
+
+    for (j = 0; j < 3; j++) {
+      p[j] = &pointlist[2 * (trianglelist[n * numberofcorners + j] -
+                             firstnumber)];
+    }
+    /* As in findcircumcenter(). */
+    xdo = p[1][0] - p[0][0];
+    ydo = p[1][1] - p[0][1];
+    xao = p[2][0] - p[0][0];
+    yao = p[2][1] - p[0][1];
+    dodist = xdo * xdo + ydo * ydo;
+    aodist = xao * xao + yao * yao;
+    denominator = 0.5 / (xdo * yao - xao * ydo);
+    circumcenters[2 * n] = p[0][0] + (yao * dodist - ydo * aodist) *
+                           denominator;
+    circumcenters[2 * n + 1] = p[0][1] + (xdo * aodist - xao * dodist) *
+                               denominator;
+  }
+
+  /* Measure each cell, then gather them at their place. */
+  celloffset = (int *) trimallocarray((size_t) numberofpoints + 1,
+                                      sizeof(int));
+  newoffset = (int *) trimallocarray((size_t) numberofpoints + 1,
+                                     sizeof(int));
+  celloffset[0] = newoffset[0] = 0;
+  *cellvertexlist = (int *) NULL;
+  *vertexlist = (REAL *) NULL;
+  for (k = 0; k < 2; k++) {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif /* _OPENMP */
+    {
+      REAL *scratch;
+      int *scratchids, *chain;
+      int newcount;
+      int v;
+
+      scratch = (REAL *) trimallocarray(64 * ((size_t) maxdegree + 3),
+                                        sizeof(REAL));
+      scratchids = (int *) trimallocarray(32 * ((size_t) maxdegree + 3),
+                                          sizeof(int));
+      chain = (int *) trimallocarray((size_t) maxdegree + 1, sizeof(int));
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1024)
+#endif /* _OPENMP */
+      for (v = 0; v < numberofpoints; v++) {
+        if (k == 0) {
+          celloffset[v + 1] =
+            voronoicell(pointlist, firstnumber, circumcenters,
+                        &incident[4 * (size_t) incidentoffset[v]],
+                        incidentoffset[v + 1] - incidentoffset[v], v,
+                        clipbox, scratch, scratchids, chain, (int *) NULL,
+                        (REAL *) NULL, 0, &newcount);
+          newoffset[v + 1] = newcount;
+        } else {
+          voronoicell(pointlist, firstnumber, circumcenters,
+                      &incident[4 * (size_t) incidentoffset[v]],
+                      incidentoffset[v + 1] - incidentoffset[v], v, clipbox,
+                      scratch, scratchids, chain,
+                      &(*cellvertexlist)[celloffset[v]],
+                      &(*vertexlist)[2 * ((size_t) numberoftriangles +
+                                         newoffset[v])],
+                      numberoftriangles + newoffset[v], &newcount);
+        }
+      }
+      trifree((VOID *) scratch);
+      trifree((VOID *) scratchids);
+      trifree((VOID *) chain);
+    }
+
+    if (k == 0) {
+      for (i = 0; i < numberofpoints; i++) {
+        celloffset[i + 1] += celloffset[i];
+        newoffset[i + 1] += newoffset[i];
+      }
+      *numberofvertices = numberoftriangles + newoffset[numberofpoints];
+      *cellvertexlist = (int *)
+        trimallocarray((size_t) celloffset[numberofpoints] + 1, sizeof(int));
+      *vertexlist = (REAL *)
+        trimallocarray(2 * (size_t) *numberofvertices + 1, sizeof(REAL));
+      for (i = 0; i < 2 * numberoftriangles; i++) {
+        (*vertexlist)[i] = circumcenters[i];
+      }
+    }
   }
-  printf("\n");
+
+  *celloffsetlist = celloffset;
+  trifree((VOID *) newoffset);
+  trifree((VOID *) circumcenters);
+  trifree((VOID *) incident);
+  trifree((VOID *) incidentoffset);
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  monotonictime()   Read a monotonic clock, in milliseconds.               */
+/*                                                                           */
+/*  Only differences between two readings are meaningful.  Where there is    */
+/*  no monotonic clock, the time of day is used instead.                     */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+double monotonictime()
+{
+  struct timespec now;
+
+#ifdef CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else /* not CLOCK_MONOTONIC */
+  timespec_get(&now, TIME_UTC);
+#endif /* not CLOCK_MONOTONIC */
+  return 1000.0 * (double) now.tv_sec + 1.0e-6 * (double) now.tv_nsec;
 }
 
+#endif /* TRILIBRARY */
+
 /*****************************************************************************/
 /*                                                                           */
 /*  statistics()   Print all sorts of cool facts.                            */
@@ -15592,8 +18082,8 @@ struct behavior *b;
     if (m->subsegs.maxitems > 0) {
       printf("  Maximum number of subsegments: %ld\n", m->subsegs.maxitems);
     }
-    if (m->viri.maxitems > 0) {
-      printf("  Maximum number of viri: %ld\n", m->viri.maxitems);
+    if (m->maxviri > 0) {
+      printf("  Maximum number of viri: %ld\n", m->maxviri);
     }
     if (m->badsubsegs.maxitems > 0) {
       printf("  Maximum number of encroached subsegments: %ld\n",
@@ -15615,7 +18105,7 @@ struct behavior *b;
            m->vertices.maxitems * m->vertices.itembytes +
            m->triangles.maxitems * m->triangles.itembytes +
            m->subsegs.maxitems * m->subsegs.itembytes +
-           m->viri.maxitems * m->viri.itembytes +
+           m->maxviri * (long) sizeof(triangle *) +
            m->badsubsegs.maxitems * m->badsubsegs.itembytes +
            m->badtriangles.maxitems * m->badtriangles.itembytes +
            m->flipstackers.maxitems * m->flipstackers.itembytes +
@@ -15628,6 +18118,12 @@ struct behavior *b;
       printf("  Number of 3D orientation tests: %ld\n", m->orient3dcount);
     }
     printf("  Number of 2D orientation tests: %ld\n", m->counterclockcount);
+    if (m->incircleadaptcount + m->counterclockadaptcount +
+        m->orient3dadaptcount > 0) {
+      printf("  Number of tests past the fast error bound: %ld\n",
+             m->incircleadaptcount + m->counterclockadaptcount +
+             m->orient3dadaptcount);
+    }
     if (m->hyperbolacount > 0) {
       printf("  Number of right-of-hyperbola tests: %ld\n",
              m->hyperbolacount);
@@ -15644,6 +18140,279 @@ struct behavior *b;
   }
 }
 
+/*****************************************************************************/
+/*                                                                           */
+/*  writestats()   Fill in the statistics of a call to triangulate(), for    */
+/*                 callers that would rather not parse what statistics()     */
+/*                 prints.                                                   */
+/*                                                                           */
+/*  `phasetime' holds seven monotonictime() readings:  at the start, and     */
+/*  after the transfer of the vertices, the triangulation, the segments,     */
+/*  the holes, the quality mesh generation, and the output.                  */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void writestats(struct mesh *m, struct behavior *b, double *phasetime,
+                struct triangulatestats *stats)
+#else /* not ANSI_DECLARATORS */
+void writestats(m, b, phasetime, stats)
+struct mesh *m;
+struct behavior *b;
+double *phasetime;
+struct triangulatestats *stats;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  stats->transfertime = phasetime[1] - phasetime[0];
+  stats->delaunaytime = phasetime[2] - phasetime[1];
+  stats->segmenttime = phasetime[3] - phasetime[2];
+  stats->holetime = phasetime[4] - phasetime[3];
+  stats->qualitytime = phasetime[5] - phasetime[4];
+  stats->outputtime = phasetime[6] - phasetime[5];
+  stats->totaltime = phasetime[6] - phasetime[0];
+
+  stats->incirclecount = m->incirclecount;
+  stats->counterclockcount = m->counterclockcount;
+  stats->orient3dcount = m->orient3dcount;
+  stats->incircleadaptcount = m->incircleadaptcount;
+  stats->counterclockadaptcount = m->counterclockadaptcount;
+  stats->orient3dadaptcount = m->orient3dadaptcount;
+  stats->hyperbolacount = m->hyperbolacount;
+  stats->circletopcount = m->circletopcount;
+  stats->circumcentercount = m->circumcentercount;
+
+  stats->maxvertices = m->vertices.maxitems;
+  stats->maxtriangles = m->triangles.maxitems;
+  stats->maxsubsegs = m->subsegs.maxitems;
+  stats->maxviri = m->maxviri;
+  stats->maxbadsubsegs = m->badsubsegs.maxitems;
+  stats->maxbadtriangles = m->badtriangles.maxitems;
+  stats->maxflipstackers = m->flipstackers.maxitems;
+  stats->maxsplaynodes = m->splaynodes.maxitems;
+  /* The same estimate as statistics() prints. */
+  stats->memory = m->vertices.maxitems * m->vertices.itembytes +
+                  m->triangles.maxitems * m->triangles.itembytes +
+                  m->subsegs.maxitems * m->subsegs.itembytes +
+                  m->maxviri * (long) sizeof(triangle *) +
+                  m->badsubsegs.maxitems * m->badsubsegs.itembytes +
+                  m->badtriangles.maxitems * m->badtriangles.itembytes +
+                  m->flipstackers.maxitems * m->flipstackers.itembytes +
+                  m->splaynodes.maxitems * m->splaynodes.itembytes;
+
+  stats->inputvertices = m->invertices;
+  stats->steinerpoints = m->vertices.items - m->undeads - m->invertices;
+  stats->segmentsteiners = m->segmentsteiners;
+  stats->trianglesteiners = m->trianglesteiners;
+}
+
+#endif /* TRILIBRARY */
+
+/*****************************************************************************/
+/*                                                                           */
+/*  triangulatemany()   Triangulate many small independent inputs, such as   */
+/*                      the polygons of a map, in one call.                  */
+/*                                                                           */
+/*  Input i has the vertices `pointoffsetlist[i]' up to (excluded)           */
+/*  `pointoffsetlist[i + 1]' of `pointlist', and likewise the segments of    */
+/*  `segmentlist' and the holes of `holelist' given by their offset lists;   */
+/*  `segmentlist' and `holelist' may be NULL.  The segments are numbered     */
+/*  within their own input, from one, or from zero with the -z switch.  All  */
+/*  the inputs are triangulated with the same switches, as triangulate()     */
+/*  would do it, and the output is gathered in the same compressed sparse    */
+/*  row form:  `outpointoffsetlist' and `outtriangleoffsetlist' hold the     */
+/*  first vertex and the first triangle of every output, and the corners of  */
+/*  its triangles are numbered within its own vertices.  The four lists are  */
+/*  allocated with trimalloc().                                              */
+/*                                                                           */
+/*  Each thread (when compiled with OpenMP) keeps one mesh, whose memory     */
+/*  pools are reused by all the inputs it triangulates; only the vertices    */
+/*  and the triangles are written.                                           */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef TRILIBRARY
+
+#ifdef ANSI_DECLARATORS
+void triangulatemany(char *triswitches, int numberofinputs, REAL *pointlist,
+                     int *pointoffsetlist, int *segmentlist,
+                     int *segmentoffsetlist, REAL *holelist,
+                     int *holeoffsetlist, REAL **outpointlist,
+                     int **outpointoffsetlist, int **outtrianglelist,
+                     int **outtriangleoffsetlist)
+#else /* not ANSI_DECLARATORS */
+void triangulatemany(triswitches, numberofinputs, pointlist, pointoffsetlist,
+                     segmentlist, segmentoffsetlist, holelist, holeoffsetlist,
+                     outpointlist, outpointoffsetlist, outtrianglelist,
+                     outtriangleoffsetlist)
+char *triswitches;
+int numberofinputs;
+REAL *pointlist;
+int *pointoffsetlist;
+int *segmentlist;
+int *segmentoffsetlist;
+REAL *holelist;
+int *holeoffsetlist;
+REAL **outpointlist;
+int **outpointoffsetlist;
+int **outtrianglelist;
+int **outtriangleoffsetlist;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct behavior batch;
+  REAL **points;
+  int **triangles;
+  int *pointoffset;
+  int *triangleoffset;
+  int chunk;
+  int i;
+
+  parsecommandline(1, &triswitches, &batch);
+  /* Switches whose outputs or inputs triangulatemany() has no room for. */
+  batch.refine = batch.vararea = batch.levels = 0;
+  batch.regionattrib = batch.segmentregions = 0;
+  batch.edgesout = batch.voronoi = batch.neighbors = batch.keepmesh = 0;
+  batch.nonodewritten = batch.noelewritten = 0;
+  batch.nobound = 1;
+  batch.order = 1;
+  batch.usesegments = batch.poly || batch.quality || batch.convex;
+  exactinit();                     /* Initialize exact arithmetic constants. */
+
+  points = (REAL **) trimallocarray((size_t) numberofinputs + 1,
+                                    sizeof(REAL *));
+  triangles = (int **) trimallocarray((size_t) numberofinputs + 1,
+                                      sizeof(int *));
+  pointoffset = (int *) trimallocarray((size_t) numberofinputs + 1,
+                                       sizeof(int));
+  triangleoffset = (int *) trimallocarray((size_t) numberofinputs + 1,
+                                          sizeof(int));
+  pointoffset[0] = triangleoffset[0] = 0;
+  /* Hand the inputs out sixteen at a time, but one at a time if there are */
+  /*   few of them, such as the tiles of a large mesh.                     */
+  chunk = numberofinputs / 1024;
+  chunk = chunk < 1 ? 1 : chunk > 16 ? 16 : chunk;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif /* _OPENMP */
+  {
+    struct mesh m;
+    struct behavior b;
+    REAL *noattributes;
+    int *nomarkers;
+    int segments;
+    int k;
+
+    poolzero(&m.vertices);
+    poolzero(&m.triangles);
+    poolzero(&m.subsegs);
+    poolzero(&m.badsubsegs);
+    poolzero(&m.badtriangles);
+    poolzero(&m.flipstackers);
+    poolzero(&m.splaynodes);
+    noattributes = (REAL *) NULL;
+    nomarkers = (int *) NULL;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, chunk)
+#endif /* _OPENMP */
+    for (k = 0; k < numberofinputs; k++) {
+      b = batch;
+      meshrestart(&m);
+      m.steinerleft = b.steiner;
+      transfernodes(&m, &b, &pointlist[2 * (size_t) pointoffsetlist[k]],
+                    (REAL *) NULL, (int *) NULL,
+                    pointoffsetlist[k + 1] - pointoffsetlist[k], 0);
+      m.hullsize = delaunay(&m, &b);
+      m.infvertex1 = (vertex) NULL;
+      m.infvertex2 = (vertex) NULL;
+      m.infvertex3 = (vertex) NULL;
+      if (b.usesegments) {
+        m.checksegments = 1;
+        segments = segmentlist == (int *) NULL ? 0 :
+                   segmentoffsetlist[k + 1] - segmentoffsetlist[k];
+        formskeleton(&m, &b, segments == 0 ? (int *) NULL :
+                     &segmentlist[2 * segmentoffsetlist[k]], (int *) NULL,
+                     segments);
+      }
+      m.holes = 0;
+      m.regions = 0;
+      if (b.poly && (m.triangles.items > 0)) {
+        if (holelist != (REAL *) NULL) {
+          m.holes = holeoffsetlist[k + 1] - holeoffsetlist[k];
+        }
+        carveholes(&m, &b, m.holes == 0 ? (REAL *) NULL :
+                   &holelist[2 * holeoffsetlist[k]], m.holes,
+                   (REAL *) NULL, 0);
+      }
+#ifndef CDT_ONLY
+      if (b.quality && (m.triangles.items > 0)) {
+        enforcequality(&m, &b);
+      }
+#endif /* not CDT_ONLY */
+
+      if (b.jettison) {
+        pointoffset[k + 1] = (int) (m.vertices.items - m.undeads);
+      } else {
+        pointoffset[k + 1] = (int) m.vertices.items;
+      }
+      triangleoffset[k + 1] = (int) m.triangles.items;
+      points[k] = (REAL *) trimallocarray(2 * (size_t) pointoffset[k + 1] + 1,
+                                          sizeof(REAL));
+      triangles[k] = (int *)
+        trimallocarray(3 * (size_t) triangleoffset[k + 1] + 1, sizeof(int));
+      writenodes(&m, &b, &points[k], &noattributes, &nomarkers);
+      writemesh(&m, &b, &triangles[k], &noattributes, (int **) NULL,
+                (int **) NULL, (int **) NULL);
+
+      /* Keep the pools for the next input, but not the dummies. */
+      trifree((VOID *) m.dummytribase);
+      if (b.usesegments) {
+        trifree((VOID *) m.dummysubbase);
+      }
+    }
+    pooldeinit(&m.vertices);
+    pooldeinit(&m.triangles);
+    pooldeinit(&m.subsegs);
+    pooldeinit(&m.badsubsegs);
+    pooldeinit(&m.badtriangles);
+    pooldeinit(&m.flipstackers);
+    pooldeinit(&m.splaynodes);
+  }
+
+  /* Gather the outputs, in the order of the inputs. */
+  for (i = 0; i < numberofinputs; i++) {
+    pointoffset[i + 1] += pointoffset[i];
+    triangleoffset[i + 1] += triangleoffset[i];
+  }
+  *outpointlist = (REAL *)
+    trimallocarray(2 * (size_t) pointoffset[numberofinputs] + 1,
+                   sizeof(REAL));
+  *outtrianglelist = (int *)
+    trimallocarray(3 * (size_t) triangleoffset[numberofinputs] + 1,
+                   sizeof(int));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif /* _OPENMP */
+  for (i = 0; i < numberofinputs; i++) {
+    memcpy(&(*outpointlist)[2 * (size_t) pointoffset[i]], points[i],
+           2 * (size_t) (pointoffset[i + 1] - pointoffset[i]) * sizeof(REAL));
+    memcpy(&(*outtrianglelist)[3 * (size_t) triangleoffset[i]], triangles[i],
+           3 * (size_t) (triangleoffset[i + 1] - triangleoffset[i]) *
+           sizeof(int));
+    trifree((VOID *) points[i]);
+    trifree((VOID *) triangles[i]);
+  }
+  *outpointoffsetlist = pointoffset;
+  *outtriangleoffsetlist = triangleoffset;
+  trifree((VOID *) points);
+  trifree((VOID *) triangles);
+}
+
+#endif /* TRILIBRARY */
+
 /*****************************************************************************/
 /*                                                                           */
 /*  main() or triangulate()   Gosh, do everything.                           */
@@ -15708,10 +18477,17 @@ char **argv;
   struct timeval tv0, tv1, tv2, tv3, tv4, tv5, tv6;
   struct timezone tz;
 #endif /* not NO_TIMER */
+#ifdef TRILIBRARY
+  double phasetime[7];           /* Monotonic clock readings for the stats. */
+  struct trimesh *kept;                           /* Mesh kept by -K switch. */
+#endif /* TRILIBRARY */
 
 #ifndef NO_TIMER
   gettimeofday(&tv0, &tz);
 #endif /* not NO_TIMER */
+#ifdef TRILIBRARY
+  phasetime[0] = monotonictime();
+#endif /* TRILIBRARY */
 
   triangleinit(&m);
 #ifdef TRILIBRARY
@@ -15722,9 +18498,13 @@ char **argv;
   m.steinerleft = b.steiner;
 
 #ifdef TRILIBRARY
-  transfernodes(&m, &b, in->pointlist, in->pointattributelist,
-                in->pointmarkerlist, in->numberofpoints,
-                in->numberofpointattributes);
+  if (in->pointstream != (VOID *) NULL) {
+    transferstream(&m, &b, in);
+  } else {
+    transfernodes(&m, &b, in->pointlist, in->pointattributelist,
+                  in->pointmarkerlist, in->numberofpoints,
+                  in->numberofpointattributes);
+  }
 #else /* not TRILIBRARY */
   readnodes(&m, &b, b.innodefilename, b.inpolyfilename, &polyfile);
 #endif /* not TRILIBRARY */
@@ -15734,6 +18514,9 @@ char **argv;
     gettimeofday(&tv1, &tz);
   }
 #endif /* not NO_TIMER */
+#ifdef TRILIBRARY
+  phasetime[1] = monotonictime();
+#endif /* TRILIBRARY */
 
 #ifdef CDT_ONLY
   m.hullsize = delaunay(&m, &b);                /* Triangulate the vertices. */
@@ -15768,6 +18551,9 @@ char **argv;
            (tv2.tv_usec - tv1.tv_usec) / 1000l);
   }
 #endif /* not NO_TIMER */
+#ifdef TRILIBRARY
+  phasetime[2] = monotonictime();
+#endif /* TRILIBRARY */
 
   /* Ensure that no vertex can be mistaken for a triangular bounding */
   /*   box vertex in insertvertex().                                 */
@@ -15798,6 +18584,9 @@ char **argv;
     }
   }
 #endif /* not NO_TIMER */
+#ifdef TRILIBRARY
+  phasetime[3] = monotonictime();
+#endif /* TRILIBRARY */
 
   if (b.poly && (m.triangles.items > 0)) {
 #ifdef TRILIBRARY
@@ -15812,6 +18601,14 @@ char **argv;
     if (!b.refine) {
       /* Carve out holes and concavities. */
       carveholes(&m, &b, holearray, m.holes, regionarray, m.regions);
+      if (b.segmentregions) {
+        /* Number the regions bounded by segments. */
+#ifdef TRILIBRARY
+        segmentregions(&m, &b, in->markerarealist, in->numberofmarkerareas);
+#else /* not TRILIBRARY */
+        segmentregions(&m, &b, (REAL *) NULL, 0);
+#endif /* not TRILIBRARY */
+      }
     }
   } else {
     /* Without a PSLG, there can be no holes or regional attributes   */
@@ -15830,10 +18627,21 @@ char **argv;
     }
   }
 #endif /* not NO_TIMER */
+#ifdef TRILIBRARY
+  phasetime[4] = monotonictime();
+#endif /* TRILIBRARY */
 
 #ifndef CDT_ONLY
   if (b.quality && (m.triangles.items > 0)) {
     enforcequality(&m, &b);           /* Enforce angle and area constraints. */
+    if (b.levels > 0) {
+      /* Refine the same mesh through further levels. */
+#ifdef TRILIBRARY
+      refinelevels(&m, &b, out);
+#else /* not TRILIBRARY */
+      refinelevels(&m, &b);
+#endif /* not TRILIBRARY */
+    }
   }
 #endif /* not CDT_ONLY */
 
@@ -15849,6 +18657,9 @@ char **argv;
 #endif /* not CDT_ONLY */
   }
 #endif /* not NO_TIMER */
+#ifdef TRILIBRARY
+  phasetime[5] = monotonictime();
+#endif /* TRILIBRARY */
 
   /* Calculate the number of edges. */
   m.edges = (3l * m.triangles.items + m.hullsize) / 2l;
@@ -15881,6 +18692,14 @@ char **argv;
     vorout->numberofpointattributes = m.nextras;
     vorout->numberofedges = m.edges;
   }
+  if (out->capacities != (struct triangulatecapacities *) NULL) {
+    /* Write the arrays of a previous call in place, where they fit. */
+    reserveoutput(&m, &b, in, out);
+  }
+  if (b.voronoi &&
+      (vorout->capacities != (struct triangulatecapacities *) NULL)) {
+    reservevoronoi(&m, vorout);
+  }
 #endif /* TRILIBRARY */
   /* If not using iteration numbers, don't write a .node file if one was */
   /*   read, because the original one would be overwritten!              */
@@ -15896,27 +18715,63 @@ char **argv;
   } else {
     /* writenodes() numbers the vertices too. */
 #ifdef TRILIBRARY
-    writenodes(&m, &b, &out->pointlist, &out->pointattributelist,
-               &out->pointmarkerlist);
+    if ((out->pointlist == in->pointlist) &&
+        (out->pointlist != (REAL *) NULL) &&
+        (m.vertices.items == m.invertices) &&
+        (!b.jettison || (m.undeads == 0))) {
+      /* No vertex was added or removed, so the output points are the input */
+      /*   points, in the same order:  they are not written again.          */
+      writenodes(&m, &b, (REAL **) NULL,
+                 (out->pointattributelist == in->pointattributelist) ?
+                 (REAL **) NULL : &out->pointattributelist,
+                 &out->pointmarkerlist);
+    } else {
+      /* The input arrays may be too short for the output points. */
+      if (out->pointlist == in->pointlist) {
+        out->pointlist = (REAL *) NULL;
+      }
+      if (out->pointattributelist == in->pointattributelist) {
+        out->pointattributelist = (REAL *) NULL;
+      }
+      if (out->pointmarkerlist == in->pointmarkerlist) {
+        out->pointmarkerlist = (int *) NULL;
+      }
+      writenodes(&m, &b, &out->pointlist, &out->pointattributelist,
+                 &out->pointmarkerlist);
+    }
 #else /* not TRILIBRARY */
     writenodes(&m, &b, b.outnodefilename, argc, argv);
 #endif /* TRILIBRARY */
   }
-  if (b.noelewritten) {
-    if (!b.quiet) {
 #ifdef TRILIBRARY
-      printf("NOT writing triangles.\n");
+  if (b.noelewritten && !b.quiet) {
+    printf("NOT writing triangles.\n");
+  }
+  if (b.voronoi) {
+    /* writevoronoi() messes up the subsegments; the mesh can't be kept. */
+    b.keepmesh = 0;
+  }
+  if (!b.edgesout && !b.neighbors) {
+    /* Nothing to defer; the mesh would be kept for nothing. */
+    b.keepmesh = 0;
+  }
+  /* The triangles, edges, and neighbors are written in one traversal. */
+  /*   With -K, the edges and the neighbors wait for trimeshoutput().  */
+  writemesh(&m, &b, b.noelewritten ? (int **) NULL : &out->trianglelist,
+            b.noelewritten ? (REAL **) NULL : &out->triangleattributelist,
+            b.edgesout && !b.keepmesh ? &out->edgelist : (int **) NULL,
+            b.edgesout && !b.keepmesh ? &out->edgemarkerlist :
+            (int **) NULL,
+            b.neighbors && !b.keepmesh ? &out->neighborlist : (int **) NULL);
 #else /* not TRILIBRARY */
+  if (b.noelewritten) {
+    if (!b.quiet) {
       printf("NOT writing an .ele file.\n");
-#endif /* not TRILIBRARY */
     }
   } else {
-#ifdef TRILIBRARY
-    writeelements(&m, &b, &out->trianglelist, &out->triangleattributelist);
-#else /* not TRILIBRARY */
     writeelements(&m, &b, b.outelefilename, argc, argv);
-#endif /* not TRILIBRARY */
   }
+#endif /* not TRILIBRARY */
   /* The -c switch (convex switch) causes a PSLG to be written */
   /*   even if none was read.                                  */
   if (b.poly || b.convex) {
@@ -15960,13 +18815,11 @@ char **argv;
     writeoff(&m, &b, b.offfilename, argc, argv);
   }
 #endif /* not TRILIBRARY */
+#ifndef TRILIBRARY
   if (b.edgesout) {
-#ifdef TRILIBRARY
-    writeedges(&m, &b, &out->edgelist, &out->edgemarkerlist);
-#else /* not TRILIBRARY */
     writeedges(&m, &b, b.edgefilename, argc, argv);
-#endif /* not TRILIBRARY */
   }
+#endif /* not TRILIBRARY */
   if (b.voronoi) {
 #ifdef TRILIBRARY
     writevoronoi(&m, &b, &vorout->pointlist, &vorout->pointattributelist,
@@ -15976,13 +18829,18 @@ char **argv;
     writevoronoi(&m, &b, b.vnodefilename, b.vedgefilename, argc, argv);
 #endif /* not TRILIBRARY */
   }
+#ifndef TRILIBRARY
   if (b.neighbors) {
-#ifdef TRILIBRARY
-    writeneighbors(&m, &b, &out->neighborlist);
-#else /* not TRILIBRARY */
     writeneighbors(&m, &b, b.neighborfilename, argc, argv);
+  }
 #endif /* not TRILIBRARY */
+
+#ifdef TRILIBRARY
+  phasetime[6] = monotonictime();
+  if (out->stats != (struct triangulatestats *) NULL) {
+    writestats(&m, &b, phasetime, out->stats);
   }
+#endif /* TRILIBRARY */
 
   if (!b.quiet) {
 #ifndef NO_TIMER
@@ -16005,8 +18863,20 @@ char **argv;
   }
 #endif /* not REDUCED */
 
+#ifdef TRILIBRARY
+  if (b.keepmesh) {
+    /* Hand the mesh over to `out'; trimeshfree() frees it. */
+    kept = (struct trimesh *) trimalloc((int) sizeof(struct trimesh));
+    kept->m = m;
+    kept->b = b;
+    kept->deferedges = b.edgesout;
+    kept->deferneighbors = b.neighbors;
+    out->mesh = (VOID *) kept;
+  } else {
+    triangledeinit(&m, &b);
+  }
+#else /* not TRILIBRARY */
   triangledeinit(&m, &b);
-#ifndef TRILIBRARY
   return 0;
 #endif /* not TRILIBRARY */
 }
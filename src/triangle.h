@@ -67,8 +67,12 @@
 /*    markers, you should use the `N' (no nodes output) switch to save       */
 /*    memory.  (If you do need boundary markers, but need to save memory, a  */
 /*    good nasty trick is to set out->pointlist equal to in->pointlist       */
-/*    before calling triangulate(), so that Triangle overwrites the input    */
-/*    points with identical copies.)                                         */
+/*    before calling triangulate(), so that Triangle does not write the      */
+/*    output points at all.  Do the same with `pointattributelist' and       */
+/*    `pointmarkerlist' to share them too; the markers are written over the  */
+/*    input markers.  If vertices are added or jettisoned after all, the     */
+/*    shared lists are set to NULL and allocated afresh, and the input lists */
+/*    are left untouched.)                                                   */
 /*  - The `I' (no iteration numbers) and `g' (.off file output) switches     */
 /*    have no effect when Triangle is compiled with TRILIBRARY defined.      */
 /*                                                                           */
@@ -139,6 +143,26 @@
 /*    Input only, although the pointer is copied to the output structure for */
 /*    your convenience.                                                      */
 /*                                                                           */
+/*  `markerarealist':  An array of area constraints keyed by segment marker. */
+/*    The first marker is at index [0], followed by its maximum area at      */
+/*    index [1], followed by the remaining pairs.  Two REALs per pair.  Used */
+/*    only if you select both the `R' switch and the `a' switch (with no     */
+/*    number following):  each segment-bounded region takes the smallest     */
+/*    area listed for the markers of its bounding segments.  Input only.     */
+/*                                                                           */
+/*  `levelpointcountlist':  With the `L' switch, the number of points of     */
+/*    each coarser refinement level; one int per level.  The points of a     */
+/*    level are the first points of `pointlist'.  Output only.               */
+/*  `leveltrianglecountlist':  The number of triangles of each coarser       */
+/*    level; one int per level.  Output only.                                */
+/*  `leveltrianglelist':  The triangles of all the coarser levels, the       */
+/*    coarsest level first.  Three ints per triangle.  Output only.          */
+/*  `leveltriangleattributelist':  The attributes of the triangles of all    */
+/*    the coarser levels.  `numberoftriangleattributes' REALs per triangle.  */
+/*    Output only.                                                           */
+/*  `numberoflevels':  The number of coarser levels recorded; the finest     */
+/*    level is the ordinary output.  Output only.                            */
+/*                                                                           */
 /*  `edgelist':  An array of edge endpoints.  The first edge's endpoints are */
 /*    at indices [0] and [1], followed by the remaining edges.  Two ints per */
 /*    edge.  Output only.                                                    */
@@ -180,6 +204,8 @@
 /*      markers default to zero), or must point to a list of markers.  If    */
 /*      `numberofpointattributes' is not zero, `pointattributelist' must     */
 /*      point to a list of point attributes.                                 */
+/*    - `pointstream' must be set to NULL, unless the points were appended   */
+/*      by streampoints() (see below) instead; `pointlist' is then ignored.  */
 /*    - If the `r' switch is used, `trianglelist' must point to a list of    */
 /*      triangles, and `numberoftriangles', `numberofcorners', and           */
 /*      `numberoftriangleattributes' must be properly set.  If               */
@@ -196,6 +222,9 @@
 /*      `numberofholes' is not zero, `holelist' must point to a list of      */
 /*      holes.  If `numberofregions' is not zero, `regionlist' must point to */
 /*      a list of region constraints.                                        */
+/*    - If the `R' and `a' switches are used (with no number following `a'), */
+/*      `numberofmarkerareas' must be properly set.  If it is not zero,      */
+/*      `markerarealist' must point to a list of marker area constraints.    */
 /*    - If the `p' switch is used, `holelist', `numberofholes',              */
 /*      `regionlist', and `numberofregions' is copied to `out'.  (You can    */
 /*      nonetheless get away with not initializing them if the `r' switch is */
@@ -213,14 +242,25 @@
 /*    - `trianglelist' must be initialized unless the `E' switch is used.    */
 /*      `neighborlist' must be initialized if the `n' switch is used.  If    */
 /*      the `E' switch is not used and (`in->numberofelementattributes' is   */
-/*      not zero or the `A' switch is used), `elementattributelist' must be  */
-/*      initialized.  `trianglearealist' may be ignored.                     */
+/*      not zero or the `A' or `R' switch is used), `elementattributelist'   */
+/*      must be initialized.  `trianglearealist' may be ignored.             */
 /*    - `segmentlist' must be initialized if the `p' or `c' switch is used,  */
 /*      and the `P' switch is not used.  `segmentmarkerlist' must also be    */
 /*      initialized under these circumstances unless the `B' switch is used. */
 /*    - `edgelist' must be initialized if the `e' switch is used.            */
 /*      `edgemarkerlist' must be initialized if the `e' switch is used and   */
 /*      the `B' switch is not.                                               */
+/*    - If the `L' switch is used, `levelpointcountlist',                    */
+/*      `leveltrianglecountlist', `leveltrianglelist', and                   */
+/*      `leveltriangleattributelist' must be set to NULL, and                */
+/*      `numberoflevels' to zero.  Triangle always allocates these.          */
+/*    - `stats' must either be set to NULL, or point to a triangulatestats   */
+/*      structure, which Triangle fills in (see below).                      */
+/*    - `mesh' must be set to NULL.  With the `K' switch, Triangle sets it   */
+/*      to the mesh it keeps (see trimeshoutput() below).                    */
+/*    - `capacities' must either be set to NULL, or point to a               */
+/*      triangulatecapacities structure, with which Triangle recycles the    */
+/*      arrays of `out' (see below).                                         */
 /*    - `holelist', `regionlist', `normlist', and all scalars may be ignored.*/
 /*                                                                           */
 /*  `vorout' (only needed if `v' switch is used):                            */
@@ -230,6 +270,9 @@
 /*      `pointmarkerlist' may be ignored.                                    */
 /*    - `edgelist' and `normlist' must both be initialized.                  */
 /*      `edgemarkerlist' may be ignored.                                     */
+/*    - `capacities' must either be set to NULL, or point to a               */
+/*      triangulatecapacities structure, with which Triangle recycles the    */
+/*      arrays of `vorout' as those of `out'.                                */
 /*    - Everything else may be ignored.                                      */
 /*                                                                           */
 /*  After a call to triangulate(), the valid fields of `out' and `vorout'    */
@@ -246,8 +289,80 @@
 /*  triangulation whether or not the edges were written.  If segments are    */
 /*  not used, `numberofsegments' will indicate the number of boundary edges. */
 /*                                                                           */
+/*  The statistics are what the `V' switch prints, without the printing.     */
+/*  The times are in milliseconds, read from a monotonic clock; a phase      */
+/*  that is skipped takes (almost) no time.  `steinerpoints' is the number   */
+/*  of vertices of the final mesh that were not input vertices; Steiner      */
+/*  points deleted again by Chew's rule count in `segmentsteiners' and       */
+/*  `trianglesteiners', but not in `steinerpoints'.  The `adapt' counts are  */
+/*  the tests that the floating-point filter could not decide, and that      */
+/*  went on to exact arithmetic.                                             */
+/*                                                                           */
+/*  With `out->capacities' pointing to a triangulatecapacities structure,    */
+/*  the arrays of `out' that Triangle writes may be left from a previous     */
+/*  call, if they were allocated with trimalloc():  the structure holds the  */
+/*  size of each of them in bytes, zero if it is unknown.  An array that is  */
+/*  large enough is written in place.  One that is too small, or of unknown  */
+/*  size, is freed with trifree() and allocated again a quarter larger than  */
+/*  needed, and its new size is recorded; a mesh that grows a little from    */
+/*  one call to the next is thus seldom allocated again.  This is meant for  */
+/*  the meshes of a time-stepping loop, where the same domain is meshed      */
+/*  again and again with moving points.  Arrays of `out' that are the arrays */
+/*  of `in' (see the nasty trick above) are left alone.  Whoever replaces an */
+/*  array of `out' must set its size to zero.  The same goes for `vorout'    */
+/*  and `vorout->capacities'.                                                */
+/*                                                                           */
 /*****************************************************************************/
 
+struct triangulatestats {
+  double transfertime;                        /* Copying the input vertices. */
+  double delaunaytime;         /* Delaunay triangulation, or reconstruction. */
+  double segmenttime;                             /* Inserting the segments. */
+  double holetime;                        /* Carving holes, finding regions. */
+  double qualitytime;                            /* Quality mesh generation. */
+  double outputtime;                           /* Writing the output arrays. */
+  double totaltime;
+
+  long incirclecount;                 /* Number of incircle tests performed. */
+  long counterclockcount;     /* Number of counterclockwise tests performed. */
+  long orient3dcount;           /* Number of 3D orientation tests performed. */
+  long incircleadaptcount;     /* Tests that went past the fast error bound, */
+  long counterclockadaptcount;        /*   to the adaptive exact arithmetic. */
+  long orient3dadaptcount;
+  long hyperbolacount;      /* Number of right-of-hyperbola tests performed. */
+  long circletopcount;       /* Number of circle top calculations performed. */
+  long circumcentercount;  /* Number of circumcenter calculations performed. */
+
+  long maxvertices;                 /* High-water marks of the memory pools. */
+  long maxtriangles;
+  long maxsubsegs;
+  long maxviri;
+  long maxbadsubsegs;
+  long maxbadtriangles;
+  long maxflipstackers;
+  long maxsplaynodes;
+  long memory;                     /* Approximate heap memory use, in bytes. */
+
+  long inputvertices;
+  long steinerpoints;
+  long segmentsteiners;              /* Steiner points inserted on segments. */
+  long trianglesteiners;         /* Steiner points inserted inside the mesh. */
+};
+
+struct triangulatecapacities {           /* Sizes in bytes, zero if unknown. */
+  long pointlist;
+  long pointattributelist;
+  long pointmarkerlist;
+  long trianglelist;
+  long triangleattributelist;
+  long neighborlist;
+  long segmentlist;
+  long segmentmarkerlist;
+  long edgelist;
+  long edgemarkerlist;
+  long normlist;
+};
+
 struct triangulateio {
   REAL *pointlist;                                               /* In / out */
   REAL *pointattributelist;                                      /* In / out */
@@ -277,14 +392,137 @@ struct triangulateio {
   int *edgemarkerlist;            /* Not used with Voronoi diagram; out only */
   REAL *normlist;                /* Used only with Voronoi diagram; out only */
   int numberofedges;                                             /* Out only */
+
+  REAL *markerarealist;                                           /* In only */
+  int numberofmarkerareas;                                        /* In only */
+
+  int *levelpointcountlist;                                      /* Out only */
+  int *leveltrianglecountlist;                                   /* Out only */
+  int *leveltrianglelist;                                        /* Out only */
+  REAL *leveltriangleattributelist;                              /* Out only */
+  int numberoflevels;                                            /* Out only */
+
+  struct triangulatestats *stats;                   /* Out only; may be NULL */
+  void *mesh;                                     /* Out only; kept with `K' */
+  void *pointstream;                  /* In only; filled with streampoints() */
+  struct triangulatecapacities *capacities;         /* In / out; may be NULL */
+};
+
+/*****************************************************************************/
+/*                                                                           */
+/*  measurequality() measures every triangle of a mesh written by            */
+/*  triangulate(), from its `pointlist' and `trianglelist', and gathers the  */
+/*  statistics that the `V' switch prints.  The aspect ratio of a triangle   */
+/*  is its longest edge divided by its shortest altitude.  `angletable[i]'   */
+/*  counts the angles between 10i and 10i + 10 degrees; `aspecttable'        */
+/*  counts the aspect ratios up to 1.5, 2, 2.5, 3, 4, 6, 10, 15, 25, 50,     */
+/*  100, 300, 1000, 10000, 100000, and beyond.                               */
+/*                                                                           */
+/*****************************************************************************/
+
+struct qualitystats {
+  REAL smallestangle;                                          /* In degrees */
+  REAL biggestangle;
+  REAL smallestarea;
+  REAL biggestarea;
+  REAL shortestedge;
+  REAL longestedge;
+  REAL shortestaltitude;
+  REAL worstaspect;
+  int angletable[18];
+  int aspecttable[16];
 };
 
+/*****************************************************************************/
+/*                                                                           */
+/*  voronoicells() computes the Voronoi cell of every vertex of a mesh       */
+/*  written by triangulate(), from its `pointlist' and `trianglelist', in    */
+/*  compressed sparse row form:  the cell of vertex i is the list of         */
+/*  `cellvertexlist' from index `celloffsetlist[i]' to `celloffsetlist[i+1]' */
+/*  excluded, the numbers of its vertices in counterclockwise order.  Vertex */
+/*  j of the cells is at `vertexlist[2j]' and `vertexlist[2j+1]'; the first  */
+/*  ones are the circumcenters of the triangles.  The cells of the vertices  */
+/*  on the boundary of the mesh are open, and start with -1, unless a        */
+/*  `clipbox' (xmin, ymin, xmax, ymax) is given:  all the cells are then     */
+/*  closed and clipped to it, with new vertices after the circumcenters.     */
+/*  (The cells of the points on the boundary of a hole run over the hole.)   */
+/*  The three lists are allocated by voronoicells(), to be freed with        */
+/*  trifree().                                                               */
+/*                                                                           */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/*                                                                           */
+/*  The `K' switch keeps the finished mesh in `out->mesh' instead of freeing */
+/*  it, and defers the `e' and `n' outputs:  `edgelist', `edgemarkerlist',   */
+/*  and `neighborlist' are left untouched (`numberofedges' is set) until     */
+/*  trimeshoutput() is called with a string holding `e' and/or `n'.  Only    */
+/*  outputs selected by the switches given to triangulate() can be written   */
+/*  this way, each of them once.  trimeshfree() frees the kept mesh and sets */
+/*  `out->mesh' to NULL; it must be called before `out' is reused.  The `K'  */
+/*  switch is ignored if the `v' switch is used, or if neither `e' nor `n'   */
+/*  is.                                                                      */
+/*                                                                           */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/*                                                                           */
+/*  streampoints() appends `numberofpoints' points, given as `pointlist',    */
+/*  `pointattriblist' (`in->numberofpointattributes' attributes per point),  */
+/*  and `pointmarkerlist' (which may be NULL), straight to the vertex pool   */
+/*  that triangulate() uses, so that a large point set can be read in chunks */
+/*  without ever being stored in a `pointlist'.  The pool is created and     */
+/*  kept in `in->pointstream' by the first call, which reserves `sizehint'   */
+/*  points and takes `in->numberofpointattributes'; the number of points     */
+/*  appended so far is returned.  The next triangulate() call with `in'      */
+/*  takes the pool over and sets `in->pointstream' to NULL:  the points are  */
+/*  triangulated once.  pointstreamfree() frees the points of a pool that    */
+/*  was not triangulated and sets `in->pointstream' to NULL.                 */
+/*                                                                           */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/*                                                                           */
+/*  triangulatemany() triangulates many small independent inputs (say, the   */
+/*  polygons of a map) with the same switches, in compressed sparse row      */
+/*  form:  input i has the vertices `pointoffsetlist[i]' up to (excluded)    */
+/*  `pointoffsetlist[i+1]' of `pointlist', and likewise the segments of      */
+/*  `segmentlist' and the holes of `holelist', which may be NULL.  The       */
+/*  segments are numbered within their input, from `firstnumber'.  Every     */
+/*  input must have at least three vertices.  The vertices and triangles of  */
+/*  output i are found in the same way in `outpointlist' and                 */
+/*  `outtrianglelist', with the corners numbered within the output.  Only    */
+/*  the vertices and triangles are written:  the `r', `v', `A', `R', `L',    */
+/*  `e', `n', `o2', `K', `N', and `E' switches are ignored, and so is `a'    */
+/*  without a number.  The four output lists are allocated by                */
+/*  triangulatemany(), to be freed with trifree().  The inputs are           */
+/*  triangulated by several threads when compiled with OpenMP.               */
+/*                                                                           */
+/*****************************************************************************/
+
 #define ANSI_DECLARATORS
 #ifdef ANSI_DECLARATORS
 void triangulate(char *, struct triangulateio *, struct triangulateio *,
                  struct triangulateio *);
 void trifree(void *memptr);
+void measurequality(REAL *, int *, int, int, int, REAL *, REAL *, REAL *,
+                    struct qualitystats *);
+void trimeshoutput(struct triangulateio *, char *);
+void trimeshfree(struct triangulateio *);
+int streampoints(struct triangulateio *, REAL *, REAL *, int *, int, int);
+void pointstreamfree(struct triangulateio *);
+void voronoicells(REAL *, int, int *, int, int, int, REAL *, REAL **, int *,
+                  int **, int **);
+void triangulatemany(char *, int, REAL *, int *, int *, int *, REAL *, int *,
+                     REAL **, int **, int **, int **);
 #else /* not ANSI_DECLARATORS */
 void triangulate();
 void trifree();
+void measurequality();
+void trimeshoutput();
+void trimeshfree();
+int streampoints();
+void pointstreamfree();
+void voronoicells();
+void triangulatemany();
 #endif /* not ANSI_DECLARATORS */
@@ -1,10 +1,23 @@
 /*
-Python interface module to double version of Triangle
+Python interface module to Triangle, in double precision unless SINGLE is
+defined (then coordinates and attributes are stored as float)
 */
 
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "Python.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef SINGLE
+#define REAL float
+#else
 #define REAL double
+#endif
 #define _NDIM 2
 
 #include "triangle.h"
@@ -23,45 +36,156 @@ extern void _Py_CountReferences(FILE*);
 #define DESCRIBE_HEX(x) CURIOUS(fprintf(stderr, "  " #x "=%08x\n", x))
 #define COUNTREFS()     CURIOUS(_Py_CountReferences(stderr))
 
-void destroy_triangulateio(PyObject *address) {
+/* Find the points and triangles of a refinement level (see the L switch).
+   Level 0 is the coarsest, negative levels count back from the finest
+   (-1), which is the ordinary output. The points of a level are the first
+   npts points of the handle. Return 0 and set an IndexError if there is
+   no such level. */
+static int
+find_level(struct triangulateio *object, int level,
+           int *npts, int *ntri, int **tlist, REAL **talist) {
+  int k, offset, nlevels;
+
+  nlevels = object->numberoflevels + 1;
+  if(level < -nlevels || level >= nlevels) {
+    sprintf(MSG, "ERROR in %s at line %d: level %d out of range (%d levels)\n", __FILE__, __LINE__, level, nlevels);
+    PyErr_SetString(PyExc_IndexError, MSG);
+    return 0;
+  }
+  if(level < 0) level += nlevels;
+  if(level == nlevels - 1) {
+    *npts  = object->numberofpoints;
+    *ntri  = object->numberoftriangles;
+    *tlist = object->trianglelist;
+    *talist= object->triangleattributelist;
+    return 1;
+  }
+  offset = 0;
+  for(k = 0; k < level; ++k) {
+    offset += object->leveltrianglecountlist[k];
+  }
+  *npts  = object->levelpointcountlist[level];
+  *ntri  = object->leveltrianglecountlist[level];
+  *tlist = object->leveltrianglelist + 3*offset;
+  *talist= NULL;
+  if(object->leveltriangleattributelist) {
+    *talist = object->leveltriangleattributelist + object->numberoftriangleattributes*offset;
+  }
+  return 1;
+}
 
-  struct triangulateio *object = NULL;
+/* What a handle points to: a triangulateio struct, followed by the file
+   that load may have mapped its arrays to, or the buffer that loads may
+   have borrowed them from (then owner is kept alive with them). The arrays
+   that lie in the mapping were not malloc'ed and must not be freed.
+   firstnumber is the number of the first point in the triangles, segments
+   and edges: 0 (z switch) or 1, or -1 if it is not known. */
+struct triangulate_handle {
+  struct triangulateio object;
+  char *map;
+  size_t mapsize;
+  Py_buffer view;
+  PyObject *owner;
+  int firstnumber;
+};
 
-#if defined(Py_DEBUG) || defined(DEBUG)
-  printf("now destroying triangulateio\n");
-#endif
+/* Check that the first 3 of the nc corners of the ntri triangles of tlist,
+   from the handle object, are numbered from *firstnumber to
+   *firstnumber + npts - 1. A negative *firstnumber is set to the numbering
+   recorded in the handle (see struct triangulate_handle) or, if the handle
+   does not know it, from the corners: 0 if a corner is numbered 0, 1
+   otherwise. Return 0 and set a ValueError if a corner is out of range. */
+static int
+check_corners(struct triangulateio *object, const int *tlist, int ntri, int nc, int npts,
+              int *firstnumber) {
+  int i, j, c, lo, hi;
+
+  lo = npts;
+  hi = -1;
+  for(i = 0; i < ntri; ++i) {
+    for(j = 0; j < 3; ++j) {
+      c = tlist[nc*i + j];
+      if(c < lo) lo = c;
+      if(c > hi) hi = c;
+    }
+  }
+  if(*firstnumber < 0) {
+    *firstnumber = ((struct triangulate_handle *) object)->firstnumber;
+  }
+  if(*firstnumber < 0) {
+    *firstnumber = (lo == 0) ? 0 : 1;
+  }
+  if(ntri > 0 && (lo < *firstnumber || hi >= *firstnumber + npts)) {
+    sprintf(MSG, "ERROR in %s at line %d: corners numbered from %d to %d, not within %d..%d (wrong firstnumber?)\n", __FILE__, __LINE__, lo, hi, *firstnumber, *firstnumber + npts - 1);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return 0;
+  }
+  return 1;
+}
 
-  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+/* Free an array of a handle, unless it lies in a mapped file or buffer */
+static void
+free_array(struct triangulateio *object, void *ptr) {
+  struct triangulate_handle *handle = (struct triangulate_handle *) object;
+
+  if(handle->map && (char *) ptr >= handle->map && (char *) ptr < handle->map + handle->mapsize) {
+    return;
+  }
+  free(ptr);
+}
 
-  if( object->pointlist             ) free( object->pointlist             );
-  if( object->pointattributelist    ) free( object->pointattributelist    ); 
-  if( object->pointmarkerlist       ) free( object->pointmarkerlist       );
+/* Free the arrays of a triangulateio struct, but not the struct itself */
+static void
+free_triangulateio(struct triangulateio *object) {
+  struct triangulate_handle *handle = (struct triangulate_handle *) object;
 
-  if( object->trianglelist          ) free( object->trianglelist          );
-  if( object->triangleattributelist ) free( object->triangleattributelist );
-  if( object->trianglearealist      ) free( object->trianglearealist      );
-  if( object->neighborlist          ) free( object->neighborlist          );
+  if( object->mesh                  ) trimeshfree( object );
+  if( object->pointstream           ) pointstreamfree( object );
 
-  if( object->segmentlist           ) free( object->segmentlist           );
-  if( object->segmentmarkerlist     ) free( object->segmentmarkerlist     );
+  if( object->pointlist             ) free_array( object, object->pointlist             );
+  if( object->pointattributelist    ) free_array( object, object->pointattributelist    ); 
+  if( object->pointmarkerlist       ) free_array( object, object->pointmarkerlist       );
 
-  if( object->holelist              ) free( object->holelist              );
+  if( object->trianglelist          ) free_array( object, object->trianglelist          );
+  if( object->triangleattributelist ) free_array( object, object->triangleattributelist );
+  if( object->trianglearealist      ) free_array( object, object->trianglearealist      );
+  if( object->neighborlist          ) free_array( object, object->neighborlist          );
 
-  if( object->regionlist            ) free( object->regionlist            );
+  if( object->segmentlist           ) free_array( object, object->segmentlist           );
+  if( object->segmentmarkerlist     ) free_array( object, object->segmentmarkerlist     );
 
-  if( object->edgelist              ) free( object->edgelist              );
-  if( object->edgemarkerlist        ) free( object->edgemarkerlist        );
-  if( object->normlist              ) free( object->normlist              );
+  if( object->holelist              ) free_array( object, object->holelist              );
 
-  free(object);
-}
+  if( object->regionlist            ) free_array( object, object->regionlist            );
 
-static PyObject *
-triangulate_NEW(PyObject *self, PyObject *args) {
-  PyObject *address, *result;
-  struct triangulateio *object;
+  if( object->markerarealist        ) free_array( object, object->markerarealist        );
+
+  if( object->levelpointcountlist   ) free_array( object, object->levelpointcountlist   );
+  if( object->leveltrianglecountlist) free_array( object, object->leveltrianglecountlist);
+  if( object->leveltrianglelist     ) free_array( object, object->leveltrianglelist     );
+  if( object->leveltriangleattributelist ) free_array( object, object->leveltriangleattributelist );
 
-  object = malloc(sizeof(struct triangulateio));
+  if( object->edgelist              ) free_array( object, object->edgelist              );
+  if( object->edgemarkerlist        ) free_array( object, object->edgemarkerlist        );
+  if( object->normlist              ) free_array( object, object->normlist              );
+
+  if( object->stats                 ) free_array( object, object->stats                 );
+  if( object->capacities            ) free( object->capacities );
+
+  if( handle->owner ) {
+    PyBuffer_Release( &handle->view );
+    Py_CLEAR( handle->owner );
+  }
+#ifndef _WIN32
+  else if( handle->map ) munmap( handle->map, handle->mapsize );
+#endif
+  handle->map = NULL;
+  handle->mapsize = 0;
+}
+
+/* Set all the arrays of a triangulateio struct to NULL and all the sizes to zero */
+static void
+init_triangulateio(struct triangulateio *object) {
 
   object->pointlist             = NULL;
   object->pointattributelist    = NULL; /* In / out */
@@ -87,10 +211,81 @@ triangulate_NEW(PyObject *self, PyObject *args) {
   object->regionlist            = NULL; /* In / pointer to array copied out */
   object->numberofregions       = 0;    /* In / copied out */
 
+  object->markerarealist        = NULL; /* In only */
+  object->numberofmarkerareas   = 0;    /* In only */
+
+  object->levelpointcountlist   = NULL; /* Out only */
+  object->leveltrianglecountlist= NULL; /* Out only */
+  object->leveltrianglelist     = NULL; /* Out only */
+  object->leveltriangleattributelist = NULL; /* Out only */
+  object->numberoflevels        = 0;    /* Out only */
+
   object->edgelist              = NULL; /* Out only */
   object->edgemarkerlist        = NULL; /* Not used with Voronoi diagram; out only */
   object->normlist              = NULL; /* Used only with Voronoi diagram; out only */
+
+  object->stats                 = NULL; /* Out only */
   object->numberofedges         = 0;    /* Out only */
+  object->mesh                  = NULL; /* Out only; kept by K switch */
+  object->pointstream           = NULL; /* In only; see streampoints */
+  object->capacities            = NULL; /* In / out; see reserve_array */
+}
+
+/* The sizes of the arrays of a handle, recorded from the first call on
+   (see struct triangulatecapacities in triangle.h) */
+static struct triangulatecapacities *
+get_capacities(struct triangulateio *object) {
+  if(!object->capacities) {
+    object->capacities = calloc(1, sizeof(struct triangulatecapacities));
+  }
+  return object->capacities;
+}
+
+/* Forget the sizes of the arrays of a handle, after they were replaced by
+   arrays of unknown size: they are allocated again on the next reserve */
+static void
+forget_capacities(struct triangulateio *object) {
+  if(object->capacities) {
+    memset(object->capacities, 0, sizeof(struct triangulatecapacities));
+  }
+}
+
+/* Make room for size bytes in the array *ptr of a handle, whose size is
+   recorded in *capacity. The array is only allocated again, a quarter
+   larger, if it is too small: points of the same number (or fewer), set
+   again at every step of a time-stepping loop, are written in place. */
+static void
+reserve_array(struct triangulateio *object, void **ptr, long *capacity, size_t size) {
+  if(*ptr && (size_t) *capacity >= size) return;
+  if(*ptr) free_array(object, *ptr);
+  *capacity = (long) (size + size / 4);
+  *ptr = malloc((size_t) *capacity);
+}
+
+void destroy_triangulateio(PyObject *address) {
+
+  struct triangulateio *object = NULL;
+
+#if defined(Py_DEBUG) || defined(DEBUG)
+  printf("now destroying triangulateio\n");
+#endif
+
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  free_triangulateio(object);
+  free(object);
+}
+
+static PyObject *
+triangulate_NEW(PyObject *self, PyObject *args) {
+  PyObject *address, *result;
+  struct triangulateio *object;
+
+  object = malloc(sizeof(struct triangulate_handle));
+  init_triangulateio(object);
+  ((struct triangulate_handle *) object)->map = NULL;
+  ((struct triangulate_handle *) object)->mapsize = 0;
+  ((struct triangulate_handle *) object)->owner = NULL;
+  ((struct triangulate_handle *) object)->firstnumber = -1;
 
   /* return opaque handle */
 
@@ -104,6 +299,7 @@ static PyObject *
 triangulate_SET_POINTS(PyObject *self, PyObject *args) {
   PyObject *address, *xy, *mrks, *elem;
   struct triangulateio *object;
+  struct triangulatecapacities *capacities;
   int npts, i;
 
   if(!PyArg_ParseTuple(args,(char *)"OOO", 
@@ -129,14 +325,9 @@ triangulate_SET_POINTS(PyObject *self, PyObject *args) {
 
   npts  = PySequence_Length(xy);
   if(npts > 0) {
-    if(npts != object->numberofpoints) {
-      if(object->pointlist) free(object->pointlist);
-      /* if(object->pointattributelist) free(object->pointattributelist); */
-      if(object->pointmarkerlist) free(object->pointmarkerlist);
-      object->pointlist = malloc(_NDIM * npts * sizeof(REAL));
-      /* object->pointattributelist = malloc(natts * npts * sizeof(REAL)); */
-      object->pointmarkerlist = malloc(npts * sizeof(int));
-    }
+    capacities = get_capacities(object);
+    reserve_array(object, (void **) &object->pointlist, &capacities->pointlist, _NDIM * npts * sizeof(REAL));
+    reserve_array(object, (void **) &object->pointmarkerlist, &capacities->pointmarkerlist, npts * sizeof(int));
     object->numberofpoints = npts;
   }
   for(i = 0; i < npts; ++i) {
@@ -186,8 +377,7 @@ triangulate_SET_POINT_ATTRIBUTES(PyObject *self, PyObject *args) {
   }
   object->numberofpointattributes = natts;
 
-  if(object->pointattributelist) free(object->pointattributelist);
-  object->pointattributelist = malloc(natts * npts * sizeof(REAL));
+  reserve_array(object, (void **) &object->pointattributelist, &get_capacities(object)->pointattributelist, natts * npts * sizeof(REAL));
 
   for(i = 0; i < npts; ++i) {
     elem = PySequence_Fast_GET_ITEM(atts, i);
@@ -200,6 +390,53 @@ triangulate_SET_POINT_ATTRIBUTES(PyObject *self, PyObject *args) {
 }
 
 
+static PyObject *
+triangulate_SET_TRIANGLES(PyObject *self, PyObject *args) {
+  PyObject *address, *tris, *elem;
+  struct triangulateio *object;
+  int ntri, nc, i, j;
+
+  if(!PyArg_ParseTuple(args,(char *)"OO", 
+               &address, &tris)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }    
+  if(!PySequence_Check(tris)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #2 ([(ia, ib, ic),...] required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);  
+
+  /* 3 or 6 corners per triangle, as many for all the triangles */
+  ntri = PySequence_Length(tris);
+  nc = 3;
+  if(ntri > 0) {
+    nc = PySequence_Length( PySequence_Fast_GET_ITEM(tris, 0) );
+  }
+  if(nc != 3 && nc != 6) {
+    sprintf(MSG, "ERROR in %s at line %d: %d corners per triangle (3 or 6 required)\n", __FILE__, __LINE__, nc);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+
+  reserve_array(object, (void **) &object->trianglelist, &get_capacities(object)->trianglelist, nc * (size_t) ntri * sizeof(int));
+  object->numberoftriangles = ntri;
+  object->numberofcorners = nc;
+  for(i = 0; i < ntri; ++i) {
+    elem = PySequence_Fast_GET_ITEM(tris, i);
+    for(j = 0; j < nc; ++j) {
+      object->trianglelist[nc*i + j] = (int) PyLong_AsLong(PySequence_Fast_GET_ITEM(elem, j));
+    }
+  }
+
+  return Py_BuildValue("");
+}
+
 static PyObject *
 triangulate_SET_TRIANGLE_ATTRIBUTES(PyObject *self, PyObject *args) {
   PyObject *address, *atts, *elem;
@@ -236,8 +473,7 @@ triangulate_SET_TRIANGLE_ATTRIBUTES(PyObject *self, PyObject *args) {
   }    
   object->numberoftriangleattributes = natts;
 
-  if(object->triangleattributelist) free(object->triangleattributelist);
-  object->triangleattributelist = malloc(natts * ntri * sizeof(REAL));
+  reserve_array(object, (void **) &object->triangleattributelist, &get_capacities(object)->triangleattributelist, natts * ntri * sizeof(REAL));
 
   for(i = 0; i < ntri; ++i) {
     elem = PySequence_Fast_GET_ITEM(atts, i);
@@ -254,10 +490,12 @@ static PyObject *
 triangulate_GET_POINT_ATTRIBUTES(PyObject *self, PyObject *args) {
   PyObject *address, *elem, *val, *result;
   struct triangulateio *object;
-  int npts, natts, i, j;
+  int npts, ntri, natts, i, j, level = -1;
+  int *tlist;
+  REAL *talist;
 
-  if(!PyArg_ParseTuple(args,(char *)"O", 
-               &address)) { 
+  if(!PyArg_ParseTuple(args,(char *)"O|i", 
+               &address, &level)) { 
     return NULL;
   }
   if(!PyCapsule_CheckExact(address)) {
@@ -266,8 +504,10 @@ triangulate_GET_POINT_ATTRIBUTES(PyObject *self, PyObject *args) {
     return NULL;
   }    
   object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
 
-  npts   = object->numberofpoints;
   result = PyList_New(npts);
   natts  = object->numberofpointattributes;
   for(i = 0; i < npts; ++i) {
@@ -287,10 +527,12 @@ static PyObject *
 triangulate_GET_TRIANGLE_ATTRIBUTES(PyObject *self, PyObject *args) {
   PyObject *address, *elem, *val, *result;
   struct triangulateio *object;
-  int ntri, natts, i, j;
+  int npts, ntri, natts, i, j, level = -1;
+  int *tlist;
+  REAL *talist;
 
-  if(!PyArg_ParseTuple(args,(char *)"O", 
-               &address)) { 
+  if(!PyArg_ParseTuple(args,(char *)"O|i", 
+               &address, &level)) { 
     return NULL;
   }
   if(!PyCapsule_CheckExact(address)) {
@@ -299,14 +541,16 @@ triangulate_GET_TRIANGLE_ATTRIBUTES(PyObject *self, PyObject *args) {
     return NULL;
   }    
   object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
 
-  ntri = object->numberoftriangles;
   result = PyList_New(ntri);
   natts  = object->numberoftriangleattributes;
   for(i = 0; i < ntri; ++i) {
     elem = PyTuple_New(natts);
     for(j = 0; j < natts; ++j) {
-      val = PyFloat_FromDouble(object->triangleattributelist[natts*i + j]);
+      val = PyFloat_FromDouble(talist[natts*i + j]);
       PyTuple_SET_ITEM(elem, j, val);
     }
     PyList_SET_ITEM(result, i, elem);
@@ -320,6 +564,7 @@ static PyObject *
 triangulate_SET_SEGMENTS(PyObject *self, PyObject *args) {
   PyObject *address, *segs, *elem, *marks, *tag;
   struct triangulateio *object;
+  struct triangulatecapacities *capacities;
   int ns, i;
 
   if(!PyArg_ParseTuple(args,(char *)"OOO", 
@@ -344,11 +589,9 @@ triangulate_SET_SEGMENTS(PyObject *self, PyObject *args) {
   object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);  
 
   ns = PySequence_Length(segs);
-  if(ns != object->numberofsegments) {
-    if(object->segmentlist) free(object->segmentlist);
-    object->segmentlist = malloc(_NDIM * ns * sizeof(int));
-    object->segmentmarkerlist = malloc( ns * sizeof(int));
-  }
+  capacities = get_capacities(object);
+  reserve_array(object, (void **) &object->segmentlist, &capacities->segmentlist, _NDIM * ns * sizeof(int));
+  reserve_array(object, (void **) &object->segmentmarkerlist, &capacities->segmentmarkerlist, ns * sizeof(int));
   object->numberofsegments = ns;
   for(i = 0; i < ns; ++i) {
     elem = PySequence_Fast_GET_ITEM(segs, i);
@@ -385,7 +628,7 @@ triangulate_SET_HOLES(PyObject *self, PyObject *args) {
 
   nh = PySequence_Length(xy);
   if(nh != object->numberofholes) {
-    if(object->holelist) free(object->holelist);
+    if(object->holelist) free_array(object, object->holelist);
     object->holelist = malloc(nh * _NDIM * sizeof(REAL));
   }
   object->numberofholes = nh;
@@ -422,7 +665,7 @@ triangulate_SET_REGIONS(PyObject *self, PyObject *args) {
 
   nr = PySequence_Length(xy);
   if(nr != object->numberofregions) {
-    if(object->regionlist) free(object->regionlist);
+    if(object->regionlist) free_array(object, object->regionlist);
     object->regionlist = malloc(nr * 4 * sizeof(REAL));
   }
   object->numberofregions = nr;
@@ -437,15 +680,90 @@ triangulate_SET_REGIONS(PyObject *self, PyObject *args) {
   return Py_BuildValue("");
 }
 
+static PyObject *
+triangulate_SET_MARKER_AREAS(PyObject *self, PyObject *args) {
+  PyObject *address, *ma, *elem;
+  struct triangulateio *object;
+  int nm, i;
+
+  if(!PyArg_ParseTuple(args,(char *)"OO", 
+               &address, &ma)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }    
+  if(!PySequence_Check(ma)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #2 ([(m, a),...] required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  nm = PySequence_Length(ma);
+  if(nm != object->numberofmarkerareas) {
+    if(object->markerarealist) free_array(object, object->markerarealist);
+    object->markerarealist = malloc(nm * 2 * sizeof(REAL));
+  }
+  object->numberofmarkerareas = nm;
+  for(i = 0; i < nm; ++i) {
+    elem = PySequence_Fast_GET_ITEM(ma, i);
+    object->markerarealist[2*i  ] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(elem, 0));
+    object->markerarealist[2*i+1] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(elem, 1));
+  }
+
+  return Py_BuildValue("");
+}
+
+/* Empty an output handle before triangulate writes to it. Its arrays are
+   freed, for Triangle to allocate them to size, unless recycle is set:
+   Triangle then writes the arrays of the previous call again where they
+   fit (see struct triangulatecapacities in triangle.h). The arrays of the
+   levels, which Triangle always allocates, and the holes and regions,
+   which are copied from the input after the call, are freed all the same.
+   The caller does not recycle the arrays of a mapped file or a borrowed
+   buffer. */
+static void
+clear_output(struct triangulateio *object, int recycle) {
+  struct triangulatestats *stats;
+
+  if(!recycle) {
+    stats = object->stats;
+    object->stats = NULL;
+    free_triangulateio(object);
+    init_triangulateio(object);
+    object->stats = stats;
+  }
+  if(recycle) get_capacities(object);
+
+  if( object->levelpointcountlist   ) free_array( object, object->levelpointcountlist   );
+  if( object->leveltrianglecountlist) free_array( object, object->leveltrianglecountlist);
+  if( object->leveltrianglelist     ) free_array( object, object->leveltrianglelist     );
+  if( object->leveltriangleattributelist ) free_array( object, object->leveltriangleattributelist );
+  object->levelpointcountlist        = NULL;
+  object->leveltrianglecountlist     = NULL;
+  object->leveltrianglelist          = NULL;
+  object->leveltriangleattributelist = NULL;
+  object->numberoflevels             = 0;
+
+  if( object->holelist              ) free_array( object, object->holelist              );
+  if( object->regionlist            ) free_array( object, object->regionlist            );
+  object->holelist   = NULL;
+  object->regionlist = NULL;
+}
+
 static PyObject *
 triangulate_TRIANGULATE(PyObject *self, PyObject *args) {
   PyObject *address_in, *address_out, *address_vor;
   struct triangulateio *object_in, *object_out, *object_vor;
+  struct triangulatecapacities *cap_in, *cap_out;
   char *swtch;
-  int i;
+  int i, npts, reuse = 0, recycle = 0;
 
-  if(!PyArg_ParseTuple(args,(char *)"sOOO",
-               &swtch, &address_in, &address_out, &address_vor)) {
+  if(!PyArg_ParseTuple(args,(char *)"sOOO|ii",
+               &swtch, &address_in, &address_out, &address_vor, &reuse, &recycle)) {
     return NULL;
   }
   if(!PyCapsule_CheckExact(address_in)) {
@@ -467,7 +785,100 @@ triangulate_TRIANGULATE(PyObject *self, PyObject *args) {
   object_out = PyCapsule_GetPointer(address_out, TRIANGULATEIO_NAME);
   object_vor = PyCapsule_GetPointer(address_vor, TRIANGULATEIO_NAME);
 
+  /* Triangle would exit */
+  npts = object_in->pointstream? streampoints(object_in, NULL, NULL, NULL, 0, 0): object_in->numberofpoints;
+  if(npts < 3) {
+    sprintf(MSG, "ERROR in %s at line %d: %d points (at least 3 required)\n", __FILE__, __LINE__, npts);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+  if(strchr(swtch, 'r') && object_in->numberoftriangles > 0 &&
+     (!object_in->trianglelist || (object_in->numberofcorners != 3 && object_in->numberofcorners != 6))) {
+    sprintf(MSG, "ERROR in %s at line %d: %d triangles of %d corners to refine (3 or 6 required)\n", __FILE__, __LINE__, object_in->numberoftriangles, object_in->numberofcorners);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+
+  /* the Voronoi diagram would be written over the points of the mesh */
+  if(strchr(swtch, 'v') && (object_vor == object_in || object_vor == object_out)) {
+    sprintf(MSG, "ERROR in %s at line %d: the Voronoi handle must differ from the input and output handles\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+
+  /* always collect the statistics, they cost next to nothing */
+  if(!object_out->stats) {
+    object_out->stats = malloc(sizeof(struct triangulatestats));
+  }
+  /* a mesh kept by a previous call (K switch) is superseded */
+  trimeshfree(object_out);
+  /* Triangle frees and reallocates the arrays of a recycled output, which
+     must be its own: not those of the input, nor those of a mapped file
+     or a borrowed buffer. Without recycle, it must not see the sizes that
+     set_points and the like record, whatever handle they belong to */
+  if(object_out == object_in || ((struct triangulate_handle *) object_out)->map ||
+     ((struct triangulate_handle *) object_out)->owner) {
+    recycle = 0;
+  }
+  if(object_out != object_in) {
+    clear_output(object_out, recycle);
+  } else if(object_out->capacities) {
+    free(object_out->capacities);
+    object_out->capacities = NULL;
+  }
+  /* the arrays of a previous Voronoi diagram are emptied the same way:
+     Triangle would write a larger diagram over them */
+  if(strchr(swtch, 'v')) {
+    trimeshfree(object_vor);
+    clear_output(object_vor, recycle && !((struct triangulate_handle *) object_vor)->map &&
+                             !((struct triangulate_handle *) object_vor)->owner);
+  }
+
+  /* share the point arrays of the input, which the output takes over if
+     Triangle adds no point (see the nasty trick in triangle.h). Not those
+     of a mapped file or a borrowed buffer, which free would not free, and
+     not without output points (N switch) */
+  reuse = reuse && object_in != object_out && object_in->pointlist &&
+          !((struct triangulate_handle *) object_in)->map && !strchr(swtch, 'N');
+  if(reuse) {
+    if(object_out->pointlist         ) free_array(object_out, object_out->pointlist         );
+    if(object_out->pointattributelist) free_array(object_out, object_out->pointattributelist);
+    if(object_out->pointmarkerlist   ) free_array(object_out, object_out->pointmarkerlist   );
+    object_out->pointlist          = object_in->pointlist;
+    object_out->pointattributelist = object_in->pointattributelist;
+    object_out->pointmarkerlist    = object_in->pointmarkerlist;
+    if(object_out->capacities) {
+      object_out->capacities->pointlist          = 0;
+      object_out->capacities->pointattributelist = 0;
+      object_out->capacities->pointmarkerlist    = 0;
+    }
+  }
+
   triangulate(swtch, object_in, object_out, object_vor);
+  ((struct triangulate_handle *) object_out)->firstnumber = strchr(swtch, 'z') ? 0 : 1;
+  if(strchr(swtch, 'v')) {
+    ((struct triangulate_handle *) object_vor)->firstnumber = strchr(swtch, 'z') ? 0 : 1;
+  }
+
+  if(reuse && object_out->pointlist == object_in->pointlist) {
+    /* the sizes of the arrays go with them */
+    cap_in  = get_capacities(object_in);
+    cap_out = recycle ? object_out->capacities : NULL;
+    object_in->pointlist = NULL;
+    if(cap_out) cap_out->pointlist = cap_in->pointlist;
+    cap_in->pointlist = 0;
+    if(object_out->pointattributelist == object_in->pointattributelist) {
+      object_in->pointattributelist = NULL;
+      if(cap_out) cap_out->pointattributelist = cap_in->pointattributelist;
+      cap_in->pointattributelist = 0;
+    }
+    if(object_out->pointmarkerlist    == object_in->pointmarkerlist   ) {
+      object_in->pointmarkerlist    = NULL;
+      if(cap_out) cap_out->pointmarkerlist = cap_in->pointmarkerlist;
+      cap_in->pointmarkerlist = 0;
+    }
+    object_in->numberofpoints = 0;
+  }
 
   /* Copy holelist and regionlist. These are input only with the pointer
      sharing the address of the input struct. By copying these, we
@@ -495,10 +906,12 @@ static PyObject *
 triangulate_GET_NUM_POINTS(PyObject *self, PyObject *args) {
   PyObject *address;
   struct triangulateio *object;
-  int n;
+  int npts, ntri, level = -1;
+  int *tlist;
+  REAL *talist;
   
-  if(!PyArg_ParseTuple(args, "O", 
-               &address)) { 
+  if(!PyArg_ParseTuple(args, "O|i", 
+               &address, &level)) { 
     return NULL;
   }
   if(!PyCapsule_CheckExact(address)) {
@@ -507,19 +920,23 @@ triangulate_GET_NUM_POINTS(PyObject *self, PyObject *args) {
     return NULL;
   }
   object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
-  n = object->numberofpoints;
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
 
-  return Py_BuildValue("i", n);
+  return Py_BuildValue("i", npts);
 }
 
 static PyObject *
 triangulate_GET_NUM_TRIANGLES(PyObject *self, PyObject *args) {
   PyObject *address;
   struct triangulateio *object;
-  int n;
+  int npts, ntri, level = -1;
+  int *tlist;
+  REAL *talist;
   
-  if(!PyArg_ParseTuple(args, "O", 
-               &address)) { 
+  if(!PyArg_ParseTuple(args, "O|i", 
+               &address, &level)) { 
     return NULL;
   }
   if(!PyCapsule_CheckExact(address)) {
@@ -528,23 +945,27 @@ triangulate_GET_NUM_TRIANGLES(PyObject *self, PyObject *args) {
     return NULL;
   }
   object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
-  n = object->numberoftriangles;
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
 
-  return Py_BuildValue("i", n);
+  return Py_BuildValue("i", ntri);
 }
 
 static PyObject *
 triangulate_GET_POINTS(PyObject *self, PyObject *args) {
 
-  /* Return a [ [(x,y), marker],..] */
+  /* Return a [ [(x,y), marker],..], of at most count points if count >= 0 */
 
   PyObject *address, *holder, *mlist;
   struct triangulateio *object;
-  int i, m;
+  int i, m, npts, ntri, level = -1, count = -1;
+  int *tlist;
+  REAL *talist;
   REAL x, y;
   
-  if(!PyArg_ParseTuple(args, "O", 
-               &address)) { 
+  if(!PyArg_ParseTuple(args, "O|ii", 
+               &address, &level, &count)) { 
     return NULL;
   }
   if(!PyCapsule_CheckExact(address)) {
@@ -553,13 +974,17 @@ triangulate_GET_POINTS(PyObject *self, PyObject *args) {
     return NULL;
   }
   object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
+  if(count >= 0 && count < npts) npts = count;
 
-  holder = PyList_New(object->numberofpoints);
+  holder = PyList_New(npts);
 
-  for (i = 0; i < object->numberofpoints; ++i) {
+  for (i = 0; i < npts; ++i) {
     x = object->pointlist[_NDIM*i  ];
     y = object->pointlist[_NDIM*i + 1];
-    m = object->pointmarkerlist[i];
+    m = object->pointmarkerlist ? object->pointmarkerlist[i] : 0;
     mlist = Py_BuildValue("[(d,d),i]", x, y, m);
     PyList_SET_ITEM(holder, i, mlist);
   }
@@ -584,12 +1009,20 @@ triangulate_GET_EDGES(PyObject *self, PyObject *args) {
   }
   object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
 
+  /* the outputs deferred by the K switch are written on first access,
+     after which the kept mesh is of no more use */
+  trimeshoutput(object, "en");
+  trimeshfree(object);
+  if (!object->edgelist) {
+    return PyList_New(0);
+  }
+
   holder = PyList_New(object->numberofedges);
 
   for (i = 0; i < object->numberofedges; ++i) {
     i1 = object->edgelist[_NDIM*i  ];
     i2 = object->edgelist[_NDIM*i+1];
-    m  = object->edgemarkerlist[i];
+    m  = object->edgemarkerlist ? object->edgemarkerlist[i] : 0;
     i1_i2_m = Py_BuildValue("((i,i),i)", i1, i2, m);
     PyList_SET_ITEM(holder, i, i1_i2_m);
   }
@@ -601,11 +1034,13 @@ static PyObject *
 triangulate_GET_TRIANGLES(PyObject *self, PyObject *args) {
   PyObject *address, *holder, *points, *kk, *atts, *aa, *elem, *neigh, *mm;
   struct triangulateio *object;
-  int i, j, k, m, nc, na, nt;
+  int i, j, k, m, nc, na, nt, npts, ntri, level = -1;
+  int *tlist;
+  REAL *talist;
   REAL a;
   
-  if(!PyArg_ParseTuple(args, "O", 
-               &address)) { 
+  if(!PyArg_ParseTuple(args, "O|i", 
+               &address, &level)) { 
     return NULL;
   }
   if(!PyCapsule_CheckExact(address)) {
@@ -614,22 +1049,37 @@ triangulate_GET_TRIANGLES(PyObject *self, PyObject *args) {
     return NULL;
   }
   object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
 
-  holder = PyList_New(object->numberoftriangles);
+  if(tlist == object->trianglelist) {
+    /* the outputs deferred by the K switch are written on first access,
+       after which the kept mesh is of no more use */
+    trimeshoutput(object, "en");
+    trimeshfree(object);
+  }
+
+  holder = PyList_New(ntri);
   nc = object->numberofcorners;
   if(object->neighborlist) {
     nt = 3;
   } else{
     nt = 0;
   }
+  if(tlist != object->trianglelist) {
+    /* coarser levels only record the triangle corners */
+    nc = 3;
+    nt = 0;
+  }
   na = object->numberoftriangleattributes;
 
-  for(i = 0; i < object->numberoftriangles; ++i) {
+  for(i = 0; i < ntri; ++i) {
     points = PyList_New(nc);
     neigh = PyTuple_New(nt);
     atts  = PyList_New(na);
     for(j = 0; j < nc; ++j) {
-      k = object->trianglelist[nc*i+j];
+      k = tlist[nc*i+j];
       kk = PyLong_FromLong((long) k);
       PyList_SET_ITEM(points, j, kk);
     }
@@ -639,7 +1089,7 @@ triangulate_GET_TRIANGLES(PyObject *self, PyObject *args) {
       PyTuple_SET_ITEM(neigh, j, mm);
     }
     for(j = 0; j < na; ++j) {
-      a = object->triangleattributelist[na*i+j];
+      a = talist[na*i+j];
       aa = PyFloat_FromDouble(a);
       PyList_SET_ITEM(atts, j, aa);
     }
@@ -653,69 +1103,2949 @@ triangulate_GET_TRIANGLES(PyObject *self, PyObject *args) {
   return holder;  
 }
 
-static PyMethodDef triangulate_methods[] = {
-  {"new", triangulate_NEW, METH_VARARGS, "Return new handle to triangulateio structure ()->h."},
-  {"set_points", triangulate_SET_POINTS, METH_VARARGS, 
-   "Set points and markers (h, [(x1,y1),(x2,y2)..], [m1,m2..])->None. \nh: handle.\n[(x1,y1),(x2,y2)..]: coordinates.\n[m1,m2,..]: point markers (1 per point)."},
-  {"set_point_attributes", triangulate_SET_POINT_ATTRIBUTES, METH_VARARGS, 
-   "Set point attributes (h, [(a1,a2,..),..])->None. \nh: handle.\n[(a1,a2,..),..]: atributes (a1,a2,..)."},
-  {"set_triangle_attributes", triangulate_SET_TRIANGLE_ATTRIBUTES, METH_VARARGS, 
-   "Set triangle attributes (h, [(a1,a2,..),..])->None. \nh: handle.\n[(a1,a2,..),..]: atributes (a1,a2,..)."},
-  {"get_point_attributes", triangulate_GET_POINT_ATTRIBUTES, METH_VARARGS, 
-   "Get point attributes (h)->[(a1,a2,..),..]. \nh: handle."},
-  {"get_triangle_attributes", triangulate_GET_TRIANGLE_ATTRIBUTES, METH_VARARGS, 
-   "Get triangle attributes (h)->[(a1,a2,..),..]. \nh: handle."},
-  {"set_segments", triangulate_SET_SEGMENTS, METH_VARARGS, 
-   "Set segments (h, [(i,j),..])->None. \nh: handle.\n[(i,j),..]: segments."},
-  {"set_holes", triangulate_SET_HOLES, METH_VARARGS, 
-   "Set holes (h, [(x1,y1),(x2,y2),..])->None. \nh: handle.\n[(x1,y1),(x2,y2),..]: hole coordinates."},
-  {"set_regions", triangulate_SET_REGIONS, METH_VARARGS, 
-   "Set regions (h, [(x1,y1,r1,a1),(x2,y2,r2,a2),..])->None. \nh: handle.\n[(x1,y1,r1,a1),(x2,y2,r2,a2),..]: region tag coordinates, id and area constraint."},
-  {"triangulate", triangulate_TRIANGULATE, METH_VARARGS, 
-   "Triangulate or refine an existing triangulation (switches, h_in, h_out, h_vor)->None.\nswitches: a string (see Triangle doc).\nh_in, h_out, h_vor: handles to the input, output and Voronoi triangulateio structs."},
-  {"get_num_points", triangulate_GET_NUM_POINTS, METH_VARARGS, 
-   "Return number of points."},
-  {"get_num_triangles", triangulate_GET_NUM_TRIANGLES, METH_VARARGS, 
-   "Return number of triangles."},
-  {"get_points", triangulate_GET_POINTS, METH_VARARGS, 
-   "Return dict from handle (h)->{i: [(x,y),[i1,i2,..], m],..}.\nh: handle.\n(x,y): point coordinates.\n[i1,i2..]: neighboring point indices.\nm: point marker (0=interior, 1=boundary)."},
-  {"get_edges", triangulate_GET_EDGES, METH_VARARGS, 
-   "Return list of edge points with edge markers (h)->[((i1,i2),m),..].\nh: handle.\n(i1,i2): point indices.\nm: edge markers."},
-  {"get_triangles", triangulate_GET_TRIANGLES, METH_VARARGS, 
-   "Return list of triangles (h)->[([i1,i2,i3,..],(k1,k2,k3), [a1,a2,..]),..].\nh: handle.\ni1,i2,i3,..: point indices at the triangle corners, optionally followed by intermediate points.\n(k1,k2,k3) and neighboring triangle indices;\na1,a2..: triangle cell attributes."},
-  {NULL, NULL, 0, NULL}
-};
+/* Binary image of a triangulateio struct (see save/load): 8 magic bytes,
+   the sixth being the version of the format, TRIANGULATEIO_NHEADER ints
+   (the sizes, a bit mask of the arrays that are not NULL, the size of REAL,
+   a byte order mark and 1 + the numbering of the handle, 0 if unknown),
+   then the arrays in the order of list_arrays, each padded to a multiple
+   of 8 bytes. Every array thus starts at a
+   multiple of 8 bytes, and can be used in place in a mapped file. */
+#define TRIANGULATEIO_MAGIC "TRIIO\001\000"
+#define TRIANGULATEIO_VERSION 1
+#define TRIANGULATEIO_NHEADER 16
+#define TRIANGULATEIO_NARRAYS 19
+#define TRIANGULATEIO_BOM 0x01020304
+
+/* Return n * k * size, or 0 and clear *ok if that overflows */
+static size_t
+array_bytes(size_t n, size_t k, size_t size, int *ok) {
+  if(k != 0 && n > ((size_t) -1) / size / k) {
+    *ok = 0;
+    return 0;
+  }
+  return n * k * size;
+}
 
-struct triangulate_state {
-  PyObject *object;
-};
+/* Return the addresses of the array pointers of a triangulateio struct and
+   their sizes in bytes. nlt is the total number of triangles of the
+   coarser levels. Return 0 if a size overflows. */
+static int
+list_arrays(struct triangulateio *object, int nlt, void ***ptrs, size_t *sizes) {
+  size_t np = object->numberofpoints, nt = object->numberoftriangles;
+  size_t ne = object->numberofedges;
+  int i = 0, ok = 1;
+
+  ptrs[i] = (void **) &object->pointlist;          sizes[i++] = array_bytes(np, 2, sizeof(REAL), &ok);
+  ptrs[i] = (void **) &object->pointattributelist; sizes[i++] = array_bytes(np, object->numberofpointattributes, sizeof(REAL), &ok);
+  ptrs[i] = (void **) &object->pointmarkerlist;    sizes[i++] = array_bytes(np, 1, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->trianglelist;       sizes[i++] = array_bytes(nt, object->numberofcorners, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->triangleattributelist; sizes[i++] = array_bytes(nt, object->numberoftriangleattributes, sizeof(REAL), &ok);
+  ptrs[i] = (void **) &object->trianglearealist;   sizes[i++] = array_bytes(nt, 1, sizeof(REAL), &ok);
+  ptrs[i] = (void **) &object->neighborlist;       sizes[i++] = array_bytes(nt, 3, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->segmentlist;        sizes[i++] = array_bytes(object->numberofsegments, 2, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->segmentmarkerlist;  sizes[i++] = array_bytes(object->numberofsegments, 1, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->holelist;           sizes[i++] = array_bytes(object->numberofholes, 2, sizeof(REAL), &ok);
+  ptrs[i] = (void **) &object->regionlist;         sizes[i++] = array_bytes(object->numberofregions, 4, sizeof(REAL), &ok);
+  ptrs[i] = (void **) &object->markerarealist;     sizes[i++] = array_bytes(object->numberofmarkerareas, 2, sizeof(REAL), &ok);
+  ptrs[i] = (void **) &object->levelpointcountlist;    sizes[i++] = array_bytes(object->numberoflevels, 1, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->leveltrianglecountlist; sizes[i++] = array_bytes(object->numberoflevels, 1, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->leveltrianglelist;  sizes[i++] = array_bytes(nlt, 3, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->leveltriangleattributelist; sizes[i++] = array_bytes(nlt, object->numberoftriangleattributes, sizeof(REAL), &ok);
+  ptrs[i] = (void **) &object->edgelist;           sizes[i++] = array_bytes(ne, 2, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->edgemarkerlist;     sizes[i++] = array_bytes(ne, 1, sizeof(int), &ok);
+  ptrs[i] = (void **) &object->normlist;           sizes[i++] = array_bytes(ne, 2, sizeof(REAL), &ok);
+  return ok;
+}
 
-#if PY_MAJOR_VERSION >= 3
-static struct PyModuleDef triangulateio_moduledef = {
-        PyModuleDef_HEAD_INIT,
-        "triangulate",
-        NULL,
-        sizeof(struct triangulate_state),
-        triangulate_methods,
-        NULL,
-        NULL,
-        NULL,
-        NULL
-};
+/* Fill the header of the binary image of a triangulateio struct, and the
+   addresses and sizes of its arrays. Return the size of the image. */
+static size_t
+image_header(struct triangulateio *object, int *header, void ***ptrs, size_t *sizes) {
+  size_t size;
+  int i, nlt = 0;
 
-PyMODINIT_FUNC
-PyInit_triangulate(void)
-#else
-void 
-inittriangulate() 
-#endif
-{
+  for(i = 0; i < object->numberoflevels; ++i) {
+    nlt += object->leveltrianglecountlist[i];
+  }
+  list_arrays(object, nlt, ptrs, sizes);
+
+  memset(header, 0, TRIANGULATEIO_NHEADER * sizeof(int));
+  header[0]  = object->numberofpoints;
+  header[1]  = object->numberofpointattributes;
+  header[2]  = object->numberoftriangles;
+  header[3]  = object->numberofcorners;
+  header[4]  = object->numberoftriangleattributes;
+  header[5]  = object->numberofsegments;
+  header[6]  = object->numberofholes;
+  header[7]  = object->numberofregions;
+  header[8]  = object->numberofmarkerareas;
+  header[9]  = object->numberoflevels;
+  header[10] = nlt;
+  header[11] = object->numberofedges;
+  size = 8 + TRIANGULATEIO_NHEADER * sizeof(int);
+  for(i = 0; i < TRIANGULATEIO_NARRAYS; ++i) {
+    if(!*ptrs[i]) continue;
+    header[12] |= 1 << i;
+    size += sizes[i] + (8 - sizes[i] % 8) % 8;
+  }
+  header[13] = sizeof(REAL);
+  header[14] = TRIANGULATEIO_BOM;
+  header[15] = ((struct triangulate_handle *) object)->firstnumber + 1;
+  return size;
+}
 
+/* Write the binary image of a triangulateio struct to image, which holds
+   the size returned by image_header */
+static void
+write_image(char *image, const int *header, void ***ptrs, size_t *sizes) {
+  size_t pad;
+  int i;
 
-#if PY_MAJOR_VERSION >= 3
-    PyObject *module = PyModule_Create(&triangulateio_moduledef);
+  memcpy(image, TRIANGULATEIO_MAGIC, 8);
+  memcpy(image + 8, header, TRIANGULATEIO_NHEADER * sizeof(int));
+  image += 8 + TRIANGULATEIO_NHEADER * sizeof(int);
+  for(i = 0; i < TRIANGULATEIO_NARRAYS; ++i) {
+    if(!*ptrs[i]) continue;
+    pad = (8 - sizes[i] % 8) % 8;
+    memcpy(image, *ptrs[i], sizes[i]);
+    memset(image + sizes[i], 0, pad);
+    image += sizes[i] + pad;
+  }
+}
+
+/* Check the magic bytes and the header (NULL if it could not be read) of
+   a binary image, name telling where it comes from. Set the Python error
+   and return 0 unless it can be read on this platform. */
+static int
+check_image(const char *magic, const int *header, const char *name) {
+  if(memcmp(magic, TRIANGULATEIO_MAGIC, 5) == 0 && magic[5] != TRIANGULATEIO_VERSION) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: %s has version %d of the format, not %d\n", __FILE__, __LINE__, name, (int) magic[5], TRIANGULATEIO_VERSION);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return 0;
+  }
+  if(memcmp(magic, TRIANGULATEIO_MAGIC, 5) != 0 || !header || header[13] != sizeof(REAL) || header[14] != TRIANGULATEIO_BOM) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: %s is not a triangulateio file written on this platform\n", __FILE__, __LINE__, name);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return 0;
+  }
+  return 1;
+}
+
+/* Set the sizes of an image header in a triangulateio struct */
+static void
+set_header_sizes(struct triangulateio *object, const int *header) {
+  object->numberofpoints             = header[0];
+  object->numberofpointattributes    = header[1];
+  object->numberoftriangles          = header[2];
+  object->numberofcorners            = header[3];
+  object->numberoftriangleattributes = header[4];
+  object->numberofsegments           = header[5];
+  object->numberofholes              = header[6];
+  object->numberofregions            = header[7];
+  object->numberofmarkerareas        = header[8];
+  object->numberoflevels             = header[9];
+  object->numberofedges              = header[11];
+}
+
+/* Empty a triangulateio struct and give it the sizes of an image header,
+   whose arrays have available bytes after it, name telling where it comes
+   from. Return the addresses and sizes of the arrays to read, like
+   list_arrays. The header is checked before the struct is touched: set the
+   Python error and return 0 if a count is negative, the triangles do not
+   have 3 or 6 corners, or the arrays overflow or do not fit. */
+static int
+read_header(struct triangulateio *object, const int *header, size_t available,
+            const char *name, void ***ptrs, size_t *sizes) {
+  struct triangulateio scratch;
+  size_t size = 0, pad;
+  int i, ok = 1;
+
+  for(i = 0; i < 12; ++i) {
+    ok = ok && header[i] >= 0;
+  }
+  ok = ok && (header[3] == 3 || header[3] == 6 || (header[3] == 0 && !(header[12] & (1 << 3))));
+  ok = ok && (header[12] & ~((1 << TRIANGULATEIO_NARRAYS) - 1)) == 0;
+  if(ok) {
+    init_triangulateio(&scratch);
+    set_header_sizes(&scratch, header);
+    ok = list_arrays(&scratch, header[10], ptrs, sizes);
+  }
+  for(i = 0; ok && i < TRIANGULATEIO_NARRAYS; ++i) {
+    if(!(header[12] & (1 << i))) continue;
+    pad = (8 - sizes[i] % 8) % 8;
+    ok = sizes[i] + pad >= sizes[i] && size + sizes[i] + pad >= size;
+    size += sizes[i] + pad;
+  }
+  if(!ok || size > available) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: %s has a corrupt header\n", __FILE__, __LINE__, name);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return 0;
+  }
+
+  free_triangulateio(object);
+  init_triangulateio(object);
+  set_header_sizes(object, header);
+  ((struct triangulate_handle *) object)->firstnumber = header[15] - 1;
+  list_arrays(object, header[10], ptrs, sizes);
+  return 1;
+}
+
+/* Return 0 unless the levels of a triangulateio struct read from an image
+   have their lists, each has at most all the points, and the triangle
+   counts of the coarser levels add up to the nlt triangles read */
+static int
+check_levels(struct triangulateio *object, int nlt) {
+  long total = 0;
+  int i;
+
+  if(object->numberoflevels > 0 && (!object->levelpointcountlist || !object->leveltrianglecountlist)) return 0;
+  if(nlt > 0 && !object->leveltrianglelist) return 0;
+  for(i = 0; i < object->numberoflevels; ++i) {
+    if(object->levelpointcountlist[i] < 0 || object->levelpointcountlist[i] > object->numberofpoints) return 0;
+    if(object->leveltrianglecountlist[i] < 0) return 0;
+    total += object->leveltrianglecountlist[i];
+  }
+  return total == nlt;
+}
+
+static PyObject *
+triangulate_FREE(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+
+  if(!PyArg_ParseTuple(args, "O", 
+               &address)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  free_triangulateio(object);
+  init_triangulateio(object);
+  ((struct triangulate_handle *) object)->firstnumber = -1;
+
+  return Py_BuildValue("");
+}
+
+static PyObject *
+triangulate_RELEASE(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+
+  if(!PyArg_ParseTuple(args, "O", 
+               &address)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  trimeshoutput(object, "en");
+  trimeshfree(object);
+
+  return Py_BuildValue("");
+}
+
+static PyObject *
+triangulate_FREE_LEVEL(PyObject *self, PyObject *args) {
+
+  /* Free the triangles of a coarse level (L switch); its points, which the
+     finer levels share, and its point count stay. The level lists are
+     copied rather than shrunk in place, as they may lie in a mapping. */
+
+  PyObject *address;
+  struct triangulateio *object;
+  int k, level, offset, ntri, nlt, natt;
+  int *counts, *tlist = NULL;
+  REAL *talist = NULL;
+
+  if(!PyArg_ParseTuple(args, "Oi",
+               &address, &level)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  if(level < 0 || level >= object->numberoflevels) {
+    sprintf(MSG, "ERROR in %s at line %d: level %d is not a coarse level (%d of them)\n", __FILE__, __LINE__, level, object->numberoflevels);
+    PyErr_SetString(PyExc_IndexError, MSG);
+    return NULL;
+  }
+  ntri = object->leveltrianglecountlist[level];
+  if(ntri == 0) {
+    return Py_BuildValue("");
+  }
+  offset = 0;
+  nlt = 0;
+  for(k = 0; k < object->numberoflevels; ++k) {
+    if(k < level) offset += object->leveltrianglecountlist[k];
+    nlt += object->leveltrianglecountlist[k];
+  }
+  natt = object->numberoftriangleattributes;
+
+  counts = malloc(object->numberoflevels * sizeof(int));
+  if(nlt > ntri) {
+    tlist = malloc((size_t) (nlt - ntri) * 3 * sizeof(int));
+    if(object->leveltriangleattributelist && natt > 0) {
+      talist = malloc((size_t) (nlt - ntri) * natt * sizeof(REAL));
+    }
+  }
+  if(!counts || (nlt > ntri && !tlist) ||
+     (object->leveltriangleattributelist && natt > 0 && nlt > ntri && !talist)) {
+    free(counts);
+    free(tlist);
+    free(talist);
+    return PyErr_NoMemory();
+  }
+
+  memcpy(counts, object->leveltrianglecountlist, object->numberoflevels * sizeof(int));
+  counts[level] = 0;
+  if(tlist) {
+    memcpy(tlist, object->leveltrianglelist, (size_t) offset * 3 * sizeof(int));
+    memcpy(tlist + 3 * offset, object->leveltrianglelist + 3 * (offset + ntri),
+           (size_t) (nlt - offset - ntri) * 3 * sizeof(int));
+  }
+  if(talist) {
+    memcpy(talist, object->leveltriangleattributelist, (size_t) offset * natt * sizeof(REAL));
+    memcpy(talist + natt * offset, object->leveltriangleattributelist + natt * (offset + ntri),
+           (size_t) (nlt - offset - ntri) * natt * sizeof(REAL));
+  }
+
+  free_array(object, object->leveltrianglecountlist);
+  free_array(object, object->leveltrianglelist);
+  if(object->leveltriangleattributelist) free_array(object, object->leveltriangleattributelist);
+  object->leveltrianglecountlist     = counts;
+  object->leveltrianglelist          = tlist;
+  object->leveltriangleattributelist = talist;
+
+  return Py_BuildValue("");
+}
+
+static PyObject *
+triangulate_SAVE(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  char *filename;
+  FILE *f;
+  void **ptrs[TRIANGULATEIO_NARRAYS];
+  size_t sizes[TRIANGULATEIO_NARRAYS];
+  int header[TRIANGULATEIO_NHEADER];
+  char pad[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  int i, ok;
+
+  if(!PyArg_ParseTuple(args, "Os", 
+               &address, &filename)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  /* the file holds every output, including those deferred by the K switch */
+  trimeshoutput(object, "en");
+  image_header(object, header, ptrs, sizes);
+
+  f = fopen(filename, "wb");
+  if(!f) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: cannot open %s for writing\n", __FILE__, __LINE__, filename);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return NULL;
+  }
+  ok = fwrite(TRIANGULATEIO_MAGIC, 1, 8, f) == 8;
+  ok = ok && fwrite(header, sizeof(int), TRIANGULATEIO_NHEADER, f) == TRIANGULATEIO_NHEADER;
+  for(i = 0; ok && i < TRIANGULATEIO_NARRAYS; ++i) {
+    if(!*ptrs[i]) continue;
+    ok = fwrite(*ptrs[i], 1, sizes[i], f) == sizes[i];
+    ok = ok && fwrite(pad, 1, (8 - sizes[i] % 8) % 8, f) == (8 - sizes[i] % 8) % 8;
+  }
+  if(fclose(f) != 0) ok = 0;
+  if(!ok) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: failed to write %s\n", __FILE__, __LINE__, filename);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return NULL;
+  }
+
+  return Py_BuildValue("");
+}
+
+static PyObject *
+triangulate_LOAD(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  struct triangulate_handle *handle;
+  char *filename;
+  FILE *f;
+  void **ptrs[TRIANGULATEIO_NARRAYS];
+  size_t sizes[TRIANGULATEIO_NARRAYS];
+  int header[TRIANGULATEIO_NHEADER];
+  char magic[8], pad[8];
+  char *map = NULL;
+  size_t mapsize = 0, offset, available;
+  long end;
+  int i, ok, use_mmap = 0;
+
+  if(!PyArg_ParseTuple(args, "Os|i", 
+               &address, &filename, &use_mmap)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  handle = (struct triangulate_handle *) object;
+
+  f = fopen(filename, "rb");
+  if(!f) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: cannot open %s for reading\n", __FILE__, __LINE__, filename);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return NULL;
+  }
+  memset(magic, 0, sizeof(magic));
+  ok = fread(magic, 1, 8, f) == 8;
+  ok = ok && fread(header, sizeof(int), TRIANGULATEIO_NHEADER, f) == TRIANGULATEIO_NHEADER;
+  if(!check_image(magic, ok? header: NULL, filename)) {
+    fclose(f);
+    return NULL;
+  }
+
+#ifndef _WIN32
+  if(use_mmap) {
+    /* map the whole file, copy on write: the arrays are used in place */
+    struct stat st;
+    if(fstat(fileno(f), &st) != 0 || st.st_size == 0) {
+      ok = 0;
+    } else {
+      mapsize = (size_t) st.st_size;
+      map = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0);
+      if(map == MAP_FAILED) {
+        map = NULL;
+        ok = 0;
+      }
+    }
+  }
+#endif
+
+  /* the arrays must fit in the rest of the file */
+  offset = 8 + TRIANGULATEIO_NHEADER * sizeof(int);
+  end = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+  available = end >= (long) offset ? (size_t) end - offset : 0;
+  if(!map && fseek(f, (long) offset, SEEK_SET) != 0) ok = 0;
+  if(!read_header(object, header, available, filename, ptrs, sizes)) {
+#ifndef _WIN32
+    if(map) munmap(map, mapsize);
+#endif
+    fclose(f);
+    return NULL;
+  }
+
+  handle->map = map;
+  handle->mapsize = mapsize;
+  for(i = 0; ok && i < TRIANGULATEIO_NARRAYS; ++i) {
+    if(!(header[12] & (1 << i))) continue;
+    if(map) {
+      /* an empty last array would lie just past the mapping, where
+         free_array would not recognize it */
+      ok = offset + sizes[i] <= mapsize;
+      *ptrs[i] = ok? map + (sizes[i] > 0 ? offset : 0): NULL;
+    } else {
+      *ptrs[i] = malloc(sizes[i] > 0 ? sizes[i] : 1);
+      ok = *ptrs[i] && fread(*ptrs[i], 1, sizes[i], f) == sizes[i];
+      ok = ok && fread(pad, 1, (8 - sizes[i] % 8) % 8, f) == (8 - sizes[i] % 8) % 8;
+    }
+    offset += sizes[i] + (8 - sizes[i] % 8) % 8;
+  }
+  fclose(f);
+  ok = ok && check_levels(object, header[10]);
+  if(!ok) {
+    free_triangulateio(object);
+    init_triangulateio(object);
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: failed to read %s\n", __FILE__, __LINE__, filename);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return NULL;
+  }
+
+  return Py_BuildValue("");
+}
+
+static PyObject *
+triangulate_GET_IMAGE_SIZE(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  void **ptrs[TRIANGULATEIO_NARRAYS];
+  size_t sizes[TRIANGULATEIO_NARRAYS];
+  int header[TRIANGULATEIO_NHEADER];
+
+  if(!PyArg_ParseTuple(args, "O", 
+               &address)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  trimeshoutput(object, "en");
+  return PyLong_FromSize_t(image_header(object, header, ptrs, sizes));
+}
+
+static PyObject *
+triangulate_DUMPS(PyObject *self, PyObject *args) {
+  PyObject *address, *buffer = Py_None, *result;
+  struct triangulateio *object;
+  Py_buffer view;
+  void **ptrs[TRIANGULATEIO_NARRAYS];
+  size_t sizes[TRIANGULATEIO_NARRAYS];
+  int header[TRIANGULATEIO_NHEADER];
+  size_t size;
+
+  if(!PyArg_ParseTuple(args, "O|O", 
+               &address, &buffer)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  /* the same image as save, written to memory */
+  trimeshoutput(object, "en");
+  size = image_header(object, header, ptrs, sizes);
+
+  if(buffer == Py_None) {
+    result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t) size);
+    if(!result) return NULL;
+    write_image(PyBytes_AS_STRING(result), header, ptrs, sizes);
+    return result;
+  }
+  if(PyObject_GetBuffer(buffer, &view, PyBUF_WRITABLE) != 0) {
+    return NULL;
+  }
+  if((size_t) view.len < size) {
+    PyBuffer_Release(&view);
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: buffer of %zd bytes too small for %zu bytes\n", __FILE__, __LINE__, view.len, size);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+  write_image(view.buf, header, ptrs, sizes);
+  PyBuffer_Release(&view);
+
+  return PyLong_FromSize_t(size);
+}
+
+static PyObject *
+triangulate_LOADS(PyObject *self, PyObject *args) {
+  PyObject *address, *buffer, *owner = Py_None;
+  struct triangulateio *object;
+  struct triangulate_handle *handle;
+  Py_buffer view;
+  void **ptrs[TRIANGULATEIO_NARRAYS];
+  size_t sizes[TRIANGULATEIO_NARRAYS];
+  int header[TRIANGULATEIO_NHEADER];
+  char magic[8];
+  char *image;
+  size_t size, offset;
+  int i, ok;
+
+  if(!PyArg_ParseTuple(args, "OO|O", 
+               &address, &buffer, &owner)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  handle = (struct triangulate_handle *) object;
+
+  if(PyObject_GetBuffer(buffer, &view, PyBUF_SIMPLE) != 0) {
+    return NULL;
+  }
+  image = view.buf;
+  size = (size_t) view.len;
+  memset(magic, 0, sizeof(magic));
+  memcpy(magic, image, size < 8? size: 8);
+  ok = size >= 8 + TRIANGULATEIO_NHEADER * sizeof(int);
+  if(ok) memcpy(header, image + 8, TRIANGULATEIO_NHEADER * sizeof(int));
+  if(!check_image(magic, ok? header: NULL, "buffer")) {
+    PyBuffer_Release(&view);
+    return NULL;
+  }
+  if(owner != Py_None && ((size_t) image) % 8 != 0) {
+    PyBuffer_Release(&view);
+    sprintf(MSG, "ERROR in %s at line %d: the arrays of a buffer must be aligned on 8 bytes to be used in place\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+
+  if(!read_header(object, header, size - 8 - TRIANGULATEIO_NHEADER * sizeof(int), "buffer", ptrs, sizes)) {
+    PyBuffer_Release(&view);
+    return NULL;
+  }
+
+  if(owner != Py_None) {
+    /* the arrays are used in place, the buffer is released with them */
+    handle->map = image;
+    handle->mapsize = size;
+    handle->view = view;
+    handle->owner = owner;
+    Py_INCREF(owner);
+  }
+  offset = 8 + TRIANGULATEIO_NHEADER * sizeof(int);
+  for(i = 0; ok && i < TRIANGULATEIO_NARRAYS; ++i) {
+    if(!(header[12] & (1 << i))) continue;
+    ok = offset + sizes[i] <= size;
+    if(!ok) break;
+    if(owner != Py_None) {
+      /* an empty last array would lie just past the buffer (see load) */
+      *ptrs[i] = image + (sizes[i] > 0 ? offset : 0);
+    } else {
+      *ptrs[i] = malloc(sizes[i] > 0 ? sizes[i] : 1);
+      ok = *ptrs[i] != NULL;
+      if(ok) memcpy(*ptrs[i], image + offset, sizes[i]);
+    }
+    offset += sizes[i] + (8 - sizes[i] % 8) % 8;
+  }
+  if(owner == Py_None) {
+    PyBuffer_Release(&view);
+  }
+  ok = ok && check_levels(object, header[10]);
+  if(!ok) {
+    free_triangulateio(object);
+    init_triangulateio(object);
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: failed to read the image of a buffer\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return NULL;
+  }
+
+  return Py_BuildValue("");
+}
+
+/* Text files of Triangle (.node, .ele and .poly, see
+   https://www.cs.cmu.edu/~quake/triangle.node.html): a file is mapped in
+   memory and each section is parsed in chunks of about TEXT_CHUNK bytes,
+   concurrently in the OpenMP build. A record is a line holding a number,
+   anything before it being skipped; its fields are separated by blanks,
+   and '#' starts a comment, as with readline() and findfield() of
+   triangle.c. */
+#define TEXT_CHUNK (1 << 20)
+#define TEXT_SERIAL 4096
+#ifdef SINGLE
+#define REAL_FORMAT "%s%.9g"
+#else
+#define REAL_FORMAT "%s%.17g"
+#endif
+
+/* A column of a section: field j of record i is base[i * stride] of
+   column j, fallback when the record has no such field. The writers put
+   separator before the field. */
+struct column {
+  char type;              /* 'r' for REAL, 'i' for int, 0 to skip it */
+  void *base;
+  int stride;
+  double fallback;
+  const char *separator;
+};
+
+/* A mapped (or read) text file */
+struct text {
+  const char *data;
+  size_t size;
+  char *buffer;           /* NULL if mapped */
+};
+
+#define NUMBER_START(c) (((c) >= '0' && (c) <= '9') || (c) == '.' \
+                         || (c) == '+' || (c) == '-')
+#define FIELD_END(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '#')
+
+static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6,
+  1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+  1e19, 1e20, 1e21, 1e22};
+
+/* Skip the current field, and anything up to the next field of the line:
+   return its start, or the end of the line ('\n', '#' or end). */
+static const char *
+next_field(const char *p, const char *end) {
+  while(p < end && !FIELD_END(*p)) ++p;
+  while(p < end && *p != '\n' && *p != '#' && !NUMBER_START(*p)) ++p;
+  return p;
+}
+
+/* Return the first field of the first record at or after p, the start of a
+   line, or NULL if there is none before end */
+static const char *
+next_record(const char *p, const char *end) {
+  while(p < end) {
+    while(p < end && *p != '\n' && *p != '#' && !NUMBER_START(*p)) ++p;
+    if(p < end && *p != '\n' && *p != '#') return p;
+    /* blank line or comment */
+    p = p < end ? memchr(p, '\n', end - p) : NULL;
+    if(!p) return NULL;
+    ++p;
+  }
+  return NULL;
+}
+
+/* Copy the field at p to a string, for strtod and strtol */
+static void
+copy_field(const char *p, const char *end, char *field, size_t size) {
+  size_t n = 0;
+  while(p + n < end && n + 1 < size && !FIELD_END(p[n])) {
+    field[n] = p[n];
+    ++n;
+  }
+  field[n] = '\0';
+}
+
+/* Parse a real as strtod() does. Decimals of at most 19 significant digits
+   whose mantissa fits in a double and with a decimal exponent of at most
+   22 are converted here, exactly: a single multiplication or division by
+   an exact power of ten. Return the end of the number. */
+static const char *
+parse_real(const char *p, const char *end, double *value) {
+  const char *q = p;
+  unsigned long long mantissa = 0;
+  int digits = 0, exponent = 0, e = 0, esign = 1, negative = 0, fast = 1;
+  char field[64], *stop;
+
+  if(q < end && (*q == '+' || *q == '-')) negative = *q++ == '-';
+  for(; q < end && *q >= '0' && *q <= '9'; ++q) {
+    if(digits < 19) {
+      mantissa = 10 * mantissa + (*q - '0');
+      if(mantissa) ++digits;
+    } else {
+      fast = 0;
+    }
+  }
+  if(q < end && *q == '.') {
+    for(++q; q < end && *q >= '0' && *q <= '9'; ++q) {
+      if(digits < 19) {
+        mantissa = 10 * mantissa + (*q - '0');
+        if(mantissa) ++digits;
+        --exponent;
+      } else {
+        fast = 0;
+      }
+    }
+  }
+  if(q + 1 < end && (*q == 'e' || *q == 'E')
+     && ((q[1] >= '0' && q[1] <= '9')
+         || ((q[1] == '+' || q[1] == '-') && q + 2 < end && q[2] >= '0' && q[2] <= '9'))) {
+    ++q;
+    if(*q == '+' || *q == '-') esign = *q++ == '-' ? -1 : 1;
+    for(; q < end && *q >= '0' && *q <= '9'; ++q) {
+      if(e < 10000) e = 10 * e + (*q - '0');
+    }
+    exponent += esign * e;
+  }
+  if(q < end && (*q | 32) >= 'a' && (*q | 32) <= 'z') fast = 0;  /* 0x, inf */
+  if(fast && mantissa == 0) {
+    *value = negative ? -0.0 : 0.0;
+    return q;
+  }
+  if(fast && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+    *value = exponent < 0 ? mantissa / powers_of_ten[-exponent]
+                          : mantissa * powers_of_ten[exponent];
+    if(negative) *value = -*value;
+    return q;
+  }
+  copy_field(p, end, field, sizeof(field));
+  *value = strtod(field, &stop);
+  return p + (stop - field);
+}
+
+/* Parse an int as strtol(..., 0) does, decimals being converted here */
+static const char *
+parse_int(const char *p, const char *end, int *value) {
+  const char *q = p;
+  long v = 0;
+  int digits = 0, negative = 0;
+  char field[64], *stop;
+
+  if(q < end && (*q == '+' || *q == '-')) negative = *q++ == '-';
+  if(q + 1 < end && q[0] == '0' && !FIELD_END(q[1]) && q[1] != '.') {
+    /* octal or hexadecimal */
+    copy_field(p, end, field, sizeof(field));
+    *value = (int) strtol(field, &stop, 0);
+    return p + (stop - field);
+  }
+  for(; q < end && *q >= '0' && *q <= '9' && digits < 18; ++q, ++digits) {
+    v = 10 * v + (*q - '0');
+  }
+  *value = (int) (negative ? -v : v);
+  return q;
+}
+
+/* Parse record i, whose first field is at p, into the columns. Return the
+   start of the next line, or NULL if it has less than nrequired fields. */
+static const char *
+parse_record(const char *p, const char *end, struct column *cols, int ncols,
+             int nrequired, size_t i) {
+  double x;
+  int j, v, present = 1;
+
+  for(j = 0; j < ncols; ++j) {
+    if(j > 0) {
+      p = next_field(p, end);
+      present = present && p < end && *p != '\n' && *p != '#';
+    }
+    if(!present && j < nrequired) return NULL;
+    if(cols[j].type == 'i') {
+      v = (int) cols[j].fallback;
+      if(present) p = parse_int(p, end, &v);
+      ((int *) cols[j].base)[i * cols[j].stride] = v;
+    } else if(cols[j].type == 'r') {
+      x = cols[j].fallback;
+      if(present) p = parse_real(p, end, &x);
+      ((REAL *) cols[j].base)[i * cols[j].stride] = (REAL) x;
+    }
+  }
+  p = p < end ? memchr(p, '\n', end - p) : NULL;
+  return p ? p + 1 : end;
+}
+
+/* Parse count records from p, the start of a line, into the columns. The
+   text is cut in chunks at line starts: the records of each chunk are
+   counted, then each chunk parses its records knowing the number of the
+   first. Return the start of the line that follows the last record, or
+   NULL if the text ends before (then *bad is -1) or if record *bad has
+   too few fields. */
+static const char *
+read_records(const char *p, const char *end, size_t count, struct column *cols,
+             int ncols, int nrequired, long *bad) {
+  const char **starts, **after;
+  size_t *firsts, i;
+  long nchunks, c, failed = -1;
+  const char *q, *result;
+
+  *bad = -1;
+  if(count == 0) return p;
+  if(count <= TEXT_SERIAL) {
+    for(i = 0; i < count; ++i) {
+      p = next_record(p, end);
+      if(!p) return NULL;
+      p = parse_record(p, end, cols, ncols, nrequired, i);
+      if(!p) {
+        *bad = (long) i;
+        return NULL;
+      }
+    }
+    return p;
+  }
+
+  nchunks = (long) ((end - p) / TEXT_CHUNK) + 1;
+  starts = malloc((nchunks + 1) * sizeof(char *));
+  after = malloc(nchunks * sizeof(char *));
+  firsts = malloc((nchunks + 1) * sizeof(size_t));
+  if(!starts || !after || !firsts) {
+    free(starts);
+    free(after);
+    free(firsts);
+    *bad = -2;
+    return NULL;
+  }
+  starts[0] = p;
+  for(c = 1; c < nchunks; ++c) {
+    q = p + (end - p) / nchunks * c;
+    q = q < starts[c - 1] ? starts[c - 1] : q;
+    q = q < end ? memchr(q, '\n', end - q) : NULL;
+    starts[c] = q ? q + 1 : end;
+  }
+  starts[nchunks] = end;
+
+  /* Count the records of each chunk... */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(q) if (nchunks > 1)
+#endif /* _OPENMP */
+  for(c = 0; c < nchunks; ++c) {
+    size_t n = 0;
+    for(q = starts[c]; (q = next_record(q, starts[c + 1])) != NULL; ++n) {
+      q = memchr(q, '\n', starts[c + 1] - q);
+      if(!q) {
+        ++n;
+        break;
+      }
+      ++q;
+    }
+    firsts[c + 1] = n;
+  }
+  /*   ...turn the counts into the number of the first record of each... */
+  firsts[0] = 0;
+  for(c = 0; c < nchunks; ++c) {
+    firsts[c + 1] += firsts[c];
+    after[c] = NULL;
+  }
+  if(firsts[nchunks] < count) {
+    free(starts);
+    free(after);
+    free(firsts);
+    return NULL;
+  }
+
+  /*   ...and parse them. */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(q, i) if (nchunks > 1)
+#endif /* _OPENMP */
+  for(c = 0; c < nchunks; ++c) {
+    q = starts[c];
+    for(i = firsts[c]; i < count && i < firsts[c + 1]; ++i) {
+      q = next_record(q, starts[c + 1]);
+      q = parse_record(q, starts[c + 1], cols, ncols, nrequired, i);
+      if(!q) {
+#ifdef _OPENMP
+#pragma omp critical (read_records)
+#endif /* _OPENMP */
+        if(failed < 0 || (long) i < failed) failed = (long) i;
+        break;
+      }
+    }
+    if(i == count && firsts[c] < count) after[c] = q;
+  }
+
+  result = NULL;
+  for(c = 0; c < nchunks; ++c) {
+    if(after[c]) result = after[c];
+  }
+  free(starts);
+  free(after);
+  free(firsts);
+  if(failed >= 0) {
+    *bad = failed;
+    return NULL;
+  }
+  return result;
+}
+
+/* Read the counts of a section header (a record without number) into
+   values, which hold the defaults of the missing ones. Return the start
+   of the next line, or NULL at the end of the text. */
+static const char *
+read_counts(const char *p, const char *end, int *values, int n) {
+  struct column cols[4];
+  int j;
+
+  p = next_record(p, end);
+  if(!p) return NULL;
+  for(j = 0; j < n; ++j) {
+    cols[j].type = 'i';
+    cols[j].base = &values[j];
+    cols[j].stride = 0;
+    cols[j].fallback = values[j];
+  }
+  return parse_record(p, end, cols, n, 1, 0);
+}
+
+/* Format the records of a section, numbered from first, and write them,
+   in rounds of chunks of about TEXT_CHUNK bytes formatted concurrently in
+   the OpenMP build. Return 0 if the file could not be written. */
+static int
+write_records(FILE *f, size_t count, int first, struct column *cols, int ncols) {
+  size_t reclen, perchunk, round, i0;
+  long nchunks = 32, c;
+  char **buffers;
+  size_t *lengths;
+  int ok = 1;
+
+  if(count == 0) return 1;
+  reclen = 16 + 40 * (size_t) ncols;
+  perchunk = TEXT_CHUNK / reclen + 1;
+  if((count - 1) / perchunk + 1 < (size_t) nchunks) {
+    nchunks = (long) ((count - 1) / perchunk + 1);
+  }
+  buffers = malloc(nchunks * sizeof(char *));
+  lengths = malloc(nchunks * sizeof(size_t));
+  if(!buffers || !lengths) {
+    free(buffers);
+    free(lengths);
+    return 0;
+  }
+  for(c = 0; c < nchunks; ++c) {
+    buffers[c] = malloc(perchunk * reclen);
+    ok = ok && buffers[c];
+  }
+
+  for(i0 = 0; ok && i0 < count; i0 += round) {
+    round = count - i0 < nchunks * perchunk ? count - i0 : nchunks * perchunk;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (round > perchunk)
+#endif /* _OPENMP */
+    for(c = 0; c < nchunks; ++c) {
+      size_t i, ibeg = i0 + c * perchunk, iend = ibeg + perchunk;
+      char *s = buffers[c];
+      int j;
+
+      iend = iend < i0 + round ? iend : i0 + round;
+      for(i = ibeg; i < iend; ++i) {
+        s += sprintf(s, "%4d", first + (int) i);
+        for(j = 0; j < ncols; ++j) {
+          if(cols[j].type == 'i') {
+            s += sprintf(s, "%s%4d", cols[j].separator,
+                         ((int *) cols[j].base)[i * cols[j].stride]);
+          } else {
+            s += sprintf(s, REAL_FORMAT, cols[j].separator,
+                         (double) ((REAL *) cols[j].base)[i * cols[j].stride]);
+          }
+        }
+        *s++ = '\n';
+      }
+      lengths[c] = s - buffers[c];
+    }
+    for(c = 0; ok && c < nchunks; ++c) {
+      ok = fwrite(buffers[c], 1, lengths[c], f) == lengths[c];
+    }
+  }
+
+  for(c = 0; c < nchunks; ++c) {
+    free(buffers[c]);
+  }
+  free(buffers);
+  free(lengths);
+  return ok;
+}
+
+/* Map a text file in memory (read it on Windows). Set the Python error and
+   return 0 on failure. */
+static int
+open_text(const char *filename, struct text *t) {
+  FILE *f;
+  int ok;
+
+  t->data = NULL;
+  t->size = 0;
+  t->buffer = NULL;
+  f = fopen(filename, "rb");
+  if(!f) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: cannot open %s for reading\n", __FILE__, __LINE__, filename);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return 0;
+  }
+  ok = fseek(f, 0, SEEK_END) == 0;
+  t->size = ok ? (size_t) ftell(f) : 0;
+  if(ok && t->size > 0) {
+#ifndef _WIN32
+    void *map = mmap(NULL, t->size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    ok = map != MAP_FAILED;
+    if(ok) t->data = map;
+#else
+    t->buffer = malloc(t->size);
+    ok = t->buffer && fseek(f, 0, SEEK_SET) == 0
+         && fread(t->buffer, 1, t->size, f) == t->size;
+    t->data = t->buffer;
+#endif
+  }
+  fclose(f);
+  if(!ok) {
+    free(t->buffer);
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: failed to read %s\n", __FILE__, __LINE__, filename);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return 0;
+  }
+  return 1;
+}
+
+static void
+close_text(struct text *t) {
+#ifndef _WIN32
+  if(!t->buffer && t->data) munmap((void *) t->data, t->size);
+#endif
+  free(t->buffer);
+}
+
+/* Set the Python error of a section that could not be read: bad is the
+   record with too few fields, -1 at the end of the file, -2 if out of
+   memory and -3 if the header of the section is wrong */
+static void
+text_error(const char *filename, const char *what, long bad) {
+  if(bad == -2) {
+    PyErr_NoMemory();
+    return;
+  }
+  if(bad >= 0) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: %s: record %ld of the %s section has too few fields\n", __FILE__, __LINE__, filename, bad + 1, what);
+  } else if(bad == -1) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: %s: unexpected end of file in the %s section\n", __FILE__, __LINE__, filename, what);
+  } else {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: %s: wrong header of the %s section\n", __FILE__, __LINE__, filename, what);
+  }
+  PyErr_SetString(PyExc_IOError, MSG);
+}
+
+/* Read the vertices of a .node or .poly file, after the header of their
+   section (counts), into the points, attributes and markers (zeros if the
+   file has none) of a triangulateio struct. Return the start of the next
+   section, or NULL with the Python error set. */
+static const char *
+read_vertices(const char *p, const char *end, const char *filename,
+              const int *counts, struct triangulateio *object, int *first) {
+  struct column cols[4];
+  REAL *points, *attributes = NULL;
+  int *markers;
+  size_t n = counts[0];
+  int natt = counts[2], j;
+  long bad;
+
+  if(counts[0] < 0 || counts[1] != 2 || counts[2] < 0) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: %s: wrong header of the vertices (%d vertices of dimension %d with %d attributes)\n", __FILE__, __LINE__, filename, counts[0], counts[1], counts[2]);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return NULL;
+  }
+  *first = 1;
+  if(next_record(p, end)) parse_int(next_record(p, end), end, first);
+
+  points = malloc(2 * n * sizeof(REAL) + 1);
+  markers = malloc(n * sizeof(int) + 1);
+  if(natt > 0) attributes = malloc(n * natt * sizeof(REAL));
+  if(!points || !markers || (natt > 0 && !attributes)) {
+    free(points);
+    free(markers);
+    free(attributes);
+    PyErr_NoMemory();
+    return NULL;
+  }
+  memset(cols, 0, sizeof(cols));
+  cols[1].type = 'r';  cols[1].base = points;     cols[1].stride = 2;
+  cols[2].type = 'r';  cols[2].base = points + 1; cols[2].stride = 2;
+  cols[3].type = counts[3] ? 'i' : 0;
+  cols[3].base = markers;  cols[3].stride = 1;
+  if(!counts[3]) memset(markers, 0, n * sizeof(int));
+  if(natt == 0) {
+    p = read_records(p, end, n, cols, 4, 3, &bad);
+  } else {
+    /* the attributes lie between the coordinates and the marker */
+    struct column *acols = malloc((natt + 4) * sizeof(struct column));
+    if(!acols) {
+      bad = -2;
+      p = NULL;
+    } else {
+      memcpy(acols, cols, 3 * sizeof(struct column));
+      for(j = 0; j < natt; ++j) {
+        acols[3 + j].type = 'r';
+        acols[3 + j].base = attributes + j;
+        acols[3 + j].stride = natt;
+        acols[3 + j].fallback = 0.;
+      }
+      acols[3 + natt] = cols[3];
+      p = read_records(p, end, n, acols, natt + 4, 3, &bad);
+      free(acols);
+    }
+  }
+  if(!p) {
+    free(points);
+    free(markers);
+    free(attributes);
+    text_error(filename, "vertex", bad);
+    return NULL;
+  }
+
+  if(object->pointlist) free_array(object, object->pointlist);
+  if(object->pointattributelist) free_array(object, object->pointattributelist);
+  if(object->pointmarkerlist) free_array(object, object->pointmarkerlist);
+  object->pointlist = points;
+  object->pointattributelist = attributes;
+  object->pointmarkerlist = markers;
+  forget_capacities(object);
+  object->numberofpoints = counts[0];
+  object->numberofpointattributes = natt;
+  return p;
+}
+
+static PyObject *
+triangulate_READ_NODE(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  char *filename;
+  struct text t;
+  const char *p;
+  int counts[4] = {0, 2, 0, 0};
+  int first = 1;
+
+  if(!PyArg_ParseTuple(args, "Os",
+               &address, &filename)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  if(!open_text(filename, &t)) return NULL;
+  p = read_counts(t.data, t.data + t.size, counts, 4);
+  if(p) p = read_vertices(p, t.data + t.size, filename, counts, object, &first);
+  else text_error(filename, "vertex", -1);
+  close_text(&t);
+  if(!p) return NULL;
+  ((struct triangulate_handle *) object)->firstnumber = first;
+
+  return Py_BuildValue("i", first);
+}
+
+static PyObject *
+triangulate_READ_ELE(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  char *filename;
+  struct text t;
+  const char *p;
+  struct column *cols;
+  int counts[3] = {0, 3, 0};
+  int *triangles = NULL;
+  REAL *attributes = NULL;
+  size_t n;
+  int nc, natt, j;
+  long bad = -1;
+
+  if(!PyArg_ParseTuple(args, "Os",
+               &address, &filename)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  if(!open_text(filename, &t)) return NULL;
+  p = read_counts(t.data, t.data + t.size, counts, 3);
+  n = counts[0];
+  nc = counts[1];
+  natt = counts[2];
+  if(p && (counts[0] < 0 || (nc != 3 && nc != 6) || natt < 0)) {
+    close_text(&t);
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: %s: wrong header of the triangles (%d triangles of %d corners with %d attributes)\n", __FILE__, __LINE__, filename, counts[0], nc, natt);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return NULL;
+  }
+  cols = malloc((1 + nc + natt) * sizeof(struct column));
+  triangles = malloc(n * nc * sizeof(int) + 1);
+  if(natt > 0) attributes = malloc(n * natt * sizeof(REAL));
+  if(p && cols && triangles && (natt == 0 || attributes)) {
+    memset(cols, 0, (1 + nc + natt) * sizeof(struct column));
+    for(j = 0; j < nc; ++j) {
+      cols[1 + j].type = 'i';
+      cols[1 + j].base = triangles + j;
+      cols[1 + j].stride = nc;
+    }
+    for(j = 0; j < natt; ++j) {
+      cols[1 + nc + j].type = 'r';
+      cols[1 + nc + j].base = attributes + j;
+      cols[1 + nc + j].stride = natt;
+    }
+    p = read_records(p, t.data + t.size, n, cols, 1 + nc + natt, 1 + nc, &bad);
+  } else if(p) {
+    p = NULL;
+    bad = -2;
+  }
+  close_text(&t);
+  free(cols);
+  if(!p) {
+    free(triangles);
+    free(attributes);
+    text_error(filename, "triangle", bad);
+    return NULL;
+  }
+
+  if(object->trianglelist) free_array(object, object->trianglelist);
+  if(object->triangleattributelist) free_array(object, object->triangleattributelist);
+  object->trianglelist = triangles;
+  object->triangleattributelist = attributes;
+  forget_capacities(object);
+  object->numberoftriangles = counts[0];
+  object->numberofcorners = nc;
+  object->numberoftriangleattributes = natt;
+
+  return Py_BuildValue("");
+}
+
+static PyObject *
+triangulate_READ_POLY(PyObject *self, PyObject *args) {
+  PyObject *address, *result;
+  struct triangulateio *object;
+  char *filename;
+  struct text t;
+  const char *p, *end;
+  struct column cols[5];
+  int counts[4] = {0, 2, 0, 0}, nsegs[2] = {0, 0}, nholes[1] = {0}, nregions[1] = {0};
+  int *segments = NULL, *markers = NULL;
+  REAL *holes = NULL, *regions = NULL;
+  int first = -1, j;
+  long bad = -1;
+
+  if(!PyArg_ParseTuple(args, "Os",
+               &address, &filename)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  if(!open_text(filename, &t)) return NULL;
+  end = t.data + t.size;
+
+  /* the vertices, unless they are in a .node file (zero vertices) */
+  p = read_counts(t.data, end, counts, 4);
+  if(!p) {
+    text_error(filename, "vertex", -1);
+  } else if(counts[0] != 0) {
+    p = read_vertices(p, end, filename, counts, object, &first);
+  }
+
+  /* the segments */
+  if(p) {
+    p = read_counts(p, end, nsegs, 2);
+    bad = p ? -3 : -1;
+    if(p && nsegs[0] >= 0) {
+      segments = malloc(2 * (size_t) nsegs[0] * sizeof(int) + 1);
+      markers = calloc((size_t) nsegs[0] + 1, sizeof(int));
+      memset(cols, 0, sizeof(cols));
+      cols[1].type = 'i';  cols[1].base = segments;     cols[1].stride = 2;
+      cols[2].type = 'i';  cols[2].base = segments + 1; cols[2].stride = 2;
+      cols[3].type = nsegs[1] ? 'i' : 0;
+      cols[3].base = markers;  cols[3].stride = 1;
+      bad = -2;
+      p = segments && markers ? read_records(p, end, nsegs[0], cols, 4, 3, &bad) : NULL;
+    } else {
+      p = NULL;
+    }
+    if(!p) text_error(filename, "segment", bad);
+  }
+
+  /* the holes */
+  if(p) {
+    p = read_counts(p, end, nholes, 1);
+    bad = p ? -3 : -1;
+    if(p && nholes[0] >= 0) {
+      holes = malloc(2 * (size_t) nholes[0] * sizeof(REAL) + 1);
+      memset(cols, 0, sizeof(cols));
+      cols[1].type = 'r';  cols[1].base = holes;     cols[1].stride = 2;
+      cols[2].type = 'r';  cols[2].base = holes + 1; cols[2].stride = 2;
+      bad = -2;
+      p = holes ? read_records(p, end, nholes[0], cols, 3, 3, &bad) : NULL;
+    } else {
+      p = NULL;
+    }
+    if(!p) text_error(filename, "hole", bad);
+  }
+
+  /* the regional attributes and area constraints, optional; a region
+     without area constraint takes its attribute, as in readholes() */
+  if(p && next_record(p, end)) {
+    p = read_counts(p, end, nregions, 1);
+    bad = -3;
+    if(nregions[0] >= 0) {
+      regions = malloc(4 * (size_t) nregions[0] * sizeof(REAL) + 1);
+      memset(cols, 0, sizeof(cols));
+      for(j = 0; j < 4; ++j) {
+        cols[1 + j].type = 'r';
+        cols[1 + j].base = regions + j;
+        cols[1 + j].stride = 4;
+        cols[1 + j].fallback = Py_NAN;
+      }
+      bad = -2;
+      p = regions ? read_records(p, end, nregions[0], cols, 5, 4, &bad) : NULL;
+    } else {
+      p = NULL;
+    }
+    if(!p) text_error(filename, "region", bad);
+    for(j = 0; p && j < nregions[0]; ++j) {
+      if(Py_IS_NAN(regions[4 * j + 3])) regions[4 * j + 3] = regions[4 * j + 2];
+    }
+  }
+  close_text(&t);
+  if(!p) {
+    free(segments);
+    free(markers);
+    free(holes);
+    free(regions);
+    return NULL;
+  }
+
+  if(object->segmentlist) free_array(object, object->segmentlist);
+  if(object->segmentmarkerlist) free_array(object, object->segmentmarkerlist);
+  if(object->holelist) free_array(object, object->holelist);
+  if(object->regionlist) free_array(object, object->regionlist);
+  object->segmentlist = segments;
+  object->segmentmarkerlist = markers;
+  forget_capacities(object);
+  object->numberofsegments = nsegs[0];
+  object->holelist = holes;
+  object->numberofholes = nholes[0];
+  object->regionlist = regions;
+  object->numberofregions = nregions[0];
+
+  if(first >= 0) {
+    ((struct triangulate_handle *) object)->firstnumber = first;
+  }
+  if(first < 0) {
+    result = Py_None;
+    Py_INCREF(result);
+    return result;
+  }
+  return Py_BuildValue("i", first);
+}
+
+/* Write the vertices of a triangulateio struct, after the header of their
+   section */
+static int
+write_vertices(FILE *f, struct triangulateio *object, int first) {
+  struct column *cols;
+  int natt = object->numberofpointattributes, j, ok;
+
+  cols = malloc((natt + 3) * sizeof(struct column));
+  if(!cols) return 0;
+  cols[0].type = 'r';  cols[0].base = object->pointlist;     cols[0].stride = 2;
+  cols[1].type = 'r';  cols[1].base = object->pointlist + 1; cols[1].stride = 2;
+  cols[0].separator = "    ";
+  cols[1].separator = "  ";
+  for(j = 0; j < natt; ++j) {
+    cols[2 + j].type = 'r';
+    cols[2 + j].base = object->pointattributelist + j;
+    cols[2 + j].stride = natt;
+    cols[2 + j].separator = "  ";
+  }
+  cols[2 + natt].type = 'i';
+  cols[2 + natt].base = object->pointmarkerlist;
+  cols[2 + natt].stride = 1;
+  cols[2 + natt].separator = "    ";
+  ok = write_records(f, object->numberofpoints, first, cols,
+                     natt + (object->pointmarkerlist ? 3 : 2));
+  free(cols);
+  return ok;
+}
+
+/* Open a text file for writing. Set the Python error and return NULL on
+   failure. */
+static FILE *
+create_text(const char *filename) {
+  FILE *f = fopen(filename, "w");
+  if(!f) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: cannot open %s for writing\n", __FILE__, __LINE__, filename);
+    PyErr_SetString(PyExc_IOError, MSG);
+  }
+  return f;
+}
+
+/* Close a text file being written, setting the Python error if it
+   could not be written. */
+static PyObject *
+close_written_text(FILE *f, const char *filename, int ok) {
+  if(fclose(f) != 0) ok = 0;
+  if(!ok) {
+    snprintf(MSG, sizeof(MSG), "ERROR in %s at line %d: failed to write %s\n", __FILE__, __LINE__, filename);
+    PyErr_SetString(PyExc_IOError, MSG);
+    return NULL;
+  }
+  return Py_BuildValue("");
+}
+
+static PyObject *
+triangulate_WRITE_NODE(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  char *filename;
+  FILE *f;
+  int first = 1, ok;
+
+  if(!PyArg_ParseTuple(args, "Os|i",
+               &address, &filename, &first)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  f = create_text(filename);
+  if(!f) return NULL;
+  ok = fprintf(f, "%d  %d  %d  %d\n", object->numberofpoints, 2,
+               object->numberofpointattributes,
+               object->pointmarkerlist ? 1 : 0) > 0;
+  ok = ok && write_vertices(f, object, first);
+  return close_written_text(f, filename, ok);
+}
+
+static PyObject *
+triangulate_WRITE_ELE(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  char *filename;
+  FILE *f;
+  struct column *cols;
+  int nc, natt, first = 1, j, ok;
+
+  if(!PyArg_ParseTuple(args, "Os|i",
+               &address, &filename, &first)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  nc = object->numberofcorners;
+  natt = object->numberoftriangleattributes;
+
+  cols = malloc((nc + natt + 1) * sizeof(struct column));
+  if(!cols) return PyErr_NoMemory();
+  for(j = 0; j < nc; ++j) {
+    cols[j].type = 'i';
+    cols[j].base = object->trianglelist + j;
+    cols[j].stride = nc;
+    cols[j].separator = j == 0 ? "    " : "  ";
+  }
+  for(j = 0; j < natt; ++j) {
+    cols[nc + j].type = 'r';
+    cols[nc + j].base = object->triangleattributelist + j;
+    cols[nc + j].stride = natt;
+    cols[nc + j].separator = "  ";
+  }
+
+  f = create_text(filename);
+  if(!f) {
+    free(cols);
+    return NULL;
+  }
+  ok = fprintf(f, "%d  %d  %d\n", object->numberoftriangles, nc, natt) > 0;
+  ok = ok && write_records(f, object->numberoftriangles, first, cols, nc + natt);
+  free(cols);
+  return close_written_text(f, filename, ok);
+}
+
+static PyObject *
+triangulate_WRITE_POLY(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  char *filename;
+  FILE *f;
+  struct column cols[4];
+  int first = 1, points = 1, j, ok;
+
+  if(!PyArg_ParseTuple(args, "Os|ii",
+               &address, &filename, &first, &points)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  f = create_text(filename);
+  if(!f) return NULL;
+  /* zero vertices means that they are in a separate .node file */
+  ok = fprintf(f, "%d  %d  %d  %d\n", points ? object->numberofpoints : 0, 2,
+               object->numberofpointattributes,
+               object->pointmarkerlist ? 1 : 0) > 0;
+  if(points) ok = ok && write_vertices(f, object, first);
+
+  cols[0].type = 'i';  cols[0].base = object->segmentlist;     cols[0].stride = 2;
+  cols[1].type = 'i';  cols[1].base = object->segmentlist + 1; cols[1].stride = 2;
+  cols[2].type = 'i';  cols[2].base = object->segmentmarkerlist; cols[2].stride = 1;
+  cols[0].separator = "    ";
+  cols[1].separator = "  ";
+  cols[2].separator = "    ";
+  ok = ok && fprintf(f, "%d  %d\n", object->numberofsegments,
+                     object->segmentmarkerlist ? 1 : 0) > 0;
+  ok = ok && write_records(f, object->numberofsegments, first, cols,
+                           object->segmentmarkerlist ? 3 : 2);
+
+  cols[0].type = 'r';  cols[0].base = object->holelist;     cols[0].stride = 2;
+  cols[1].type = 'r';  cols[1].base = object->holelist + 1; cols[1].stride = 2;
+  cols[0].separator = "   ";
+  ok = ok && fprintf(f, "%d\n", object->numberofholes) > 0;
+  ok = ok && write_records(f, object->numberofholes, first, cols, 2);
+
+  if(object->numberofregions > 0) {
+    for(j = 0; j < 4; ++j) {
+      cols[j].type = 'r';
+      cols[j].base = object->regionlist + j;
+      cols[j].stride = 4;
+      cols[j].separator = j == 0 ? "   " : "  ";
+    }
+    ok = ok && fprintf(f, "%d\n", object->numberofregions) > 0;
+    ok = ok && write_records(f, object->numberofregions, first, cols, 4);
+  }
+  return close_written_text(f, filename, ok);
+}
+
+static PyObject *
+triangulate_GET_NUM_LEVELS(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  int n;
+  
+  if(!PyArg_ParseTuple(args, "O", 
+               &address)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  n = object->numberoflevels + 1;
+
+  return Py_BuildValue("i", n);
+}
+
+static PyObject *
+triangulate_GET_STATS(PyObject *self, PyObject *args) {
+  PyObject *address;
+  struct triangulateio *object;
+  struct triangulatestats *st;
+  
+  if(!PyArg_ParseTuple(args, "O", 
+               &address)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  st = object->stats;
+  if(!st) {
+    return Py_BuildValue("");
+  }
+
+  return Py_BuildValue("{s:d,s:d,s:d,s:d,s:d,s:d,s:d,"
+                       "s:l,s:l,s:l,s:l,s:l,s:l,s:l,s:l,s:l,"
+                       "s:l,s:l,s:l,s:l,s:l,s:l,s:l,s:l,s:l,"
+                       "s:l,s:l,s:l,s:l}",
+                       "transfer_ms",          st->transfertime,
+                       "delaunay_ms",          st->delaunaytime,
+                       "segments_ms",          st->segmenttime,
+                       "holes_ms",             st->holetime,
+                       "quality_ms",           st->qualitytime,
+                       "output_ms",            st->outputtime,
+                       "total_ms",             st->totaltime,
+                       "incircle_tests",       st->incirclecount,
+                       "orient2d_tests",       st->counterclockcount,
+                       "orient3d_tests",       st->orient3dcount,
+                       "incircle_adapt",       st->incircleadaptcount,
+                       "orient2d_adapt",       st->counterclockadaptcount,
+                       "orient3d_adapt",       st->orient3dadaptcount,
+                       "hyperbola_tests",      st->hyperbolacount,
+                       "circletop_calcs",      st->circletopcount,
+                       "circumcenter_calcs",   st->circumcentercount,
+                       "max_vertices",         st->maxvertices,
+                       "max_triangles",        st->maxtriangles,
+                       "max_subsegs",          st->maxsubsegs,
+                       "max_viri",             st->maxviri,
+                       "max_bad_subsegs",      st->maxbadsubsegs,
+                       "max_bad_triangles",    st->maxbadtriangles,
+                       "max_flip_stackers",    st->maxflipstackers,
+                       "max_splay_nodes",      st->maxsplaynodes,
+                       "memory_bytes",         st->memory,
+                       "input_vertices",       st->inputvertices,
+                       "steiner_points",       st->steinerpoints,
+                       "segment_steiners",     st->segmentsteiners,
+                       "triangle_steiners",    st->trianglesteiners);
+}
+
+/* Return a new array.array of the given type code holding a copy of nbytes bytes */
+static PyObject *
+new_array(const char *typecode, void *data, size_t nbytes) {
+  PyObject *module, *arr, *bytes, *res;
+
+  module = PyImport_ImportModule("array");
+  if(!module) {
+    return NULL;
+  }
+  arr = PyObject_CallMethod(module, "array", "s", typecode);
+  Py_DECREF(module);
+  if(!arr) {
+    return NULL;
+  }
+  bytes = PyBytes_FromStringAndSize((char *) data, (Py_ssize_t) nbytes);
+  if(!bytes) {
+    Py_DECREF(arr);
+    return NULL;
+  }
+  res = PyObject_CallMethod(arr, "frombytes", "O", bytes);
+  Py_DECREF(bytes);
+  if(!res) {
+    Py_DECREF(arr);
+    return NULL;
+  }
+  Py_DECREF(res);
+  return arr;
+}
+
+/* Return a new array.array holding a copy of n REALs */
+static PyObject *
+new_real_array(REAL *data, int n) {
+  return new_array(sizeof(REAL) == sizeof(float)? "f": "d", data, (size_t) n * sizeof(REAL));
+}
+
+/* Return a new array.array of doubles holding the npts points of data
+   moved by origin, or a copy of them if origin is (0, 0) */
+static PyObject *
+new_point_array(REAL *data, int npts, const double *origin) {
+  PyObject *res;
+  double *buffer;
+  int i;
+
+  if(origin[0] == 0. && origin[1] == 0.) {
+    return new_real_array(data, _NDIM * npts);
+  }
+  buffer = (double *) malloc(_NDIM * (size_t) npts * sizeof(double) + 1);
+  if(!buffer) {
+    return PyErr_NoMemory();
+  }
+  for(i = 0; i < npts; ++i) {
+    buffer[2*i    ] = (double) data[2*i    ] + origin[0];
+    buffer[2*i + 1] = (double) data[2*i + 1] + origin[1];
+  }
+  res = new_array("d", buffer, _NDIM * (size_t) npts * sizeof(double));
+  free(buffer);
+  return res;
+}
+
+static PyObject *
+triangulate_GET_MESH_ARRAYS(PyObject *self, PyObject *args) {
+
+  /* Return the coordinates and the triangle corners as flat arrays, with no
+     Python object per point or per triangle */
+
+  PyObject *address, *xy, *corners;
+  struct triangulateio *object;
+  int i, j, nc, npts, ntri, level = -1, firstnumber = -1;
+  int *tlist, *buffer;
+  REAL *talist;
+  double origin[2] = {0., 0.};
+  
+  if(!PyArg_ParseTuple(args, "O|ii(dd)", 
+               &address, &level, &firstnumber, &origin[0], &origin[1])) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
+  if(npts > 0 && !object->pointlist) {
+    sprintf(MSG, "ERROR in %s at line %d: handle has no points\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+  nc = object->numberofcorners;
+  if(tlist != object->trianglelist) {
+    /* coarser levels only record the triangle corners */
+    nc = 3;
+  }
+  if(!check_corners(object, tlist, ntri, nc, npts, &firstnumber)) {
+    return NULL;
+  }
+
+  /* keep the 3 corners of higher order triangles, number them from zero */
+  buffer = (int *) malloc(3 * (size_t) ntri * sizeof(int) + 1);
+  if(!buffer) {
+    return PyErr_NoMemory();
+  }
+  for(i = 0; i < ntri; ++i) {
+    for(j = 0; j < 3; ++j) {
+      buffer[3*i + j] = tlist[nc*i + j] - firstnumber;
+    }
+  }
+  xy = new_point_array(object->pointlist, npts, origin);
+  corners = new_array("i", buffer, 3 * (size_t) ntri * sizeof(int));
+  free(buffer);
+  if(!xy || !corners) {
+    Py_XDECREF(xy);
+    Py_XDECREF(corners);
+    return NULL;
+  }
+
+  return Py_BuildValue("(NN)", xy, corners);
+}
+
+static PyObject *
+triangulate_GET_VORONOI_CELLS(PyObject *self, PyObject *args) {
+
+  /* Return the Voronoi cells of the points in compressed sparse row form */
+
+  PyObject *address, *xy, *offsets, *cells;
+  struct triangulateio *object;
+  int i, nc, npts, ntri, nvert, level = -1, firstnumber = -1, clip = 0;
+  int *tlist, *celloffsetlist, *cellvertexlist;
+  REAL *talist, *vertexlist;
+  REAL box[4];
+  double origin[2] = {0., 0.};
+  
+  if(!PyArg_ParseTuple(args, "O|iii(dd)", 
+               &address, &level, &firstnumber, &clip, &origin[0], &origin[1])) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
+  if(npts > 0 && !object->pointlist) {
+    sprintf(MSG, "ERROR in %s at line %d: handle has no points\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+  nc = object->numberofcorners;
+  if(tlist != object->trianglelist) {
+    /* coarser levels only record the triangle corners */
+    nc = 3;
+  }
+  if(!check_corners(object, tlist, ntri, nc, npts, &firstnumber)) {
+    return NULL;
+  }
+
+  /* clip to the bounding box of the points */
+  box[0] = box[1] = box[2] = box[3] = 0;
+  for(i = 0; i < npts; ++i) {
+    if(i == 0 || object->pointlist[_NDIM*i  ] < box[0]) box[0] = object->pointlist[_NDIM*i  ];
+    if(i == 0 || object->pointlist[_NDIM*i+1] < box[1]) box[1] = object->pointlist[_NDIM*i+1];
+    if(i == 0 || object->pointlist[_NDIM*i  ] > box[2]) box[2] = object->pointlist[_NDIM*i  ];
+    if(i == 0 || object->pointlist[_NDIM*i+1] > box[3]) box[3] = object->pointlist[_NDIM*i+1];
+  }
+
+  voronoicells(object->pointlist, npts, tlist, ntri, nc, firstnumber,
+               clip ? box : NULL, &vertexlist, &nvert, &celloffsetlist, &cellvertexlist);
+
+  xy      = new_point_array(vertexlist, nvert, origin);
+  offsets = new_array("i", celloffsetlist, (npts + 1) * sizeof(int));
+  cells   = new_array("i", cellvertexlist, celloffsetlist[npts] * sizeof(int));
+  trifree(vertexlist);
+  trifree(celloffsetlist);
+  trifree(cellvertexlist);
+  if(!xy || !offsets || !cells) {
+    Py_XDECREF(xy);
+    Py_XDECREF(offsets);
+    Py_XDECREF(cells);
+    return NULL;
+  }
+
+  return Py_BuildValue("(NNN)", xy, offsets, cells);
+}
+
+/* Return a new malloc'ed copy, as doubles, of a flat array of numbers: any
+   object with the buffer protocol (array.array, numpy array,...) of floats
+   or integers, or else a sequence of numbers. Set *n to the number of
+   items. Return NULL and set an exception on failure. */
+static double *
+read_numbers(PyObject *obj, Py_ssize_t *n) {
+  Py_buffer view;
+  PyObject *seq;
+  double *res;
+  const char *fmt;
+  char code;
+  Py_ssize_t i;
+
+  if(PyObject_CheckBuffer(obj)) {
+    if(PyObject_GetBuffer(obj, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) {
+      return NULL;
+    }
+    fmt = view.format? view.format: "B";
+    if(*fmt == '@' || *fmt == '=' || *fmt == '<' || *fmt == '>' || *fmt == '!') fmt++;
+    code = fmt[0];
+    *n = view.itemsize > 0? view.len / view.itemsize: 0;
+    if(fmt[0] == '\0' || fmt[1] != '\0' || !strchr("fdbhilqnBHILQN", code) ||
+       (view.itemsize != 1 && view.itemsize != 2 && view.itemsize != 4 && view.itemsize != 8) ||
+       (strchr("fd", code) && view.itemsize < 4)) {
+      sprintf(MSG, "ERROR in %s at line %d: unsupported array type '%.8s' (numbers required)\n", __FILE__, __LINE__, view.format? view.format: "B");
+      PyErr_SetString(PyExc_TypeError, MSG);
+      PyBuffer_Release(&view);
+      return NULL;
+    }
+    res = (double *) malloc(*n * sizeof(double) + 1);
+    if(!res) {
+      PyBuffer_Release(&view);
+      PyErr_NoMemory();
+      return NULL;
+    }
+    for(i = 0; i < *n; ++i) {
+      if(code == 'f' || code == 'd') {
+        res[i] = view.itemsize == 4? (double) ((float *) view.buf)[i]: ((double *) view.buf)[i];
+      }
+      else if(strchr("BHILQN", code)) {
+        switch(view.itemsize) {
+          case 1:  res[i] = (double) ((unsigned char *) view.buf)[i]; break;
+          case 2:  res[i] = (double) ((unsigned short *) view.buf)[i]; break;
+          case 4:  res[i] = (double) ((unsigned int *) view.buf)[i]; break;
+          default: res[i] = (double) ((unsigned long long *) view.buf)[i];
+        }
+      }
+      else {
+        switch(view.itemsize) {
+          case 1:  res[i] = (double) ((signed char *) view.buf)[i]; break;
+          case 2:  res[i] = (double) ((short *) view.buf)[i]; break;
+          case 4:  res[i] = (double) ((int *) view.buf)[i]; break;
+          default: res[i] = (double) ((long long *) view.buf)[i];
+        }
+      }
+    }
+    PyBuffer_Release(&view);
+    return res;
+  }
+
+  seq = PySequence_Fast(obj, "ERROR: a flat array or sequence of numbers is required");
+  if(!seq) {
+    return NULL;
+  }
+  *n = PySequence_Fast_GET_SIZE(seq);
+  res = (double *) malloc(*n * sizeof(double) + 1);
+  if(!res) {
+    Py_DECREF(seq);
+    PyErr_NoMemory();
+    return NULL;
+  }
+  for(i = 0; i < *n; ++i) {
+    res[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, i));
+  }
+  Py_DECREF(seq);
+  if(PyErr_Occurred()) {
+    free(res);
+    return NULL;
+  }
+  return res;
+}
+
+/* Read the items and the offsets of a list of inputs in compressed sparse
+   row form, with width numbers per item, into new malloc'ed arrays. The
+   offsets must run from 0 up to the number of items and never decrease.
+   Return 0 and set an exception on failure. */
+static int
+read_csr(PyObject *obj, PyObject *offsets_obj, int width, const char *name,
+         double **items, int **offsets, int *ninputs) {
+  double *buffer;
+  Py_ssize_t n, noffsets, i;
+
+  *items = read_numbers(obj, &n);
+  if(!*items) {
+    return 0;
+  }
+  buffer = read_numbers(offsets_obj, &noffsets);
+  if(!buffer) {
+    free(*items);
+    return 0;
+  }
+  if(n % width != 0 || n / width > 0x7fffffff || noffsets < 1 ||
+     (*ninputs >= 0 && noffsets != *ninputs + 1)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong %s (%d numbers and %d offsets)\n", __FILE__, __LINE__, name, (int) n, (int) noffsets);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    free(*items);
+    free(buffer);
+    return 0;
+  }
+  *offsets = (int *) malloc(noffsets * sizeof(int));
+  if(!*offsets) {
+    free(*items);
+    free(buffer);
+    PyErr_NoMemory();
+    return 0;
+  }
+  for(i = 0; i < noffsets; ++i) {
+    (*offsets)[i] = (int) buffer[i];
+    if(buffer[i] != (double) (*offsets)[i] || buffer[i] > (double) (n / width) ||
+       (i == 0 && buffer[i] != 0.) || (i > 0 && buffer[i] < buffer[i - 1])) {
+      sprintf(MSG, "ERROR in %s at line %d: wrong %s offset %g at %d (offsets must run from 0 up to %d)\n", __FILE__, __LINE__, name, buffer[i], (int) i, (int) (n / width));
+      PyErr_SetString(PyExc_ValueError, MSG);
+      free(*items);
+      free(*offsets);
+      free(buffer);
+      return 0;
+    }
+  }
+  free(buffer);
+  *ninputs = (int) noffsets - 1;
+  return 1;
+}
+
+static PyObject *
+triangulate_TRIANGULATE_MANY(PyObject *self, PyObject *args) {
+
+  /* Triangulate a batch of small independent inputs (e.g. polygons) in one
+     call, all of them with the same switches */
+
+  PyObject *xy_obj, *offsets_obj, *seg_obj = Py_None, *seg_offsets_obj = Py_None;
+  PyObject *holes_obj = Py_None, *hole_offsets_obj = Py_None;
+  PyObject *xy, *point_offsets, *triangles, *triangle_offsets;
+  char *swtch;
+  double *points, *segs = NULL, *hls = NULL, *origins, *buffer;
+  int *pointoffsets, *segoffsets = NULL, *holeoffsets = NULL;
+  int *segmentlist = NULL, *outpointoffsets, *outtriangles, *outtriangleoffsets;
+  REAL *pointlist, *holelist = NULL, *outpoints;
+  int i, k, npts, first, ninputs = -1, ok = 1;
+
+  if(!PyArg_ParseTuple(args, "sOO|OOOO",
+               &swtch, &xy_obj, &offsets_obj, &seg_obj, &seg_offsets_obj,
+               &holes_obj, &hole_offsets_obj)) {
+    return NULL;
+  }
+  if(!read_csr(xy_obj, offsets_obj, _NDIM, "points", &points, &pointoffsets, &ninputs)) {
+    return NULL;
+  }
+  for(i = 0; i < ninputs; ++i) {
+    if(pointoffsets[i + 1] - pointoffsets[i] < 3) {
+      sprintf(MSG, "ERROR in %s at line %d: input %d has %d points (at least 3 required)\n", __FILE__, __LINE__, i, pointoffsets[i + 1] - pointoffsets[i]);
+      PyErr_SetString(PyExc_ValueError, MSG);
+      ok = 0;
+      break;
+    }
+  }
+  if(ok && seg_obj != Py_None) {
+    ok = read_csr(seg_obj, seg_offsets_obj, 2, "segments", &segs, &segoffsets, &ninputs);
+  }
+  if(ok && holes_obj != Py_None) {
+    ok = read_csr(holes_obj, hole_offsets_obj, _NDIM, "holes", &hls, &holeoffsets, &ninputs);
+  }
+  if(!ok) {
+    free(points);
+    free(pointoffsets);
+    if(segs) free(segs);
+    if(segoffsets) free(segoffsets);
+    return NULL;
+  }
+
+  /* the coordinates as REAL, the segments as int. In the float build, the
+     points and the holes of each input are stored relative to its first point */
+  origins = (double *) malloc(_NDIM * (size_t) ninputs * sizeof(double) + 1);
+  pointlist = (REAL *) malloc(_NDIM * (size_t) pointoffsets[ninputs] * sizeof(REAL) + 1);
+  if(hls) {
+    holelist = (REAL *) malloc(_NDIM * (size_t) holeoffsets[ninputs] * sizeof(REAL) + 1);
+  }
+  if(segs) {
+    segmentlist = (int *) malloc(2 * (size_t) segoffsets[ninputs] * sizeof(int) + 1);
+  }
+  if(!origins || !pointlist || (hls && !holelist) || (segs && !segmentlist)) {
+    free(points);
+    free(pointoffsets);
+    free(origins);
+    free(pointlist);
+    if(segs) free(segs);
+    if(segoffsets) free(segoffsets);
+    if(segmentlist) free(segmentlist);
+    if(hls) free(hls);
+    if(holeoffsets) free(holeoffsets);
+    if(holelist) free(holelist);
+    return PyErr_NoMemory();
+  }
+  for(k = 0; k < ninputs; ++k) {
+    origins[_NDIM*k] = origins[_NDIM*k + 1] = 0.;
+#ifdef SINGLE
+    origins[_NDIM*k    ] = points[_NDIM*pointoffsets[k]    ];
+    origins[_NDIM*k + 1] = points[_NDIM*pointoffsets[k] + 1];
+#endif
+    for(i = _NDIM*pointoffsets[k]; i < _NDIM*pointoffsets[k + 1]; ++i) {
+      pointlist[i] = (REAL) (points[i] - origins[_NDIM*k + i % _NDIM]);
+    }
+    for(i = _NDIM*(hls? holeoffsets[k]: 0); i < _NDIM*(hls? holeoffsets[k + 1]: 0); ++i) {
+      holelist[i] = (REAL) (hls[i] - origins[_NDIM*k + i % _NDIM]);
+    }
+  }
+  free(points);
+  if(hls) free(hls);
+  if(segs) {
+    /* Triangle would skip a segment to a point outside its input */
+    first = strchr(swtch, 'z') ? 0 : 1;
+    for(k = 0; ok && k < ninputs; ++k) {
+      npts = pointoffsets[k + 1] - pointoffsets[k];
+      for(i = 2 * segoffsets[k]; i < 2 * segoffsets[k + 1]; ++i) {
+        if(!(segs[i] >= first && segs[i] < first + npts && segs[i] == (int) segs[i])) {
+          sprintf(MSG, "ERROR in %s at line %d: segment %d of input %d ends at %g, not a point of the input (%d..%d)\n", __FILE__, __LINE__, i / 2 - segoffsets[k], k, segs[i], first, first + npts - 1);
+          PyErr_SetString(PyExc_ValueError, MSG);
+          ok = 0;
+          break;
+        }
+        segmentlist[i] = (int) segs[i];
+      }
+    }
+    free(segs);
+  }
+  if(!ok) {
+    free(origins);
+    free(pointlist);
+    free(pointoffsets);
+    free(segmentlist);
+    free(segoffsets);
+    if(holelist) free(holelist);
+    if(holeoffsets) free(holeoffsets);
+    return NULL;
+  }
+
+  triangulatemany(swtch, ninputs, pointlist, pointoffsets, segmentlist,
+                  segoffsets, holelist, holeoffsets, &outpoints,
+                  &outpointoffsets, &outtriangles, &outtriangleoffsets);
+
+  free(pointlist);
+  free(pointoffsets);
+  if(segmentlist) free(segmentlist);
+  if(segoffsets) free(segoffsets);
+  if(holelist) free(holelist);
+  if(holeoffsets) free(holeoffsets);
+
+  /* the coordinates are returned as doubles in both builds */
+  buffer = (double *) malloc(_NDIM * (size_t) outpointoffsets[ninputs] * sizeof(double) + 1);
+  if(!buffer) {
+    free(origins);
+    trifree(outpoints);
+    trifree(outpointoffsets);
+    trifree(outtriangles);
+    trifree(outtriangleoffsets);
+    return PyErr_NoMemory();
+  }
+  for(k = 0; k < ninputs; ++k) {
+    for(i = _NDIM*outpointoffsets[k]; i < _NDIM*outpointoffsets[k + 1]; ++i) {
+      buffer[i] = (double) outpoints[i] + origins[_NDIM*k + i % _NDIM];
+    }
+  }
+  free(origins);
+  xy               = new_array("d", buffer, _NDIM * (size_t) outpointoffsets[ninputs] * sizeof(double));
+  free(buffer);
+  point_offsets    = new_array("i", outpointoffsets, (ninputs + 1) * sizeof(int));
+  triangles        = new_array("i", outtriangles, 3 * (size_t) outtriangleoffsets[ninputs] * sizeof(int));
+  triangle_offsets = new_array("i", outtriangleoffsets, (ninputs + 1) * sizeof(int));
+  trifree(outpoints);
+  trifree(outpointoffsets);
+  trifree(outtriangles);
+  trifree(outtriangleoffsets);
+  if(!xy || !point_offsets || !triangles || !triangle_offsets) {
+    Py_XDECREF(xy);
+    Py_XDECREF(point_offsets);
+    Py_XDECREF(triangles);
+    Py_XDECREF(triangle_offsets);
+    return NULL;
+  }
+
+  return Py_BuildValue("(NNNN)", xy, point_offsets, triangles, triangle_offsets);
+}
+
+static PyObject *
+triangulate_GATHER_POINTS(PyObject *self, PyObject *args) {
+
+  /* Gather the points of a list of numbers into a new flat array, with no
+     Python object per point (the inputs of triangle.triangulate_tiles) */
+
+  PyObject *xy_obj, *ids_obj, *res;
+  double *xy, *ids, *buffer;
+  Py_ssize_t n, nids, i;
+  int a;
+
+  if(!PyArg_ParseTuple(args, "OO",
+               &xy_obj, &ids_obj)) {
+    return NULL;
+  }
+  xy = read_numbers(xy_obj, &n);
+  if(!xy) {
+    return NULL;
+  }
+  ids = read_numbers(ids_obj, &nids);
+  if(!ids) {
+    free(xy);
+    return NULL;
+  }
+  buffer = (double *) malloc(_NDIM * (size_t) nids * sizeof(double) + 1);
+  if(!buffer) {
+    free(xy);
+    free(ids);
+    return PyErr_NoMemory();
+  }
+  for(i = 0; i < nids; ++i) {
+    a = (int) ids[i];
+    if(ids[i] != (double) a || a < 0 || a >= n / _NDIM) {
+      sprintf(MSG, "ERROR in %s at line %d: point number %g at %d, not within 0..%d\n", __FILE__, __LINE__, ids[i], (int) i, (int) (n / _NDIM) - 1);
+      PyErr_SetString(PyExc_ValueError, MSG);
+      free(xy);
+      free(ids);
+      free(buffer);
+      return NULL;
+    }
+    buffer[_NDIM*i    ] = xy[_NDIM*a    ];
+    buffer[_NDIM*i + 1] = xy[_NDIM*a + 1];
+  }
+  res = new_array("d", buffer, _NDIM * (size_t) nids * sizeof(double));
+  free(xy);
+  free(ids);
+  free(buffer);
+  return res;
+}
+
+static PyObject *
+triangulate_STITCH_TILES(PyObject *self, PyObject *args) {
+
+  /* Number the points of the meshes of tiles (output of triangulate_many)
+     globally: the first points of each tile are given their global numbers,
+     the points added inside a tile are appended to the shared points */
+
+  PyObject *shared_obj, *ids_obj, *id_offsets_obj, *txy_obj, *point_offsets_obj;
+  PyObject *corners_obj, *triangle_offsets_obj, *xy, *triangles;
+  double *shared, *ids, *txy, *corners;
+  int *idoffsets, *pointoffsets, *triangleoffsets, *numbers, *tlist;
+  double *buffer;
+  Py_ssize_t nshared, i;
+  int k, c, ntiles = -1, nids, npts, base, total, ok = 1;
+
+  if(!PyArg_ParseTuple(args, "OOOOOOO",
+               &shared_obj, &ids_obj, &id_offsets_obj, &txy_obj, &point_offsets_obj,
+               &corners_obj, &triangle_offsets_obj)) {
+    return NULL;
+  }
+  shared = read_numbers(shared_obj, &nshared);
+  if(!shared) {
+    return NULL;
+  }
+  if(!read_csr(ids_obj, id_offsets_obj, 1, "point numbers", &ids, &idoffsets, &ntiles)) {
+    free(shared);
+    return NULL;
+  }
+  if(!read_csr(txy_obj, point_offsets_obj, _NDIM, "points", &txy, &pointoffsets, &ntiles)) {
+    free(shared);
+    free(ids);
+    free(idoffsets);
+    return NULL;
+  }
+  if(!read_csr(corners_obj, triangle_offsets_obj, 3, "triangles", &corners, &triangleoffsets, &ntiles)) {
+    free(shared);
+    free(ids);
+    free(idoffsets);
+    free(txy);
+    free(pointoffsets);
+    return NULL;
+  }
+
+  /* the global number of each point of the tiles */
+  numbers = (int *) malloc((size_t) pointoffsets[ntiles] * sizeof(int) + 1);
+  tlist = (int *) malloc(3 * (size_t) triangleoffsets[ntiles] * sizeof(int) + 1);
+  total = (int) (nshared / _NDIM) + pointoffsets[ntiles] - idoffsets[ntiles];
+  buffer = (double *) malloc(_NDIM * (size_t) total * sizeof(double) + 1);
+  if(!numbers || !tlist || !buffer) {
+    free(numbers);
+    free(tlist);
+    free(buffer);
+    free(shared);
+    free(ids);
+    free(idoffsets);
+    free(txy);
+    free(pointoffsets);
+    free(corners);
+    free(triangleoffsets);
+    return PyErr_NoMemory();
+  }
+  base = (int) (nshared / _NDIM);
+  memcpy(buffer, shared, _NDIM * (size_t) base * sizeof(double));
+  for(k = 0; ok && k < ntiles; ++k) {
+    nids = idoffsets[k + 1] - idoffsets[k];
+    npts = pointoffsets[k + 1] - pointoffsets[k];
+    ok = nids <= npts;
+    for(i = 0; ok && i < npts; ++i) {
+      if(i < nids) {
+        c = (int) ids[idoffsets[k] + i];
+        ok = ids[idoffsets[k] + i] == (double) c && c >= 0 && c < nshared / _NDIM;
+      } else {
+        c = base++;
+        buffer[_NDIM*c    ] = txy[_NDIM*(pointoffsets[k] + i)    ];
+        buffer[_NDIM*c + 1] = txy[_NDIM*(pointoffsets[k] + i) + 1];
+      }
+      numbers[pointoffsets[k] + i] = c;
+    }
+    for(i = 3 * (Py_ssize_t) triangleoffsets[k]; ok && i < 3 * (Py_ssize_t) triangleoffsets[k + 1]; ++i) {
+      c = (int) corners[i];
+      ok = corners[i] == (double) c && c >= 0 && c < npts;
+      if(ok) tlist[i] = numbers[pointoffsets[k] + c];
+    }
+    if(!ok) {
+      sprintf(MSG, "ERROR in %s at line %d: the points or the triangles of tile %d do not match its %d point numbers\n", __FILE__, __LINE__, k, nids);
+      PyErr_SetString(PyExc_ValueError, MSG);
+      free(numbers);
+      free(tlist);
+      free(buffer);
+    }
+  }
+  free(shared);
+  free(ids);
+  free(idoffsets);
+  free(txy);
+  free(pointoffsets);
+  free(corners);
+  if(!ok) {
+    free(triangleoffsets);
+    return NULL;
+  }
+  free(numbers);
+
+  xy        = new_array("d", buffer, _NDIM * (size_t) total * sizeof(double));
+  triangles = new_array("i", tlist, 3 * (size_t) triangleoffsets[ntiles] * sizeof(int));
+  free(buffer);
+  free(tlist);
+  free(triangleoffsets);
+  if(!xy || !triangles) {
+    Py_XDECREF(xy);
+    Py_XDECREF(triangles);
+    return NULL;
+  }
+
+  return Py_BuildValue("(NN)", xy, triangles);
+}
+
+static PyObject *
+triangulate_STREAM_POINTS(PyObject *self, PyObject *args) {
+
+  /* Append a chunk of points straight to the vertex pool of an input handle
+     (see streampoints), without a pointlist. Only the chunk is converted */
+
+  PyObject *address, *xy_obj, *mrks_obj = Py_None, *atts_obj = Py_None;
+  struct triangulateio *object;
+  double *xy, *mrks = NULL, *atts = NULL, x0 = 0., y0 = 0.;
+  REAL *pointlist, *attributelist = NULL;
+  int *markerlist = NULL;
+  Py_ssize_t n, nmrks, natts, i;
+  int npts, total, sizehint = 0;
+
+  if(!PyArg_ParseTuple(args, "OO|OOi(dd)",
+               &address, &xy_obj, &mrks_obj, &atts_obj, &sizehint, &x0, &y0)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+
+  xy = read_numbers(xy_obj, &n);
+  if(!xy) {
+    return NULL;
+  }
+  npts = (int) (n / _NDIM);
+  total = object->pointstream? streampoints(object, NULL, NULL, NULL, 0, 0): 0;
+  if(n % _NDIM != 0 || n / _NDIM > 0x7fffffff - total) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #2 (%d numbers, x0, y0, x1, y1,.. required)\n", __FILE__, __LINE__, (int) n);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    free(xy);
+    return NULL;
+  }
+  if(npts == 0) {
+    free(xy);
+    return PyLong_FromLong(total);
+  }
+  if(mrks_obj != Py_None) {
+    mrks = read_numbers(mrks_obj, &nmrks);
+    if(!mrks || nmrks != npts) {
+      if(mrks) {
+        sprintf(MSG, "ERROR in %s at line %d: wrong argument #3 (%d markers for %d points)\n", __FILE__, __LINE__, (int) nmrks, npts);
+        PyErr_SetString(PyExc_ValueError, MSG);
+        free(mrks);
+      }
+      free(xy);
+      return NULL;
+    }
+  }
+  natts = 0;
+  if(atts_obj != Py_None) {
+    atts = read_numbers(atts_obj, &natts);
+    if(!atts) {
+      free(xy);
+      if(mrks) free(mrks);
+      return NULL;
+    }
+  }
+  /* the first chunk sets the number of attributes per point */
+  if(!object->pointstream) {
+    object->numberofpointattributes = (int) (natts / npts);
+  }
+  if(natts != (Py_ssize_t) npts * object->numberofpointattributes) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #4 (%d attributes for %d points, %d per point required)\n", __FILE__, __LINE__, (int) natts, npts, object->numberofpointattributes);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    free(xy);
+    if(mrks) free(mrks);
+    if(atts) free(atts);
+    return NULL;
+  }
+
+  /* convert in place: a REAL or an int is never larger than a double */
+  pointlist = (REAL *) xy;
+  for(i = 0; i < n; ++i) {
+    pointlist[i] = (REAL) (xy[i] - (i % _NDIM? y0: x0));
+  }
+  if(mrks) {
+    markerlist = (int *) mrks;
+    for(i = 0; i < npts; ++i) {
+      markerlist[i] = (int) mrks[i];
+    }
+  }
+  if(atts) {
+    attributelist = (REAL *) atts;
+    for(i = 0; i < natts; ++i) {
+      attributelist[i] = (REAL) atts[i];
+    }
+  }
+
+  total = streampoints(object, pointlist, attributelist, markerlist, npts, sizehint);
+
+  free(xy);
+  if(mrks) free(mrks);
+  if(atts) free(atts);
+
+  return PyLong_FromLong(total);
+}
+
+/* Whether the bounding box of a circle lies in the finalized cells of a
+   grid (x0, y0, dx, dy, nx, ny), the space outside the grid being final */
+static int
+circle_final(double cx, double cy, double r, const double *grid, const double *final) {
+  double i0, i1, j0, j1;
+  int nx = (int) grid[4], ny = (int) grid[5], i, j;
+
+  i0 = floor((cx - r - grid[0]) / grid[2]);
+  i1 = floor((cx + r - grid[0]) / grid[2]);
+  j0 = floor((cy - r - grid[1]) / grid[3]);
+  j1 = floor((cy + r - grid[1]) / grid[3]);
+  if(!(i0 == i0 && i1 == i1 && j0 == j0 && j1 == j1)) {
+    return 0;
+  }
+  if(i1 < 0. || j1 < 0. || i0 > nx - 1. || j0 > ny - 1.) {
+    return 1;
+  }
+  i0 = i0 < 0.? 0.: i0;
+  j0 = j0 < 0.? 0.: j0;
+  i1 = i1 > nx - 1.? nx - 1.: i1;
+  j1 = j1 > ny - 1.? ny - 1.: j1;
+  for(j = (int) j0; j <= (int) j1; ++j) {
+    for(i = (int) i0; i <= (int) i1; ++i) {
+      if(final[(size_t) j*nx + i] == 0.) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+/* Whether a point of a box (xmin, ymin, xmax, ymax) lies on the right of
+   the line a->b, or on it */
+static int
+box_right(double ax, double ay, double bx, double by, const double *box) {
+  int k;
+
+  for(k = 0; k < 4; ++k) {
+    if((bx - ax) * (box[1 + (k & 2)] - ay) - (by - ay) * (box[2 * (k & 1)] - ax) <= 0.) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static PyObject *
+triangulate_FINALIZE_FRONT(PyObject *self, PyObject *args) {
+
+  /* One step of the streaming Delaunay triangulation of
+     triangle.stream_delaunay. The Delaunay triangles of the active points
+     in h are either behind the front (they replace triangles written
+     before, whose points were retired), final (their circumcircle lies in
+     finalized cells, no point can come into it any more) or not yet.
+     Return the final triangles (global numbers), and the points, global
+     numbers and front of the next step */
+
+  PyObject *address, *xy_obj, *ids_obj, *front_obj, *final_obj;
+  PyObject *res = NULL, *triangles, *newxy, *newids, *newfront;
+  struct triangulateio *object;
+  double *xy = NULL, *ids = NULL, *front = NULL, *final = NULL, grid[6];
+  double ax, ay, bx, by, cx, cy, d, ux, uy, box[4];
+  long long *tribuf = NULL, *idbuf = NULL;
+  double *xybuf = NULL;
+  int *tlist, *nlist, *start = NULL, *incident = NULL, *stack = NULL;
+  int *right = NULL, *index = NULL, *frontbuf = NULL;
+  unsigned char *state = NULL, *blocked = NULL;
+  Py_ssize_t n, nids, nfront, nfinal;
+  int npts, ntri, nedges, nstack, nnew, nout, nkeep, a, b, t, u, v, k, i, e;
+
+  if(!PyArg_ParseTuple(args, "OOOO(dddddd)O",
+               &address, &xy_obj, &ids_obj, &front_obj,
+               &grid[0], &grid[1], &grid[2], &grid[3], &grid[4], &grid[5], &final_obj)) {
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument #1 (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  npts  = object->numberofpoints;
+  ntri  = object->numberoftriangles;
+  tlist = object->trianglelist;
+  nlist = object->neighborlist;
+  if(ntri > 0 && (!nlist || object->numberofcorners != 3)) {
+    sprintf(MSG, "ERROR in %s at line %d: the handle has no neighbors (triangulate with the n switch, without o2)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+
+  xy = read_numbers(xy_obj, &n);
+  if(xy) ids = read_numbers(ids_obj, &nids);
+  if(ids) front = read_numbers(front_obj, &nfront);
+  if(front) final = read_numbers(final_obj, &nfinal);
+  if(!final) {
+    goto done;
+  }
+  if(n != 2 * (Py_ssize_t) npts || nids != npts || nfront % 2 != 0 ||
+     grid[2] <= 0. || grid[3] <= 0. || nfinal != (Py_ssize_t) grid[4] * (Py_ssize_t) grid[5]) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong sizes (%d points in the handle, %d coordinates, %d numbers, %d front numbers, %d cells)\n", __FILE__, __LINE__, npts, (int) n, (int) nids, (int) nfront, (int) nfinal);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    goto done;
+  }
+  nedges = (int) (nfront / 2);
+
+  start    = (int *) calloc((size_t) npts + 1, sizeof(int));
+  incident = (int *) malloc(3 * (size_t) ntri * sizeof(int) + 1);
+  stack    = (int *) malloc((size_t) ntri * sizeof(int) + 1);
+  right    = (int *) malloc((size_t) nedges * sizeof(int) + 1);
+  index    = (int *) malloc((size_t) npts * sizeof(int) + 1);
+  frontbuf = (int *) malloc(2 * ((size_t) nedges + 3 * (size_t) ntri) * sizeof(int) + 1);
+  state    = (unsigned char *) calloc((size_t) ntri + 1, 1);
+  blocked  = (unsigned char *) calloc((size_t) ntri + 1, 1);
+  if(!start || !incident || !stack || !right || !index || !frontbuf || !state || !blocked) {
+    PyErr_NoMemory();
+    goto done;
+  }
+
+  /* the triangles around each point, in compressed sparse row form */
+  for(i = 0; i < 3 * ntri; ++i) {
+    start[tlist[i] + 1]++;
+  }
+  for(v = 0; v < npts; ++v) {
+    start[v + 1] += start[v];
+  }
+  for(i = 0; i < 3 * ntri; ++i) {
+    incident[start[tlist[i]]++] = i / 3;
+  }
+  for(v = npts; v > 0; --v) {
+    start[v] = start[v - 1];
+  }
+  start[0] = 0;
+
+  /* the front edge a->b has the written triangles on its left. The
+     triangles on that side are behind the front (state 1), up to the
+     front edges, which are Delaunay edges of any subset of the points */
+  nstack = 0;
+  for(e = 0; e < nedges; ++e) {
+    a = (int) front[2*e];
+    b = (int) front[2*e + 1];
+    right[e] = -1;
+    if(a < 0 || a >= npts || b < 0 || b >= npts) {
+      sprintf(MSG, "ERROR in %s at line %d: front edge %d (%d, %d) out of range\n", __FILE__, __LINE__, e, a, b);
+      PyErr_SetString(PyExc_ValueError, MSG);
+      goto done;
+    }
+    for(i = start[a]; i < start[a + 1]; ++i) {
+      t = incident[i];
+      for(k = 0; k < 3; ++k) {
+        /* side k is opposite to corner k, as in the neighbor list */
+        if(tlist[3*t + (k + 1) % 3] == a && tlist[3*t + (k + 2) % 3] == b) {
+          blocked[t] |= 1 << k;
+          if(!state[t]) {
+            state[t] = 1;
+            stack[nstack++] = t;
+          }
+        }
+        else if(tlist[3*t + (k + 1) % 3] == b && tlist[3*t + (k + 2) % 3] == a) {
+          blocked[t] |= 1 << k;
+          right[e] = t;
+        }
+      }
+    }
+  }
+  while(nstack > 0) {
+    t = stack[--nstack];
+    for(k = 0; k < 3; ++k) {
+      u = nlist[3*t + k];
+      if(!(blocked[t] & (1 << k)) && u >= 0 && !state[u]) {
+        state[u] = 1;
+        stack[nstack++] = u;
+      }
+    }
+  }
+
+  /* the final triangles (state 2) */
+  nout = 0;
+  for(t = 0; t < ntri; ++t) {
+    if(state[t]) {
+      continue;
+    }
+    ax = xy[2*tlist[3*t]];
+    ay = xy[2*tlist[3*t] + 1];
+    bx = xy[2*tlist[3*t + 1]] - ax;
+    by = xy[2*tlist[3*t + 1] + 1] - ay;
+    cx = xy[2*tlist[3*t + 2]] - ax;
+    cy = xy[2*tlist[3*t + 2] + 1] - ay;
+    d = 2. * (bx * cy - by * cx);
+    if(d == 0.) {
+      continue;
+    }
+    ux = (cy * (bx * bx + by * by) - by * (cx * cx + cy * cy)) / d;
+    uy = (bx * (cx * cx + cy * cy) - cx * (bx * bx + by * by)) / d;
+    /* with a margin for the rounding of the center and the radius */
+    if(circle_final(ax + ux, ay + uy, 1.000001 * sqrt(ux * ux + uy * uy), grid, final)) {
+      state[t] = 2;
+      nout++;
+    }
+  }
+
+  /* the bounding box of the cells still open, empty if none */
+  box[0] = box[1] = HUGE_VAL;
+  box[2] = box[3] = -HUGE_VAL;
+  for(i = 0; i < (int) nfinal; ++i) {
+    if(final[i] == 0.) {
+      ux = grid[0] + (i % (int) grid[4]) * grid[2];
+      uy = grid[1] + (i / (int) grid[4]) * grid[3];
+      box[0] = ux < box[0]? ux: box[0];
+      box[1] = uy < box[1]? uy: box[1];
+      box[2] = ux + grid[2] > box[2]? ux + grid[2]: box[2];
+      box[3] = uy + grid[3] > box[3]? uy + grid[3]: box[3];
+    }
+  }
+
+  /* the next front: the front edges whose right side is not final, and
+     the edges of the final triangles with a triangle on their right that
+     is not. The edges of the convex hull with a final triangle on their
+     left stay on the front as long as a point can come on their right
+     (the open cells are approximated by their bounding box). The points
+     kept are those of the next front and of the triangles that are not
+     final. A point of no triangle is a duplicate, dropped for good, unless
+     there is no triangle at all (points all collinear so far) */
+  for(v = 0; v < npts; ++v) {
+    index[v] = ntri == 0? 0: -1;
+  }
+  nnew = 0;
+  for(e = 0; e < nedges; ++e) {
+    a = (int) front[2*e];
+    b = (int) front[2*e + 1];
+    if(right[e] < 0? box[0] <= box[2] && box_right(xy[2*a], xy[2*a + 1], xy[2*b], xy[2*b + 1], box):
+       state[right[e]] != 2) {
+      frontbuf[2*nnew    ] = a;
+      frontbuf[2*nnew + 1] = b;
+      nnew++;
+    }
+  }
+  for(t = 0; t < ntri; ++t) {
+    if(state[t] == 2 && box[0] <= box[2]) {
+      for(k = 0; k < 3; ++k) {
+        a = tlist[3*t + (k + 1) % 3];
+        b = tlist[3*t + (k + 2) % 3];
+        if(nlist[3*t + k] < 0 && box_right(xy[2*a], xy[2*a + 1], xy[2*b], xy[2*b + 1], box)) {
+          frontbuf[2*nnew    ] = a;
+          frontbuf[2*nnew + 1] = b;
+          nnew++;
+        }
+      }
+    }
+    if(state[t]) {
+      continue;
+    }
+    for(k = 0; k < 3; ++k) {
+      index[tlist[3*t + k]] = 0;
+      u = nlist[3*t + k];
+      if(u >= 0 && state[u] == 2) {
+        frontbuf[2*nnew    ] = tlist[3*t + (k + 2) % 3];
+        frontbuf[2*nnew + 1] = tlist[3*t + (k + 1) % 3];
+        nnew++;
+      }
+    }
+  }
+  for(i = 0; i < 2 * nnew; ++i) {
+    index[frontbuf[i]] = 0;
+  }
+  nkeep = 0;
+  for(v = 0; v < npts; ++v) {
+    if(index[v] == 0) {
+      index[v] = nkeep++;
+    }
+  }
+  for(i = 0; i < 2 * nnew; ++i) {
+    frontbuf[i] = index[frontbuf[i]];
+  }
+
+  tribuf = (long long *) malloc(3 * (size_t) nout * sizeof(long long) + 1);
+  idbuf  = (long long *) malloc((size_t) nkeep * sizeof(long long) + 1);
+  xybuf  = (double *) malloc(2 * (size_t) nkeep * sizeof(double) + 1);
+  if(!tribuf || !idbuf || !xybuf) {
+    PyErr_NoMemory();
+    goto done;
+  }
+  nout = 0;
+  for(t = 0; t < ntri; ++t) {
+    if(state[t] == 2) {
+      for(k = 0; k < 3; ++k) {
+        tribuf[nout++] = (long long) ids[tlist[3*t + k]];
+      }
+    }
+  }
+  for(v = 0; v < npts; ++v) {
+    if(index[v] >= 0) {
+      idbuf[index[v]] = (long long) ids[v];
+      xybuf[2*index[v]    ] = xy[2*v];
+      xybuf[2*index[v] + 1] = xy[2*v + 1];
+    }
+  }
+
+  triangles = new_array("q", tribuf, (size_t) nout * sizeof(long long));
+  newxy     = new_array("d", xybuf, 2 * (size_t) nkeep * sizeof(double));
+  newids    = new_array("q", idbuf, (size_t) nkeep * sizeof(long long));
+  newfront  = new_array("i", frontbuf, 2 * (size_t) nnew * sizeof(int));
+  if(!triangles || !newxy || !newids || !newfront) {
+    Py_XDECREF(triangles);
+    Py_XDECREF(newxy);
+    Py_XDECREF(newids);
+    Py_XDECREF(newfront);
+    goto done;
+  }
+  res = Py_BuildValue("(NNNN)", triangles, newxy, newids, newfront);
+
+ done:
+  free(xy);
+  free(ids);
+  free(front);
+  free(final);
+  free(start);
+  free(incident);
+  free(stack);
+  free(right);
+  free(index);
+  free(frontbuf);
+  free(state);
+  free(blocked);
+  free(tribuf);
+  free(idbuf);
+  free(xybuf);
+  return res;
+}
+
+static PyObject *
+triangulate_GET_QUALITY(PyObject *self, PyObject *args) {
+  PyObject *address, *angles, *aspects, *areas, *angletable, *aspecttable, *summary;
+  struct triangulateio *object;
+  struct qualitystats q;
+  int i, nc, npts, ntri, level = -1, firstnumber = -1;
+  int *tlist;
+  REAL *talist, *buffer;
+  
+  if(!PyArg_ParseTuple(args, "O|ii", 
+               &address, &level, &firstnumber)) { 
+    return NULL;
+  }
+  if(!PyCapsule_CheckExact(address)) {
+    sprintf(MSG, "ERROR in %s at line %d: wrong argument (triangulateio handle required)\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_TypeError, MSG);
+    return NULL;
+  }
+  object = PyCapsule_GetPointer(address, TRIANGULATEIO_NAME);
+  if(!find_level(object, level, &npts, &ntri, &tlist, &talist)) {
+    return NULL;
+  }
+  if(ntri > 0 && !object->pointlist) {
+    sprintf(MSG, "ERROR in %s at line %d: handle has no points\n", __FILE__, __LINE__);
+    PyErr_SetString(PyExc_ValueError, MSG);
+    return NULL;
+  }
+  nc = object->numberofcorners;
+  if(tlist != object->trianglelist) {
+    /* coarser levels only record the triangle corners */
+    nc = 3;
+  }
+  if(!check_corners(object, tlist, ntri, nc, npts, &firstnumber)) {
+    return NULL;
+  }
+
+  buffer = (REAL *) malloc(3 * (size_t) ntri * sizeof(REAL) + 1);
+  if(!buffer) {
+    return PyErr_NoMemory();
+  }
+  measurequality(object->pointlist, tlist, ntri, nc, firstnumber,
+                 buffer, buffer + ntri, buffer + 2*ntri, &q);
+
+  angles  = new_real_array(buffer, ntri);
+  aspects = new_real_array(buffer + ntri, ntri);
+  areas   = new_real_array(buffer + 2*ntri, ntri);
+  free(buffer);
+  angletable = PyList_New(18);
+  for(i = 0; i < 18; ++i) {
+    PyList_SET_ITEM(angletable, i, PyLong_FromLong((long) q.angletable[i]));
+  }
+  aspecttable = PyList_New(16);
+  for(i = 0; i < 16; ++i) {
+    PyList_SET_ITEM(aspecttable, i, PyLong_FromLong((long) q.aspecttable[i]));
+  }
+  summary = Py_BuildValue("{s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:N,s:N}",
+                          "min_angle",        (double) q.smallestangle,
+                          "max_angle",        (double) q.biggestangle,
+                          "min_area",         (double) q.smallestarea,
+                          "max_area",         (double) q.biggestarea,
+                          "min_edge",         (double) q.shortestedge,
+                          "max_edge",         (double) q.longestedge,
+                          "min_altitude",     (double) q.shortestaltitude,
+                          "max_aspect",       (double) q.worstaspect,
+                          "angle_histogram",  angletable,
+                          "aspect_histogram", aspecttable);
+  if(!angles || !aspects || !areas || !summary) {
+    Py_XDECREF(angles);
+    Py_XDECREF(aspects);
+    Py_XDECREF(areas);
+    Py_XDECREF(summary);
+    return NULL;
+  }
+
+  return Py_BuildValue("(NNNN)", angles, aspects, areas, summary);
+}
+
+static PyMethodDef triangulate_methods[] = {
+  {"new", triangulate_NEW, METH_VARARGS, "Return new handle to triangulateio structure ()->h."},
+  {"free", triangulate_FREE, METH_VARARGS, 
+   "Free the arrays held by a handle right away, leaving it empty (h)->None. \nh: handle."},
+  {"release", triangulate_RELEASE, METH_VARARGS, 
+   "Write the outputs deferred by the K switch, then free the mesh kept for them (h)->None. \nh: handle."},
+  {"free_level", triangulate_FREE_LEVEL, METH_VARARGS, 
+   "Free the triangles of a coarse level, keeping its point count (h, level)->None. \nh: handle.\nlevel: refinement level (L switch), 0 is the coarsest; the finest cannot be freed."},
+  {"save", triangulate_SAVE, METH_VARARGS, 
+   "Write the arrays held by a handle to a binary file (h, filename)->None. \nh: handle.\nfilename: file name."},
+  {"load", triangulate_LOAD, METH_VARARGS, 
+   "Replace the arrays held by a handle with those of a file written by save (h, filename[, mmap])->None. \nh: handle.\nfilename: file name.\nmmap: 1 to map the file in memory (copy on write) and use its arrays in place, without reading them, 0 (default) to read them."},
+  {"get_image_size", triangulate_GET_IMAGE_SIZE, METH_VARARGS, 
+   "Return the size in bytes of the binary image of a handle, as written by save or dumps (h)->int. \nh: handle."},
+  {"dumps", triangulate_DUMPS, METH_VARARGS, 
+   "Return the binary image of a handle, as written by save, or write it to a buffer (h[, buffer])->bytes or int. \nh: handle.\nbuffer: writable buffer of at least get_image_size(h) bytes (e.g. the buf of a multiprocessing.shared_memory.SharedMemory), then the number of bytes written is returned."},
+  {"loads", triangulate_LOADS, METH_VARARGS, 
+   "Replace the arrays held by a handle with those of a binary image written by save or dumps (h, buffer[, owner])->None. \nh: handle.\nbuffer: object supporting the buffer protocol (bytes, memoryview, mmap,...).\nowner: if given and not None, the arrays are used in place, without copy, the buffer and owner being kept by the handle until its arrays are freed (e.g. the buf of a SharedMemory and the SharedMemory), otherwise they are copied."},
+  {"set_points", triangulate_SET_POINTS, METH_VARARGS, 
+   "Set points and markers (h, [(x1,y1),(x2,y2)..], [m1,m2..])->None. \nh: handle.\n[(x1,y1),(x2,y2)..]: coordinates.\n[m1,m2,..]: point markers (1 per point).\nThe arrays of h are only allocated again when they are too small."},
+  {"set_point_attributes", triangulate_SET_POINT_ATTRIBUTES, METH_VARARGS, 
+   "Set point attributes (h, [(a1,a2,..),..])->None. \nh: handle.\n[(a1,a2,..),..]: atributes (a1,a2,..)."},
+  {"set_triangles", triangulate_SET_TRIANGLES, METH_VARARGS, 
+   "Set triangles (h, [(i,j,k),..])->None. \nh: handle.\n[(i,j,k),..]: corners, 3 or 6 per triangle, numbered like the points (e.g. to write them with write_ele or refine them with the r switch)."},
+  {"set_triangle_attributes", triangulate_SET_TRIANGLE_ATTRIBUTES, METH_VARARGS, 
+   "Set triangle attributes (h, [(a1,a2,..),..])->None. \nh: handle.\n[(a1,a2,..),..]: atributes (a1,a2,..)."},
+  {"get_point_attributes", triangulate_GET_POINT_ATTRIBUTES, METH_VARARGS, 
+   "Get point attributes (h[, level])->[(a1,a2,..),..]. \nh: handle.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest."},
+  {"get_triangle_attributes", triangulate_GET_TRIANGLE_ATTRIBUTES, METH_VARARGS, 
+   "Get triangle attributes (h[, level])->[(a1,a2,..),..]. \nh: handle.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest."},
+  {"set_segments", triangulate_SET_SEGMENTS, METH_VARARGS, 
+   "Set segments (h, [(i,j),..])->None. \nh: handle.\n[(i,j),..]: segments."},
+  {"set_holes", triangulate_SET_HOLES, METH_VARARGS, 
+   "Set holes (h, [(x1,y1),(x2,y2),..])->None. \nh: handle.\n[(x1,y1),(x2,y2),..]: hole coordinates."},
+  {"set_regions", triangulate_SET_REGIONS, METH_VARARGS, 
+   "Set regions (h, [(x1,y1,r1,a1),(x2,y2,r2,a2),..])->None. \nh: handle.\n[(x1,y1,r1,a1),(x2,y2,r2,a2),..]: region tag coordinates, id and area constraint."},
+  {"set_marker_areas", triangulate_SET_MARKER_AREAS, METH_VARARGS, 
+   "Set area constraints keyed by segment marker (h, [(m1,a1),(m2,a2),..])->None. \nh: handle.\n[(m1,a1),(m2,a2),..]: segment marker and max area of the regions it bounds (used with the R and a switches)."},
+  {"triangulate", triangulate_TRIANGULATE, METH_VARARGS, 
+   "Triangulate or refine an existing triangulation (switches, h_in, h_out, h_vor[, reuse[, recycle]])->None.\nswitches: a string (see Triangle doc). With K, the mesh is kept in h_out and the edges (e) and neighbors (n) are only computed by the first get_edges, get_triangles or save.\nh_in, h_out, h_vor: handles to the input, output and Voronoi triangulateio structs.\nreuse: if not 0 and no point is added (e.g. no q, a, s, D or u switch), h_out takes the points, attributes and markers of h_in over instead of copying them, h_in is left without points; otherwise h_in is untouched.\nrecycle: if not 0, the arrays that h_out holds from a previous call are written again in place, and only allocated again (a quarter larger) when they are too small; otherwise they are freed first."},
+  {"triangulate_many", triangulate_TRIANGULATE_MANY, METH_VARARGS, 
+   "Triangulate many small independent inputs with the same switches (switches, xy, offsets[, segments, seg_offsets[, holes, hole_offsets]])->(xy, point_offsets, triangles, triangle_offsets).\nswitches: a string (see Triangle doc); only the points and the triangles are computed.\nxy: flat array (array module, numpy,..) of the coordinates x0, y0, x1, y1,.. of all the inputs; input i has the points offsets[i] to offsets[i+1] (excluded), at least 3.\nsegments, seg_offsets: optional segments i0, j0, i1, j1,.. and the offsets of the segments of each input; the points are numbered within the input, from 0 with the z switch, 1 otherwise.\nholes, hole_offsets: optional holes x0, y0,.. and their offsets.\nReturn the points (doubles) and the triangles of the outputs in the same form, the triangle corners numbered within the output like the segments. The inputs are triangulated by several threads in the OpenMP build."},
+  {"gather_points", triangulate_GATHER_POINTS, METH_VARARGS, 
+   "Gather points by number (xy, ids)->xy. \nxy: flat array (array module, numpy,..) of the coordinates x0, y0, x1, y1,..\nids: numbers of the points to gather, from 0.\nReturn the coordinates of the points ids[0], ids[1],.. (doubles)."},
+  {"stitch_tiles", triangulate_STITCH_TILES, METH_VARARGS, 
+   "Number the points of the meshes of tiles globally (shared, ids, id_offsets, xy, point_offsets, triangles, triangle_offsets)->(xy, triangles). \nshared: coordinates x0, y0, x1, y1,.. of the points shared by the tiles.\nids, id_offsets: global numbers (from 0) of the first points of each tile, in compressed sparse row form.\nxy, point_offsets, triangles, triangle_offsets: meshes of the tiles, as returned by triangulate_many with the z switch.\nReturn the shared points followed by the other points of the tiles, tile by tile, and the corners of all the triangles numbered globally."},
+  {"stream_points", triangulate_STREAM_POINTS, METH_VARARGS, 
+   "Append a chunk of points to an input handle, straight to the vertices of the next triangulation (h, xy[, markers[, attributes[, size_hint[, origin]]]])->int. \nh: handle.\nxy: flat array (array module, numpy,..) or sequence of the coordinates x0, y0, x1, y1,..\nmarkers: optional point markers (1 per point, 0 by default).\nattributes: optional point attributes a00, a01,.., a10,..; the first chunk sets their number per point.\nsize_hint: expected total number of points, reserved by the first chunk.\norigin: (x, y) subtracted from the coordinates.\nReturn the number of points appended so far. The points of the handle (set_points) are ignored by the next triangulate, which takes the appended points over: they are triangulated once and not kept in h."},
+  {"finalize_front", triangulate_FINALIZE_FRONT, METH_VARARGS, 
+   "One step of triangle.stream_delaunay: split the Delaunay triangles of the active points into triangles behind the front, final triangles and others (h, xy, ids, front, grid, final)->(triangles, xy, ids, front). \nh: output handle of a triangulation of the active points with the n switch.\nxy: coordinates of the active points x0, y0, x1, y1,..\nids: their global numbers.\nfront: pairs of local point numbers a0, b0, a1, b1,.. of the front edges, the triangles written before being on the left of a->b.\ngrid: (x0, y0, dx, dy, nx, ny) of the cells.\nfinal: nx*ny flags of the finalized cells (row by row), no point comes into them any more.\nReturn the final triangles (global numbers, array of type 'q') and the xy, ids and front of the next step."},
+  {"read_node", triangulate_READ_NODE, METH_VARARGS, 
+   "Replace the points of a handle with those of a .node file of Triangle (h, filename)->int. \nh: handle.\nfilename: file name.\nReturn the number of the first vertex, 0 or 1 (then triangulate without the z switch). The markers are zero if the file has none."},
+  {"read_ele", triangulate_READ_ELE, METH_VARARGS, 
+   "Replace the triangles of a handle with those of a .ele file of Triangle, e.g. to refine them (r switch) (h, filename)->None. \nh: handle.\nfilename: file name. The corners are numbered as in the file."},
+  {"read_poly", triangulate_READ_POLY, METH_VARARGS, 
+   "Replace the segments, holes and regions of a handle, and the points unless they are in a .node file, with those of a .poly file of Triangle (h, filename)->int or None. \nh: handle.\nfilename: file name.\nReturn the number of the first vertex, or None if the file has no vertices (see read_node). The segments are numbered as in the file."},
+  {"write_node", triangulate_WRITE_NODE, METH_VARARGS, 
+   "Write the points of a handle to a .node file of Triangle (h, filename[, firstnumber])->None. \nh: handle.\nfilename: file name.\nfirstnumber: number of the first vertex, 1 (default) or 0 for a handle triangulated with the z switch."},
+  {"write_ele", triangulate_WRITE_ELE, METH_VARARGS, 
+   "Write the triangles of a handle to a .ele file of Triangle (h, filename[, firstnumber])->None. \nh: handle.\nfilename: file name.\nfirstnumber: number of the first triangle, 1 (default) or 0 with the z switch; the corners are written as they are numbered in the handle."},
+  {"write_poly", triangulate_WRITE_POLY, METH_VARARGS, 
+   "Write the segments, holes and regions of a handle, and its points, to a .poly file of Triangle (h, filename[, firstnumber[, points]])->None. \nh: handle.\nfilename: file name.\nfirstnumber: number of the first vertex, 1 (default) or 0 with the z switch.\npoints: 1 (default) to write the points in the file, 0 to leave them to a .node file."},
+  {"get_num_points", triangulate_GET_NUM_POINTS, METH_VARARGS, 
+   "Return number of points (h[, level])->n.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest."},
+  {"get_num_triangles", triangulate_GET_NUM_TRIANGLES, METH_VARARGS, 
+   "Return number of triangles (h[, level])->n.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest."},
+  {"get_num_levels", triangulate_GET_NUM_LEVELS, METH_VARARGS, 
+   "Return number of refinement levels (h)->n, including the finest one (L switch)."},
+  {"get_stats", triangulate_GET_STATS, METH_VARARGS, 
+   "Return the timings (ms) and counters of the triangulation that produced a handle (h)->{name: value}, or None."},
+  {"get_quality", triangulate_GET_QUALITY, METH_VARARGS, 
+   "Return the quality of each triangle and a summary (h[, level[, firstnumber]])->(min_angles, aspect_ratios, areas, {name: value}).\nh: handle.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest.\nfirstnumber: number of the first point, 0 with the z switch, 1 otherwise; by default the numbering the handle was triangulated, read or loaded with, else found from the corners.\nmin_angles, aspect_ratios, areas: arrays (array module) of the smallest angle in degrees, the longest edge over the shortest altitude and the area of each triangle.\n{name: value}: extremes, plus histograms of the angles (10 degree bins) and of the aspect ratios (bins up to 1.5, 2, 2.5, 3, 4, 6, 10, 15, 25, 50, 100, 300, 1000, 10000, 100000, and beyond)."},
+  {"get_voronoi_cells", triangulate_GET_VORONOI_CELLS, METH_VARARGS, 
+   "Return the Voronoi cell of each point in compressed sparse row form (h[, level[, firstnumber[, clip[, origin]]]])->(xy, offsets, cells).\nh: handle.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest.\nfirstnumber: number of the first point, 0 with the z switch, 1 otherwise; by default the numbering the handle was triangulated, read or loaded with, else found from the corners.\nclip: if not 0, close the cells of the boundary points and clip every cell to the bounding box of the points.\norigin: (x, y) added to the coordinates, which are then doubles.\nxy: array (array module) of the coordinates of the cell vertices x0, y0, x1, y1,..., the circumcenters of the triangles first.\noffsets, cells: arrays, the cell of point i lists the indices cells[offsets[i]:offsets[i+1]] of its vertices, counterclockwise; without clip, the open cells of the boundary points start with -1."},
+  {"get_points", triangulate_GET_POINTS, METH_VARARGS, 
+   "Return dict from handle (h[, level[, count]])->{i: [(x,y),[i1,i2,..], m],..}.\nh: handle.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest.\ncount: optional number of the first points to return, all of them if negative (default).\n(x,y): point coordinates.\n[i1,i2..]: neighboring point indices.\nm: point marker (0=interior, 1=boundary)."},
+  {"get_edges", triangulate_GET_EDGES, METH_VARARGS, 
+   "Return list of edge points with edge markers (h)->[((i1,i2),m),..].\nh: handle.\n(i1,i2): point indices.\nm: edge markers."},
+  {"get_mesh_arrays", triangulate_GET_MESH_ARRAYS, METH_VARARGS, 
+   "Return the points and the triangles as flat arrays (h[, level[, firstnumber[, origin]]])->(xy, corners).\nh: handle.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest.\nfirstnumber: number of the first point, 0 with the z switch, 1 otherwise; by default the numbering the handle was triangulated, read or loaded with, else found from the corners.\norigin: (x, y) added to the coordinates, which are then doubles.\nxy: array (array module) of the point coordinates x0, y0, x1, y1,...\ncorners: array of the point indices at the 3 corners of each triangle, numbered from 0."},
+  {"get_triangles", triangulate_GET_TRIANGLES, METH_VARARGS, 
+   "Return list of triangles (h[, level])->[([i1,i2,i3,..],(k1,k2,k3), [a1,a2,..]),..].\nh: handle.\nlevel: optional refinement level (L switch), 0 is the coarsest, -1 (default) the finest.\ni1,i2,i3,..: point indices at the triangle corners, optionally followed by intermediate points.\n(k1,k2,k3) and neighboring triangle indices;\na1,a2..: triangle cell attributes."},
+  {NULL, NULL, 0, NULL}
+};
+
+struct triangulate_state {
+  PyObject *object;
+};
+
+#if PY_MAJOR_VERSION >= 3
+static struct PyModuleDef triangulateio_moduledef = {
+        PyModuleDef_HEAD_INIT,
+        "triangulate",
+        NULL,
+        sizeof(struct triangulate_state),
+        triangulate_methods,
+        NULL,
+        NULL,
+        NULL,
+        NULL
+};
+
+PyMODINIT_FUNC
+PyInit_triangulate(void)
+#else
+void 
+inittriangulate() 
+#endif
+{
+
+
+#if PY_MAJOR_VERSION >= 3
+    PyObject *module = PyModule_Create(&triangulateio_moduledef);
+    if(module) {
+      PyModule_AddIntConstant(module, "real_size", (long) sizeof(REAL));
+    }
     return module;
 #else
-    Py_InitModule("triangulate", triangulate_methods);
+    PyObject *module = Py_InitModule("triangulate", triangulate_methods);
+    PyModule_AddIntConstant(module, "real_size", (long) sizeof(REAL));
 #endif
 }
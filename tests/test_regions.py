@@ -44,3 +44,29 @@ print(t.get_triangles())
 # note that to have edges in "t" we need to use the "e" switch in
 # triangulate! 
 print(t.get_edges())
+
+# regions can also be numbered without region points using the 'R' switch:
+# every set of triangles enclosed by segments gets its own id (1, 2, ...).
+# With 'a' (no number), the area constraint of each region can be looked up
+# from the markers of its bounding segments; the smallest area wins.
+
+t2 = triangle.Triangle()
+t2.set_points(points)
+t2.set_segments(segs, segTags)
+t2.set_marker_areas([(5, 0.1), (7, 0.02)])
+t2.triangulate(mode='pzqRaeQ')
+
+pts = t2.get_points()
+ids = set()
+for p, k, a in t2.get_triangles():
+    ids.add(a[0])
+    (x0, y0), (x1, y1), (x2, y2) = [pts[i][0] for i in p[:3]]
+    area = 0.5*abs((x1 - x0)*(y2 - y0) - (x2 - x0)*(y1 - y0))
+    xc = (x0 + x1 + x2)/3.
+    if xc < 0:
+        # left region is bounded by markers 5 and 4
+        assert area <= 0.1 + 1.e-10
+    else:
+        # right region is bounded by markers 5 and 7
+        assert area <= 0.02 + 1.e-10
+assert ids == {1.0, 2.0}
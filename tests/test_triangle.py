@@ -6,7 +6,11 @@ sys.path.insert(0, os.getcwd())
 
 import math
 import triangle
+import triangulate
 import numpy
+
+# the tolerances are scaled up for the float build (TRIANGLE_SINGLE=1)
+TOL = 1. if triangulate.real_size == 8 else 1.e5
     
 def xtest_bad():
     
@@ -138,11 +142,1079 @@ def test_circle_with_hole():
         error += (point_attributes[i][0] - x)**2 + (point_attributes[i][1] - y)**2
     error = math.sqrt(error/float(len(pts)))
     print('error = %g' % error)
-    assert(abs(error) < 1.e-10)
+    assert(abs(error) < 1.e-10*TOL)
 
   
+def test_holes_and_regions():
+
+    # a grid of squares, every one a hole, a region of its own or left without a region point,
+    # the squares being seeded in the order of the grid, far from the order of the mesh
+    n = 8
+    pts = [(0., 0.), (n, 0.), (n, n), (0., n)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0)]
+    hls, regions, kind = [], [(0.1, 0.1, 1., 0.05)], {}
+    for i in range(n):
+        for j in range(n):
+            k = len(pts)
+            pts += [(i + 0.2, j + 0.2), (i + 0.8, j + 0.2), (i + 0.8, j + 0.8), (i + 0.2, j + 0.8)]
+            seg += [(k, k + 1), (k + 1, k + 2), (k + 2, k + 3), (k + 3, k)]
+            kind[i, j] = (i*n + j) % 3
+            if kind[i, j] == 0:
+                hls += [(i + 0.25, j + 0.25), (i + 0.75, j + 0.75)]
+            elif kind[i, j] == 1:
+                regions.append((i + 0.3, j + 0.7, 10. + i*n + j, 0.002))
+    t = triangle.Triangle()
+    t.set_points(pts, [1 for p in pts])
+    t.set_segments(seg)
+    t.set_holes(hls)
+    t.set_regions(regions)
+    t.triangulate(mode='pzq30AaQ')
+
+    # the triangles are where the seeds located one by one would have put them
+    points = [p[0] for p in t.get_points()]
+    total = 0.
+    for corners, neighbors, attributes in t.get_triangles():
+        (x0, y0), (x1, y1), (x2, y2) = [points[c] for c in corners[:3]]
+        area = 0.5*((x1 - x0)*(y2 - y0) - (x2 - x0)*(y1 - y0))
+        total += area
+        xc, yc = (x0 + x1 + x2)/3., (y0 + y1 + y2)/3.
+        i, j = int(xc), int(yc)
+        inside = 0.2 < xc - i < 0.8 and 0.2 < yc - j < 0.8
+        assert(not (inside and kind[i, j] == 0))
+        if inside and kind[i, j] == 1:
+            assert(attributes[0] == 10. + i*n + j and area <= 0.002*(1. + 1.e-5))
+        elif inside:
+            # enclosed, but no seed
+            assert(attributes[0] == 0.)
+        else:
+            assert(attributes[0] == 1. and area <= 0.05*(1. + 1.e-5))
+    nholes = len([k for k in kind.values() if k == 0])
+    assert(abs(total - n*n + 0.36*nholes) < 1.e-5*n*n)
+    print('holes and regions: %d triangles' % t.get_num_triangles())
+
+
+def test_levels():
+
+    # a square with a square hole, refined through 3 more levels on one mesh
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.),
+           (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+    t = triangle.Triangle()
+    t.set_points(pts, [1, 1, 1, 1, 0, 0, 0, 0])
+    t.set_segments(seg)
+    t.set_holes([(0.5, 0.5)])
+    t.triangulate(area=0.05, mode='pzq27eQ', levels=3)
+
+    points = t.get_points(level=-1)
+    for level in range(1, 5):
+        n = t.get_num_points(level)
+        # the points of a coarser level come first
+        assert(t.get_points(level) == points[:n])
+        area = 0.
+        for ijk, k, a in t.get_triangles(level):
+            assert(max(ijk) < n)
+            (x0, y0), (x1, y1), (x2, y2) = [points[i][0] for i in ijk]
+            a = 0.5*((x1 - x0)*(y2 - y0) - (x2 - x0)*(y1 - y0))
+            assert(0. < a <= 0.05/2**(level - 1))
+            area += a
+        assert(abs(area - 0.96) < 1.e-10*TOL)
+        print('level %d number of points/triangles: %d/%d' % \
+              (level, n, t.get_num_triangles(level)))
+
+    # keep on refining from the finest level
+    t.refine(2.0)
+    assert(t.get_num_points() > t.get_num_points(4))
+
+    # triangulate again, once and twice, with the points set again
+    u = triangle.Triangle()
+    u.set_points(pts, [1, 1, 1, 1, 0, 0, 0, 0])
+    u.set_segments(seg)
+    u.set_holes([(0.5, 0.5)])
+    u.triangulate(area=0.01, mode='pzq27eQ')
+    for i in range(2):
+        t.set_points(pts, [1, 1, 1, 1, 0, 0, 0, 0])
+        t.triangulate(area=0.01, mode='pzq27eQ')
+        assert(len(t.hndls) == 2)
+        assert(t.get_points() == u.get_points() and t.get_triangles() == u.get_triangles())
+
+    # many levels, whose lists grow geometrically
+    t.triangulate(area=0.05, mode='pzq27eQ', levels=9)
+    points = t.get_points()
+    for level in range(1, 11):
+        n = t.get_num_points(level)
+        assert(t.get_points(level) == points[:n])
+        assert(max([max(ijk) for ijk, k, a in t.get_triangles(level)]) < n)
+
+
+def test_history():
+
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0)]
+
+    # reference: full history
+    ref = triangle.Triangle()
+    ref.set_points(pts, [1, 1, 1, 1])
+    ref.set_segments(seg)
+    ref.triangulate(area=0.05, mode='pzq27eQ')
+    for i in range(4):
+        ref.refine(2.0)
+
+    for policy in ('drop', 'spill'):
+        t = triangle.Triangle()
+        t.set_points(pts, [1, 1, 1, 1])
+        t.set_segments(seg)
+        t.set_history(keep=2, policy=policy)
+        t.triangulate(area=0.05, mode='pzq27eQ')
+        for i in range(4):
+            t.refine(2.0)
+        for level in range(1, 6):
+            assert(t.get_num_points(level) == ref.get_num_points(level))
+            assert(t.get_num_triangles(level) == ref.get_num_triangles(level))
+            assert(t.get_points(level) == ref.get_points(level))
+        for level in (1, 2, 3):
+            if policy == 'drop':
+                assert(t.get_triangles(level) == [])
+            else:
+                assert(t.get_triangles(level) == ref.get_triangles(level))
+        for level in (4, 5):
+            assert(t.get_triangles(level) == ref.get_triangles(level))
+
+    # explicit drop, of a level kept in the handle of the finest one (L switch)
+    u = triangle.Triangle()
+    u.set_points(pts, [1, 1, 1, 1])
+    u.set_segments(seg)
+    u.triangulate(area=0.05, mode='pzq27eQ', levels=3)
+    h = u.hndls[-1]
+    before = [u.get_triangles(level) for level in range(1, 5)]
+    size = len(triangulate.dumps(h))
+    u.drop_level(2)
+    assert(len(triangulate.dumps(h)) < size)
+    assert(u.get_triangles(2) == [] and u.get_num_triangles(2) == len(before[1]))
+    for level in (1, 3, 4):
+        assert(u.get_triangles(level) == before[level - 1])
+    assert(u.get_points(2) == u.get_points(-1)[:u.get_num_points(2)])
+
+    ref.drop_level(2)
+    assert(ref.get_num_triangles(2) > 0 and ref.get_triangles(2) == [])
+    ref.drop_level(-1)
+    assert(ref.get_triangles(-1) != [])
+
+
+def _export(case):
+
+    # a mesh large enough to fill many pool blocks, and its output arrays
+    import random
+    random.seed(1)
+    h_in, h_out, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+    if case == 'holes':
+        # squares carved out everywhere leave dead triangles in every block
+        n = 12
+        pts = [(0., 0.), (n, 0.), (n, n), (0., n)]
+        seg = [(0, 1), (1, 2), (2, 3), (3, 0)]
+        for i in range(n):
+            for j in range(n):
+                k = len(pts)
+                pts += [(i + 0.3, j + 0.3), (i + 0.7, j + 0.3), (i + 0.7, j + 0.7), (i + 0.3, j + 0.7)]
+                seg += [(k, k + 1), (k + 1, k + 2), (k + 2, k + 3), (k + 3, k)]
+        triangulate.set_points(h_in, pts, [1 for p in pts])
+        triangulate.set_segments(h_in, seg, [2 for s in seg])
+        triangulate.set_holes(h_in, [(i + 0.5, j + 0.5) for i in range(n) for j in range(n)])
+        mode = 'pzq30a0.01enQ'
+    else:
+        pts = [(random.random(), random.random()) for i in range(10000)]
+        triangulate.set_points(h_in, pts, [0 for p in pts])
+        mode = {'en': 'zenQ', 'o2': 'zo2enQ'}[case]
+    triangulate.triangulate(mode, h_in, h_out, h_vor)
+    return triangulate.get_triangles(h_out), triangulate.get_edges(h_out)
+
+
+def test_parallel_export():
+
+    # the blocks written by several threads (OpenMP build) number the triangles, neighbors
+    # and edges as one thread does
+    import subprocess
+    here = os.path.dirname(os.path.abspath(__file__))
+    for case in ('en', 'o2', 'holes'):
+        res = []
+        for nthreads in (1, 4):
+            env = dict(os.environ, OMP_NUM_THREADS=str(nthreads))
+            env['PYTHONPATH'] = os.pathsep.join([os.getcwd(), here, env.get('PYTHONPATH', '')])
+            res.append(subprocess.check_output([sys.executable, '-c',
+                'import test_triangle; tris, edges = test_triangle._export(%r); print(tris); print(edges)' % case],
+                env=env))
+        assert(res[0] == res[1])
+
+        # and the arrays agree with each other: neighbors across a shared side, every side an edge
+        tris, edges = _export(case)
+        # (in this process the edges may be written from the other side, the memory laid out anew)
+        assert(repr(tris).encode() == res[0].split(b'\n')[0])
+        sides = set()
+        for i, (corners, neighbors, attributes) in enumerate(tris):
+            assert(len(corners) == (6 if case == 'o2' else 3))
+            for k in range(3):
+                sides.add(tuple(sorted((corners[(k + 1) % 3], corners[(k + 2) % 3]))))
+                if neighbors[k] >= 0:
+                    assert(i in tris[neighbors[k]][1])
+        assert(sorted([tuple(sorted(e)) for e, m in edges]) == sorted(sides))
+        assert(len(tris) > 3*4092)
+    print('parallel export: %d triangles' % len(tris))
+
+
+def test_stats():
+
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.),
+           (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+    t = triangle.Triangle()
+    t.set_points(pts, [1, 1, 1, 1, 0, 0, 0, 0])
+    t.set_segments(seg)
+    t.set_holes([(0.5, 0.5)])
+    t.triangulate(area=0.01, mode='pzq30eQ')
+
+    stats = t.get_stats()
+    phases = ('transfer_ms', 'delaunay_ms', 'segments_ms', 'holes_ms',
+              'quality_ms', 'output_ms')
+    for name in phases:
+        assert(stats[name] >= 0.)
+    assert(abs(sum([stats[name] for name in phases]) - stats['total_ms']) < 1.e-6)
+    assert(stats['incircle_tests'] > 0 and stats['orient2d_tests'] > 0)
+    assert(stats['input_vertices'] == len(pts))
+    assert(stats['steiner_points'] == t.get_num_points() - len(pts))
+    assert(stats['steiner_points'] <= stats['segment_steiners'] + stats['triangle_steiners'])
+    assert(stats['max_triangles'] >= t.get_num_triangles())
+    print('stats: %s' % stats)
+
+
+def test_quality():
+
+    import math
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.),
+           (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+    t = triangle.Triangle()
+    t.set_points(pts, [1, 1, 1, 1, 0, 0, 0, 0])
+    t.set_segments(seg)
+    t.set_holes([(0.5, 0.5)])
+    t.triangulate(area=0.01, mode='pzq30eQ')
+
+    angles, aspects, areas, summary = t.get_quality()
+    xy = [p[0] for p in t.get_points()]
+    tris = [c[0] for c in t.get_triangles()]
+    assert(len(angles) == len(aspects) == len(areas) == len(tris))
+    for i, c in enumerate(tris):
+        p = [xy[j] for j in c[:3]]
+        cross = (p[1][0] - p[0][0])*(p[2][1] - p[0][1]) - (p[1][1] - p[0][1])*(p[2][0] - p[0][0])
+        longest2 = max([(p[j][0] - p[j-1][0])**2 + (p[j][1] - p[j-1][1])**2 for j in range(3)])
+        smallest = min([math.degrees(math.atan2(abs(cross),
+                                                (p[j-1][0] - p[j][0])*(p[j-2][0] - p[j][0]) +
+                                                (p[j-1][1] - p[j][1])*(p[j-2][1] - p[j][1])))
+                        for j in range(3)])
+        assert(abs(areas[i] - 0.5*cross) < 1.e-12*TOL)
+        assert(abs(aspects[i] - longest2/abs(cross)) < 1.e-9*TOL*aspects[i])
+        assert(abs(angles[i] - smallest) < 1.e-9*TOL)
+    assert(abs(sum(areas) - 1. + 0.04) < 1.e-12*TOL)
+    assert(min(angles) >= 30. and summary['min_angle'] == min(angles))
+    assert(summary['max_area'] <= 0.01 and summary['max_aspect'] == max(aspects))
+    assert(sum(summary['angle_histogram']) == 3*len(tris))
+    assert(sum(summary['aspect_histogram']) == len(tris))
+
+    # without the z switch, the corners are numbered from 1: found by default, a wrong firstnumber is refused
+    h_in, h, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+    triangulate.set_points(h_in, [(0., 0.), (1., 0.), (0., 1.)], [1, 1, 1])
+    triangulate.triangulate('Q', h_in, h, h_vor)
+    assert(triangulate.get_quality(h)[0] == triangulate.get_quality(h, -1, 1)[0])
+    try:
+        triangulate.get_quality(h, -1, 0)
+        assert(False)
+    except ValueError:
+        pass
+
+    # the numbering is the handle's, even when the last point is a duplicate, left out of the triangles
+    triangulate.set_points(h_in, [(0., 0.), (1., 0.), (0., 1.), (1., 1.), (0., 1.)], [1, 1, 1, 1, 1])
+    triangulate.triangulate('Q', h_in, h, h_vor)
+    assert(max([max(c) for c, n, a in triangulate.get_triangles(h)]) == 4)
+    assert(triangulate.get_quality(h)[2] == triangulate.get_quality(h, -1, 1)[2])
+    print('quality: %s' % summary)
+
+
+def test_offcenters():
+
+    import random
+    rnd = random.Random(3)
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.)] + [(rnd.random(), rnd.random()) for i in range(300)]
+    points = {}
+    for placement in ('', 'U0', 'U1', 'U2', 'U'):
+        t = triangle.Triangle()
+        t.set_points(pts, [1, 1, 1, 1] + [0 for p in pts[4:]])
+        t.set_segments([(0, 1), (1, 2), (2, 3), (3, 0)])
+        t.triangulate(mode='pzq33%sQ' % placement)
+        assert(t.get_quality()[3]['min_angle'] >= 33.)
+        points[placement] = t.get_points()
+    # U1 is the default, a bare U is U2, and off-centers need far fewer points than circumcenters
+    assert(points[''] == points['U1'] and points['U'] == points['U2'])
+    assert(2*len(points['U1']) < len(points['U0']) and 2*len(points['U2']) < len(points['U0']))
+
+
+def test_translate():
+
+    # a square with a hole, in UTM like coordinates
+    x0, y0 = 512345.678, 5123456.789
+    pts = [(x0 + x, y0 + y) for x, y in [(0., 0.), (100., 0.), (100., 100.), (0., 100.),
+                                         (40., 40.), (60., 40.), (60., 60.), (40., 60.)]]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+    res = {}
+    for mode in ('pzq30veQ', 'pzq30veQT'):
+        t = triangle.Triangle()
+        t.set_points(pts, [1, 1, 1, 1, 0, 0, 0, 0])
+        t.set_segments(seg)
+        t.set_holes([(x0 + 50., y0 + 50.)])
+        t.triangulate(area=20., mode=mode)
+        points = [p[0] for p in t.get_points()]
+        if triangulate.real_size == 8:
+            # the input vertices come back bit for bit
+            assert(points[:len(pts)] == pts)
+        for x, y in points:
+            assert(x0 <= x <= x0 + 100. and y0 <= y <= y0 + 100.)
+            assert(not (x0 + 40. < x < x0 + 60. and y0 + 40. < y < y0 + 60.))
+        angles, aspects, areas, summary = t.get_quality()
+        assert(summary['min_angle'] >= 30.*(1. - 1.e-6) and summary['max_area'] <= 20.*(1. + 1.e-6))
+        assert(abs(sum(areas) - 100.**2 + 20.**2) < 1.e-6*TOL)
+        stats = t.get_stats()
+        res[mode] = (t.get_num_points(), stats['incircle_adapt'], stats['orient2d_adapt'])
+    print('translate: %s' % res)
+
+
+def test_keep_mesh():
+
+    # the K switch defers the edges and the neighbors to their first access
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.), (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+    res = {}
+    for mode in ('pzq30a0.001enQ', 'pzq30a0.001enQK'):
+        h_in, h_out, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+        triangulate.set_points(h_in, pts, [1, 1, 1, 1, 0, 0, 0, 0])
+        triangulate.set_segments(h_in, seg, [1, 1, 1, 1, 2, 2, 2, 2])
+        triangulate.set_holes(h_in, [(0.5, 0.5)])
+        triangulate.triangulate(mode, h_in, h_out, h_vor)
+        # the edges may be written from either side, depending on the memory layout
+        edges = sorted([(tuple(sorted(e)), m) for e, m in triangulate.get_edges(h_out)])
+        res[mode] = (triangulate.get_triangles(h_out), edges, triangulate.get_points(h_out))
+        triangulate.release(h_out)
+        assert(triangulate.get_triangles(h_out) == res[mode][0])
+    assert(res['pzq30a0.001enQ'] == res['pzq30a0.001enQK'])
+    assert(set([m for e, m in res['pzq30a0.001enQK'][1]]) == set([0, 1, 2]))
+
+    # the first access writes every deferred output and frees the mesh; without e or n, none is kept
+    for mode in ('pzq30a0.001enQK', 'pzq30a0.001QK'):
+        h_in, h_out, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+        triangulate.set_points(h_in, pts, [1, 1, 1, 1, 0, 0, 0, 0])
+        triangulate.set_segments(h_in, seg, [1, 1, 1, 1, 2, 2, 2, 2])
+        triangulate.set_holes(h_in, [(0.5, 0.5)])
+        triangulate.triangulate(mode, h_in, h_out, h_vor)
+        assert(triangulate.get_triangles(h_out)[0][1] == (res['pzq30a0.001enQ'][0][0][1] if 'n' in mode else ()))
+        edges = sorted([(tuple(sorted(e)), m) for e, m in triangulate.get_edges(h_out)])
+        assert(edges == (res['pzq30a0.001enQ'][1] if 'e' in mode else []))
+
+    # the mesh is only kept on request (lazy), and refine then keeps the mesh of the last level only
+    res = []
+    for lazy in (False, True):
+        t = triangle.Triangle()
+        t.set_points(pts, [1, 1, 1, 1, 0, 0, 0, 0])
+        t.set_segments(seg)
+        t.set_holes([(0.5, 0.5)])
+        t.triangulate(area=0.01, mode='pzq30enQ', lazy=lazy)
+        t.refine()
+        t.refine()
+        for level in (1, 2, 3):
+            tris = t.get_triangles(level)
+            nhull = len([k for tri in tris for k in tri[1] if k < 0])
+            assert(len(t.get_edges(level)) == (3*len(tris) + nhull)//2)
+        res.append([(t.get_triangles(level), sorted([tuple(sorted(e)) for e, m in t.get_edges(level)]))
+                    for level in (1, 2, 3)])
+    assert(res[0] == res[1])
+    print('keep mesh: %d triangles' % t.get_num_triangles())
+
+
+def test_mesh_arrays():
+
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.), (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+    for mode in ('pq30Q', 'pzq30o2Q'):
+        t = triangle.Triangle()
+        t.set_points(pts, [1, 1, 1, 1, 0, 0, 0, 0])
+        t.set_segments(seg)
+        t.set_holes([(0.5, 0.5)])
+        t.triangulate(area=0.01, mode=mode, levels=1)
+        for level in (1, 2):
+            xy, corners = t.get_mesh_arrays(level)
+            points = t.get_points(level)
+            assert(len(xy) == 2*len(points))
+            assert([p[0] for p in points] == [(xy[2*i], xy[2*i + 1]) for i in range(len(points))])
+            first = 0 if mode.find('z') >= 0 else 1
+            tris = [[k - first for k in tri[0][:3]] for tri in t.get_triangles(level)]
+            assert(tris == [list(corners[3*i:3*i + 3]) for i in range(len(tris))])
+            # the numbering is the handle's, a wrong one is refused
+            h, k = t._handle(level)
+            assert(triangulate.get_mesh_arrays(h, k)[1] == corners)
+            try:
+                triangulate.get_mesh_arrays(h, k, 1 - first)
+                assert(len(corners) == 0)
+            except ValueError:
+                pass
+            # the coordinates moved by an origin, as doubles
+            raw = triangulate.get_mesh_arrays(h, k)[0]
+            moved, same = triangulate.get_mesh_arrays(h, k, -1, (10., -20.))
+            assert(same == corners and moved.typecode == 'd')
+            assert(list(moved) == [v + (10. if i % 2 == 0 else -20.) for i, v in enumerate(raw)])
+
+
+def test_voronoi_cells():
+
+    # the clipped cells tile the bounding box of the points
+    rng = numpy.random.RandomState(3)
+    pts = [(x, 2*y) for x, y in rng.random_sample((500, 2))]
+    t = triangle.Triangle()
+    t.set_points(pts, [0 for p in pts])
+    t.triangulate(mode='zQ')
+    xmin, ymin = numpy.min(pts, axis=0)
+    xmax, ymax = numpy.max(pts, axis=0)
+    xy, offsets, cells = t.get_voronoi_cells(clip=True)
+    xy = numpy.array(xy).reshape(-1, 2)
+    assert(len(offsets) == len(pts) + 1 and len(xy) >= t.get_num_triangles())
+    total = 0.
+    for i, (x, y) in enumerate(pts):
+        poly = xy[cells[offsets[i]:offsets[i + 1]]]
+        edges = numpy.roll(poly, -1, axis=0) - poly
+        area = 0.5*numpy.sum(poly[:, 0]*edges[:, 1] - poly[:, 1]*edges[:, 0])
+        assert(area > 0.)
+        total += area
+        # convex, counterclockwise, and around its point
+        assert(numpy.all(edges[:, 0]*(y - poly[:, 1]) - edges[:, 1]*(x - poly[:, 0]) >= -1.e-10*TOL))
+    assert(abs(total - (xmax - xmin)*(ymax - ymin)) < 1.e-10*TOL)
+
+    # without clipping, the cells of the hull points are open
+    xy, offsets, cells = t.get_voronoi_cells()
+    assert(len(xy) == 2*t.get_num_triangles())
+    nopen = len([i for i in range(len(pts)) if cells[offsets[i]] == -1])
+    assert(0 < nopen < len(pts) and len(cells) == 3*t.get_num_triangles() + nopen)
+
+    # the numbering is the handle's, a wrong one is refused
+    h, k = t._handle(-1)
+    assert(triangulate.get_voronoi_cells(h, k)[2] == cells)
+    try:
+        triangulate.get_voronoi_cells(h, k, 1)
+        assert(False)
+    except ValueError:
+        pass
+
+    # the vertices moved by an origin, as doubles
+    raw = triangulate.get_voronoi_cells(h, k)[0]
+    moved, same, cells2 = triangulate.get_voronoi_cells(h, k, -1, 0, (10., -20.))
+    assert(same == offsets and cells2 == cells and moved.typecode == 'd')
+    assert(list(moved) == [v + (10. if i % 2 == 0 else -20.) for i, v in enumerate(raw)])
+    print('voronoi cells: %d open' % nopen)
+
+
+def test_triangulate_many():
+
+    # star shaped polygons, and a square with a hole
+    rng = numpy.random.RandomState(5)
+    polys, holes = [], []
+    for i in range(50):
+        n = rng.randint(5, 40)
+        r = 1. + rng.random_sample(n)
+        t = 2*math.pi*numpy.arange(n)/n
+        polys.append([(10.*i + x, y) for x, y in zip(r*numpy.cos(t), r*numpy.sin(t))])
+        holes.append([])
+    polys.append([(0., 0.), (1., 0.), (1., 1.), (0., 1.), (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)])
+    holes.append([(0.5, 0.5)])
+    segs = [[(k, (k + 1) % len(p)) for k in range(len(p))] for p in polys]
+    segs[-1] = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+
+    points = numpy.array([xy for p in polys for xy in p]).ravel()
+    offsets = numpy.cumsum([0] + [len(p) for p in polys])
+    seg_offsets = numpy.cumsum([0] + [len(s) for s in segs])
+    hole_offsets = numpy.cumsum([0] + [len(h) for h in holes])
+    xy, point_offsets, tris, tri_offsets = triangle.triangulate_many(
+        points, offsets, [k for s in segs for e in s for k in e], seg_offsets,
+        mode='pq30a0.05Q', holes=[c for h in holes for xy in h for c in xy], hole_offsets=hole_offsets)
+    assert(len(point_offsets) == len(polys) + 1 and len(tri_offsets) == len(polys) + 1)
+    assert(len(xy) == 2*point_offsets[-1] and len(tris) == 3*tri_offsets[-1])
+
+    # the same as one polygon at a time
+    for i, p in enumerate(polys):
+        t = triangle.Triangle()
+        t.set_points(p, [1 for xy in p])
+        t.set_segments(segs[i])
+        if holes[i]:
+            t.set_holes(holes[i])
+        t.triangulate(area=0.05, mode='pzq30Q')
+        pts = numpy.array(xy[2*point_offsets[i]:2*point_offsets[i + 1]]).reshape(-1, 2)
+        corners = tris[3*tri_offsets[i]:3*tri_offsets[i + 1]]
+        a, b, c = [pts[corners[k::3]] for k in range(3)]
+        area = 0.5*numpy.sum((b - a)[:, 0]*(c - a)[:, 1] - (b - a)[:, 1]*(c - a)[:, 0])
+        ring = numpy.array(p[:len(segs[i]) if not holes[i] else 4])
+        edges = numpy.roll(ring, -1, axis=0) - ring
+        ref = 0.5*numpy.sum(ring[:, 0]*edges[:, 1] - ring[:, 1]*edges[:, 0]) - (0.04 if holes[i] else 0.)
+        assert(abs(area - ref) < 1.e-10*TOL)
+        if triangulate.real_size == 8:
+            # bit for bit
+            pts = xy[2*point_offsets[i]:2*point_offsets[i + 1]]
+            assert(len(pts) == 2*t.get_num_points() and len(corners) == 3*t.get_num_triangles())
+            assert([q[0] for q in t.get_points()] == [(pts[2*k], pts[2*k + 1]) for k in range(len(pts)//2)])
+            assert([tri[0] for tri in t.get_triangles()] == [list(corners[3*k:3*k + 3]) for k in range(len(corners)//3)])
+
+    # every polygon needs 3 points
+    try:
+        triangle.triangulate_many([0., 0., 1., 0., 0., 1., 1., 1., 2., 2.], [0, 3, 5])
+        assert(False)
+    except ValueError:
+        pass
+
+    # and its segments end at its own points
+    square, ring = [0., 0., 1., 0., 1., 1., 0., 1.], [0, 1, 1, 2, 2, 3, 3, 0]
+    for bad in (4, -1, 2.5):
+        try:
+            triangle.triangulate_many(square*2, [0, 4, 8], ring + ring[:-1] + [bad], [0, 4, 8], mode='pQ')
+            assert(False)
+        except ValueError:
+            pass
+    assert(list(triangle.triangulate_many(square*2, [0, 4, 8], ring*2, [0, 4, 8], mode='pQ')[3]) == [0, 2, 4])
+    print('triangulate many: %d triangles' % tri_offsets[-1])
+
+
+def test_triangulate_tiles():
+
+    # a square with a hole and an internal segment across the tiles
+    pts = [0., 0., 1., 0., 1., 1., 0., 1., 0.4, 0.4, 0.6, 0.4, 0.6, 0.6, 0.4, 0.6, 0.1, 0.8, 0.9, 0.8]
+    segs = [0, 1, 1, 2, 2, 3, 3, 0, 4, 7, 7, 6, 6, 5, 5, 4, 8, 9]
+    for tiles in (1, 4, 7, (3, 2)):
+        xy, tris, tile_of = triangle.triangulate_tiles(pts, segs, holes=[0.5, 0.5], tiles=tiles,
+                                                       area=0.001, mode='pzq27Q')
+        ntiles = tiles if isinstance(tiles, int) else tiles[0]*tiles[1]
+        assert(list(xy[:len(pts)]) == pts and sorted(set(tile_of)) == list(range(ntiles)))
+        assert(len(set(tris)) == len(xy)//2 and len(tile_of) == len(tris)//3)
+        corners = numpy.array(tris).reshape(-1, 3)
+        a, b, c = [numpy.array(xy).reshape(-1, 2)[corners[:, k]] for k in range(3)]
+        areas = 0.5*((b - a)[:, 0]*(c - a)[:, 1] - (b - a)[:, 1]*(c - a)[:, 0])
+        assert(numpy.all(areas > 0.) and numpy.all(areas <= 0.001*(1. + 1.e-6*TOL)))
+        assert(abs(numpy.sum(areas) - 0.96) < 1.e-12*TOL)
+        # the tiles conform: an edge has at most one triangle on either side, and the
+        # edges with one triangle are on the boundary of the domain
+        edges = set()
+        for k in range(3):
+            edges.update(zip(corners[:, k], corners[:, (k + 1) % 3]))
+        assert(len(edges) == 3*len(corners))
+        boundary = numpy.array([e for e in edges if (e[1], e[0]) not in edges])
+        ends = numpy.array(xy).reshape(-1, 2)[boundary]
+        middle = numpy.all(numpy.abs(ends - 0.5) < 0.1 + 1.e-12*TOL, axis=(1, 2))
+        assert(numpy.all(middle | numpy.any(numpy.all((ends == 0.) | (ends == 1.), axis=1), axis=1)))
+        # no triangle crosses the internal segment
+        y = numpy.array([a[:, 1], b[:, 1], c[:, 1]])
+        x = numpy.array([a[:, 0], b[:, 0], c[:, 0]])
+        inside = (x.min(axis=0) >= 0.1) & (x.max(axis=0) <= 0.9)
+        assert(not numpy.any(inside & (y.min(axis=0) < 0.8 - 1.e-12*TOL) & (y.max(axis=0) > 0.8 + 1.e-12*TOL)))
+
+    # the numbering of two tiles sharing points 1 and 2, each with a point of its own
+    shared = [0., 0., 1., 0., 0., 1., 1., 1.]
+    assert(list(triangulate.gather_points(shared, [3, 1])) == [1., 1., 1., 0.])
+    txy = [1., 0., 0., 1., 0., 0., 0.2, 0.2, 0., 1., 1., 0., 1., 1., 0.8, 0.8]
+    xy, tris = triangulate.stitch_tiles(shared, [1, 2, 0, 2, 1, 3], [0, 3, 6], txy, [0, 4, 8],
+                                        [0, 1, 3, 0, 1, 3], [0, 1, 2])
+    assert(list(xy) == shared + [0.2, 0.2, 0.8, 0.8] and list(tris) == [1, 2, 4, 2, 1, 5])
+    for bad in ([0, 1, 4, 0, 1, 3], [0, 1, 3, 0, 1, -1]):
+        try:
+            triangulate.stitch_tiles(shared, [1, 2, 0, 2, 1, 3], [0, 3, 6], txy, [0, 4, 8], bad, [0, 1, 2])
+            assert(False)
+        except ValueError:
+            pass
+    print('triangulate tiles: %d triangles in %d tiles' % (len(tile_of), len(set(tile_of))))
+
+
+def test_save_load():
+
+    import tempfile
+    import struct
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.), (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+    h_in, h_out, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+    triangulate.set_points(h_in, pts, [1, 1, 1, 1, 0, 0, 0, 0])
+    triangulate.set_segments(h_in, seg, [1, 1, 1, 1, 2, 2, 2, 2])
+    triangulate.set_holes(h_in, [(0.5, 0.5)])
+    triangulate.triangulate('pzq30a0.01enQ', h_in, h_out, h_vor)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        filename = os.path.join(tmp, 'mesh.tri')
+        triangulate.save(h_out, filename)
+
+        # read or mapped, the same handle; a mapped handle can be refined as is
+        refined = []
+        for use_mmap in (0, 1):
+            h = triangulate.new()
+            triangulate.load(h, filename, use_mmap)
+            assert(triangulate.get_points(h) == triangulate.get_points(h_out))
+            assert(triangulate.get_triangles(h) == triangulate.get_triangles(h_out))
+            h_ref = triangulate.new()
+            triangulate.triangulate('pzrq30a0.002Q', h, h_ref, h_vor)
+            refined.append((triangulate.get_points(h_ref), triangulate.get_triangles(h_ref)))
+            triangulate.free(h)
+        h_ref = triangulate.new()
+        triangulate.triangulate('pzrq30a0.002Q', h_out, h_ref, h_vor)
+        assert(refined[0] == refined[1] == (triangulate.get_points(h_ref), triangulate.get_triangles(h_ref)))
+
+        # the arrays of the file, without copy
+        arrays = triangle.load_arrays(filename)
+        xy, corners = triangulate.get_mesh_arrays(h_out)
+        assert(list(arrays['points']) == list(xy) and list(arrays['triangles']) == list(corners))
+        assert(len(arrays['neighbors']) == len(corners) and len(arrays['edges']) == 2*len(arrays['edge_markers']))
+        assert(list(arrays['holes']) == [0.5, 0.5])
+        del arrays, xy, corners
+
+        # the numbering goes with the file: 1, although the last point is left out; the (empty)
+        # hole list is the last array of the file, mapped or not
+        triangulate.set_points(h_in, [(0., 0.), (1., 0.), (0., 1.), (1., 1.), (0., 1.)], [1, 1, 1, 1, 1])
+        triangulate.triangulate('Q', h_in, h_out, h_vor)
+        triangulate.save(h_out, filename)
+        for use_mmap in (0, 1):
+            h = triangulate.new()
+            triangulate.load(h, filename, use_mmap)
+            assert(triangulate.get_mesh_arrays(h)[1] == triangulate.get_mesh_arrays(h_out, -1, 1)[1])
+
+        # a corrupt header is refused before the handle is touched: a negative count, triangles
+        # without corners, attributes overflowing the sizes, a truncated file
+        with open(filename, 'rb') as f:
+            image = f.read()
+        header = struct.unpack_from('16i', image, 8)
+        corrupt = [{0: -1}, {2: 2**30}, {3: 0}, {0: 2**31 - 1, 1: 2**31 - 1, 12: header[12] | 2}]
+        images = [image[:8] + struct.pack('16i', *[c.get(i, header[i]) for i in range(16)]) + image[72:]
+                  for c in corrupt]
+        for image in images + [image[:-16]]:
+            with open(filename + '.bad', 'wb') as f:
+                f.write(image)
+            for use_mmap in (0, 1):
+                try:
+                    triangulate.load(h, filename + '.bad', use_mmap)
+                    assert(False)
+                except IOError:
+                    pass
+                assert(triangulate.get_mesh_arrays(h)[1] == triangulate.get_mesh_arrays(h_out, -1, 1)[1])
+
+        # another version of the format is refused
+        with open(filename, 'r+b') as f:
+            f.seek(5)
+            f.write(b'\002')
+        try:
+            triangulate.load(triangulate.new(), filename, 1)
+            assert(False)
+        except IOError:
+            pass
+
+
+def test_text_files():
+
+    import tempfile
+    import random
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.), (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)]
+    h_in, h_out, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+    triangulate.set_points(h_in, pts, [1, 1, 1, 1, 0, 0, 0, 0])
+    triangulate.set_point_attributes(h_in, [(p[0] + p[1],) for p in pts])
+    triangulate.set_segments(h_in, seg, [1, 1, 1, 1, 2, 2, 2, 2])
+    triangulate.set_holes(h_in, [(0.5, 0.5)])
+    triangulate.set_regions(h_in, [(0.1, 0.1, 3., 0.01)])
+    triangulate.triangulate('pzAq30a0.01Q', h_in, h_out, h_vor)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        filename = lambda ext: os.path.join(tmp, 'mesh' + ext)
+
+        # a .poly file with its points gives the same mesh
+        triangulate.write_poly(h_in, filename('.poly'), 0)
+        h = triangulate.new()
+        assert(triangulate.read_poly(h, filename('.poly')) == 0)
+        h2 = triangulate.new()
+        triangulate.triangulate('pzAq30a0.01Q', h, h2, h_vor)
+        assert(triangulate.get_triangles(h2) == triangulate.get_triangles(h_out))
+
+        # the output read back from .node, .ele and .poly files, and refined
+        triangulate.write_node(h_out, filename('.node'), 0)
+        triangulate.write_ele(h_out, filename('.ele'), 0)
+        triangulate.write_poly(h_out, filename('.1.poly'), 0, 0)
+        h = triangulate.new()
+        assert(triangulate.read_node(h, filename('.node')) == 0)
+        triangulate.read_ele(h, filename('.ele'))
+        assert(triangulate.read_poly(h, filename('.1.poly')) is None)
+        assert(triangulate.get_points(h) == triangulate.get_points(h_out))
+        assert(triangulate.get_triangles(h) == triangulate.get_triangles(h_out))
+        assert(triangulate.get_triangle_attributes(h) == triangulate.get_triangle_attributes(h_out))
+        h_ref, h_ref2 = triangulate.new(), triangulate.new()
+        triangulate.triangulate('pzrq30a0.002Q', h, h_ref, h_vor)
+        triangulate.triangulate('pzrq30a0.002Q', h_out, h_ref2, h_vor)
+        assert(triangulate.get_triangles(h_ref) == triangulate.get_triangles(h_ref2))
+
+        # comments, blank lines, missing fields, octal numbers, as read by Triangle
+        with open(filename('.hand.poly'), 'w') as f:
+            f.write('# unit square\n\n4 2 0 1\n1 0 0 1\n2 1e0 0 1\n3 1 1\n 4 0 1 010  # octal\n'
+                    '4 1\n1 1 2 5\n2 2 3\n3 3 4 5\n4 4 1 5\n0\n1\n1 0.5 0.5 7\n')
+        h = triangulate.new()
+        assert(triangulate.read_poly(h, filename('.hand.poly')) == 1)
+        assert(triangulate.get_points(h) == [[(0., 0.), 1], [(1., 0.), 1], [(1., 1.), 0], [(0., 1.), 8]])
+        triangulate.triangulate('pAQ', h, h2, h_vor)
+        assert(triangulate.get_triangle_attributes(h2) == [(7.,), (7.,)])
+
+        # a file of several chunks, in the usual number formats
+        rnd = random.Random(1)
+        xy = [(rnd.uniform(-1.e3, 1.e3)*10**rnd.randint(-20, 20), rnd.random()) for i in range(40000)]
+        formats = ['%r', '%.17g', '%.6f', '%.3e', '%g']
+        with open(filename('.big.node'), 'w') as f:
+            f.write('%d 2 0 0\n' % len(xy))
+            for i, (x, y) in enumerate(xy):
+                f.write('%d  %s %s\n' % (i + 1, formats[i % 5] % x, formats[i % 5] % y))
+        h = triangulate.new()
+        assert(triangulate.read_node(h, filename('.big.node')) == 1)
+        read, corners = triangulate.get_mesh_arrays(h)
+        if triangulate.real_size == 8:
+            with open(filename('.big.node')) as f:
+                assert(list(read) == [float(v) for line in f.readlines()[1:] for v in line.split()[1:]])
+
+        # corners numbered as the points of the .node file, from 0 here, the first point left out
+        with open(filename('.zero.node'), 'w') as f:
+            f.write('4 2 0 0\n0 0 0\n1 1 0\n2 0 1\n3 1 1\n')
+        with open(filename('.zero.ele'), 'w') as f:
+            f.write('1 3 0\n0 1 3 2\n')
+        h = triangulate.new()
+        assert(triangulate.read_node(h, filename('.zero.node')) == 0)
+        triangulate.read_ele(h, filename('.zero.ele'))
+        assert(list(triangulate.get_mesh_arrays(h)[1]) == [1, 3, 2])
+
+        # a truncated file
+        with open(filename('.bad.node'), 'w') as f:
+            f.write('3 2 0 0\n1 0 0\n2 1 0\n')
+        try:
+            triangulate.read_node(h, filename('.bad.node'))
+            assert(False)
+        except IOError:
+            pass
+
+
+def test_stream_points():
+
+    import random
+    rnd = random.Random(5)
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.)] + [(rnd.random(), rnd.random()) for i in range(5000)]
+    markers = [1, 1, 1, 1] + [0 for i in range(5000)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0)]
+
+    # in chunks of numpy arrays or of lists, the same mesh as with set_points
+    t = triangle.Triangle()
+    t.set_points(pts, markers)
+    t.set_point_attributes([(x + 2*y,) for x, y in pts])
+    t.set_segments(seg)
+    t.triangulate(area=0.001, mode='pzq30Q')
+    xy = numpy.array(pts)
+    for chunk in (64, 1000):
+        u = triangle.Triangle()
+        chunks = [(xy[i:i + chunk], markers[i:i + chunk], xy[i:i + chunk, 0] + 2*xy[i:i + chunk, 1])
+                  for i in range(0, len(pts), chunk)]
+        assert(u.stream_points(chunks, size_hint=len(pts)) == len(pts))
+        u.set_segments(seg)
+        u.triangulate(area=0.001, mode='pzq30Q')
+        assert(u.get_num_points() >= len(pts))
+        if triangulate.real_size == 8:
+            # the float build stores the points relative to another origin (see stream_points)
+            assert(u.get_points() == t.get_points() and u.get_triangles() == t.get_triangles())
+            assert(u.get_point_attributes() == t.get_point_attributes())
+    u = triangle.Triangle()
+    u.stream_points([[x for p in pts[:2000] for x in p], [x for p in pts[2000:] for x in p]])
+    u.triangulate(mode='zQ')
+    assert(u.get_num_points() == len(pts))
+
+    # the points are triangulated once, a chunk must have whole points and one marker per point
+    h = triangulate.new()
+    assert(triangulate.stream_points(h, xy[:10].ravel(), None, None, 10) == 10)
+    triangulate.triangulate('zQ', h, triangulate.new(), triangulate.new())
+    for call in (lambda: triangulate.triangulate('zQ', h, triangulate.new(), triangulate.new()),
+                 lambda: triangulate.stream_points(h, [0., 0., 1.]),
+                 lambda: triangulate.stream_points(h, xy[:10].ravel(), [0, 1])):
+        try:
+            call()
+            assert(False)
+        except ValueError:
+            pass
+
+
+def test_reuse_points():
+
+    import random
+    rnd = random.Random(7)
+    pts = [(0., 0.), (1., 0.), (1., 1.), (0., 1.)] + [(rnd.random(), rnd.random()) for i in range(2000)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0)]
+    for mode, added in (('pzQ', False), ('pzQT', False), ('pzq30Q', True)):
+        t = triangle.Triangle()
+        t.set_points(pts, [1, 1, 1, 1] + [0 for p in pts[4:]])
+        t.set_point_attributes([(x*y,) for x, y in pts])
+        t.set_segments(seg)
+        t.triangulate(mode=mode)
+        u = triangle.Triangle()
+        u.set_points(pts, [1, 1, 1, 1] + [0 for p in pts[4:]])
+        u.set_point_attributes([(x*y,) for x, y in pts])
+        u.set_segments(seg)
+        u.triangulate(mode=mode, reuse_points=True)
+        assert(u.get_points() == t.get_points() and u.get_triangles() == t.get_triangles())
+        assert(u.get_point_attributes() == t.get_point_attributes())
+        # the input keeps its points only if the mesh could not take them over
+        assert(triangulate.get_num_points(u.hndls[0]) == (len(pts) if added else 0))
+
+
+def test_recycle():
+
+    import random
+    rnd = random.Random(5)
+    inner = [(0.1 + 0.8*rnd.random(), 0.1 + 0.8*rnd.random()) for i in range(200)]
+    square = [(0., 0.), (1., 0.), (1., 1.), (0., 1.)]
+    seg = [(0, 1), (1, 2), (2, 3), (3, 0)]
+
+    # time steps with moving points, meshes that grow and shrink, outputs that come and go
+    t = triangle.Triangle()
+    for step, (area, mode, n) in enumerate([(0.01, 'pzq30eQ', 200), (0.0005, 'pzq30enQ', 150),
+                                            (0.02, 'pzQ', 200), (0.001, 'pzq30eQ', 100)]):
+        pts = square + [(x + 0.05*math.sin(step + x), y + 0.05*math.cos(step + y)) for x, y in inner[:n]]
+        t.set_points(pts, [1, 1, 1, 1] + [0 for p in pts[4:]])
+        t.set_point_attributes([(x*y,) for x, y in pts])
+        t.set_segments(seg)
+        t.triangulate(area=area, mode=mode, recycle=True)
+        u = triangle.Triangle()
+        u.set_points(pts, [1, 1, 1, 1] + [0 for p in pts[4:]])
+        u.set_point_attributes([(x*y,) for x, y in pts])
+        u.set_segments(seg)
+        u.triangulate(area=area, mode=mode)
+        assert(t.get_points() == u.get_points() and t.get_triangles() == u.get_triangles())
+        assert(t.get_edges() == u.get_edges() and t.get_point_attributes() == u.get_point_attributes())
+
+    # the points of the input can be handed over as well, and the arrays of the low level
+    # module are written without the K switch
+    h_in, h_out, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+    for step in range(3):
+        pts = square + [(x + 0.01*step, y) for x, y in inner[:50*(step + 1)]]
+        triangulate.set_points(h_in, pts, [0 for p in pts])
+        triangulate.set_segments(h_in, seg, [1 for s in seg])
+        triangulate.triangulate('pzenQ', h_in, h_out, h_vor, step == 1, True)
+        h, ref = triangulate.new(), triangulate.new()
+        triangulate.set_points(h, pts, [0 for p in pts])
+        triangulate.set_segments(h, seg, [1 for s in seg])
+        triangulate.triangulate('pzenQ', h, ref, h_vor)
+        assert(triangulate.get_points(h_out) == triangulate.get_points(ref))
+        assert(triangulate.get_triangles(h_out) == triangulate.get_triangles(ref))
+        assert(triangulate.get_edges(h_out) == triangulate.get_edges(ref))
+
+    # the arrays of a borrowed buffer or of a mapped file, triangulated again in place
+    # (input and output handles being the same), are never recycled nor freed
+    import tempfile
+    image = bytearray(triangulate.dumps(h_out))
+    pts = square + inner[:40]
+    with tempfile.TemporaryDirectory() as tmp:
+        triangulate.save(h_out, os.path.join(tmp, 'mesh.tri'))
+        for recycle in (False, True):
+            for mapped in (False, True):
+                h = triangulate.new()
+                if mapped:
+                    triangulate.load(h, os.path.join(tmp, 'mesh.tri'), 1)
+                else:
+                    triangulate.loads(h, memoryview(image), image)
+                triangulate.set_points(h, pts, [0 for p in pts])
+                triangulate.triangulate('zenQ', h, h, h_vor, False, recycle)
+                ref = triangulate.new()
+                triangulate.set_points(h_in, pts, [0 for p in pts])
+                triangulate.triangulate('zenQ', h_in, ref, h_vor)
+                assert(triangulate.get_triangles(h) == triangulate.get_triangles(ref))
+                assert(triangulate.get_edges(h) == triangulate.get_edges(ref))
+                triangulate.free(h)
+
+    # the Voronoi diagrams of growing and shrinking meshes, written to the same handle
+    for recycle in (False, True):
+        for n in (20, 120, 50, 204):
+            pts = square + inner[:n - 4]
+            triangulate.set_points(h_in, pts, [0 for p in pts])
+            triangulate.triangulate('zvQ', h_in, h_out, h_vor, False, recycle)
+            h, ref, v = triangulate.new(), triangulate.new(), triangulate.new()
+            triangulate.set_points(h, pts, [0 for p in pts])
+            triangulate.triangulate('zvQ', h, ref, v)
+            assert(triangulate.get_points(h_vor) == triangulate.get_points(v))
+            assert(triangulate.get_edges(h_vor) == triangulate.get_edges(v))
+    try:
+        triangulate.triangulate('zvQ', h_in, h_out, h_out)
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_stream_delaunay():
+
+    import array
+    import io
+    import random
+    rnd = random.Random(11)
+    nx, ny = 6, 4
+    pts = [(rnd.random(), rnd.random()) for i in range(6000)]
+    pts.sort(key=lambda p: int(p[0]*nx))
+
+    # the points column by column of cells, column i - 1 being finalized after column i
+    def chunks():
+        for i in range(nx):
+            yield ([x for p in pts if int(p[0]*nx) == i for x in p],
+                   [(i - 1, j) for j in range(ny)] if i > 0 else [])
+
+    out = io.BytesIO()
+    n, ntri, max_active = triangle.stream_delaunay(chunks(), (0., 0., 1./nx, 1./ny, nx, ny), out)
+    tris = array.array('q', out.getvalue())
+    assert(n == len(pts) and len(tris) == 3*ntri)
+    assert(max_active < len(pts)//2)
+    print('stream delaunay: %d triangles, at most %d points' % (ntri, max_active))
+
+    # the Delaunay triangulation of all the points
+    t = triangle.Triangle()
+    t.set_points(pts)
+    t.triangulate(mode='zQ')
+    xy, corners = t.get_mesh_arrays()
+    assert(ntri == len(corners)//3)
+    if triangulate.real_size == 8:
+        # the float build rounds the points relative to other origins (see stream_delaunay)
+        assert(set(tuple(sorted(tris[3*k:3*k + 3])) for k in range(ntri)) ==
+               set(tuple(sorted(corners[3*k:3*k + 3])) for k in range(ntri)))
+
+    # a front made of bad point numbers
+    h = triangulate.new()
+    triangulate.set_points(h, [(0., 0.), (1., 0.), (0., 1.)], [0, 0, 0])
+    out = triangulate.new()
+    triangulate.triangulate('zQn', h, out, triangulate.new())
+    try:
+        triangulate.finalize_front(out, [0., 0., 1., 0., 0., 1.], [0, 1, 2], [0, 5],
+                                   (0., 0., 1., 1., 1, 1), [1])
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_triangulate_distributed():
+
+    import tempfile
+    pts = [0., 0., 1., 0., 1., 1., 0., 1., 0.4, 0.4, 0.6, 0.4, 0.6, 0.6, 0.4, 0.6, 0.1, 0.8, 0.9, 0.8]
+    segs = [0, 1, 1, 2, 2, 3, 3, 0, 4, 7, 7, 6, 6, 5, 5, 4, 8, 9]
+
+    # two workers of two tiles each, the same mesh as in one process
+    ref = triangle.triangulate_tiles(pts, segs, holes=[0.5, 0.5], tiles=4, area=0.001)
+    with tempfile.TemporaryDirectory() as tmp:
+        xy, tris, parts, report = triangle.triangulate_distributed(pts, segs, holes=[0.5, 0.5], workers=2,
+                                                                   tiles=4, area=0.001,
+                                                                   prefix=os.path.join(tmp, 'mesh'))
+        assert(xy == ref[0] and tris == ref[1])
+        assert(list(parts) == [0 if k < 2 else 1 for k in ref[2]])
+        assert([w['tiles'] for w in report['workers']] == [[0, 1], [2, 3]])
+        assert(sum(w['triangles'] for w in report['workers']) == len(parts))
+        assert(report['imbalance'] >= 1.)
+
+        # the partition files: the triangles of the partition, then the ghost triangles
+        for p in range(2):
+            h = triangulate.new()
+            assert(triangulate.read_node(h, os.path.join(tmp, 'mesh.%d.node' % p)) == 0)
+            triangulate.read_ele(h, os.path.join(tmp, 'mesh.%d.ele' % p))
+            owned = list(parts).count(p)
+            tri_parts = [a[0] for a in triangulate.get_triangle_attributes(h)]
+            assert(tri_parts[:owned] == [p]*owned and len(tri_parts) > owned)
+            assert(all(q != p for q in tri_parts[owned:]))
+            numbers = [int(a[0]) for a in triangulate.get_point_attributes(h)]
+            local = numpy.array([xy[2*a:2*a + 2] for a in numbers])
+            assert(numpy.all(local == numpy.array([q[0] for q in triangulate.get_points(h)])) or
+                   triangulate.real_size < 8)
+    print('triangulate distributed: imbalance %.2f' % report['imbalance'])
+
+
+def build_square_with_hole(area):
+
+    t = triangle.Triangle()
+    t.set_points([(0., 0.), (1., 0.), (1., 1.), (0., 1.), (0.4, 0.4), (0.6, 0.4), (0.6, 0.6), (0.4, 0.6)],
+                 [1, 1, 1, 1, 0, 0, 0, 0])
+    t.set_segments([(0, 1), (1, 2), (2, 3), (3, 0), (4, 7), (7, 6), (6, 5), (5, 4)])
+    t.set_holes([(0.5, 0.5)])
+    t.triangulate(area=area, mode='pzq30eQ', levels=2)
+    t.refine()
+    t.share()
+    return t
+
+
+def test_pickle():
+
+    import pickle
+    import struct
+    import multiprocessing
+    t = build_square_with_hole(0.01)
+    t.refine()
+    t.set_history(keep=2, policy='spill')
+    sizes = [(t.get_num_points(l), t.get_num_triangles(l)) for l in range(1, len(t.hndls))]
+
+    # by copy or through shared memory, the same levels, and the copy can be refined
+    for shared in (False, True):
+        t.share(shared)
+        u = pickle.loads(pickle.dumps(t))
+        assert([(u.get_num_points(l), u.get_num_triangles(l)) for l in range(1, len(u.hndls))] == sizes)
+        assert(u.get_points(2) == t.get_points(2) and u.get_triangles() == t.get_triangles())
+        assert(u.get_edges() == t.get_edges())
+        u.refine()
+        assert(u.get_num_triangles() > t.get_num_triangles())
+
+    # a handle used in place, whose last array (the hole list) is empty, is freed
+    h_in, h, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+    triangulate.set_points(h_in, [(0., 0.), (1., 0.), (0., 1.), (1., 1.)], [1, 1, 1, 1])
+    triangulate.triangulate('Q', h_in, h, h_vor)
+    image = bytearray(triangulate.dumps(h))
+    u = triangulate.new()
+    triangulate.loads(u, memoryview(image), image)
+    assert(triangulate.get_triangles(u) == triangulate.get_triangles(h))
+
+    # so are corrupt images, copied or borrowed, which leave the handle as it was (see test_save_load)
+    header = struct.unpack_from('16i', image, 8)
+    corrupt = [{0: -1}, {2: 2**30}, {3: 0}, {0: 2**31 - 1, 1: 2**31 - 1, 12: header[12] | 2}]
+    images = [image[:8] + struct.pack('16i', *[c.get(i, header[i]) for i in range(16)]) + image[72:]
+              for c in corrupt]
+    for image in images + [image[:-16]]:
+        for owner in (None, image):
+            try:
+                triangulate.loads(u, memoryview(image), owner) if owner else triangulate.loads(u, image)
+                assert(False)
+            except IOError:
+                pass
+            assert(triangulate.get_triangles(u) == triangulate.get_triangles(h))
+    triangulate.free(u)
+
+    # meshes built by worker processes, started afresh: a forked child of a process that ran
+    # OpenMP threads hangs in its first parallel region (OpenMP build)
+    with multiprocessing.get_context('spawn').Pool(2) as pool:
+        meshes = pool.map(build_square_with_hole, [0.01, 0.001])
+    for area, u in zip([0.01, 0.001], meshes):
+        assert(u.get_triangles() == build_square_with_hole(area).get_triangles())
+
 
 if __name__ == '__main__':
     test_simple()
     test_simple2()
     test_circle_with_hole()
+    test_holes_and_regions()
+    test_levels()
+    test_history()
+    test_parallel_export()
+    test_stats()
+    test_quality()
+    test_offcenters()
+    test_translate()
+    test_keep_mesh()
+    test_mesh_arrays()
+    test_voronoi_cells()
+    test_triangulate_many()
+    test_triangulate_tiles()
+    test_triangulate_distributed()
+    test_save_load()
+    test_text_files()
+    test_stream_points()
+    test_reuse_points()
+    test_recycle()
+    test_stream_delaunay()
+    test_pickle()
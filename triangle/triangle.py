@@ -1,12 +1,41 @@
 #!/usr/bin/env python
 
 import triangulate
+import array
+import math
+import mmap
+import struct
 import sys
+import os
+import tempfile
+import time
+import multiprocessing
 
 """
 Interface to the TRIANGLE program by Jonathan Richard Shewchuck
 """
 
+class _Watermark:
+    """
+    A refinement level whose arrays were freed. Only its sizes are kept:
+    its points are the first npoints points of any finer level.
+    """
+    def __init__(self, npoints, ntriangles):
+        self.npoints = npoints
+        self.ntriangles = ntriangles
+
+
+class _Spilled(_Watermark):
+    """
+    A refinement level written to disk with triangulate.save. k is the
+    level within the saved handle (-1 for its finest level).
+    """
+    def __init__(self, npoints, ntriangles, filename, k):
+        _Watermark.__init__(self, npoints, ntriangles)
+        self.filename = filename
+        self.k = k
+
+
 class Triangle:
 
 
@@ -23,11 +52,24 @@ class Triangle:
         
         self.area  = None
         self.mode  = ''
+        self.lazy  = False
+
+        # the coordinates are stored relative to this point when triangulate
+        # is built with TRIANGLE_SINGLE=1, to make the most of float
+        self.origin = (0., 0.)
 
         self.has_points = False
         self.has_segmts = False
         self.has_trgltd = False
 
+        # retention policy of the refinement history (see set_history)
+        self.keep = None
+        self.policy = 'drop'
+        self.spill_dir = None
+
+        # pickle the arrays through shared memory (see share)
+        self.shared = False
+
 
     def set_points(self, pts, markers=[]):
 
@@ -52,11 +94,61 @@ class Triangle:
                 mrks = [markers[i] for i in range(n1)] + [0 for i in range(n2)]
             else:
                 mrks = markers
-                
+
+        if triangulate.real_size < 8 and pts:
+            xs = [p[0] for p in pts]
+            ys = [p[1] for p in pts]
+            self.origin = (0.5*(min(xs) + max(xs)), 0.5*(min(ys) + max(ys)))
+            pts = self._shift(pts, -1)
         triangulate.set_points(self.hndls[0], pts, mrks)
         self.has_points = True
 
 
+    def stream_points(self, chunks, size_hint=0):
+
+        """
+        Set the points chunk by chunk, e.g. while reading a file too large for a list of points. Each chunk
+        goes straight to the vertices of the next triangulation, only the current chunk is converted.
+
+        @param chunks iterable of xy, (xy, markers) or (xy, markers, attributes), where xy is a flat array
+                      (array module, numpy,..) of the coordinates x0, y0, x1, y1,.., markers holds one marker
+                      per point (or None for zeros) and attributes the same number of attributes per point,
+                      a00, a01,.., a10,..
+        @param size_hint expected total number of points, reserved at once
+        @return the number of points
+
+        @note use instead of set_points and set_point_attributes. The points are taken over by the next call
+              to triangulate, which is thus the only one: they are not kept in the input (level 0), and are
+              not pickled before it.
+        """
+        n = 0
+        for chunk in chunks:
+            if not isinstance(chunk, tuple):
+                chunk = (chunk,)
+            xy, markers, attributes = (chunk + (None, None))[:3]
+            if n == 0 and triangulate.real_size < 8:
+                # relative to the first point, the bounding box is not known yet
+                self.origin = self._first_point(xy)
+            n = triangulate.stream_points(self.hndls[0], xy, markers, attributes, size_hint, self.origin)
+        self.has_points = n > 0
+        return n
+
+
+    @staticmethod
+    def _first_point(xy):
+        """
+        Get the first point of a flat array or sequence of coordinates.
+        """
+        try:
+            v = memoryview(xy)
+            v = v.cast('B').cast(v.format)
+        except TypeError:
+            v = xy
+        if len(v) < 2:
+            return (0., 0.)
+        return (float(v[0]), float(v[1]))
+
+
     def set_segments(self, segs, markers=[]):
 
         """
@@ -93,7 +185,7 @@ class Triangle:
 
         @param xy [ (x0, y0), ... ] where (x0,y0) is a point inside a hole
         """
-        triangulate.set_holes(self.hndls[0], xy)
+        triangulate.set_holes(self.hndls[0], self._shift(xy, -1))
 
     def set_regions(self, xy):
 
@@ -104,7 +196,21 @@ class Triangle:
                                                 r is the region attribute (tag)
                                                 a is the area constraint
         """
-        triangulate.set_regions(self.hndls[0], xy)
+        triangulate.set_regions(self.hndls[0], self._shift(xy, -1))
+
+    def set_marker_areas(self, table):
+
+        """
+        Set area constraints keyed by segment marker.
+
+        @param table [ (m, a), ... ] where m is a segment marker
+                                          a is the max area of the regions bounded by segments with marker m
+
+        @note used with the 'R' switch (number the segment-bounded regions, no region points needed) and
+        the 'a' switch without a number, e.g. mode='pzqRae'. A region bounded by several markers takes the
+        smallest area.
+        """
+        triangulate.set_marker_areas(self.hndls[0], table)
 
 
     def set_point_attributes(self, att):
@@ -124,10 +230,10 @@ class Triangle:
 
         @param att [(a0,..), ...]
         """
-        triangulate.set_triangle_attributes(self.hndls[1], att)
+        triangulate.set_triangle_attributes(self._handle(1)[0], att)
 
 
-    def triangulate(self, area=None, mode='pzq27eQ'):
+    def triangulate(self, area=None, mode='pzq27eQ', levels=0, reuse_points=False, recycle=False, lazy=False):
 
         """
         Perform an initial triangulation.
@@ -135,6 +241,21 @@ class Triangle:
         @param area is a max area constraint
         @param mode a string of TRIANGLE switches. Refer to the TRIANGLE doc for more info about mode:
         http://www.cs.cmu.edu/~quake/triangle.switch.html
+        @param levels number of refinement levels to add on the same mesh, each halving the area
+                      constraint (see the 'L' switch). This is much cheaper than calling 'refine'
+                      repeatedly: the coarser levels only store their number of points (a prefix
+                      of the finest points) and their triangles. Edges are only available on the
+                      finest level.
+        @param reuse_points if no point is added (e.g. mode='pzQ', without q, a, s, D or u), the mesh takes the
+                            point arrays of the input over instead of copying them: the input (level 0) is left
+                            without points and this is the only triangulation. Otherwise the input is untouched.
+        @param recycle write the mesh to the arrays of the previous triangulation, which are only allocated again
+                       (a quarter larger) when they are too small, e.g. when the same domain is meshed again with
+                       moving points at every step of a time-stepping loop. Otherwise they are freed first.
+        @param lazy compute the edges and neighbors requested by mode the first time they are read, by get_edges
+                    or get_triangles, rather than now. The mesh stays in memory until then (see the 'K' switch),
+                    which pays off when they may not be read at all, but costs memory otherwise. The mesh is not
+                    kept when mode requests neither. refine follows the same choice.
 
         @note invoke this after setting the boundary points, segments, and optionally hole positions.
         """
@@ -150,16 +271,248 @@ class Triangle:
         # e: edge
         # p: planar straight line graph
         # Q: quiet mode
+        # K: keep the mesh, compute the edges and neighbors on first access, then free it
 
         self.mode = mode
+        self.lazy = lazy
+        if lazy:
+            mode += 'K'
         if area:
             self.area = area
             mode += 'a%f'% area
 
+        if levels > 0:
+            mode += 'L%d' % levels
+            self.hndls[1:] = [triangulate.new()]
+        elif len(self.hndls) > 1 and isinstance(self.hndls[1], (tuple, _Watermark)):
+            # the first level was a coarse level of an L switch, or was dropped
+            self.hndls[1:] = [triangulate.new()]
+
         if len(self.hndls) <= 1: self.hndls.append( triangulate.new() )
-        triangulate.triangulate(mode, self.hndls[0], self.hndls[1], self.h_vor)
+        triangulate.triangulate(mode, self.hndls[0], self.hndls[1], self.h_vor, reuse_points, recycle)
         self.has_trgltd = True
 
+        if levels > 0:
+            # the coarser levels live in the output handle of the finest level
+            h = self.hndls[1]
+            self.hndls[1:] = [(h, k) for k in range(levels)] + [h]
+            if self.area:
+                self.area /= 2.0**levels
+
+        self._trim()
+
+
+    def set_history(self, keep=None, policy='drop', directory=None):
+
+        """
+        Bound the memory held by the refinement history.
+
+        @param keep number of most recent levels whose arrays stay in memory (None to keep them all).
+                    The input (level 0) and the last level are always kept.
+        @param policy what to do with the older levels: 'drop' frees their arrays and only keeps their
+                      number of points and triangles (their points remain available as the first points
+                      of the last level), 'spill' writes them to a binary file read back on access
+        @param directory where to write the spilled levels (a new temporary directory is created in it,
+                         and removed with this object)
+        """
+        if policy not in ('drop', 'spill'):
+            print('%s: Error. Unknown history policy "%s" (expected "drop" or "spill")' \
+                  % (__file__, policy))
+            return
+        self.keep = keep
+        self.policy = policy
+        if policy == 'spill' and self.spill_dir is None:
+            self.spill_dir = tempfile.TemporaryDirectory(prefix='triangle', dir=directory)
+        self._trim()
+
+
+    def share(self, shared=True):
+
+        """
+        Pickle this object through shared memory, e.g. to return a large mesh from a worker process of
+        multiprocessing without copying it through a pipe.
+
+        @param shared True to write the arrays of every level to new multiprocessing.shared_memory
+                      segments when this object is pickled, and only pickle their names, False to pickle
+                      the arrays themselves (default)
+
+        @note the process that unpickles the object uses the arrays in place and removes the segments,
+              which can thus only be unpickled once. A segment that is never unpickled is only removed
+              when the multiprocessing resource tracker exits. Sharing requires Python 3.8 or later.
+        """
+        self.shared = shared
+
+
+    def __getstate__(self):
+        """
+        Pickle the arrays of every handle as a binary image (see triangulate.dumps), each handle once.
+        The spilled levels are read back, the dropped ones remain watermarks.
+        """
+        state = self.__dict__.copy()
+        images, index, hndls = [], {}, []
+        for level, entry in enumerate(self.hndls):
+            if isinstance(entry, _Watermark) and not isinstance(entry, _Spilled):
+                hndls.append(entry)
+                continue
+            if isinstance(entry, _Spilled):
+                key = entry.filename
+            else:
+                key = id(entry[0] if isinstance(entry, tuple) else entry)
+            h, k = self._handle(level)
+            if key not in index:
+                index[key] = len(images)
+                images.append(self._dump(h))
+            hndls.append((index[key], k))
+        state['hndls'] = hndls
+        state['h_vor'] = self._dump(self.h_vor)
+        state['images'] = images
+        state['spill_dir'] = None
+        return state
+
+
+    def __setstate__(self, state):
+        """
+        Rebuild the handles of a pickled object, then apply its retention policy again.
+        """
+        images = [self._load(image) for image in state.pop('images')]
+        hndls = []
+        for entry in state['hndls']:
+            if isinstance(entry, _Watermark):
+                hndls.append(entry)
+            elif entry[1] < 0:
+                hndls.append(images[entry[0]])
+            else:
+                hndls.append((images[entry[0]], entry[1]))
+        state['hndls'] = hndls
+        state['h_vor'] = self._load(state['h_vor'])
+        self.__dict__.update(state)
+        if self.policy == 'spill':
+            self.spill_dir = tempfile.TemporaryDirectory(prefix='triangle')
+        self._trim()
+
+
+    def _dump(self, h):
+        """
+        Get the binary image of a handle to pickle: its bytes, or the name and size of the shared
+        memory segment holding it if share was called.
+        """
+        if not self.shared:
+            return triangulate.dumps(h)
+        # Python 3.8 or later
+        from multiprocessing import shared_memory
+        size = triangulate.get_image_size(h)
+        shm = shared_memory.SharedMemory(create=True, size=size)
+        triangulate.dumps(h, shm.buf)
+        shm.close()
+        return (shm.name, size)
+
+
+    @staticmethod
+    def _load(image):
+        """
+        Get a new handle holding a binary image returned by _dump. The arrays of a shared memory
+        segment are used in place, and the segment is removed.
+        """
+        h = triangulate.new()
+        if isinstance(image, bytes):
+            triangulate.loads(h, image)
+            return h
+        from multiprocessing import shared_memory
+        name, size = image
+        shm = shared_memory.SharedMemory(name=name)
+        triangulate.loads(h, shm.buf, shm)
+        shm.unlink()
+        return h
+
+
+    def drop_level(self, level):
+
+        """
+        Free the arrays of a refinement level right away, keeping only its number of points and triangles.
+
+        @param level refinement level (-1 for the last level). The input (level 0) and the last level
+                     cannot be dropped. Level numbers are not changed.
+        """
+        n = len(self.hndls)
+        if level % n in (0, n - 1):
+            print('%s: Error. Cannot drop the input or the last level' % (__file__))
+            return
+        self._release(level % n, 'drop')
+
+
+    def _trim(self):
+        """
+        Apply the retention policy to the levels older than the last self.keep ones.
+        """
+        if self.keep is None:
+            return
+        last = len(self.hndls) - 1
+        for level in range(1, min(last, last - self.keep + 1)):
+            self._release(level, self.policy)
+
+
+    def _release(self, level, policy):
+        """
+        Free the arrays of a level, either dropping them or spilling them to disk.
+        """
+        entry = self.hndls[level]
+        if isinstance(entry, _Watermark):
+            return
+        if isinstance(entry, tuple):
+            # a coarse level living in the handle of a finer level: dropping it
+            # frees its triangles, spilling it waits for its handle
+            if policy == 'drop':
+                self.hndls[level] = _Watermark(triangulate.get_num_points(*entry),
+                                               triangulate.get_num_triangles(*entry))
+                triangulate.free_level(*entry)
+            return
+        filename = None
+        if policy == 'spill':
+            filename = os.path.join(self.spill_dir.name, 'level%d.tri' % level)
+            triangulate.save(entry, filename)
+        for i, e in enumerate(self.hndls):
+            if e is entry or (isinstance(e, tuple) and e[0] is entry):
+                h, k = e if isinstance(e, tuple) else (e, -1)
+                npts = triangulate.get_num_points(h, k)
+                ntri = triangulate.get_num_triangles(h, k)
+                if filename:
+                    self.hndls[i] = _Spilled(npts, ntri, filename, k)
+                else:
+                    self.hndls[i] = _Watermark(npts, ntri)
+        triangulate.free(entry)
+
+
+    def _handle(self, level):
+        """
+        Get the handle of a refinement level.
+
+        @param level refinement level (-1 for the last level). The coarsest level is 1.
+        @return (handle, k) where k is the level within the handle (-1 for its finest level),
+                handle is None if the level was dropped
+        """
+        h = self.hndls[level]
+        if isinstance(h, _Spilled):
+            k = h.k
+            h, filename = triangulate.new(), h.filename
+            triangulate.load(h, filename, 1)
+            return h, k
+        if isinstance(h, _Watermark):
+            return None, -1
+        if isinstance(h, tuple):
+            return h
+        return h, -1
+
+
+    def _dropped(self, level):
+        """
+        Report an error if a level was dropped.
+        """
+        if isinstance(self.hndls[level], _Watermark) and not isinstance(self.hndls[level], _Spilled):
+            print('%s: Error. Level %d was dropped, only its points and sizes are kept' \
+                  % (__file__, level))
+            return True
+        return False
+
 
     def get_num_points(self, level=-1):
         """
@@ -168,7 +521,9 @@ class Triangle:
         @param level refinement level (-1 for the last level). The coarsest level is 1.
         @return number
         """
-        return triangulate.get_num_points(self.hndls[level])
+        if isinstance(self.hndls[level], _Watermark):
+            return self.hndls[level].npoints
+        return triangulate.get_num_points(*self._handle(level))
 
         
     def get_num_triangles(self, level=-1):
@@ -178,7 +533,9 @@ class Triangle:
         @param level refinement level (-1 for the last level). The coarsest level is 1
         @return number
         """
-        return triangulate.get_num_triangles(self.hndls[level])
+        if isinstance(self.hndls[level], _Watermark):
+            return self.hndls[level].ntriangles
+        return triangulate.get_num_triangles(*self._handle(level))
 
 
     def refine(self, area_ratio=2.0):
@@ -199,12 +556,17 @@ class Triangle:
         self.hndls.append( triangulate.new() )
 
         mode = self.mode + 'cr'
+        if self.lazy:
+            mode += 'K'
         if self.area:
             self.area /= area_ratio
             mode += 'a%f' % self.area
 
         triangulate.triangulate(mode, self.hndls[-2],
                                 self.hndls[-1], self.h_vor)
+        # only the last level keeps its mesh
+        triangulate.release(self.hndls[-2])
+        self._trim()
 
 
     def get_points(self, level=-1):
@@ -217,7 +579,25 @@ class Triangle:
                      level=-2 the previous one, etc.
         @return [ [(x, y), marker], ...] where marker is 1 on the boundary and 0 inside. Here, 
         """
-        return triangulate.get_points(self.hndls[level])
+        entry = self.hndls[level]
+        if isinstance(entry, _Watermark) and not isinstance(entry, _Spilled):
+            # refinement only appends points
+            pts = triangulate.get_points(*self._handle(-1), entry.npoints)
+        else:
+            pts = triangulate.get_points(*self._handle(level))
+        if self.origin != (0., 0.):
+            pts = [[(p[0][0] + self.origin[0], p[0][1] + self.origin[1]), p[1]] for p in pts]
+        return pts
+
+
+    def _shift(self, xy, sign):
+        """
+        Translate the points by sign*origin (see set_points), keep any other components.
+        """
+        if self.origin == (0., 0.):
+            return xy
+        ox, oy = sign*self.origin[0], sign*self.origin[1]
+        return [(p[0] + ox, p[1] + oy) + tuple(p[2:]) for p in xy]
 
 
     def get_edges(self, level=-1):
@@ -231,7 +611,14 @@ class Triangle:
         @return [((p0, p1), m),..) where (p0, p1) are point indices and 
         m is the boundary marker (0=interior, 1=boundary)
         """
-        return triangulate.get_edges(self.hndls[level])
+        if self._dropped(level):
+            return []
+        h, k = self._handle(level)
+        if k >= 0:
+            print('%s: Error. Edges are only available on the finest of the levels added by "triangulate"' \
+                  % (__file__))
+            return []
+        return triangulate.get_edges(h)
         
 
     def get_triangles(self, level=-1):
@@ -245,7 +632,9 @@ class Triangle:
         @return [([p0, p1, p2,..], (k0,k1,k2), [a0,a1,..]),..] where p0, p1, p2,.. are the 
         point indices at the triangle corners, optionally followed by intermediate points (k0, k1, k2) and triangle cell attributes a1,a2.. 
         """
-        return triangulate.get_triangles(self.hndls[level])
+        if self._dropped(level):
+            return []
+        return triangulate.get_triangles(*self._handle(level))
         
 
     def get_point_attributes(self, level=-1):
@@ -258,7 +647,9 @@ class Triangle:
                      level=-2 the previous one, etc.
         @return [(a0,...), ....]
         """
-        return triangulate.get_point_attributes(self.hndls[level])
+        if self._dropped(level):
+            return []
+        return triangulate.get_point_attributes(*self._handle(level))
         
 
     def get_triangle_attributes(self, level=-1):
@@ -271,7 +662,90 @@ class Triangle:
                      level=-2 the previous one, etc.
         @return [(a0,...), ....]
         """
-        return triangulate.get_triangle_attributes(self.hndls[level])
+        if self._dropped(level):
+            return []
+        return triangulate.get_triangle_attributes(*self._handle(level))
+
+
+    def get_stats(self, level=-1):
+
+        """
+        Get the timings and counters of the triangulation or refinement that produced a level.
+
+        @param level refinement level (-1 for the last level). Levels added by "triangulate" share
+                     the stats of their finest level.
+        @return {name: value, ...}: the time spent in each phase, in ms ('transfer_ms', 'delaunay_ms',
+        'segments_ms', 'holes_ms', 'quality_ms', 'output_ms', 'total_ms'), the number of geometric
+        predicates evaluated ('incircle_tests', 'orient2d_tests',...), the peak size of the memory
+        pools ('max_triangles',...) and the number of Steiner points ('steiner_points',...)
+        """
+        if self._dropped(level):
+            return {}
+        h, k = self._handle(level)
+        return triangulate.get_stats(h) or {}
+
+
+    def get_quality(self, level=-1):
+
+        """
+        Measure the quality of each triangle, without printing anything (see the V switch).
+
+        @param level refinement level (-1 for the last level). The coarsest level is 1.
+        @return (min_angles, aspect_ratios, areas, summary): arrays of the smallest angle (in degrees),
+        the longest edge over the shortest altitude and the area of each triangle, and a dict with the
+        extremes ('min_angle', 'max_aspect',...), the 'angle_histogram' (10 degree bins) and the
+        'aspect_histogram' (same bins as the V switch)
+        """
+        if self._dropped(level):
+            return None
+        h, k = self._handle(level)
+        firstnumber = 0
+        if self.mode.find('z') < 0:
+            firstnumber = 1
+        return triangulate.get_quality(h, k, firstnumber)
+
+
+    def get_mesh_arrays(self, level=-1):
+
+        """
+        Get the points and the triangles as flat arrays, much faster than get_points and get_triangles
+        on large meshes.
+
+        @param level refinement level (-1 for the last level). The coarsest level is 1.
+        @return (xy, corners): arrays (array module) of the coordinates x0, y0, x1, y1,... and of the
+        indices of the 3 corners of each triangle, numbered from 0 whatever the mode
+        """
+        if self._dropped(level):
+            return None
+        h, k = self._handle(level)
+        firstnumber = 0
+        if self.mode.find('z') < 0:
+            firstnumber = 1
+        return triangulate.get_mesh_arrays(h, k, firstnumber, self.origin)
+
+
+    def get_voronoi_cells(self, level=-1, clip=False):
+
+        """
+        Get the Voronoi cell of each point, e.g. as control volumes of a finite volume scheme.
+
+        @param level refinement level (-1 for the last level). The coarsest level is 1.
+        @param clip close the cells of the boundary points and clip all the cells to the bounding box of
+                    the points
+        @return (xy, offsets, cells): arrays (array module) of the coordinates x0, y0, x1, y1,... of the
+        cell vertices (the circumcenters of the triangles first, in the order of get_triangles), and of
+        the indices of the vertices of each cell, counterclockwise: those of point i are
+        cells[offsets[i]:offsets[i + 1]]. Without clip, the open cells of the boundary points start with -1
+        @note the cells are those of the triangulation: with holes or concavities, the cells of their
+              boundary points run over them
+        """
+        if self._dropped(level):
+            return None
+        h, k = self._handle(level)
+        firstnumber = 0
+        if self.mode.find('z') < 0:
+            firstnumber = 1
+        return triangulate.get_voronoi_cells(h, k, firstnumber, int(clip), self.origin)
 
 
     # backward compatibility
@@ -285,49 +759,585 @@ class Triangle:
     # add some visualization capability to fast check the mesh
     
     
-    def plot_mesh(self,level=-1):
+    def plot_mesh(self, level=-1, labels=False):
+
+        """
+        Plot the triangles of a level with matplotlib.
+
+        @param level refinement level (-1 for the last level). The coarsest level is 1.
+        @param labels write the attributes of each triangle at its center (slow on large meshes)
+        @return the matplotlib.pyplot module
+        """
+        import numpy
         import matplotlib.pyplot as plt
-        from matplotlib.path import Path
-        import matplotlib.patches as patches
-        
-        mesh = self.get_triangles(level)
-        points = self.get_points(level)
+        from matplotlib.tri import Triangulation
 
-        verts = []
-        codes = []
- 
         fig, ax = plt.subplots()
-        
-        for _t in mesh:
-            #([n1, n2, n3], (), [regiona_tag])
-            p = _t[0]
-            x1,y1 = points[p[0]][0]
-            x2,y2 = points[p[1]][0]
-            x3,y3 = points[p[2]][0]
-
-            verts.append((x1, y1))
-            verts.append((x2, y2))
-            verts.append((x3, y3))
-            verts.append((x1, y1))
-            codes.append(Path.MOVETO)
-            codes.append(Path.LINETO)
-            codes.append(Path.LINETO)
-            codes.append(Path.CLOSEPOLY)
-            
-            ax.text((x1+x2+x3)/3, (y1+y2+y3)/3, str(_t[2]))
-        
-        path = Path(verts, codes)
+        arrays = self.get_mesh_arrays(level)
+        if arrays is None:
+            return plt
+        xy = numpy.frombuffer(arrays[0], dtype=arrays[0].typecode).reshape(-1, 2)
+        corners = numpy.frombuffer(arrays[1], dtype=numpy.intc).reshape(-1, 3)
+
+        # every edge once, drawn by a single artist
+        ax.triplot(Triangulation(xy[:, 0], xy[:, 1], corners), 'k-', lw=1)
+
+        if labels:
+            centers = xy[corners].mean(axis=1)
+            for (x, y), att in zip(centers, self.get_triangle_attributes(level)):
+                ax.text(x, y, str(att))
 
-        patch = patches.PathPatch(path, facecolor='None', lw=1)
-        ax.add_patch(patch)
         ax.margins(0.05)
         ax.axis('equal')
 
         return plt
-    
-
 
 
-    
-    
-    
+def triangulate_many(points, offsets, segments=None, seg_offsets=None, mode='pzQ', holes=None, hole_offsets=None):
+
+    """
+    Triangulate many small independent polygons (e.g. building footprints) in one call, all with the
+    same switches. The polygons are given in compressed sparse row form: polygon i has the points
+    offsets[i] to offsets[i + 1] (excluded), at least 3, of the flat coordinates x0, y0, x1, y1,...
+    and likewise for the segments (pairs of point indices numbered from zero within their polygon)
+    and the holes (x, y).
+
+    @param points flat coordinates of all the polygons (a list, array.array, numpy array,...)
+    @param offsets first point of each polygon, followed by the number of points
+    @param segments flat point indices i0, j0, i1, j1,... of the segments of all the polygons
+    @param seg_offsets first segment of each polygon, followed by the number of segments
+    @param mode a string of TRIANGLE switches, 'z' is added. Only the points and the triangles are
+                computed: the edges, neighbors, Voronoi diagram, refinement and regional switches
+                are ignored.
+    @param holes flat coordinates of the holes of all the polygons
+    @param hole_offsets first hole of each polygon, followed by the number of holes
+    @return (xy, point_offsets, triangles, triangle_offsets): arrays (array module) of the output
+    points of all the polygons and of the corners of their triangles, numbered from zero within
+    their polygon: the triangles of polygon i are triangles[3*triangle_offsets[i]:3*triangle_offsets[i + 1]]
+    and refer to the points xy[2*point_offsets[i]:2*point_offsets[i + 1]]
+    @note the polygons are triangulated in C with no Python object per polygon, by several threads
+          when triangulate is built with OpenMP
+    """
+    if mode.find('z') < 0:
+        mode += 'z'
+    return triangulate.triangulate_many(mode, points, offsets, segments, seg_offsets, holes, hole_offsets)
+
+
+def triangulate_tiles(points, segments, holes=None, tiles=4, area=None, mode='pzq27Q'):
+
+    """
+    Mesh a PSLG tile by tile, the tiles being meshed concurrently when triangulate is built with
+    OpenMP, and stitch the tiles into one mesh. The tiles are unions of the triangles of a coarse
+    mesh, whose edges between two tiles are split once for both, at the size of the area constraint:
+    with the 'Y' switch, no point is added on them and the tiles conform.
+
+    @param points flat coordinates x0, y0, x1, y1,... of the points (a list, array.array, numpy array,...)
+    @param segments flat point indices i0, j0, i1, j1,... of the segments, numbered from zero
+    @param holes flat coordinates of the holes
+    @param tiles number of tiles, balanced by recursive coordinate bisection, or (nx, ny) for the
+                 rectangles of a grid over the bounding box of the points (tile i + nx*j)
+    @param area maximum triangle area, which also sets the length of the pieces of the tile boundaries
+    @param mode a string of TRIANGLE switches, 'p', 'z' and 'Y' are added (see triangulate_many for
+                the switches that are ignored)
+    @return (xy, triangles, triangle_tiles): arrays (array module) of the points, of the corners of
+    the triangles (counterclockwise, numbered from zero) and of the tile of each triangle. The input
+    points come first, in their order, followed by the points added on the tile boundaries and
+    inside the tiles.
+    @note without area, the boundaries of the tiles are the edges of the coarse mesh, which no
+          switch refines
+    """
+    shared, tile_points, tile_segments, tile_holes, names = _tile_inputs(points, segments, holes,
+                                                                         tiles, area)
+    if area:
+        mode += 'a%.17f' % area
+    out = triangulate.triangulate_many(_tile_mode(mode), _gather(shared, tile_points),
+                                       tile_points[1], tile_segments[0], tile_segments[1],
+                                       tile_holes[0], tile_holes[1])
+    return _stitch(shared, tile_points, names, out)
+
+
+def triangulate_distributed(points, segments, holes=None, workers=4, tiles=None, area=None,
+                            mode='pzq27Q', prefix=None):
+
+    """
+    Mesh a PSLG tile by tile in worker processes, which receive their tiles and send their meshes
+    back through pipes, and stitch the tiles into one mesh as triangulate_tiles does. Worker w meshes
+    the tiles of a contiguous range of numbers, which are neighbors with recursive bisection.
+
+    @param points flat coordinates x0, y0, x1, y1,... of the points (a list, array.array, numpy array,...)
+    @param segments flat point indices i0, j0, i1, j1,... of the segments, numbered from zero
+    @param holes flat coordinates of the holes
+    @param workers number of worker processes, each being a partition of the mesh
+    @param tiles number of tiles (workers by default) or (nx, ny), see triangulate_tiles
+    @param area maximum triangle area
+    @param mode a string of TRIANGLE switches, see triangulate_tiles
+    @param prefix if given, the mesh of partition p is also written to prefix.p.node and prefix.p.ele
+                  (see _write_partitions), with a layer of ghost triangles
+    @return (xy, triangles, triangle_parts, report): the arrays of triangulate_tiles with the partition
+    of each triangle, and a dict of timings: 'workers' holds for each worker its 'tiles', 'points',
+    'triangles' and 'seconds' spent meshing, 'imbalance' is the largest of these times over their
+    mean, and 'partition_seconds', 'mesh_seconds' and 'merge_seconds' the wall times of the steps
+    @note the workers are started with 'spawn' (see Triangle.share). If one fails or dies, all are
+          stopped and a RuntimeError names it.
+    """
+    tic = time.perf_counter()
+    shared, tile_points, tile_segments, tile_holes, names = _tile_inputs(points, segments, holes,
+                                                                         tiles or workers, area)
+    if area:
+        mode += 'a%.17f' % area
+    mode = _tile_mode(mode)
+    xy = _gather(shared, tile_points)
+    ntiles = len(names)
+    ranges = [(w*ntiles//workers, (w + 1)*ntiles//workers) for w in range(workers)]
+    toc = time.perf_counter()
+    report = {'partition_seconds': toc - tic}
+
+    # one job per worker: its tiles in the form of triangulate_many
+    context = multiprocessing.get_context('spawn')
+    pipes, processes = [], []
+    for k0, k1 in ranges:
+        near, far = context.Pipe()
+        process = context.Process(target=_tile_worker, args=(far,))
+        process.start()
+        far.close()
+        p0, p1 = tile_points[1][k0], tile_points[1][k1]
+        s0, s1 = tile_segments[1][k0], tile_segments[1][k1]
+        h0, h1 = tile_holes[1][k0], tile_holes[1][k1]
+        near.send((mode, xy[2*p0:2*p1], [o - p0 for o in tile_points[1][k0:k1 + 1]],
+                   tile_segments[0][2*s0:2*s1], [o - s0 for o in tile_segments[1][k0:k1 + 1]],
+                   tile_holes[0][2*h0:2*h1], [o - h0 for o in tile_holes[1][k0:k1 + 1]]))
+        pipes.append(near)
+        processes.append(process)
+    results = []
+    try:
+        for w, near in enumerate(pipes):
+            try:
+                results.append(near.recv())
+            except (EOFError, OSError):
+                processes[w].join(timeout=1.)
+                raise RuntimeError('worker %d (tiles %s) died with exit code %s before sending its mesh'
+                                   % (w, names[ranges[w][0]:ranges[w][1]], processes[w].exitcode))
+    finally:
+        # the workers are stopped even if one failed, the others being killed
+        for near, process in zip(pipes, processes):
+            try:
+                near.send(None)
+            except OSError:
+                pass
+            near.close()
+            process.join(timeout=1. if len(results) < len(pipes) else None)
+            if process.is_alive():
+                process.terminate()
+                process.join()
+    for w, (out, seconds) in enumerate(results):
+        if isinstance(out, Exception):
+            raise RuntimeError('worker %d (tiles %s) failed: %s' % (w, names[ranges[w][0]:ranges[w][1]], str(out).strip())) from out
+    txy, point_offsets = array.array('d'), array.array('i', [0])
+    corners, triangle_offsets = array.array('i'), array.array('i', [0])
+    report['workers'] = []
+    for (k0, k1), ((wxy, wpoint_offsets, wcorners, wtriangle_offsets), seconds) in zip(ranges, results):
+        base = point_offsets[-1], triangle_offsets[-1]
+        txy.extend(wxy)
+        point_offsets.extend(base[0] + o for o in wpoint_offsets[1:])
+        corners.extend(wcorners)
+        triangle_offsets.extend(base[1] + o for o in wtriangle_offsets[1:])
+        report['workers'].append({'tiles': names[k0:k1], 'points': wpoint_offsets[-1],
+                                  'triangles': wtriangle_offsets[-1], 'seconds': seconds})
+    tic = time.perf_counter()
+    report['mesh_seconds'] = tic - toc
+    times = [r['seconds'] for r in report['workers']]
+    report['imbalance'] = max(times)*len(times)/sum(times) if sum(times) > 0. else 1.
+
+    # the partition of each triangle
+    xy, triangles, triangle_tiles = _stitch(shared, tile_points, names,
+                                            (txy, point_offsets, corners, triangle_offsets))
+    part = {}
+    for w, (k0, k1) in enumerate(ranges):
+        for name in names[k0:k1]:
+            part[name] = w
+    triangle_parts = array.array('i', [part[k] for k in triangle_tiles])
+    if prefix:
+        _write_partitions(prefix, xy, triangles, triangle_parts, workers)
+    report['merge_seconds'] = time.perf_counter() - tic
+    return xy, triangles, triangle_parts, report
+
+
+def _tile_worker(conn):
+    """
+    Worker process of triangulate_distributed: mesh the tiles received through conn, with the
+    arguments of triangulate_many, and send the mesh (or the exception raised) and the time spent
+    back, until None.
+    """
+    while True:
+        job = conn.recv()
+        if job is None:
+            break
+        tic = time.perf_counter()
+        try:
+            out = triangulate.triangulate_many(*job)
+        except Exception as error:
+            out = error
+        conn.send((out, time.perf_counter() - tic))
+    conn.close()
+
+
+def _write_partitions(prefix, xy, triangles, parts, nparts):
+    """
+    Write the mesh of each partition p to the files prefix.p.node and prefix.p.ele of Triangle, numbered
+    from zero (read them with triangulate.read_node and read_ele). The triangles of the partition come
+    first, followed by the ghost triangles, those of the other partitions with a point on its boundary;
+    every triangle has the partition it belongs to as attribute. The points of the triangles of the
+    partition come first, followed by the other points of the ghost triangles; every point has two
+    attributes, its number in the whole mesh and its owner, the lowest partition it is a point of,
+    and marker 0.
+    """
+    npts, ntri = len(xy)//2, len(parts)
+    owner = array.array('i', [nparts])*npts
+    for t in range(ntri):
+        for a in triangles[3*t:3*t + 3]:
+            owner[a] = min(owner[a], parts[t])
+    # the partitions of the points on the boundaries of the partitions
+    sharing = {}
+    for t in range(ntri):
+        for a in triangles[3*t:3*t + 3]:
+            if parts[t] != owner[a]:
+                sharing.setdefault(a, set([owner[a]])).add(parts[t])
+    own = [[] for p in range(nparts)]
+    ghosts = [set() for p in range(nparts)]
+    for t in range(ntri):
+        own[parts[t]].append(t)
+        for a in triangles[3*t:3*t + 3]:
+            for p in sharing.get(a, ()):
+                if p != parts[t]:
+                    ghosts[p].add(t)
+    for p in range(nparts):
+        tris = own[p] + sorted(ghosts[p])
+        local = {}
+        for t in tris:
+            for a in triangles[3*t:3*t + 3]:
+                if a not in local:
+                    local[a] = len(local)
+        h = triangulate.new()
+        triangulate.set_points(h, [(xy[2*a], xy[2*a + 1]) for a in local], [0]*len(local))
+        triangulate.set_point_attributes(h, [(a, owner[a]) for a in local])
+        triangulate.set_triangles(h, [tuple(local[a] for a in triangles[3*t:3*t + 3]) for t in tris])
+        triangulate.set_triangle_attributes(h, [(parts[t],) for t in tris])
+        triangulate.write_node(h, '%s.%d.node' % (prefix, p), 0)
+        triangulate.write_ele(h, '%s.%d.ele' % (prefix, p), 0)
+        triangulate.free(h)
+
+
+def _tile_mode(mode):
+    """
+    Switches of the tiles: keep the points of the tile boundaries, number from zero, no jettison.
+    """
+    mode = mode.replace('j', '')
+    for s in 'pzY':
+        if mode.find(s) < 0:
+            mode += s
+    return mode
+
+
+def _tile_inputs(points, segments, holes, tiles, area):
+    """
+    Split a PSLG into tiles. Return the coordinates of the points shared by the tiles (the input
+    points, the points of the coarse mesh on the tile boundaries and the points splitting them),
+    the global numbers of the points of each tile (flat array and offsets), and the segments (local
+    numbers) and the holes of each tile in the same form, and the number of each tile.
+    """
+    xy = array.array('d', points)
+    n = len(xy)//2
+    segs = array.array('i', segments)
+    hls = array.array('d', holes if holes is not None else [])
+    if n < 3:
+        raise ValueError('at least 3 points are required, got %d' % n)
+    xmin, xmax = min(xy[0::2]), max(xy[0::2])
+    ymin, ymax = min(xy[1::2]), max(xy[1::2])
+
+    # the coarse mesh, several triangles per tile. The segments are split beforehand to the size
+    # of its triangles, and not by triangulate (YY): their pieces are edges of the coarse mesh
+    ntiles = tiles if isinstance(tiles, int) else tiles[0]*tiles[1]
+    coarse_area = (xmax - xmin)*(ymax - ymin)/(32.*ntiles)
+    if area:
+        coarse_area = max(coarse_area, 4.*area)
+    cxy, constrained = _split(xy, segs, math.sqrt(4.*coarse_area/math.sqrt(3.)))
+    cxy, _, corners, _ = triangulate.triangulate_many('pzQYYq20a%.17f' % coarse_area, cxy, [0, len(cxy)//2],
+                                                      [k for e in constrained for k in e],
+                                                      [0, len(constrained)], hls, [0, len(hls)//2])
+    cxy[:2*n] = xy
+    constrained = set(constrained)
+    ntri = len(corners)//3
+    centers = [((cxy[2*a] + cxy[2*b] + cxy[2*c])/3., (cxy[2*a + 1] + cxy[2*b + 1] + cxy[2*c + 1])/3.)
+               for a, b, c in zip(corners[0::3], corners[1::3], corners[2::3])]
+
+    # the tile of each coarse triangle
+    tile_of = [0]*ntri
+    if isinstance(tiles, int):
+        weights = [abs((cxy[2*b] - cxy[2*a])*(cxy[2*c + 1] - cxy[2*a + 1]) -
+                       (cxy[2*b + 1] - cxy[2*a + 1])*(cxy[2*c] - cxy[2*a]))
+                   for a, b, c in zip(corners[0::3], corners[1::3], corners[2::3])]
+        _bisect(list(range(ntri)), centers, weights, 0, tiles, tile_of)
+    else:
+        nx, ny = tiles
+        dx, dy = (xmax - xmin)/nx or 1., (ymax - ymin)/ny or 1.
+        for t, (x, y) in enumerate(centers):
+            tile_of[t] = min(int((x - xmin)/dx), nx - 1) + nx*min(int((y - ymin)/dy), ny - 1)
+
+    # the edges of the coarse mesh: those between two tiles or on the boundary, and the segments
+    edges = {}
+    for t in range(ntri):
+        for k in range(3):
+            a, b = corners[3*t + (k + 1) % 3], corners[3*t + (k + 2) % 3]
+            edges.setdefault((a, b) if a < b else (b, a), []).append(t)
+
+    # the pieces of the tile boundaries and of the segments inside the tiles. The points of the
+    # coarse mesh on them and the points splitting them are numbered after the input points
+    shared = array.array('d', xy)
+    numbers = {}
+    def number(a):
+        if a < n:
+            return a
+        if a not in numbers:
+            numbers[a] = len(shared)//2
+            shared.extend(cxy[2*a:2*a + 2])
+        return numbers[a]
+    size = math.sqrt(4.*area/math.sqrt(3.)) if area else None
+    pieces = {}
+    members = {}
+    for e, ts in edges.items():
+        ks = set(tile_of[t] for t in ts)
+        a, b = e
+        if len(ts) == 2 and len(ks) == 1:
+            if e in constrained:
+                members.setdefault(tile_of[ts[0]], []).append(e)
+                pieces[e] = [number(a), number(b)]
+            continue
+        for k in ks:
+            members.setdefault(k, []).append(e)
+        m = int(math.ceil(math.hypot(cxy[2*b] - cxy[2*a], cxy[2*b + 1] - cxy[2*a + 1])/size)) if size else 1
+        chain = [number(a)]
+        for i in range(1, m):
+            chain.append(len(shared)//2)
+            shared.append(cxy[2*a] + (cxy[2*b] - cxy[2*a])*i/m)
+            shared.append(cxy[2*a + 1] + (cxy[2*b + 1] - cxy[2*a + 1])*i/m)
+        pieces[e] = chain + [number(b)]
+
+    # the triangles of each tile, and the holes: the user's holes in the bounding box of the tile,
+    # and a point of every other coarse triangle along its boundary, in case the tile encloses it
+    tris = {}
+    for t in range(ntri):
+        tris.setdefault(tile_of[t], []).append(t)
+    tile_points = (array.array('i'), array.array('i', [0]))
+    tile_segments = (array.array('i'), array.array('i', [0]))
+    tile_holes = (array.array('d'), array.array('i', [0]))
+    names = []
+    for k in sorted(tris):
+        local = {}
+        for t in tris[k]:
+            for a in corners[3*t:3*t + 3]:
+                if a < n and a not in local:
+                    local[a] = len(local)
+        for e in members.get(k, []):
+            chain = pieces[e]
+            for a in chain:
+                if a not in local:
+                    local[a] = len(local)
+            for a, b in zip(chain[:-1], chain[1:]):
+                tile_segments[0].append(local[a])
+                tile_segments[0].append(local[b])
+            for t in edges[e]:
+                if tile_of[t] != k:
+                    tile_holes[0].extend(centers[t])
+        ids = sorted(local, key=local.get)
+        xs = [shared[2*a] for a in ids]
+        ys = [shared[2*a + 1] for a in ids]
+        x0, x1, y0, y1 = min(xs), max(xs), min(ys), max(ys)
+        for x, y in zip(hls[0::2], hls[1::2]):
+            if x0 <= x <= x1 and y0 <= y <= y1:
+                tile_holes[0].extend((x, y))
+        tile_points[0].extend(ids)
+        tile_points[1].append(len(tile_points[0]))
+        tile_segments[1].append(len(tile_segments[0])//2)
+        tile_holes[1].append(len(tile_holes[0])//2)
+        names.append(k)
+    return shared, tile_points, tile_segments, tile_holes, names
+
+
+def _split(xy, segs, size):
+    """
+    Split segments into pieces no longer than size. Return the points followed by those added, and
+    the pieces (i, j), i < j.
+    """
+    xy = array.array('d', xy)
+    pieces = []
+    for a, b in zip(segs[0::2], segs[1::2]):
+        m = int(math.ceil(math.hypot(xy[2*b] - xy[2*a], xy[2*b + 1] - xy[2*a + 1])/size))
+        chain = [a]
+        for i in range(1, m):
+            chain.append(len(xy)//2)
+            xy.append(xy[2*a] + (xy[2*b] - xy[2*a])*i/m)
+            xy.append(xy[2*a + 1] + (xy[2*b + 1] - xy[2*a + 1])*i/m)
+        chain.append(b)
+        pieces.extend((i, j) if i < j else (j, i) for i, j in zip(chain[:-1], chain[1:]))
+    return xy, pieces
+
+
+def _bisect(triangles, centers, weights, first, parts, tile_of):
+    """
+    Split triangles into parts of about the same weight, numbered from first, by cutting their
+    centers across the longer side of their bounding box.
+    """
+    if parts == 1 or not triangles:
+        for t in triangles:
+            tile_of[t] = first
+        return
+    xs = [centers[t][0] for t in triangles]
+    ys = [centers[t][1] for t in triangles]
+    axis = 0 if max(xs) - min(xs) >= max(ys) - min(ys) else 1
+    triangles = sorted(triangles, key=lambda t: centers[t][axis])
+    left = parts//2
+    target = sum(weights[t] for t in triangles)*left/parts
+    total, cut = 0., 0
+    while cut < len(triangles) - 1 and total + weights[triangles[cut]] <= target:
+        total += weights[triangles[cut]]
+        cut += 1
+    _bisect(triangles[:cut], centers, weights, first, left, tile_of)
+    _bisect(triangles[cut:], centers, weights, first + left, parts - left, tile_of)
+
+
+def _gather(shared, tile_points):
+    """
+    Coordinates of the points of all the tiles.
+    """
+    return triangulate.gather_points(shared, tile_points[0])
+
+
+def _stitch(shared, tile_points, names, out):
+    """
+    Number the points of the meshes of the tiles (output of triangulate_many) globally: the points
+    of a tile boundary are numbered once, the points added inside a tile after the shared ones.
+    """
+    xy, triangles = triangulate.stitch_tiles(shared, tile_points[0], tile_points[1], *out)
+    triangle_offsets = out[3]
+    triangle_tiles = array.array('i')
+    for k, name in enumerate(names):
+        triangle_tiles.extend(array.array('i', [name])*(triangle_offsets[k + 1] - triangle_offsets[k]))
+    return xy, triangles, triangle_tiles
+
+
+def stream_delaunay(chunks, grid, out):
+
+    """
+    Delaunay triangulation of a point set too large for memory, streamed chunk by chunk, e.g. from a
+    file sorted by cells. The plane is covered by a grid of nx*ny cells; along with its points, each
+    chunk finalizes the cells that no later point falls into. Only the points near the cells still open
+    are kept: every step triangulates them, writes the triangles that can no longer change (their
+    circumcircle lies in finalized cells) and retires the points that have all their triangles written.
+
+    @param chunks iterable of (xy, cells), where xy is a flat array (array module, numpy,..) or sequence
+                  of the coordinates x0, y0, x1, y1,.. of the next points and cells the (i, j) indices of
+                  the cells finalized after them. The cells left are finalized after the last chunk.
+    @param grid (x0, y0, dx, dy, nx, ny): lower left corner of the grid, cell sizes and numbers of cells.
+                The points should lie in the grid, cell (i, j) holds x0 + i*dx <= x < x0 + (i + 1)*dx.
+    @param out binary file (or io.BytesIO,..) the triangles are written to, as 3 int64 numbers each: the
+               global numbers of their corners, that is the positions of the points in the stream
+               (from zero), counterclockwise
+    @return (number of points, number of triangles, largest number of points held at once)
+    @note the triangles are those of the Delaunay triangulation of all the points, written in no
+          particular order, provided no point falls into a cell finalized before. Of several points
+          at the same place, only one is a corner of triangles.
+    """
+    x0, y0, dx, dy, nx, ny = grid
+    grid = (float(x0), float(y0), float(dx), float(dy), int(nx), int(ny))
+    nx, ny = grid[4], grid[5]
+    final = bytearray(nx*ny)
+    xy, ids, front = array.array('d'), array.array('q'), array.array('i')
+    npoints, ntriangles, max_active = 0, 0, 0
+    for points, cells in chunks:
+        xy.extend(array.array('d', points))
+        n = len(xy)//2 - len(ids)
+        ids.extend(range(npoints, npoints + n))
+        npoints += n
+        for i, j in cells:
+            final[j*nx + i] = 1
+        max_active = max(max_active, len(ids))
+        if len(ids) >= 3:
+            xy, ids, front, ntri = _stream_delaunay_step(xy, ids, front, grid, final, out)
+            ntriangles += ntri
+    final[:] = b'\x01'*len(final)
+    if len(ids) >= 3:
+        xy, ids, front, ntri = _stream_delaunay_step(xy, ids, front, grid, final, out)
+        ntriangles += ntri
+    return npoints, ntriangles, max_active
+
+
+def _stream_delaunay_step(xy, ids, front, grid, final, out):
+    """
+    Triangulate the active points, write the final triangles and return the next active points.
+    """
+    h_in, h_out, h_vor = triangulate.new(), triangulate.new(), triangulate.new()
+    # relative to the first point in the float build
+    origin = (xy[0], xy[1]) if triangulate.real_size < 8 else (0., 0.)
+    triangulate.stream_points(h_in, xy, None, None, len(ids), origin)
+    triangulate.triangulate('zQn', h_in, h_out, h_vor)
+    triangles, xy, ids, front = triangulate.finalize_front(h_out, xy, ids, front, grid, final)
+    out.write(triangles)
+    return xy, ids, front, len(triangles)//3
+
+
+# the arrays of a file written by triangulate.save, in their order in the file: name, type
+# ('r' for REAL) and number of items given the header (see list_arrays in trianglemodule.c)
+_ARRAYS = [('points', 'r', lambda h: 2*h[0]),
+           ('point_attributes', 'r', lambda h: h[0]*h[1]),
+           ('point_markers', 'i', lambda h: h[0]),
+           ('triangles', 'i', lambda h: h[2]*h[3]),
+           ('triangle_attributes', 'r', lambda h: h[2]*h[4]),
+           ('triangle_areas', 'r', lambda h: h[2]),
+           ('neighbors', 'i', lambda h: 3*h[2]),
+           ('segments', 'i', lambda h: 2*h[5]),
+           ('segment_markers', 'i', lambda h: h[5]),
+           ('holes', 'r', lambda h: 2*h[6]),
+           ('regions', 'r', lambda h: 4*h[7]),
+           ('marker_areas', 'r', lambda h: 2*h[8]),
+           ('level_point_counts', 'i', lambda h: h[9]),
+           ('level_triangle_counts', 'i', lambda h: h[9]),
+           ('level_triangles', 'i', lambda h: 3*h[10]),
+           ('level_triangle_attributes', 'r', lambda h: h[10]*h[4]),
+           ('edges', 'i', lambda h: 2*h[11]),
+           ('edge_markers', 'i', lambda h: h[11]),
+           ('norms', 'r', lambda h: 2*h[11])]
+
+
+def load_arrays(filename):
+
+    """
+    Map a file written by triangulate.save (or Triangle.set_history) in memory and return its arrays
+    without reading or copying them.
+
+    @param filename file name
+    @return dict of the arrays held by the file, by name ('points', 'point_markers', 'triangles',
+    'neighbors', 'segments', 'holes',...), as flat memoryviews of the mapped file (e.g. for
+    numpy.frombuffer), of doubles or floats (see triangulate.real_size) and ints. The points are
+    x0, y0, x1, y1,... and the triangles list numberofcorners point indices each, as written by
+    triangulate (from 1 unless the mesh was built with the 'z' switch).
+    @note the mapping lives as long as the arrays. To refine a saved mesh, use
+          triangulate.load(h, filename, 1), which maps the file as well.
+    """
+    with open(filename, 'rb') as f:
+        data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    header = struct.unpack('=8s16i', data[:72])
+    magic, header = header[0], header[1:]
+    if magic[:5] != b'TRIIO' or magic[5] != 1 or header[14] != 0x01020304:
+        raise IOError('%s is not a triangulateio file (version 1) written on this platform' % filename)
+    real = 'd' if header[13] == 8 else 'f'
+    view = memoryview(data)
+    arrays = {}
+    offset = 72
+    for k, (name, typecode, count) in enumerate(_ARRAYS):
+        if not header[12] & (1 << k):
+            continue
+        typecode = real if typecode == 'r' else 'i'
+        size = count(header)*struct.calcsize(typecode)
+        arrays[name] = view[offset:offset + size].cast(typecode)
+        offset += size + (8 - size % 8) % 8
+    return arrays